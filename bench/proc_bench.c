@@ -0,0 +1,190 @@
+/*
+ * proc_bench: benchmark of /proc files parsers used by pgcenter.
+ * Parsers read synthetic files of a large host (128 cpus, 600 block devices,
+ * 64 interfaces), so results don't depend on the host where bench is run.
+ * Run with "make bench".
+ */
+
+#define main pgcenter_main
+#include "../pgcenter.c"
+#undef main
+
+#define BENCH_CPUS          128
+#define BENCH_DEVICES       600
+#define BENCH_INTERFACES    64
+#define BENCH_LOOPS         20000
+
+/*
+ ********************************************************** bench function **
+ * Pseudo-random counter value, sequence is the same in all runs.
+ ****************************************************************************
+ */
+unsigned long long bench_value(void)
+{
+    static unsigned long long state = 88172645463325252ULL;
+
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state % 10000000000ULL;
+}
+
+/*
+ ********************************************************** bench function **
+ * Create synthetic /proc file in directory.
+ *
+ * IN:
+ * @dir             Directory for files.
+ * @file            Index of file in proc_files[], its path is replaced.
+ * @name            Name of file.
+ *
+ * RETURNS:
+ * Opened file.
+ ****************************************************************************
+ */
+FILE * bench_open(const char * dir, enum proc_file file, const char * name)
+{
+    static char paths[TOTAL_PROC_FILES][PATH_MAX];
+    FILE * fp;
+
+    snprintf(paths[file], PATH_MAX, "%s/%s", dir, name);
+    if ((fp = fopen(paths[file], "w")) == NULL) {
+        fprintf(stderr, "can't create %s: %s\n", paths[file], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    proc_files[file].path = paths[file];
+    return fp;
+}
+
+/*
+ ********************************************************** bench function **
+ * Write synthetic stat, meminfo, diskstats and net/dev files and point
+ * parsers to them.
+ *
+ * IN:
+ * @dir             Directory for files.
+ ****************************************************************************
+ */
+void bench_write_files(const char * dir)
+{
+    const char * meminfo[] = {
+        "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "SwapCached",
+        "Active", "Inactive", "Active(anon)", "Inactive(anon)", "Active(file)",
+        "Inactive(file)", "Unevictable", "Mlocked", "SwapTotal", "SwapFree",
+        "Dirty", "Writeback", "AnonPages", "Mapped", "Shmem", "KReclaimable",
+        "Slab", "SReclaimable", "SUnreclaim", "KernelStack", "PageTables",
+        "NFS_Unstable", "Bounce", "WritebackTmp", "CommitLimit", "Committed_AS",
+        "VmallocTotal", "VmallocUsed", "VmallocChunk", "Percpu", "HardwareCorrupted",
+        "AnonHugePages", "ShmemHugePages", "ShmemPmdMapped", "FileHugePages",
+        "FilePmdMapped", "HugePages_Total", "HugePages_Free", "HugePages_Rsvd",
+        "HugePages_Surp", "Hugepagesize", "Hugetlb", "DirectMap4k", "DirectMap2M",
+        "DirectMap1G"
+    };
+    unsigned int i, j;
+    FILE * fp;
+
+    fp = bench_open(dir, proc_stat, "stat");
+    for (i = 0; i <= BENCH_CPUS; i++) {
+        if (i == 0)
+            fprintf(fp, "cpu ");
+        else
+            fprintf(fp, "cpu%u", i - 1);
+        for (j = 0; j < 10; j++)
+            fprintf(fp, " %llu", bench_value());
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "intr 123");
+    for (i = 0; i < 512; i++)
+        fprintf(fp, " 0");
+    fprintf(fp, "\nctxt 9999\nbtime 1\nprocesses 5\nprocs_running 1\nprocs_blocked 0\nsoftirq 1 2 3\n");
+    fclose(fp);
+
+    fp = bench_open(dir, proc_meminfo, "meminfo");
+    for (i = 0; i < ARRAY_SIZE(meminfo); i++)
+        fprintf(fp, "%-15s %10llu kB\n", meminfo[i], bench_value() / 1000);
+    fclose(fp);
+
+    fp = bench_open(dir, proc_diskstats, "diskstats");
+    for (i = 0; i < BENCH_DEVICES; i++) {
+        fprintf(fp, " 259 %7u nvme%un%u", i, i / 8, i % 8);
+        for (j = 0; j < 17; j++)
+            fprintf(fp, " %llu", bench_value());
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+
+    fp = bench_open(dir, proc_netdev, "dev");
+    fprintf(fp, "Inter-|   Receive                                                |  Transmit\n");
+    fprintf(fp, " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n");
+    for (i = 0; i < BENCH_INTERFACES; i++) {
+        fprintf(fp, "%6s%u:", "eth", i);
+        for (j = 0; j < 16; j++)
+            fprintf(fp, " %llu", bench_value());
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+}
+
+/*
+ ********************************************************** bench function **
+ * Monotonic time in nanoseconds.
+ ****************************************************************************
+ */
+double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    static struct cpu_s st_cpu[BENCH_CPUS + 1];
+    static struct iodata_s ios[BENCH_DEVICES], * c_ios[BENCH_DEVICES];
+    static struct nicdata_s nicd[BENCH_INTERFACES], * c_nicd[BENCH_INTERFACES];
+    struct mem_s st_mem;
+    unsigned long long uptime = 0, uptime0 = 0;
+    unsigned int i, n;
+    char dir[] = "/tmp/proc_bench.XXXXXX";
+    double t, spent[4] = { 0 };
+
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "can't create temporary directory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    bench_write_files(dir);
+    for (i = 0; i < BENCH_DEVICES; i++)
+        c_ios[i] = &ios[i];
+    for (i = 0; i < BENCH_INTERFACES; i++)
+        c_nicd[i] = &nicd[i];
+
+    for (i = 0; i < BENCH_LOOPS; i++) {
+        t = bench_now();
+        uptime0 = 1;
+        read_cpu_stat(st_cpu, BENCH_CPUS + 1, &uptime, &uptime0);
+        spent[0] += bench_now() - t;
+
+        t = bench_now();
+        read_mem_stat(&st_mem);
+        spent[1] += bench_now() - t;
+
+        t = bench_now();
+        read_diskstats(c_ios, BENCH_DEVICES, &n);
+        spent[2] += bench_now() - t;
+
+        t = bench_now();
+        read_netdev(c_nicd, BENCH_INTERFACES, &n);
+        spent[3] += bench_now() - t;
+    }
+
+    printf("%u loops, usec per read: stat %.1f, meminfo %.1f, diskstats %.1f, net/dev %.1f\n",
+            BENCH_LOOPS, spent[0] / BENCH_LOOPS / 1000, spent[1] / BENCH_LOOPS / 1000,
+            spent[2] / BENCH_LOOPS / 1000, spent[3] / BENCH_LOOPS / 1000);
+
+    for (i = 0; i < TOTAL_PROC_FILES; i++)
+        if (proc_files[i].path != NULL && strncmp(proc_files[i].path, dir, strlen(dir)) == 0)
+            unlink(proc_files[i].path);
+    rmdir(dir);
+    return EXIT_SUCCESS;
+}
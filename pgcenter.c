@@ -5,6 +5,7 @@
 
 #define _GNU_SOURCE
 #include <ctype.h>
+#include <endian.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
@@ -18,12 +19,18 @@
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -31,6 +38,9 @@
 #include <termios.h>
 #include <time.h>
 #include <unistd.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 #include "libpq-fe.h"
 #include "pgcenter.h"
 #include "qstats.h"
@@ -44,7 +54,8 @@ void print_usage(void)
 {
     printf("%s is the admin console for PostgreSQL.\n\n", PROGRAM_NAME);
     printf("Usage:\n \
-  %s [OPTION]... [DBNAME [USERNAME]]\n\n", PROGRAM_NAME);
+  %s [OPTION]... [DBNAME [USERNAME]]\n \
+  %s report -R FILENAME --context=NAME [REPORT OPTION]...\n\n", PROGRAM_NAME, PROGRAM_NAME);
     printf("General options:\n \
   -?, --help                show this help, then exit.\n \
   -V, --version             print version, then exit.\n\n");
@@ -55,7 +66,19 @@ void print_usage(void)
   -d, --dbname=DBNAME       database name (default: \"current user\")\n \
   -f, --file=FILENAME       conninfo file (default: \"~/.pgcenterrc\")\n \
   -w, --no-password         never prompt for password\n \
-  -W, --password            force password prompt (should happen automatically)\n\n");
+  -W, --password            force password prompt (should happen automatically)\n \
+  -b, --binary              fetch query results in binary format\n \
+  -r, --record=FILENAME     record stats into file without interactive console\n \
+  -R, --replay=FILENAME     replay stats recorded into file\n \
+  --format=FORMAT           output format: ncurses (default), csv or json\n \
+  --output=FILENAME         write csv or json output into file (default: stdout)\n \
+  --listen=[ADDR:]PORT      serve metrics over http without interactive console\n\n");
+    printf("Report options:\n \
+  --from=TIME               start of time window (default: start of file)\n \
+  --to=TIME                 end of time window (default: end of file)\n \
+  --context=NAME            context, iostat or nicstat\n \
+  --order=COLUMN[,...]      order columns, top rows are printed for each of them\n \
+  --limit=N                 number of top rows (default: %d)\n\n", REPORT_DEFAULT_LIMIT);
     printf("Report bugs to %s.\n", PROGRAM_ISSUES_URL);
 
     exit(EXIT_SUCCESS);
@@ -71,8 +94,14 @@ void print_usage(void)
  */
 void sig_handler(int signo)
 {
+    /* recording loop finishes current frame and exits */
+    if (headless) {
+        stop_requested = 1;
+        return;
+    }
+
     switch (signo) {
-        default: case SIGINT:
+        default: case SIGINT: case SIGTERM:
             endwin();
             exit(EXIT_SUCCESS);
             break;
@@ -89,6 +118,9 @@ void init_signal_handlers(void)
     if (signal(SIGINT, sig_handler) == SIG_ERR) {
         mreport(true, msg_fatal, "FATAL: failed to establish SIGINT handler.\n");
     }
+    if (signal(SIGTERM, sig_handler) == SIG_ERR) {
+        mreport(true, msg_fatal, "FATAL: failed to establish SIGTERM handler.\n");
+    }
 }
 
 /*
@@ -101,7 +133,13 @@ void init_signal_handlers(void)
  */
 bool key_is_pressed(void)
 {
-    int ch = getch();
+    int ch;
+
+    /* there is no terminal in headless mode */
+    if (headless)
+        return false;
+
+    ch = getch();
 
     if (ch != ERR) {
         ungetch(ch);
@@ -212,15 +250,15 @@ int check_string(const char * string, enum chk_type ctype)
  * String comparison function for qsort (descending order).
  *
  * IN: 
- * @a, @b       Array elements.
- * @arg         Order key.
+ * @a, @b       Snapshot rows numbers.
+ * @arg         Snapshot and order key.
  ****************************************************************************
  */
 int str_cmp_desc(const void * a, const void * b, void * arg)
 {
-    int *key = (int *) arg;
-    const char *pa = ((const char ***) a)[0][*key];
-    const char *pb = ((const char ***) b)[0][*key];
+    struct sort_key_s *key = (struct sort_key_s *) arg;
+    const char *pa = SNAPSHOT_VALUE(key->snap, *(const unsigned int *) a, key->key);
+    const char *pb = SNAPSHOT_VALUE(key->snap, *(const unsigned int *) b, key->key);
 
     return -strcmp(pa, pb);
 }
@@ -230,53 +268,53 @@ int str_cmp_desc(const void * a, const void * b, void * arg)
  * String comparison function for qsort (ascending order).
  *
  * IN: 
- * @a, @b       Array elements.
- * @arg         Order key.
+ * @a, @b       Snapshot rows numbers.
+ * @arg         Snapshot and order key.
  ****************************************************************************
  */
 int str_cmp_asc(const void * a, const void * b, void * arg)
 {
-    int *key = (int *) arg;
-    const char *pa = ((const char ***) a)[0][*key];
-    const char *pb = ((const char ***) b)[0][*key];
+    struct sort_key_s *key = (struct sort_key_s *) arg;
+    const char *pa = SNAPSHOT_VALUE(key->snap, *(const unsigned int *) a, key->key);
+    const char *pb = SNAPSHOT_VALUE(key->snap, *(const unsigned int *) b, key->key);
 
     return strcmp(pa, pb);
 }
 
 /*
  ******************************************************** routine function **
- * Integer comparison function for qsort (descending order).
+ * Number comparison function for qsort (descending order).
  *
  * IN: 
- * @a, @b       Array elements.
- * @arg         Order key.
+ * @a, @b       Snapshot rows numbers.
+ * @arg         Snapshot and order key.
  ****************************************************************************
  */
-int int_cmp_desc(const void * a, const void * b, void * arg)
+int num_cmp_desc(const void * a, const void * b, void * arg)
 {
-    int *key = (int *) arg;
-    const char *ia = ((const char ***) a)[0][*key];
-    const char *ib = ((const char ***) b)[0][*key];
+    struct sort_key_s *key = (struct sort_key_s *) arg;
+    double na = key->values[*(const unsigned int *) a];
+    double nb = key->values[*(const unsigned int *) b];
 
-    return atoll(ib) - atoll(ia);
+    return (nb > na) - (nb < na);
 }
 
 /*
  ******************************************************** routine function **
- * Integer comparison function for qsort (ascending order).
+ * Number comparison function for qsort (ascending order).
  *
  * IN: 
- * @a, @b       Array elements.
- * @arg         Order key.
+ * @a, @b       Snapshot rows numbers.
+ * @arg         Snapshot and order key.
  ****************************************************************************
  */
-int int_cmp_asc(const void * a, const void * b, void * arg)
+int num_cmp_asc(const void * a, const void * b, void * arg)
 {
-    int *key = (int *) arg;
-    const char *ia = ((const char ***) a)[0][*key];
-    const char *ib = ((const char ***) b)[0][*key];
+    struct sort_key_s *key = (struct sort_key_s *) arg;
+    double na = key->values[*(const unsigned int *) a];
+    double nb = key->values[*(const unsigned int *) b];
 
-    return atoll(ia) - atoll(ib);
+    return (na > nb) - (na < nb);
 }
 
 /*
@@ -297,88 +335,168 @@ struct args_s * init_args_mem(void) {
 
 /*
  *********************************************************** init function **
- * Allocate memory for screens options struct array.
+ * Allocate memory for screens registry and connections array.
+ *
+ * OUT:
+ * @screens    Initialized array of screens options, terminated by NULL.
+ * @conns      Array of connections, not opened yet.
+ ****************************************************************************
+ */
+void init_screens(struct screen_s ** screens[], PGconn ** conns[])
+{
+    *screens = NULL;
+    *conns = NULL;
+    grow_screens(screens, conns, SCREENS_INIT);
+}
+
+/*
+ ******************************************************** routine function **
+ * Get number of screens in the registry.
+ *
+ * IN:
+ * @screens    Array of screens options, terminated by NULL.
+ *
+ * RETURNS:
+ * Number of allocated screens, used or not.
+ ****************************************************************************
+ */
+unsigned int count_screens(struct screen_s * screens[])
+{
+    unsigned int i = 0;
+
+    while (screens[i] != NULL)
+        i++;
+    return i;
+}
+
+/*
+ *********************************************************** init function **
+ * Grow screens registry and connections array. Screens are kept small until
+ * they are viewed, their contexts and snapshots are allocated on first view.
+ *
+ * IN:
+ * @size       New number of screens.
  *
  * OUT:
- * @screen_s   Initialized array of screens options.
+ * @screens    Array of screens options, terminated by NULL.
+ * @conns      Array of connections, new connections aren't opened.
  ****************************************************************************
  */
-void init_screens(struct screen_s *screens[])
+void grow_screens(struct screen_s ** screens[], PGconn ** conns[], unsigned int size)
 {
-    unsigned int i, j, k;       /* all are iterators */
-    for (i = 0; i < MAX_SCREEN; i++) {
-        if ((screens[i] = (struct screen_s *) malloc(SCREEN_SIZE)) == NULL) {
+    unsigned int i, n = (*screens == NULL) ? 0 : count_screens(*screens);
+
+    if (size <= n)
+        return;
+
+    if ((*screens = realloc(*screens, (size + 1) * sizeof(struct screen_s *))) == NULL
+            || (*conns = realloc(*conns, size * sizeof(PGconn *))) == NULL) {
+        mreport(true, msg_fatal, "FATAL: realloc() for screens failed.\n");
+    }
+
+    for (i = n; i < size; i++) {
+        if (((*screens)[i] = (struct screen_s *) malloc(SCREEN_SIZE)) == NULL) {
             mreport(true, msg_fatal, "FATAL: malloc() for screens failed.\n");
         }
-        memset(screens[i], 0, SCREEN_SIZE);
-        screens[i]->screen = i;
-        screens[i]->conn_used = false;
-        screens[i]->host[0] = '\0';
-        screens[i]->port[0] = '\0';
-        screens[i]->user[0] = '\0';
-        screens[i]->dbname[0] = '\0';
-        screens[i]->password[0] = '\0';
-        screens[i]->conninfo[0] = '\0';
-        screens[i]->subscreen_enabled = false;
-        screens[i]->subscreen = SUBSCREEN_NONE;
-        screens[i]->log_path[0] = '\0';
-        screens[i]->current_context = DEFAULT_QUERY_CONTEXT;
-        snprintf(screens[i]->pg_stat_activity_min_age, XS_BUF_LEN, "%s", PG_STAT_ACTIVITY_MIN_AGE_DEFAULT);
-        screens[i]->signal_options = 0;
-        screens[i]->pg_stat_sys = false;
-
-        for (j = 0; j < TOTAL_CONTEXTS; j++) {
-            switch (j) {
-                case 0:
-                    screens[i]->context_list[j].context = pg_stat_database;
-                    break;
-                case 1:
-                    screens[i]->context_list[j].context = pg_stat_replication;
-                    break;
-                case 2:
-                    screens[i]->context_list[j].context = pg_stat_tables;
-                    break;
-                case 3:
-                    screens[i]->context_list[j].context = pg_stat_indexes;
-                    break;
-                case 4:
-                    screens[i]->context_list[j].context = pg_statio_tables;
-                    break;
-                case 5:
-                    screens[i]->context_list[j].context = pg_tables_size;
-                    break;
-                case 6:
-                    screens[i]->context_list[j].context = pg_stat_activity_long;
-                    break;
-                case 7:
-                    screens[i]->context_list[j].context = pg_stat_functions;
-                    break;
-                case 8:
-                    screens[i]->context_list[j].context = pg_stat_statements_timing;
-                    break;
-                case 9:
-                    screens[i]->context_list[j].context = pg_stat_statements_general;
-                    break;
-                case 10:
-                    screens[i]->context_list[j].context = pg_stat_statements_io;
-                    break;
-                case 11:
-                    screens[i]->context_list[j].context = pg_stat_statements_temp;
-                    break;
-                case 12:
-                    screens[i]->context_list[j].context = pg_stat_statements_local;
-                    break;
-                case 13:
-                    screens[i]->context_list[j].context = pg_stat_progress_vacuum;
-                    break;
-            }
-            /* initiate sorting */
-            screens[i]->context_list[j].order_key = 0;
-            screens[i]->context_list[j].order_desc = true;
-            /* create empty array for filtration patterns */
-            for (k = 0; k < MAX_COLS; k++)
-                screens[i]->context_list[j].fstrings[k][0] = '\0';
+        memset((*screens)[i], 0, SCREEN_SIZE);
+        (*screens)[i]->screen = i;
+        (*screens)[i]->conn_used = false;
+        (*screens)[i]->subscreen_enabled = false;
+        (*screens)[i]->subscreen = SUBSCREEN_NONE;
+        (*screens)[i]->current_context = DEFAULT_QUERY_CONTEXT;
+        snprintf((*screens)[i]->pg_stat_activity_min_age, XS_BUF_LEN, "%s", PG_STAT_ACTIVITY_MIN_AGE_DEFAULT);
+        (*screens)[i]->signal_options = 0;
+        (*screens)[i]->pg_stat_sys = false;
+        (*screens)[i]->context_list = NULL;
+        (*screens)[i]->p_snap = NULL;
+        (*screens)[i]->c_snap = NULL;
+        (*screens)[i]->sampled = false;
+        (*screens)[i]->query_sent = false;
+        (*conns)[i] = NULL;
+    }
+    (*screens)[size] = NULL;
+}
+
+/*
+ *********************************************************** init function **
+ * Allocate contexts and snapshots of the screen when it's viewed first time.
+ *
+ * IN:
+ * @screen     Screen which is going to be viewed.
+ ****************************************************************************
+ */
+void activate_screen(struct screen_s * screen)
+{
+    unsigned int j, k;          /* all are iterators */
+
+    if (screen->p_snap == NULL)
+        screen->p_snap = init_snapshot();
+    if (screen->c_snap == NULL)
+        screen->c_snap = init_snapshot();
+    if (screen->context_list != NULL)
+        return;
+
+    if ((screen->context_list = (struct context_s *) malloc(CONTEXT_SIZE * TOTAL_CONTEXTS)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc() for contexts failed.\n");
+    }
+
+    for (j = 0; j < TOTAL_CONTEXTS; j++) {
+        switch (j) {
+            case 0:
+                screen->context_list[j].context = pg_stat_database;
+                break;
+            case 1:
+                screen->context_list[j].context = pg_stat_replication;
+                break;
+            case 2:
+                screen->context_list[j].context = pg_stat_tables;
+                break;
+            case 3:
+                screen->context_list[j].context = pg_stat_indexes;
+                break;
+            case 4:
+                screen->context_list[j].context = pg_statio_tables;
+                break;
+            case 5:
+                screen->context_list[j].context = pg_tables_size;
+                break;
+            case 6:
+                screen->context_list[j].context = pg_stat_activity_long;
+                break;
+            case 7:
+                screen->context_list[j].context = pg_stat_functions;
+                break;
+            case 8:
+                screen->context_list[j].context = pg_stat_statements_timing;
+                break;
+            case 9:
+                screen->context_list[j].context = pg_stat_statements_general;
+                break;
+            case 10:
+                screen->context_list[j].context = pg_stat_statements_io;
+                break;
+            case 11:
+                screen->context_list[j].context = pg_stat_statements_temp;
+                break;
+            case 12:
+                screen->context_list[j].context = pg_stat_statements_local;
+                break;
+            case 13:
+                screen->context_list[j].context = pg_stat_progress_vacuum;
+                break;
+            case 14:
+                screen->context_list[j].context = pg_stat_backends;
+                break;
+            case 15:
+                screen->context_list[j].context = pg_fleet;
+                break;
         }
+        /* initiate sorting */
+        screen->context_list[j].order_key = 0;
+        screen->context_list[j].order_desc = true;
+        /* create empty array for filtration patterns */
+        for (k = 0; k < MAX_COLS; k++)
+            screen->context_list[j].fstrings[k][0] = '\0';
     }
 }
 
@@ -443,6 +561,18 @@ void init_args_struct(struct args_s *args)
     args->user[0] = '\0';
     args->dbname[0] = '\0';
     args->need_passwd = false;                      /* by default password not need */
+    args->binary_results = false;                   /* by default results are fetched as text */
+    args->record_file[0] = '\0';                     /* by default interactive console is started */
+    args->replay_file[0] = '\0';                     /* replay is started only when file is specified */
+    args->report = false;
+    args->report_from[0] = '\0';                     /* by default report covers whole file */
+    args->report_to[0] = '\0';
+    args->report_context[0] = '\0';
+    args->report_order[0] = '\0';                    /* by default context sort order is used */
+    args->report_limit = REPORT_DEFAULT_LIMIT;
+    snprintf(args->output_format, sizeof(args->output_format), "ncurses");
+    args->output_file[0] = '\0';                     /* csv and json are written into stdout */
+    args->listen[0] = '\0';                          /* metrics endpoint is started only when address is specified */
 }
 
 /*
@@ -478,11 +608,14 @@ void arg_parse(int argc, char *argv[], struct args_s *args)
     int param, option_index;
 
     /* short options */
-    const char * short_options = "f:h:p:U:d:wW?";
+    const char * short_options = "bf:h:p:U:d:r:R:wW?";
 
     /* long options */
     const struct option long_options[] = {
         {"help", no_argument, NULL, '?'},
+        {"binary", no_argument, NULL, 'b'},
+        {"record", required_argument, NULL, 'r'},
+        {"replay", required_argument, NULL, 'R'},
         {"file", required_argument, NULL, 'f'},
         {"host", required_argument, NULL, 'h'},
         {"port", required_argument, NULL, 'p'},
@@ -490,8 +623,17 @@ void arg_parse(int argc, char *argv[], struct args_s *args)
         {"no-password", no_argument, NULL, 'w'},
         {"password", no_argument, NULL, 'W'},
         {"user", required_argument, NULL, 'U'},
+        {"from", required_argument, NULL, OPT_FROM},
+        {"to", required_argument, NULL, OPT_TO},
+        {"context", required_argument, NULL, OPT_CONTEXT},
+        {"order", required_argument, NULL, OPT_ORDER},
+        {"limit", required_argument, NULL, OPT_LIMIT},
+        {"format", required_argument, NULL, OPT_FORMAT},
+        {"output", required_argument, NULL, OPT_OUTPUT},
+        {"listen", required_argument, NULL, OPT_LISTEN},
         {NULL, 0, NULL, 0}
     };
+    bool report_opts = false;
 
     if (argc > 1) {
         if ((strcmp(argv[1], "-?") == 0) || (argc == 2 && (strcmp(argv[1], "--help") == 0))) {
@@ -500,6 +642,11 @@ void arg_parse(int argc, char *argv[], struct args_s *args)
         if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0) {
             mreport(true, msg_notice, "%s %.1f.%d\n", PROGRAM_NAME, PROGRAM_VERSION, PROGRAM_RELEASE);
         }
+        /* report is a command, its options follow it */
+        if (strcmp(argv[1], "report") == 0) {
+            args->report = true;
+            optind = 2;
+        }
     }
     
     while ( (param = getopt_long(argc, argv,
@@ -532,12 +679,63 @@ void arg_parse(int argc, char *argv[], struct args_s *args)
             case 'W':
                 args->need_passwd = true;
                 break;
+            case 'b':
+                args->binary_results = true;
+                break;
+            case 'r':
+                snprintf(args->record_file, sizeof(args->record_file), "%s", optarg);
+                break;
+            case 'R':
+                snprintf(args->replay_file, sizeof(args->replay_file), "%s", optarg);
+                break;
+            case OPT_FROM:
+                snprintf(args->report_from, sizeof(args->report_from), "%s", optarg);
+                report_opts = true;
+                break;
+            case OPT_TO:
+                snprintf(args->report_to, sizeof(args->report_to), "%s", optarg);
+                report_opts = true;
+                break;
+            case OPT_CONTEXT:
+                snprintf(args->report_context, sizeof(args->report_context), "%s", optarg);
+                report_opts = true;
+                break;
+            case OPT_ORDER:
+                snprintf(args->report_order, sizeof(args->report_order), "%s", optarg);
+                report_opts = true;
+                break;
+            case OPT_LIMIT:
+                if (check_string(optarg, is_number) == -1 || atoi(optarg) < 1) {
+                    mreport(true, msg_fatal, "Invalid report limit: %s.\n", optarg);
+                }
+                args->report_limit = atoi(optarg);
+                report_opts = true;
+                break;
+            case OPT_FORMAT:
+                if (strcmp(optarg, "ncurses") != 0 && strcmp(optarg, "csv") != 0 && strcmp(optarg, "json") != 0) {
+                    mreport(true, msg_fatal, "Invalid output format: %s, use ncurses, csv or json.\n", optarg);
+                }
+                snprintf(args->output_format, sizeof(args->output_format), "%s", optarg);
+                break;
+            case OPT_OUTPUT:
+                snprintf(args->output_file, sizeof(args->output_file), "%s", optarg);
+                break;
+            case OPT_LISTEN:
+                snprintf(args->listen, sizeof(args->listen), "%s", optarg);
+                break;
             case '?': default:
                 mreport(true, msg_fatal, "Try \"%s --help\" for more information.\n", argv[0]);
                 break;
         }
     }
 
+    if (report_opts && args->report == false) {
+        mreport(true, msg_fatal, "Options --from, --to, --context, --order and --limit are used only with report command.\n");
+    }
+    if (args->report && (strlen(args->replay_file) == 0 || strlen(args->report_context) == 0)) {
+        mreport(true, msg_fatal, "Report command requires --replay and --context options.\n");
+    }
+
     /* handle extra parameters if they're exist, first - dbname, second - user, others - ignore */
     while (argc - optind >= 1) {
         if ( (argc - optind > 1)
@@ -647,10 +845,12 @@ void create_initial_conn(struct args_s * args, struct screen_s * screens[])
  * @pos             Start position in array.
  *
  * OUT:
- * @screens         Connections options array.
+ * @screens         Connections options array, grows when file has many entries.
+ * @conns           Connections array, grows together with screens.
  ****************************************************************************
  */
-unsigned int create_pgcenterrc_conn(struct args_s * args, struct screen_s * screens[], unsigned int pos)
+unsigned int create_pgcenterrc_conn(struct args_s * args, struct screen_s ** screens[],
+                PGconn ** conns[], unsigned int pos)
 {
     FILE *fp;
     static char pgcenterrc_path[PATH_MAX];
@@ -678,17 +878,20 @@ unsigned int create_pgcenterrc_conn(struct args_s * args, struct screen_s * scre
 
     /* read connections settings from .pgcenterrc */
     if ((fp = fopen(pgcenterrc_path, "r")) != NULL) {
-        while ((fgets(strbuf, XL_BUF_LEN, fp) != 0) && (i < MAX_SCREEN)) {
+        while (fgets(strbuf, XL_BUF_LEN, fp) != 0) {
+            /* registry is doubled, so hundreds of entries need a few reallocs */
+            if ((*screens)[i] == NULL)
+                grow_screens(screens, conns, i * 2);
             sscanf(strbuf, "%[^:]:%[^:]:%[^:]:%[^:]:%[^:\n]",
-                        screens[i]->host,	screens[i]->port,
-                        screens[i]->dbname,	screens[i]->user,
-                        screens[i]->password);
-                        screens[i]->screen = i;
-                        screens[i]->conn_used = true;
-            check_portnum(screens[i]->port);
+                        (*screens)[i]->host,	(*screens)[i]->port,
+                        (*screens)[i]->dbname,	(*screens)[i]->user,
+                        (*screens)[i]->password);
+                        (*screens)[i]->screen = i;
+                        (*screens)[i]->conn_used = true;
+            check_portnum((*screens)[i]->port);
             /* if "null" read from file, than we should connecting through unix socket */
-            if (!strcmp(screens[i]->host, "(null)")) {
-                screens[i]->host[0] = '\0';
+            if (!strcmp((*screens)[i]->host, "(null)")) {
+                (*screens)[i]->host[0] = '\0';
             }
             i++;
         }
@@ -715,6 +918,8 @@ void reconnect_if_failed(WINDOW * window, PGconn * conn, struct screen_s * scree
     if (PQstatus(conn) == CONNECTION_BAD) {
         wclear(window);
         PQreset(conn);
+        /* prepared queries don't survive reconnect */
+        screen->pg_special.prepared = 0;
         wprintw(window, "The connection to the server was lost. Attempting reconnect.");
         wrefresh(window);
         /* reset previous query results after reconnect */
@@ -741,7 +946,7 @@ void reconnect_if_failed(WINDOW * window, PGconn * conn, struct screen_s * scree
 void prepare_conninfo(struct screen_s * screens[])
 {
     unsigned int i;
-    for ( i = 0; i < MAX_SCREEN; i++ ) {
+    for ( i = 0; screens[i] != NULL; i++ ) {
         if (screens[i]->conn_used) {
             if (strlen(screens[i]->host) != 0) {
 		snprintf(screens[i]->conninfo + strlen(screens[i]->conninfo),
@@ -770,7 +975,9 @@ void prepare_conninfo(struct screen_s * screens[])
 
 /*
  ******************************************************** startup function **
- * Open connections to PostgreSQL using conninfo string from screen struct.
+ * Open connection of the first screen using conninfo string from screen
+ * struct. Other connections are opened when their screens are viewed first
+ * time, see open_screen_connection().
  *
  * IN:
  * @screens         Screens options array.
@@ -781,40 +988,165 @@ void prepare_conninfo(struct screen_s * screens[])
  */
 void open_connections(struct screen_s * screens[], PGconn * conns[])
 {
-    unsigned int i;
-    for ( i = 0; i < MAX_SCREEN; i++ ) {
-        if (screens[i]->conn_used) {
-            conns[i] = PQconnectdb(screens[i]->conninfo);
-            if ( PQstatus(conns[i]) == CONNECTION_BAD && PQconnectionNeedsPassword(conns[i]) == 1) {
-                printf("%s:%s %s@%s require ", 
-                                screens[i]->host, screens[i]->port,
-                                screens[i]->user, screens[i]->dbname);
-                snprintf(screens[i]->password, sizeof(screens[i]->password), "%s",
-			password_prompt("password: ", sizeof(screens[i]->password), false));
-		snprintf(screens[i]->conninfo + strlen(screens[i]->conninfo),
-			 sizeof(screens[i]->conninfo) - strlen(screens[i]->conninfo),
-			 " password=%s", screens[i]->password);
-                conns[i] = PQconnectdb(screens[i]->conninfo);
-            } else if ( PQstatus(conns[i]) == CONNECTION_BAD ) {
-                mreport(false, msg_error, "ERROR: Connection to %s:%s with %s@%s failed (console %i).\n",
+    unsigned int i = 0;
+
+    activate_screen(screens[i]);
+    conns[i] = PQconnectdb(screens[i]->conninfo);
+    if ( PQstatus(conns[i]) == CONNECTION_BAD && PQconnectionNeedsPassword(conns[i]) == 1) {
+        printf("%s:%s %s@%s require ", 
                         screens[i]->host, screens[i]->port,
-                        screens[i]->user, screens[i]->dbname, i + 1);
-                continue;
-            }
+                        screens[i]->user, screens[i]->dbname);
+        snprintf(screens[i]->password, sizeof(screens[i]->password), "%s",
+                password_prompt("password: ", sizeof(screens[i]->password), false));
+        snprintf(screens[i]->conninfo + strlen(screens[i]->conninfo),
+                sizeof(screens[i]->conninfo) - strlen(screens[i]->conninfo),
+                " password=%s", screens[i]->password);
+        PQfinish(conns[i]);
+        conns[i] = PQconnectdb(screens[i]->conninfo);
+    } else if ( PQstatus(conns[i]) == CONNECTION_BAD ) {
+        mreport(false, msg_error, "ERROR: Connection to %s:%s with %s@%s failed (console %i).\n",
+                screens[i]->host, screens[i]->port,
+                screens[i]->user, screens[i]->dbname, i + 1);
+        return;
+    }
+
+    init_connection(conns[i], screens[i]);
+}
+
+/*
+ ******************************************************** routine function **
+ * Get PostgreSQL details and setup session of new connection.
+ *
+ * IN:
+ * @conn            New connection.
+ * @screen          Screen associated with connection.
+ ****************************************************************************
+ */
+void init_connection(PGconn * conn, struct screen_s * screen)
+{
+    PGresult * res;
+    char errmsg[ERRSIZE];
+
+    /* prepared queries don't survive reconnect and depend on version */
+    screen->pg_special.prepared = 0;
+
+    /* get PostgreSQL details */
+    get_pg_special(conn, screen);
 
-            /* get PostgreSQL details */
-            get_pg_special(conns[i], screens[i]);
+    /* suppress log messages with log_min_duration_statement */
+    if ((res = do_query(conn, PG_SUPPRESS_LOG_QUERY, errmsg)) != NULL)
+        PQclear(res);
+    /* increase our work_mem */
+    if ((res = do_query(conn, PG_INCREASE_WORK_MEM_QUERY, errmsg)) != NULL)
+        PQclear(res);
+}
+
+/*
+ ******************************************************** routine function **
+ * Open connection of the screen which is viewed first time.
+ *
+ * IN:
+ * @window          Window where status is printed.
+ * @screen          Screen which is going to be viewed.
+ *
+ * RETURNS:
+ * New connection, if connection failed it's reset later.
+ ****************************************************************************
+ */
+PGconn * open_screen_connection(WINDOW * window, struct screen_s * screen)
+{
+    PGconn * conn;
+    char params[CONN_ARG_MAXLEN],
+         msg[] = "Required password: ";
+    bool with_esc;
+
+    activate_screen(screen);
+
+    wclear(window);
+    wprintw(window, "Connecting to %s:%s with %s@%s.", screen->host, screen->port, screen->user, screen->dbname);
+    wrefresh(window);
 
-            PGresult * res;
-            char errmsg[ERRSIZE];
-            /* suppress log messages with log_min_duration_statement */
-            if ((res = do_query(conns[i], PG_SUPPRESS_LOG_QUERY, errmsg)) != NULL)
-               PQclear(res);
-            /* increase our work_mem */
-            if ((res = do_query(conns[i], PG_INCREASE_WORK_MEM_QUERY, errmsg)) != NULL)
-                PQclear(res);
+    conn = PQconnectdb(screen->conninfo);
+    /* if password required, ask user for password */
+    if (PQstatus(conn) == CONNECTION_BAD && PQconnectionNeedsPassword(conn) == 1) {
+        wclear(window);
+        cmd_readline(window, msg, strlen(msg), &with_esc, params, sizeof(params), false);
+        if (strlen(params) != 0 && with_esc == false) {
+            snprintf(screen->password, sizeof(screen->password), "%s", params);
+            snprintf(screen->conninfo + strlen(screen->conninfo),
+                    sizeof(screen->conninfo) - strlen(screen->conninfo), " password=%s", screen->password);
+            PQfinish(conn);
+            conn = PQconnectdb(screen->conninfo);
         }
     }
+
+    wclear(window);
+    if (PQstatus(conn) == CONNECTION_BAD) {
+        wprintw(window, "Connection to %s:%s with %s@%s failed.", screen->host, screen->port, screen->user, screen->dbname);
+        return conn;
+    }
+
+    init_connection(conn, screen);
+    return conn;
+}
+
+/*
+ ******************************************************** routine function **
+ * Start opening connection without waiting for it, it's finished later with
+ * poll_screen_connection() when its socket is ready. Password can't be asked
+ * here, such servers fail until their screen is viewed.
+ *
+ * IN:
+ * @screen          Screen which connection is opened.
+ *
+ * RETURNS:
+ * Connection in progress, or failed connection.
+ ****************************************************************************
+ */
+PGconn * start_screen_connection(struct screen_s * screen)
+{
+    PGconn * conn;
+
+    activate_screen(screen);
+
+    /* libpq asks to wait for writing before the first poll */
+    conn = PQconnectStart(screen->conninfo);
+    screen->connect_events = (conn != NULL && PQstatus(conn) != CONNECTION_BAD) ? POLLOUT : 0;
+    screen->background_conn = true;
+
+    return conn;
+}
+
+/*
+ ******************************************************** routine function **
+ * Advance connection in progress when its socket is ready. Session is set up
+ * when connection is established.
+ *
+ * IN:
+ * @conn            Connection in progress.
+ * @screen          Screen associated with connection.
+ *
+ * OUT:
+ * @screen          Events awaited by connection, 0 if it's done or failed.
+ ****************************************************************************
+ */
+void poll_screen_connection(PGconn * conn, struct screen_s * screen)
+{
+    switch (PQconnectPoll(conn)) {
+        case PGRES_POLLING_READING:
+            screen->connect_events = POLLIN;
+            break;
+        case PGRES_POLLING_WRITING:
+            screen->connect_events = POLLOUT;
+            break;
+        case PGRES_POLLING_OK:
+            screen->connect_events = 0;
+            init_connection(conn, screen);
+            break;
+        default:
+            screen->connect_events = 0;
+            break;
+    }
 }
 
 /*
@@ -828,8 +1160,8 @@ void open_connections(struct screen_s * screens[], PGconn * conns[])
 void close_connections(struct screen_s * screens[], PGconn * conns[])
 {
     unsigned int i;
-    for (i = 0; i < MAX_SCREEN; i++)
-        if (screens[i]->conn_used)
+    for (i = 0; screens[i] != NULL; i++)
+        if (screens[i]->conn_used && conns[i] != NULL)
             PQfinish(conns[i]);
 }
 
@@ -878,45 +1210,25 @@ void prepare_query(struct screen_s * screen, char * query)
 			PG_STAT_REPLICATION_QUERY_P3);
             break;
         case pg_stat_tables:
-            snprintf(query, QUERY_MAXLEN, "%s%s%s", PG_STAT_TABLES_QUERY_P1,
-			screen->pg_stat_sys ? "all" : "user", PG_STAT_TABLES_QUERY_P2);
+            snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_TABLES_QUERY);
             break;
         case pg_stat_indexes:
-            snprintf(query, QUERY_MAXLEN, "%s%s%s%s%s", 
-			PG_STAT_INDEXES_QUERY_P1, screen->pg_stat_sys ? "all" : "user",
-                        PG_STAT_INDEXES_QUERY_P2, screen->pg_stat_sys ? "all" : "user",
-                        PG_STAT_INDEXES_QUERY_P3);
+            snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_INDEXES_QUERY);
             break;
         case pg_statio_tables:
-            snprintf(query, QUERY_MAXLEN, "%s%s%s",
-                        PG_STATIO_TABLES_QUERY_P1, screen->pg_stat_sys ? "all" : "user",
-                        PG_STATIO_TABLES_QUERY_P2);
+            snprintf(query, QUERY_MAXLEN, "%s", PG_STATIO_TABLES_QUERY);
             break;
         case pg_tables_size:
-            snprintf(query, QUERY_MAXLEN, "%s%s%s",
-                        PG_TABLES_SIZE_QUERY_P1, screen->pg_stat_sys ? "all" : "user",
-                        PG_TABLES_SIZE_QUERY_P2);
+            snprintf(query, QUERY_MAXLEN, "%s", PG_TABLES_SIZE_QUERY);
             break;
         case pg_stat_activity_long:
-            /* 
-             * build query from several parts, 
-             * thus user can change duration which is used in WHERE clause.
-             */
+            /* duration used in WHERE clause is passed as parameter, thus user can change it */
             if (atoi(screen->pg_special.pg_version_num) < PG92) {
-                snprintf(query, QUERY_MAXLEN, "%s%s%s%s%s",
-                        PG_STAT_ACTIVITY_LONG_91_QUERY_P1, screen->pg_stat_activity_min_age,
-                        PG_STAT_ACTIVITY_LONG_91_QUERY_P2, screen->pg_stat_activity_min_age,
-                        PG_STAT_ACTIVITY_LONG_91_QUERY_P3);
+                snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_ACTIVITY_LONG_91_QUERY);
             } else if (atoi(screen->pg_special.pg_version_num) > PG92 && atoi(screen->pg_special.pg_version_num) < PG96) {
-                snprintf(query, QUERY_MAXLEN, "%s%s%s%s%s",
-                        PG_STAT_ACTIVITY_LONG_95_QUERY_P1, screen->pg_stat_activity_min_age,
-                        PG_STAT_ACTIVITY_LONG_95_QUERY_P2, screen->pg_stat_activity_min_age,
-                        PG_STAT_ACTIVITY_LONG_95_QUERY_P3);
+                snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_ACTIVITY_LONG_95_QUERY);
 	    } else {
-                snprintf(query, QUERY_MAXLEN, "%s%s%s%s%s",
-                        PG_STAT_ACTIVITY_LONG_QUERY_P1, screen->pg_stat_activity_min_age,
-                        PG_STAT_ACTIVITY_LONG_QUERY_P2, screen->pg_stat_activity_min_age,
-                        PG_STAT_ACTIVITY_LONG_QUERY_P3);
+                snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_ACTIVITY_LONG_QUERY);
             }
             break;
         case pg_stat_functions:
@@ -948,3766 +1260,10488 @@ void prepare_query(struct screen_s * screen, char * query)
         case pg_stat_progress_vacuum:
             snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_PROGRESS_VACUUM_QUERY);
             break;
+        case pg_stat_backends:
+            if (atoi(screen->pg_special.pg_version_num) < PG92)
+                snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_BACKENDS_91_QUERY);
+            else if (atoi(screen->pg_special.pg_version_num) < PG96)
+                snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_BACKENDS_95_QUERY);
+            else
+                snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_BACKENDS_QUERY);
+            break;
     }
 }
 
 /*
- ********************************************************* routine function **
- * Send query to PostgreSQL.
+ ****************************************************************************
+ * Get parameters of a query using current screen query context.
  *
  * IN:
- * @conn            PostgreSQL connection.
- * @query           Query text.
+ * @screen              Current screen where query context is stored.
  *
  * OUT:
- * @errmsg          Error message returned by postgres.
+ * @params              Values of query parameters.
  *
- * RETURNS:         PostgreSQL query result or error message if error occurs.
+ * RETURNS:
+ * Number of query parameters.
  ****************************************************************************
  */
-PGresult * do_query(PGconn * conn, const char * query, char errmsg[])
+int get_query_params(struct screen_s * screen, const char * params[])
 {
-    PGresult    *res;
-
-    res = PQexec(conn, query);
-    switch (PQresultStatus(res)) {
-        case PG_CMD_OK: case PG_TUP_OK:
-            return res;
-            break;
+    switch (screen->current_context) {
+        case pg_stat_tables: case pg_stat_indexes: case pg_statio_tables: case pg_tables_size:
+            params[0] = screen->pg_stat_sys ? "t" : "f";
+            return 1;
+        case pg_stat_activity_long:
+            params[0] = screen->pg_stat_activity_min_age;
+            return 1;
         default:
-	    snprintf(errmsg, ERRSIZE, "%s: %s\nDETAIL: %s\nHINT: %s",
-			PQresultErrorField(res, PG_DIAG_SEVERITY),
-			PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY),
-			PQresultErrorField(res, PG_DIAG_MESSAGE_DETAIL),
-			PQresultErrorField(res, PG_DIAG_MESSAGE_HINT));
-            PQclear(res);
-            return NULL;
-            break;
+            return 0;
     }
 }
 
 /*
- ************************************************* summary window function **
- * Print current time.
+ ****************************************************************************
+ * Send a query using current screen query context, result isn't waited.
+ * Query is prepared once per connection, prepared queries are forgotten when
+ * connection is reset. Query which is already prepared on the server, but
+ * isn't known as prepared, is deallocated and prepared again.
+ *
+ * IN:
+ * @conn                Current postgres connection.
+ * @screen              Current screen where query context is stored.
  *
  * OUT:
- * @strtime         Current time.
+ * @errmsg              Error message returned by postgres.
+ *
+ * RETURNS:
+ * False if query can't be sent.
  ****************************************************************************
  */
-void get_time(char * strtime)
+bool send_context_query(PGconn * conn, struct screen_s * screen, char errmsg[])
 {
-    time_t rawtime;
-    struct tm *timeinfo;
+    PGresult *res;
+    char name[XS_BUF_LEN],
+         dealloc[S_BUF_LEN],
+         query[QUERY_MAXLEN];
+    const char *params[1];
+    int nparams;
+    unsigned int mask = 1U << screen->current_context;
 
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
-    strftime(strtime, 20, "%Y-%m-%d %H:%M:%S", timeinfo);
+    snprintf(name, sizeof(name), "pgcenter_%i", screen->current_context);
+
+    if ((screen->pg_special.prepared & mask) == 0) {
+        prepare_query(screen, query);
+        res = PQprepare(conn, name, query, 0, NULL);
+        if (PQresultStatus(res) != PG_CMD_OK && PQstatus(conn) == CONNECTION_OK) {
+            PQclear(res);
+            snprintf(dealloc, sizeof(dealloc), "DEALLOCATE %s", name);
+            PQclear(PQexec(conn, dealloc));
+            res = PQprepare(conn, name, query, 0, NULL);
+        }
+        if (PQresultStatus(res) != PG_CMD_OK) {
+            get_query_error(res, errmsg);
+            PQclear(res);
+            return false;
+        }
+        PQclear(res);
+        screen->pg_special.prepared |= mask;
+    }
+
+    /* binary format is used since 9.2, where queries have no types which need text output */
+    nparams = get_query_params(screen, params);
+    if (PQsendQueryPrepared(conn, name, nparams, params, NULL, NULL,
+                (screen->binary_results && atoi(screen->pg_special.pg_version_num) >= PG92) ? 1 : 0) == 0) {
+        snprintf(errmsg, ERRSIZE, "%s", PQerrorMessage(conn));
+        return false;
+    }
+
+    return true;
 }
 
 /*
- ************************************************* summary window function **
- * Print title to the summary window: program name and current time.
+ ****************************************************************************
+ * Get result of a query sent by send_context_query(), connection shouldn't
+ * be busy.
  *
  * IN:
- * @window          Window where title will be printed.
+ * @conn                Current postgres connection.
+ * @screen              Current screen where query context is stored.
+ *
+ * OUT:
+ * @errmsg              Error message returned by postgres.
+ * @canceled            Query is canceled due to key press.
+ *
+ * RETURNS:
+ * PostgreSQL query result or NULL if error occurs.
  ****************************************************************************
  */
-void print_title(WINDOW * window)
+PGresult * finish_context_query(PGconn * conn, struct screen_s * screen, char errmsg[], bool * canceled)
 {
-    static char strtime[20];
-    get_time(strtime);
-    wprintw(window, "%s: %s, ", PROGRAM_NAME, strtime);
-}
+    PGresult *res;
+    char query[QUERY_MAXLEN];
 
-/*
- ************************************************* summary window function **
- * Read /proc/loadavg and return load average values.
- *
- * RETURNS:
- * Load average for 1, 5, 15 minutes.
- ****************************************************************************
- */
-float * get_loadavg()
-{
-    static float la[3];
-    FILE *fp;
+    *canceled = false;
+    res = get_query_result(conn, errmsg);
 
-    if ((fp = fopen(LOADAVG_FILE, "r")) != NULL) {
-        if ((fscanf(fp, "%f %f %f", &la[0], &la[1], &la[2])) != 3)
-            la[0] = la[1] = la[2] = 0;            /* something goes wrong */
-        fclose(fp);
-    } else {
-        la[0] = la[1] = la[2] = 0;                /* can't read statfile */
+    /* texts of new pg_stat_statements queries are fetched once and then cached */
+    if (res != NULL && PGSS_CONTEXT(screen->current_context)
+            && fetch_query_texts(conn, res, errmsg, canceled) == false) {
+        PQclear(res);
+        res = NULL;
     }
 
-    return la;
+    /* backends are joined with their processes stats, processes of remote host aren't seen */
+    if (res != NULL && screen->current_context == pg_stat_backends)
+        res = join_backends_proc(res, &screen->backends, screen->pg_special.pg_is_local);
+
+    /* 
+     * prepared query might become invalid, e.g. when extension is recreated,
+     * so drop it and prepare again next time.
+     */
+    if (res == NULL && *canceled == false && PQstatus(conn) == CONNECTION_OK) {
+        snprintf(query, QUERY_MAXLEN, "DEALLOCATE pgcenter_%i", screen->current_context);
+        PQclear(PQexec(conn, query));
+        screen->pg_special.prepared &= ~(1U << screen->current_context);
+    }
+
+    return res;
 }
 
 /*
- ************************************************* summary window function **
- * Print load average to the summary window.
+ ******************************************************** routine function **
+ * Cancel context queries which are in progress. Queries of background
+ * screens keep running, their results are taken by the next sampling, so
+ * key press costs a single cancel and background screens stay fresh.
  *
  * IN:
- * @window      Window where load average will be printed.
+ * @screens             Screens array.
+ * @conns               Connections array.
+ * @console_index       Index of current screen.
+ * @all                 Cancel queries of background screens too, e.g. fleet
+ *                      overview queries which belong to current screen.
  ****************************************************************************
  */
-void print_loadavg(WINDOW * window)
+void cancel_context_queries(struct screen_s * screens[], PGconn * conns[], unsigned int console_index, bool all)
 {
-    float * la = get_loadavg();
-    wprintw(window, "load average: %.2f, %.2f, %.2f\n", la[0], la[1], la[2]);
+    unsigned int i;
+
+    for (i = 0; screens[i] != NULL; i++) {
+        if (screens[i]->query_sent && (all || i == console_index)) {
+            cancel_query(conns[i]);
+            screens[i]->query_sent = false;
+        }
+    }
 }
 
 /*
- ************************************************* summary window function **
- * Print current connection info.
+ ******************************************************** routine function **
+ * Parse query result into screen snapshots and calculate rates.
  *
  * IN:
- * @window          Window where info will be printed.
- * @conn            Current connection.
- * @console_no      Current console number.
+ * @screen              Screen which query result belongs to.
+ * @res                 Query result, it's cleared.
+ *
+ * RETURNS:
+ * SAMPLE_OK if rates are calculated, SAMPLE_NODATA for the first snapshot.
  ****************************************************************************
  */
-void print_conninfo(WINDOW * window, PGconn *conn, unsigned int console_no)
+int store_screen_result(struct screen_s * screen, PGresult * res)
 {
-    const char * states[] = { "ok", "failed", "unknown" };
-    int st_index;
-    char buffer[CONNINFO_TITLE_LEN];
+    struct snapshot_s * tmp_snap;
+    int status = SAMPLE_OK;
 
-    switch (PQstatus(conn)) {
-        case CONNECTION_OK:
-            st_index = 0;	/* ok */
-            break;
-        case CONNECTION_BAD:
-            st_index = 1;	/* failed */
-            break;
-        default:
-            st_index = 2;	/* unknown */
-            break;
+    /* rates are calculated using time when query actually completed */
+    screen->c_snap->ts = get_monotonic_time();
+    pgrescpy(screen->c_snap, res, screen);
+    PQclear(res);
+
+    /* first snapshot is only used as previous one for the next sample */
+    if (screen->sampled)
+        diff_arrays(screen->p_snap, screen->c_snap);
+    else {
+        screen->sampled = true;
+        status = SAMPLE_NODATA;
     }
 
-    snprintf(buffer, sizeof(buffer), "conn%i [%s]: %s:%s %s@%s",
-                console_no, states[st_index],
-                PQhost(conn), PQport(conn),
-                PQuser(conn), PQdb(conn));
+    /* current snapshot becomes previous, its memory is reused on next sample */
+    tmp_snap = screen->p_snap;
+    screen->p_snap = screen->c_snap;
+    screen->c_snap = tmp_snap;
 
-    mvwprintw(window, 0, COLS / 2, "%s", buffer);
-    wrefresh(window);
+    return status;
 }
 
 /*
- ************************************************** system window function **
- * Print current postgres process activity: number of total/idle/idle in 
- * transaction/active/waiting/others backends.
+ ******************************************************** routine function **
+ * Prepare fleet overview query, it depends on version of each server.
  *
  * IN:
- * @window          Window where info will be printed.
- * @conn            Current postgres connection.
+ * @screen              Screen which query is prepared for.
+ *
+ * OUT:
+ * @query               Text of query.
  ****************************************************************************
  */
-void print_postgres_activity(WINDOW * window, struct screen_s * screen, PGconn * conn)
+void prepare_fleet_query(struct screen_s * screen, char * query)
 {
-    unsigned int t_count = 0,			/* total number of connections */
-        	 i_count = 0,			/* number of idle connections */
-        	 x_count = 0,			/* number of idle in xact */
-        	 a_count = 0,			/* number of active connections */
-        	 w_count = 0,			/* number of waiting connections */
-        	 o_count = 0;			/* other, unclassiffied */
-    PGresult *res;
-    static char errmsg[ERRSIZE];
-    char query[QUERY_MAXLEN];
-
-    if (atoi(screen->pg_special.pg_version_num) < PG96)
-    	snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_ACTIVITY_COUNT_95_QUERY);
-    else
-        snprintf(query, QUERY_MAXLEN, "%s", PG_STAT_ACTIVITY_COUNT_QUERY);
-
-    if ((res = do_query(conn, query, errmsg)) != NULL) {
-        t_count = atoi(PQgetvalue(res, 0, 0));
-        i_count = atoi(PQgetvalue(res, 0, 1));
-        x_count = atoi(PQgetvalue(res, 0, 2));
-        a_count = atoi(PQgetvalue(res, 0, 3));
-        w_count = atoi(PQgetvalue(res, 0, 4));
-        o_count = atoi(PQgetvalue(res, 0, 5));
-        PQclear(res);
-    } 
-
-    mvwprintw(window, 1, COLS / 2,
-            "  activity:%3i total,%3i idle,%3i idle_in_xact,%3i active,%3i waiting,%3i others",
-            t_count, i_count, x_count, a_count, w_count, o_count);
-    wrefresh(window);
+    snprintf(query, QUERY_MAXLEN, "%s%s%s", PG_FLEET_QUERY_P1,
+            (atoi(screen->pg_special.pg_version_num) < PG96)
+                ? PG_FLEET_WAITING_95
+                : PG_FLEET_WAITING,
+            PG_FLEET_QUERY_P2);
 }
 
 /*
- ************************************************** system window function **
- * Print pg_stat_statements related info.
+ ******************************************************** routine function **
+ * Merge fleet overview results of all servers into one result, each server
+ * is a row with server name and its state in the first columns. Servers which
+ * are still connecting, unreachable or failed the query have no values.
  *
  * IN:
- * @window          Window where info will be printed.
- * @conn            Current postgres connection.
- * @interval        Screen refresh interval.
+ * @screens             Screens array.
+ * @conns               Connections array.
+ * @results             Results of fleet query, NULL if server hasn't answered.
+ * @n                   Number of results.
+ *
+ * RETURNS:
+ * Merged result, or NULL if no servers answered. Results are cleared.
  ****************************************************************************
  */
-void print_pgss_info(WINDOW * window, PGconn * conn, unsigned long interval)
+PGresult * merge_fleet_results(struct screen_s * screens[], PGconn * conns[], PGresult * results[], unsigned int n)
 {
-    float avgtime;
-    static unsigned int qps, prev_queries = 0;
-    unsigned int divisor;
-    char maxtime[XS_BUF_LEN] = "";
-    PGresult *res;
-    char errmsg[ERRSIZE];
+    PGresult * res = NULL;
+    unsigned int i, j, first = n, row = 0, n_cols = 0;
+    char server[S_BUF_LEN];
+    const char * state;
+    bool answered;
+
+    for (i = 0; i < n && n_cols == 0; i++)
+        if (results[i] != NULL && PQntuples(results[i]) == 1) {
+            n_cols = PQnfields(results[i]) + 2;
+            first = i;
+        }
+    if (n_cols == 0) {
+        for (i = 0; i < n; i++)
+            PQclear(results[i]);
+        return NULL;
+    }
 
-    if (PQstatus(conn) == CONNECTION_BAD) {
-        avgtime = qps = 0;
-        snprintf(maxtime, sizeof(maxtime), "--:--:--");
-    } 
+    PGresAttDesc attrs[n_cols];
 
-    divisor = interval / 1000000;
-    if ((res = do_query(conn, PG_STAT_STATEMENTS_SYS_QUERY, errmsg)) != NULL) {
-        avgtime = atof(PQgetvalue(res, 0, 0));
-        qps = (atoi(PQgetvalue(res, 0, 1)) - prev_queries) / divisor;
-        prev_queries = atoi(PQgetvalue(res, 0, 1));
-        PQclear(res);
-    } else {
-        avgtime = 0;
-        qps = 0;
+    memset(attrs, 0, sizeof(attrs));
+    attrs[0].name = "server";
+    attrs[1].name = "state";
+    for (j = 0; j < 2; j++) {
+        attrs[j].typid = TEXTOID;
+        attrs[j].typlen = -1;
+        attrs[j].atttypmod = -1;
+    }
+    for (j = 2; j < n_cols; j++) {
+        attrs[j].name = PQfname(results[first], j - 2);
+        attrs[j].typid = PQftype(results[first], j - 2);
+        attrs[j].typlen = PQfsize(results[first], j - 2);
+        attrs[j].atttypmod = PQfmod(results[first], j - 2);
     }
 
-    if ((res = do_query(conn, PG_STAT_ACTIVITY_SYS_QUERY, errmsg)) != NULL) {
-        snprintf(maxtime, sizeof(maxtime), "%s", PQgetvalue(res, 0, 0));
-        PQclear(res);
-    } else {
-        snprintf(maxtime, sizeof(maxtime), "--:--:--");
+    res = PQmakeEmptyPGresult(NULL, PGRES_TUPLES_OK);
+    PQsetResultAttrs(res, n_cols, attrs);
+    for (i = 0; i < n; i++) {
+        if (screens[i]->conn_used == false || conns[i] == NULL) {
+            PQclear(results[i]);
+            continue;
+        }
+
+        answered = (results[i] != NULL && PQntuples(results[i]) == 1
+                    && (unsigned int) PQnfields(results[i]) == n_cols - 2);
+        if (answered)
+            state = PG_FLEET_STATE_OK;
+        else if (screens[i]->connect_events != 0)
+            state = PG_FLEET_STATE_CONNECTING;
+        else if (PQstatus(conns[i]) != CONNECTION_OK)
+            state = PG_FLEET_STATE_UNREACHABLE;
+        else
+            state = PG_FLEET_STATE_FAILED;
+
+        /* server name with state is a key for matching rows, rates start over when server comes back */
+        snprintf(server, sizeof(server), "%s:%s/%s", PQhost(conns[i]), PQport(conns[i]), PQdb(conns[i]));
+        PQsetvalue(res, row, 0, server, strlen(server));
+        PQsetvalue(res, row, 1, (char *) state, strlen(state));
+        for (j = 2; j < n_cols; j++) {
+            if (answered)
+                PQsetvalue(res, row, j, PQgetvalue(results[i], 0, j - 2),
+                        PQgetisnull(results[i], 0, j - 2) ? -1 : PQgetlength(results[i], 0, j - 2));
+            else
+                PQsetvalue(res, row, j, NULL, -1);
+        }
+        row++;
+        PQclear(results[i]);
     }
 
-    mvwprintw(window, 3, COLS / 2,
-            "statements: %3i stmt/s,  %3.3f stmt_avgtime, %s xact_maxtime",
-            qps, avgtime, maxtime);
-    wrefresh(window);
+    return res;
 }
 
 /*
- ******************************************************* get stat function **
- * Allocate memory for statistics structs.
+ ******************************************************** routine function **
+ * Join backends query result with stats of their processes. Process columns
+ * are inserted after pid, they are NULLs if process isn't seen, e.g. when
+ * postgres runs on remote host. Values are encoded in format of the result,
+ * so binary results stay binary. Processes which aren't found anymore are
+ * released from the cache.
  *
- * OUT:
- * @st_cpu          Struct for cpu statistics.
- * @st_mem_short    Struct for mem statistics.
+ * IN:
+ * @res                 Backends query result, pid is the first column.
+ * @cache               Processes cache of the screen.
+ * @local               Backends processes are on this host.
+ *
+ * RETURNS:
+ * Joined result. Query result is cleared.
  ****************************************************************************
  */
-void init_stats(struct cpu_s *st_cpu[], struct mem_s **st_mem_short)
+PGresult * join_backends_proc(PGresult * res, struct backends_cache_s * cache, bool local)
 {
-    unsigned int i;
-    /* Allocate structures for CPUs "all" and 0 */
-    for (i = 0; i < 2; i++) {
-        if ((st_cpu[i] = (struct cpu_s *) malloc(STATS_CPU_SIZE * 2)) == NULL) {
-            mreport(true, msg_fatal, "FATAL: malloc for cpu stats failed.\n");
+    static const char * names[BACKEND_PROC_COLS] = { "cpu", "read_kb", "write_kb", "rss_mb", "pstate" };
+    PGresult * joined;
+    struct backend_proc_s * bp;
+    unsigned int i, j, k, src,
+                 n_rows = PQntuples(res),
+                 n_cols = PQnfields(res) + BACKEND_PROC_COLS;
+    int format = PQbinaryTuples(res) ? 1 : 0, len;
+    char buf[XS_BUF_LEN];
+    uint64_t v64;
+
+    if (PQnfields(res) == 0)
+        return res;
+
+    PGresAttDesc attrs[n_cols];
+    struct backend_stat_s st[n_rows + 1];
+    bool found[n_rows + 1];
+
+    /* rows are ordered by pid descending, reverse walk appends new pids to the sorted cache */
+    for (i = n_rows; i-- > 0; ) {
+        /* values of rows without process are built too, though they're stored as NULLs */
+        memset(&st[i], 0, sizeof(struct backend_stat_s));
+        found[i] = false;
+        if (local == false || PQgetisnull(res, i, 0))
+            continue;
+        if ((bp = get_backend_proc(cache, format ? decode_int(PQgetvalue(res, i, 0), PQgetlength(res, i, 0))
+                                                 : atoi(PQgetvalue(res, i, 0)))) == NULL)
+            continue;
+        bp->seen = true;
+        found[i] = read_backend_stat(bp, &st[i]);
+    }
+    if (local)
+        release_backends_proc(cache);
+
+    memset(attrs, 0, sizeof(attrs));
+    for (j = 0, src = 0; j < n_cols; j++) {
+        attrs[j].format = format;
+        if (j >= 1 && j <= BACKEND_PROC_COLS) {
+            k = j - 1;
+            attrs[j].name = (char *) names[k];
+            attrs[j].typid = (k < BACKEND_PROC_COLS - 1) ? INT8OID : TEXTOID;
+            attrs[j].typlen = (k < BACKEND_PROC_COLS - 1) ? 8 : -1;
+            attrs[j].atttypmod = -1;
+            continue;
         }
-        memset(st_cpu[i], 0, STATS_CPU_SIZE * 2);
+        attrs[j].name = PQfname(res, src);
+        attrs[j].typid = PQftype(res, src);
+        attrs[j].typlen = PQfsize(res, src);
+        attrs[j].atttypmod = PQfmod(res, src);
+        src++;
     }
 
-    /* Allocate structures for memory */
-    if ((*st_mem_short = (struct mem_s *) malloc(STATS_MEM_SIZE)) == NULL) {
-        mreport(true, msg_fatal, "FATAL: malloc for memory stats failed.\n");
+    joined = PQmakeEmptyPGresult(NULL, PGRES_TUPLES_OK);
+    PQsetResultAttrs(joined, n_cols, attrs);
+
+    for (i = 0; i < n_rows; i++) {
+        long long values[BACKEND_PROC_COLS - 1] = { st[i].cpu, st[i].read_kb, st[i].write_kb, st[i].rss_mb };
+
+        for (j = 0, src = 0; j < n_cols; j++) {
+            if (j < 1 || j > BACKEND_PROC_COLS) {
+                PQsetvalue(joined, i, j, PQgetvalue(res, i, src),
+                        PQgetisnull(res, i, src) ? -1 : PQgetlength(res, i, src));
+                src++;
+            } else if (found[i] == false) {
+                PQsetvalue(joined, i, j, NULL, -1);
+            } else if ((k = j - 1) == BACKEND_PROC_COLS - 1) {
+                PQsetvalue(joined, i, j, &st[i].state, st[i].state != '\0' ? 1 : 0);
+            } else if (format) {
+                v64 = htobe64(values[k]);
+                PQsetvalue(joined, i, j, (char *) &v64, sizeof(v64));
+            } else {
+                len = snprintf(buf, sizeof(buf), "%lli", values[k]);
+                PQsetvalue(joined, i, j, buf, len);
+            }
+        }
     }
-    memset(*st_mem_short, 0, STATS_MEM_SIZE);
+    PQclear(res);
+
+    return joined;
 }
 
 /*
- ******************************************************* get stat function **
- * Allocate memory for IO statistics structs.
+ ******************************************************** routine function **
+ * Take snapshots on all open connections. Queries are sent at once and their
+ * results are read as soon as they arrive, so every screen keeps its own
+ * rates and they are ready when screen is switched. Queries of background
+ * screens which are still running since previous sampling aren't sent again.
+ * When current screen shows fleet overview, all connections are asked for
+ * fleet query instead and their results go into current screen snapshot.
+ * Fleet overview starts connections which aren't opened yet or failed, they
+ * are polled together with queries and only shortly after them, so servers
+ * which are slow to connect or unreachable don't delay sampling.
+ *
+ * IN:
+ * @screens             Screens array.
+ * @conns               Connections array.
+ * @console_index       Index of current screen.
  *
  * OUT:
- * @c_ios       Struct for current stats snapshot.
- * @p_ios       Struct for previous stats snapshot.
- * @bdev        Number of block devices.
+ * @errmsg              Error message of current screen query.
+ *
+ * RETURNS:
+ * State of current screen snapshot, SAMPLE_CANCELED if key is pressed.
  ****************************************************************************
  */
-void init_iostats(struct iodata_s *c_ios[], struct iodata_s *p_ios[], unsigned int bdev)
+int sample_screens(struct screen_s * screens[], PGconn * conns[], unsigned int console_index, char errmsg[])
 {
-    unsigned int i;
-    for (i = 0; i < bdev; i++) {
-        if ((c_ios[i] = (struct iodata_s *) malloc(STATS_IODATA_SIZE)) == NULL ||
-            (p_ios[i] = (struct iodata_s *) malloc(STATS_IODATA_SIZE)) == NULL) {
-                mreport(true, msg_fatal, "FATAL: malloc for iostat failed.\n");
+    unsigned int n_screens = count_screens(screens);
+    struct pollfd fds[n_screens + 1];
+    unsigned int idx[n_screens + 1];
+    PGresult * fleet[n_screens];
+    unsigned int i, k, n, in_flight = 0, connecting;
+    int status = SAMPLE_FAILED, timeout;
+    double deadline, left;
+    bool is_fleet = (screens[console_index]->current_context == pg_fleet);
+    char screen_err[ERRSIZE],
+         query[QUERY_MAXLEN];
+    char * err;
+    PGresult * res;
+    bool canceled, sent;
+
+    snprintf(errmsg, ERRSIZE, "%s", PQerrorMessage(conns[console_index]));
+    for (i = 0; i < n_screens; i++) {
+        fleet[i] = NULL;
+        err = (i == console_index) ? errmsg : screen_err;
+        if (screens[i]->conn_used == false)
+            continue;
+
+        /* fleet overview doesn't wait for connections, current screen's one is reset by main loop */
+        if (is_fleet && i != console_index && screens[i]->connect_events == 0
+                && (conns[i] == NULL || PQstatus(conns[i]) == CONNECTION_BAD)) {
+            PQfinish(conns[i]);
+            conns[i] = start_screen_connection(screens[i]);
+        }
+
+        /* screens which never were viewed have no connections */
+        if (conns[i] == NULL || PQstatus(conns[i]) != CONNECTION_OK) {
+            screens[i]->sampled = false;
+            continue;
+        }
+
+        /* background query continues, but connection is needed for fleet query */
+        if (screens[i]->query_sent) {
+            if (is_fleet == false) {
+                in_flight++;
+                continue;
+            }
+            cancel_query(conns[i]);
+            screens[i]->query_sent = false;
+        }
+
+        if (is_fleet) {
+            prepare_fleet_query(screens[i], query);
+            if ((sent = PQsendQuery(conns[i], query)) == 0)
+                snprintf(err, ERRSIZE, "%s", PQerrorMessage(conns[i]));
+        } else
+            sent = send_context_query(conns[i], screens[i], err);
+
+        if (sent == false) {
+            screens[i]->sampled = false;
+            continue;
+        }
+        screens[i]->query_sent = true;
+        in_flight++;
+    }
+
+    deadline = get_monotonic_time() + CONNECT_WAIT;
+    while (1) {
+        /* keys might be already read by ncurses and kept in its queue */
+        if (key_is_pressed()) {
+            cancel_context_queries(screens, conns, console_index, is_fleet);
+            for (i = 0; i < n_screens; i++)
+                PQclear(fleet[i]);
+            return SAMPLE_CANCELED;
+        }
+
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        for (i = 0, n = 1, connecting = 0; i < n_screens; i++) {
+            if (screens[i]->query_sent)
+                fds[n].events = POLLIN;
+            else if (screens[i]->connect_events != 0 && conns[i] != NULL) {
+                fds[n].events = screens[i]->connect_events;
+                connecting++;
+            } else
+                continue;
+            fds[n].fd = PQsocket(conns[i]);
+            idx[n++] = i;
+        }
+
+        /* queries are waited until they finish, connections in progress only until deadline */
+        if (in_flight > 0)
+            timeout = -1;
+        else if (connecting > 0 && (left = deadline - get_monotonic_time()) > 0)
+            timeout = left * 1000 + 1;
+        else
+            break;
+
+        if (poll(fds, n, timeout) <= 0)
+            continue;
+        exit_on_hangup(fds[0].revents);
+        if (fds[0].revents & POLLIN) {
+            cancel_context_queries(screens, conns, console_index, is_fleet);
+            for (i = 0; i < n_screens; i++)
+                PQclear(fleet[i]);
+            return SAMPLE_CANCELED;
+        }
+
+        for (k = 1; k < n; k++) {
+            if (fds[k].revents == 0)
+                continue;
+            i = idx[k];
+            err = (i == console_index) ? errmsg : screen_err;
+
+            /* server connected during fleet sampling is asked in the same sample */
+            if (screens[i]->query_sent == false) {
+                poll_screen_connection(conns[i], screens[i]);
+                if (is_fleet && PQstatus(conns[i]) == CONNECTION_OK) {
+                    prepare_fleet_query(screens[i], query);
+                    if (PQsendQuery(conns[i], query)) {
+                        screens[i]->query_sent = true;
+                        in_flight++;
+                    }
+                }
+                continue;
+            }
+
+            if (PQconsumeInput(conns[i]) == 0) {
+                snprintf(err, ERRSIZE, "%s", PQerrorMessage(conns[i]));
+                res = NULL;
+            } else if (PQisBusy(conns[i]))
+                continue;
+            else if (is_fleet)
+                res = get_query_result(conns[i], err);
+            else if ((res = finish_context_query(conns[i], screens[i], err, &canceled)) == NULL && canceled) {
+                screens[i]->query_sent = false;
+                cancel_context_queries(screens, conns, console_index, false);
+                return SAMPLE_CANCELED;
+            }
+            screens[i]->query_sent = false;
+            in_flight--;
+
+            if (is_fleet)
+                fleet[i] = res;
+            else if (res == NULL)
+                screens[i]->sampled = false;
+            else if (i == console_index)
+                status = store_screen_result(screens[i], res);
+            else
+                store_screen_result(screens[i], res);
+        }
+    }
+
+    /* fleet overview is a single snapshot of current screen, row per server */
+    if (is_fleet) {
+        if ((res = merge_fleet_results(screens, conns, fleet, n_screens)) == NULL) {
+            if (strlen(errmsg) == 0)
+                snprintf(errmsg, ERRSIZE, "No servers answered fleet overview query.");
+            screens[console_index]->sampled = false;
+            return SAMPLE_FAILED;
         }
+        status = store_screen_result(screens[console_index], res);
     }
+
+    return status;
 }
 
 /*
- ******************************************************* get stat function **
- * Free memory consumed by IO statistics structs.
+ ******************************************************** routine function **
+ * Exit program when terminal is hung up. Stdin stays ready forever then, so
+ * polling it would spin, and no keys will come anymore.
  *
- * OUT:
- * @c_ios       Struct for current stats snapshot.
- * @p_ios       Struct for previous stats snapshot.
- * @bdev        Number of block devices.
+ * IN:
+ * @revents         Events of stdin returned by poll().
  ****************************************************************************
  */
-void free_iostats(struct iodata_s *c_ios[], struct iodata_s *p_ios[], unsigned int bdev)
+void exit_on_hangup(short revents)
 {
-    unsigned int i;
-    for (i = 0; i < bdev; i++) {
-        free(c_ios[i]);
-        free(p_ios[i]);
+    if (revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        endwin();
+        exit(EXIT_SUCCESS);
     }
 }
 
 /*
- ******************************************************* get stat function **
- * Allocate memory for NIC data structs.
+ ******************************************************** routine function **
+ * Wait until data arrives from postgres connection or key is pressed.
  *
- * OUT:
- * @c_nicdata       Struct for current stats snapshot.
- * @p_nicdata       Struct for previous stats snapshot.
- * @idev            Number of interfaces.
+ * IN:
+ * @conn            PostgreSQL connection, if NULL wait for keys only.
+ * @timeout_ms      Timeout in milliseconds, -1 means wait infinitely.
+ *
+ * RETURNS:
+ * false if key is pressed, true if data arrived or timeout expired. Program
+ * exits when terminal is hung up.
  ****************************************************************************
  */
-void init_nicdata(struct nicdata_s *c_nicdata[], struct nicdata_s *p_nicdata[], unsigned int idev)
+bool wait_for_input(PGconn * conn, int timeout_ms)
 {
-    unsigned int i;
-    for (i = 0; i < idev; i++) {
-        if ((c_nicdata[i] = (struct nicdata_s *) malloc(STATS_NICDATA_SIZE)) == NULL ||
-            (p_nicdata[i] = (struct nicdata_s *) malloc(STATS_NICDATA_SIZE)) == NULL ) {
-                mreport(true, msg_fatal, "FATAL: malloc for nicstat failed.\n");
-        }
+    struct pollfd fds[2];
+    nfds_t nfds = 1;
 
-	/* initialize interfaces with unknown speed and duplex */
-	c_nicdata[i]->speed = -1;
-	c_nicdata[i]->duplex = DUPLEX_UNKNOWN;
+    /* keys might be already read by ncurses and kept in its queue */
+    if (key_is_pressed())
+        return false;
+
+    /* stdin isn't watched in headless mode, it might be /dev/null which is always readable */
+    fds[0].fd = headless ? -1 : STDIN_FILENO;
+    fds[0].events = POLLIN;
+    if (conn != NULL && PQsocket(conn) >= 0) {
+        fds[1].fd = PQsocket(conn);
+        fds[1].events = POLLIN;
+        nfds = 2;
+    }
+
+    if (poll(fds, nfds, timeout_ms) > 0) {
+        exit_on_hangup(fds[0].revents);
+        if (fds[0].revents & POLLIN)
+            return false;
     }
+
+    return true;
 }
 
 /*
- ******************************************************* get stat function **
- * Free memory consumed by NIC data structs.
+ ******************************************************** routine function **
+ * Cancel query in progress and discard its results.
  *
- * OUT:
- * @c_nicdata      Struct for current stats snapshot.
- * @p_nicdata      Struct for previous stats snapshot.
- * @idev           Number of block devices.
+ * IN:
+ * @conn            PostgreSQL connection.
  ****************************************************************************
  */
-void free_nicdata(struct nicdata_s *c_nicdata[], struct nicdata_s *p_nicdata[], unsigned int idev)
+void cancel_query(PGconn * conn)
 {
-    unsigned int i;
-    for (i = 0; i < idev; i++) {
-        free(c_nicdata[i]);
-        free(p_nicdata[i]);
+    PGcancel *cancel;
+    PGresult *res;
+    char errbuf[ERRSIZE];
+
+    if ((cancel = PQgetCancel(conn)) != NULL) {
+        PQcancel(cancel, errbuf, sizeof(errbuf));
+        PQfreeCancel(cancel);
     }
+
+    /* connection can't be used until all results are consumed */
+    while ((res = PQgetResult(conn)) != NULL)
+        PQclear(res);
 }
 
 /*
- *************************************************** get cpu stat function **
- * Get system clock resolution.
+ ******************************************************** routine function **
+ * Format error message of failed query.
+ *
+ * IN:
+ * @res             Result of failed query.
  *
  * OUT:
- * @hz      Number of intervals per second.
+ * @errmsg          Error message returned by postgres.
  ****************************************************************************
  */
-void get_HZ(void)
+void get_query_error(PGresult * res, char errmsg[])
 {
-    unsigned long ticks;
-    if ((ticks = sysconf(_SC_CLK_TCK)) == -1)
-        mreport(false, msg_error, "ERROR: sysconf failure.\n");
-            
-    hz = (unsigned int) ticks;
+    snprintf(errmsg, ERRSIZE, "%s: %s\nDETAIL: %s\nHINT: %s",
+            PQresultErrorField(res, PG_DIAG_SEVERITY),
+            PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY),
+            PQresultErrorField(res, PG_DIAG_MESSAGE_DETAIL),
+            PQresultErrorField(res, PG_DIAG_MESSAGE_HINT));
 }
 
 /*
- *************************************************** get cpu stat function **
- * Read machine uptime independently of the number of processors.
+ ******************************************************** routine function **
+ * Get result of query sent to PostgreSQL. Only last result is returned, 
+ * others are discarded.
+ *
+ * IN:
+ * @conn            PostgreSQL connection.
  *
  * OUT:
- * @uptime          Uptime value in jiffies.
+ * @errmsg          Error message returned by postgres.
+ *
+ * RETURNS:         PostgreSQL query result or NULL if error occurs.
  ****************************************************************************
  */
-void read_uptime(unsigned long long *uptime)
+PGresult * get_query_result(PGconn * conn, char errmsg[])
 {
-    FILE *fp;
-    unsigned long up_sec, up_cent;
+    PGresult    *res, *next;
 
-    if ((fp = fopen(UPTIME_FILE, "r")) != NULL) {
-        if ((fscanf(fp, "%lu.%lu", &up_sec, &up_cent)) != 2) {
-	    fclose(fp);
-	    return;
-    	}
-    } else
-        return;
+    if ((res = PQgetResult(conn)) == NULL) {
+        snprintf(errmsg, ERRSIZE, "%s", PQerrorMessage(conn));
+        return NULL;
+    }
+    while ((next = PQgetResult(conn)) != NULL) {
+        PQclear(res);
+        res = next;
+    }
 
-    *uptime = (unsigned long long) up_sec * HZ + (unsigned long long) up_cent * HZ / 100;
-    fclose(fp);
+    switch (PQresultStatus(res)) {
+        case PG_CMD_OK: case PG_TUP_OK:
+            return res;
+            break;
+        default:
+            get_query_error(res, errmsg);
+            PQclear(res);
+            return NULL;
+            break;
+    }
 }
 
 /*
- **************************************************** get cpu stat function **
- * Read cpu statistics from /proc/stat. Also calculate uptime if 
- * read_uptime() function return NULL.
+ ********************************************************* routine function **
+ * Wait for result of query sent to PostgreSQL without blocking key handling.
+ * Query is canceled if key is pressed while query is in progress.
  *
  * IN:
- * @st_cpu          Struct where stat will be saved.
- * @nbr             Total number of CPU (including cpu "all").
+ * @conn            PostgreSQL connection.
  *
  * OUT:
- * @st_cpu          Struct with statistics.
- * @uptime          Machine uptime multiplied by the number of processors.
- * @uptime0         Machine uptime. Filled only if previously set to zero.
+ * @errmsg          Error message returned by postgres.
+ * @canceled        Query is canceled due to key press.
+ *
+ * RETURNS:         PostgreSQL query result or NULL if error occurs.
  ****************************************************************************
  */
-void read_cpu_stat(struct cpu_s *st_cpu, unsigned int nbr,
-                            unsigned long long *uptime, unsigned long long *uptime0)
+PGresult * wait_query_result(PGconn * conn, char errmsg[], bool * canceled)
 {
-    FILE *fp;
-    struct cpu_s *st_cpu_i;
-    struct cpu_s sc;
-    char line[XL_BUF_LEN];
-    unsigned int proc_nb;
-
-    if ((fp = fopen(STAT_FILE, "r")) == NULL) {
-        /* zeroing stats if stats read failed */
-        memset(st_cpu, 0, STATS_CPU_SIZE);
-        return;
-    }
+    *canceled = false;
 
-    while ( (fgets(line, sizeof(line), fp)) != NULL ) {
-        if (!strncmp(line, "cpu ", 4)) {
-            memset(st_cpu, 0, STATS_CPU_SIZE);
-            sscanf(line + 5, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                            &st_cpu->cpu_user,      &st_cpu->cpu_nice,
-                            &st_cpu->cpu_sys,       &st_cpu->cpu_idle,
-                            &st_cpu->cpu_iowait,    &st_cpu->cpu_hardirq,
-                            &st_cpu->cpu_softirq,   &st_cpu->cpu_steal,
-                            &st_cpu->cpu_guest,     &st_cpu->cpu_guest_nice);
-                            *uptime = st_cpu->cpu_user + st_cpu->cpu_nice +
-                                st_cpu->cpu_sys + st_cpu->cpu_idle +
-                                st_cpu->cpu_iowait + st_cpu->cpu_steal +
-                                st_cpu->cpu_hardirq + st_cpu->cpu_softirq +
-                                st_cpu->cpu_guest + st_cpu->cpu_guest_nice;
-        } else if (!strncmp(line, "cpu", 3)) {
-            if (nbr > 1) {
-                memset(&sc, 0, STATS_CPU_SIZE);
-                sscanf(line + 3, "%u %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                                &proc_nb,           &sc.cpu_user,
-                                &sc.cpu_nice,       &sc.cpu_sys,
-                                &sc.cpu_idle,       &sc.cpu_iowait,
-                                &sc.cpu_hardirq,    &sc.cpu_softirq,
-                                &sc.cpu_steal,      &sc.cpu_guest,
-                                &sc.cpu_guest_nice);
-
-                                if (proc_nb < (nbr - 1)) {
-                                    st_cpu_i = st_cpu + proc_nb + 1;
-                                    *st_cpu_i = sc;
-                                }
-
-                                if (!proc_nb && !*uptime0) {
-                                    *uptime0 = sc.cpu_user + sc.cpu_nice   +
-                                    sc.cpu_sys     + sc.cpu_idle   +
-                                    sc.cpu_iowait  + sc.cpu_steal  +
-                                    sc.cpu_hardirq + sc.cpu_softirq;
-                                    printf("read_cpu_stat: uptime0 = %llu\n", *uptime0);
-                                }
-            }
+    while (PQisBusy(conn)) {
+        if (wait_for_input(conn, -1) == false) {
+            cancel_query(conn);
+            snprintf(errmsg, ERRSIZE, "Query canceled.");
+            *canceled = true;
+            return NULL;
+        }
+        if (PQconsumeInput(conn) == 0) {
+            snprintf(errmsg, ERRSIZE, "%s", PQerrorMessage(conn));
+            return NULL;
         }
     }
-    fclose(fp);
+
+    return get_query_result(conn, errmsg);
 }
 
 /*
- *************************************************** get cpu stat function **
- * Compute time interval.
+ ********************************************************* routine function **
+ * Send query to PostgreSQL.
  *
  * IN:
- * @prev_uptime     Previous uptime value in jiffies.
- * @curr_interval   Current uptime value in jiffies.
+ * @conn            PostgreSQL connection.
+ * @query           Query text.
  *
- * RETURNS:
- * Interval of time in jiffies.
+ * OUT:
+ * @errmsg          Error message returned by postgres.
+ *
+ * RETURNS:         PostgreSQL query result or error message if error occurs.
  ****************************************************************************
  */
-unsigned long long get_interval(unsigned long long prev_uptime,
-                                        unsigned long long curr_uptime)
+PGresult * do_query(PGconn * conn, const char * query, char errmsg[])
 {
-    unsigned long long itv;
-    
-    /* first run prev_uptime=0 so displaying stats since system startup */
-    itv = curr_uptime - prev_uptime;
-
-    if (!itv) {     /* Paranoia checking */
-        itv = 1;
+    if (PQsendQuery(conn, query) == 0) {
+        snprintf(errmsg, ERRSIZE, "%s", PQerrorMessage(conn));
+        return NULL;
     }
 
-    return itv;
+    return get_query_result(conn, errmsg);
 }
 
 /*
- *************************************************** get cpu stat function **
- * Workaround for CPU counters read from /proc/stat: Dyn-tick kernels
- * have a race issue that can make those counters go backward.
+ ************************************************* summary window function **
+ * Print current time.
+ *
+ * OUT:
+ * @strtime         Current time.
  ****************************************************************************
  */
-double ll_sp_value(unsigned long long value1, unsigned long long value2,
-                unsigned long long itv)
+void get_time(char * strtime)
 {
-    if (value2 < value1)
-        return (double) 0;
-    else
-        return SP_VALUE(value1, value2, itv);
+    time_t rawtime;
+    struct tm *timeinfo;
+
+    time(&rawtime);
+    timeinfo = localtime(&rawtime);
+    strftime(strtime, 20, "%Y-%m-%d %H:%M:%S", timeinfo);
 }
 
 /*
- *************************************************** get cpu stat function **
- * Display cpu statistics in specified window.
+ ******************************************************** routine function **
+ * Get monotonic time used for calculating rates. Unlike wall clock, it isn't
+ * affected by system time adjustments.
  *
- * IN:
- * @window      Window in which spu statistics will be printed.
- * @st_cpu      Struct with cpu statistics.
- * @curr        Index in array for current sample statistics.
- * @itv         Interval of time.
+ * RETURNS:
+ * Monotonic time in seconds.
  ****************************************************************************
  */
-void write_cpu_stat_raw(WINDOW * window, struct cpu_s *st_cpu[],
-                unsigned int curr, unsigned long long itv)
+double get_monotonic_time(void)
 {
-    wprintw(window, 
-            "    %%cpu: %4.1f us, %4.1f sy, %4.1f ni, %4.1f id, %4.1f wa, %4.1f hi, %4.1f si, %4.1f st\n",
-            ll_sp_value(st_cpu[!curr]->cpu_user, st_cpu[curr]->cpu_user, itv),
-            ll_sp_value(st_cpu[!curr]->cpu_sys + st_cpu[!curr]->cpu_softirq + st_cpu[!curr]->cpu_hardirq,
-            st_cpu[curr]->cpu_sys + st_cpu[curr]->cpu_softirq + st_cpu[curr]->cpu_hardirq, itv),
-            ll_sp_value(st_cpu[!curr]->cpu_nice, st_cpu[curr]->cpu_nice, itv),
-            (st_cpu[curr]->cpu_idle < st_cpu[!curr]->cpu_idle) ?
-            0.0 :
-            ll_sp_value(st_cpu[!curr]->cpu_idle, st_cpu[curr]->cpu_idle, itv),
-            ll_sp_value(st_cpu[!curr]->cpu_iowait, st_cpu[curr]->cpu_iowait, itv),
-            ll_sp_value(st_cpu[!curr]->cpu_hardirq, st_cpu[curr]->cpu_hardirq, itv),
-            ll_sp_value(st_cpu[!curr]->cpu_softirq, st_cpu[curr]->cpu_softirq, itv),
-            ll_sp_value(st_cpu[!curr]->cpu_steal, st_cpu[curr]->cpu_steal, itv));
-    wrefresh(window);
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1)
+        mreport(true, msg_fatal, "FATAL: clock_gettime failed.\n");
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 /*
- ************************************************** system window function **
- * Composite function which read cpu stats and uptime then print out stats 
- * to specified window.
+ ************************************************* summary window function **
+ * Print title to the summary window: program name and current time.
  *
  * IN:
- * @window      Window where cpu statistics will be printed.
- * @st_cpu      Struct with cpu statistics.
+ * @window          Window where title will be printed.
  ****************************************************************************
  */
-void print_cpu_usage(WINDOW * window, struct cpu_s *st_cpu[])
+void print_title(WINDOW * window)
 {
-    static unsigned long long uptime[2]  = {0, 0};
-    static unsigned long long uptime0[2] = {0, 0};
-    static unsigned int curr = 1;
-    static unsigned long long itv;
-
-    uptime0[curr] = 0;
-    read_uptime(&(uptime0[curr]));
-    read_cpu_stat(st_cpu[curr], 2, &(uptime[curr]), &(uptime0[curr]));
-    itv = get_interval(uptime[!curr], uptime[curr]);
-    write_cpu_stat_raw(window, st_cpu, curr, itv);
-    itv = get_interval(uptime0[!curr], uptime0[curr]);
-    curr ^= 1;
+    static char strtime[20];
+    get_time(strtime);
+    wprintw(window, "%s: %s, ", PROGRAM_NAME, strtime);
 }
 
 /*
- ************************************************** system window function **
- * Print memory usage statistics
+ ****************************************************** proc file function **
+ * Read /proc file from the start. File is opened on first read and is kept
+ * open during session, so each sample costs a single pread() into buffer
+ * which is allocated once. Buffer grows when file doesn't fit into it.
+ * Descriptor is closed on read error, so file is opened again next time.
  *
  * IN:
- * @window          Window where mem statistics will be printed.
- * @st_mem_short    Struct with mem statistics.
+ * @file            /proc file.
+ *
+ * RETURNS:
+ * File contents, null-terminated, or NULL if file can't be read.
  ****************************************************************************
  */
-void print_mem_usage(WINDOW * window, struct mem_s *st_mem_short)
+char * read_proc_file(enum proc_file file)
 {
-    FILE *mem_fp;
-    char buffer[XL_BUF_LEN];
-    char key[M_BUF_LEN];
-    unsigned long long value;
-    
-    if ((mem_fp = fopen(MEMINFO_FILE, "r")) != NULL) {
-        while (fgets(buffer, XL_BUF_LEN, mem_fp) != NULL) {
-            sscanf(buffer, "%s %llu", key, &value);
-            if (!strcmp(key,"MemTotal:"))
-                st_mem_short->mem_total = value / 1024;
-            else if (!strcmp(key,"MemFree:"))
-                st_mem_short->mem_free = value / 1024;
-            else if (!strcmp(key,"SwapTotal:"))
-                st_mem_short->swap_total = value / 1024;
-            else if (!strcmp(key,"SwapFree:"))
-                st_mem_short->swap_free = value / 1024;
-            else if (!strcmp(key,"Cached:"))
-                st_mem_short->cached = value / 1024;
-            else if (!strcmp(key,"Dirty:"))
-                st_mem_short->dirty = value / 1024;
-            else if (!strcmp(key,"Writeback:"))
-                st_mem_short->writeback = value / 1024;
-            else if (!strcmp(key,"Buffers:"))
-                st_mem_short->buffers = value / 1024;
-            else if (!strcmp(key,"Slab:"))
-                st_mem_short->slab = value / 1024;
+    struct proc_file_s * pf = &proc_files[file];
+    size_t len = 0;
+    ssize_t n;
+
+    if (pf->path == NULL || (pf->fd == -1 && (pf->fd = open(pf->path, O_RDONLY | O_CLOEXEC)) == -1))
+        return NULL;
+    if (pf->buf == NULL) {
+        pf->size = PROC_BUF_LEN;
+        if ((pf->buf = malloc(pf->size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for %s failed.\n", pf->path);
         }
-        st_mem_short->mem_used = st_mem_short->mem_total - st_mem_short->mem_free
-            - st_mem_short->cached - st_mem_short->buffers - st_mem_short->slab;
-        st_mem_short->swap_used = st_mem_short->swap_total - st_mem_short->swap_free;
+    }
 
-        fclose(mem_fp);
-    } else {
-        /* read /proc/meminfo failed, zeroing stats */
-        st_mem_short->mem_total = st_mem_short->mem_free = st_mem_short->mem_used = 0;
-        st_mem_short->cached = st_mem_short->buffers = st_mem_short->slab = 0;
-        st_mem_short->swap_total = st_mem_short->swap_free = st_mem_short->swap_used = 0;
-        st_mem_short->dirty = st_mem_short->writeback = 0;
+    while ((n = pread(pf->fd, pf->buf + len, pf->size - 1 - len, len)) != 0) {
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            close(pf->fd);
+            pf->fd = -1;
+            return NULL;
+        }
+        len += n;
+        if (len == pf->size - 1) {
+            pf->size *= 2;
+            if ((pf->buf = realloc(pf->buf, pf->size)) == NULL) {
+                mreport(true, msg_fatal, "FATAL: realloc for %s failed.\n", pf->path);
+            }
+        }
     }
+    pf->buf[len] = '\0';
 
-    wprintw(window, " MiB mem: %6llu total, %6llu free, %6llu used, %8llu buff/cached\n",
-            st_mem_short->mem_total,
-            st_mem_short->mem_free,
-            st_mem_short->mem_used,
-            st_mem_short->cached + st_mem_short->buffers + st_mem_short->slab);
-    wprintw(window, "MiB swap: %6llu total, %6llu free, %6llu used, %6llu/%llu dirty/writeback\n",
-            st_mem_short->swap_total,
-            st_mem_short->swap_free,
-            st_mem_short->swap_used,
-            st_mem_short->dirty,
-            st_mem_short->writeback);
+    return pf->buf;
 }
 
 /*
- ************************************************** system window function **
- * Save current io statistics snapshot.
+ ****************************************************** proc file function **
+ * Split /proc file contents into lines, line break is replaced with null.
  *
  * IN:
- * @curr        Current statistics snapshot which must be saved.
- * @prev        Struct for saving stat snapshot.
- * @bdev       Number of block devices.
+ * @pos             Position in contents, it's moved to the next line.
+ *
+ * RETURNS:
+ * Line or NULL at the end of contents.
  ****************************************************************************
  */
-void replace_iodata(struct iodata_s *curr[], struct iodata_s *prev[], unsigned int bdev)
+char * next_proc_line(char ** pos)
 {
-    unsigned int i;
-    for (i = 0; i < bdev; i++) {
-        prev[i]->r_completed = curr[i]->r_completed;
-        prev[i]->r_merged = curr[i]->r_merged;
-        prev[i]->r_sectors = curr[i]->r_sectors;
-        prev[i]->r_spent = curr[i]->r_spent;
-        prev[i]->w_completed = curr[i]->w_completed;
-        prev[i]->w_merged = curr[i]->w_merged;
-        prev[i]->w_sectors = curr[i]->w_sectors;
-        prev[i]->w_spent = curr[i]->w_spent;
-        prev[i]->io_in_progress = curr[i]->io_in_progress;
-        prev[i]->t_spent = curr[i]->t_spent;
-        prev[i]->t_weighted = curr[i]->t_weighted;
-        prev[i]->arqsz = curr[i]->arqsz;
-        prev[i]->await = curr[i]->await;
-        prev[i]->util = curr[i]->util;
+    char * line = *pos, * end;
+
+    if (line == NULL || *line == '\0')
+        return NULL;
+
+    if ((end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+        *pos = end + 1;
+    } else {
+        *pos = line + strlen(line);
     }
+
+    return line;
 }
 
 /*
- ************************************************** system window function **
- * Save current nicstat snapshot.
+ ****************************************************** proc file function **
+ * Count lines of /proc file.
  *
  * IN:
- * @curr        Current statistics snapshot which must be saved.
- * @prev        Struct for saving stat snapshot.
- * @idev        Number of interfaces.
+ * @file            /proc file.
+ *
+ * RETURNS:
+ * Number of lines, 0 if file can't be read.
  ****************************************************************************
  */
-void replace_nicdata(struct nicdata_s *curr[], struct nicdata_s *prev[], unsigned int idev)
+unsigned int count_proc_lines(enum proc_file file)
 {
-    unsigned int i;
-    for (i = 0; i < idev; i++) {
-        prev[i]->rbytes = curr[i]->rbytes;
-        prev[i]->rpackets = curr[i]->rpackets;
-        prev[i]->wbytes = curr[i]->wbytes;
-        prev[i]->wpackets = curr[i]->wpackets;
-        prev[i]->ierr = curr[i]->ierr;
-        prev[i]->oerr = curr[i]->oerr;
-        prev[i]->coll = curr[i]->coll;
-        prev[i]->sat = curr[i]->sat;
+    char * pos = read_proc_file(file);
+    unsigned int n = 0;
+
+    if (pos == NULL)
+        return 0;
+
+    while ((pos = strchr(pos, '\n')) != NULL) {
+        pos++;
+        n++;
     }
+
+    return n;
 }
 
 /*
- ****************************************************** subscreen function **
- * Print IO statistics from /proc/diskstats.
+ ****************************************************** proc file function **
+ * Scan unsigned decimal number in /proc file line, leading blanks are
+ * skipped. Line isn't copied, position is moved past the number.
  *
  * IN:
- * @window          Window where stat will be printed.
- * @w_cmd           Window for errors and messages.
- * @c_ios           Snapshot for current stat.
- * @p_ios           Snapshot for previous stat.
- * @bdev            Number of devices.
- * @repaint         Repaint subscreen flag.
+ * @pos             Position in line.
+ *
+ * RETURNS:
+ * Number, 0 if there is no number at position.
  ****************************************************************************
  */
-void print_iostat(WINDOW * window, WINDOW * w_cmd, struct iodata_s *c_ios[],
-        struct iodata_s *p_ios[], unsigned int bdev, bool * repaint)
+unsigned long long scan_proc_number(char ** pos)
 {
-    /* if number of devices is changed, we should realloc structs and repaint subscreen */
-    if (bdev != count_block_devices()) {
-        wprintw(w_cmd, "The number of devices is changed. ");
-        *repaint = true;
-        return;
-    }
-
-    FILE *fp;
-    static unsigned long long uptime0[2] = {0, 0};
-    static unsigned long long itv;
-    static unsigned int curr = 1;
-    unsigned int i = 0;
-    char line[M_BUF_LEN];
-
-    unsigned int major, minor;
-    char devname[S_BUF_LEN];
-    unsigned long r_completed, r_merged, r_sectors, r_spent,
-                  w_completed, w_merged, w_sectors, w_spent,
-                  io_in_progress, t_spent, t_weighted;
-    double r_await[bdev], w_await[bdev];
-    
-    uptime0[curr] = 0;
-    read_uptime(&(uptime0[curr]));
-
-    /*
-     * If /proc/diskstats read failed, fire up repaint flag.
-     * Next when subscreen repainting fails, subscreen will be closed.
-     */
-    if ((fp = fopen(DISKSTATS_FILE, "r")) == NULL) {
-        wclear(window);
-        wprintw(window, "Do nothing. Can't open %s", DISKSTATS_FILE);
-        *repaint = true;
-        return;
-    }
-
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        sscanf(line, "%u %u %s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu",
-                    &major, &minor, devname,
-                    &r_completed, &r_merged, &r_sectors, &r_spent,
-                    &w_completed, &w_merged, &w_sectors, &w_spent,
-                    &io_in_progress, &t_spent, &t_weighted);
-        c_ios[i]->major = major;
-        c_ios[i]->minor = minor;
-        snprintf(c_ios[i]->devname, S_BUF_LEN, "%s", devname);
-        c_ios[i]->r_completed = r_completed;
-        c_ios[i]->r_merged = r_merged;
-        c_ios[i]->r_sectors = r_sectors;
-        c_ios[i]->r_spent = r_spent;
-        c_ios[i]->w_completed = w_completed;
-        c_ios[i]->w_merged = w_merged;
-        c_ios[i]->w_sectors = w_sectors;
-        c_ios[i]->w_spent = w_spent;
-        c_ios[i]->io_in_progress = io_in_progress;
-        c_ios[i]->t_spent = t_spent;
-        c_ios[i]->t_weighted = t_weighted;
-        i++;
-    }
-    fclose(fp);
-
-    itv = get_interval(uptime0[!curr], uptime0[curr]);
-                    
-    for (i = 0; i < bdev; i++) {
-        c_ios[i]->util = S_VALUE(p_ios[i]->t_spent, c_ios[i]->t_spent, itv);
-        c_ios[i]->await = ((c_ios[i]->r_completed + c_ios[i]->w_completed) - (p_ios[i]->r_completed + p_ios[i]->w_completed)) ?
-            ((c_ios[i]->r_spent - p_ios[i]->r_spent) + (c_ios[i]->w_spent - p_ios[i]->w_spent)) /
-            ((double) ((c_ios[i]->r_completed + c_ios[i]->w_completed) - (p_ios[i]->r_completed + p_ios[i]->w_completed))) : 0.0;
-        c_ios[i]->arqsz = ((c_ios[i]->r_completed + c_ios[i]->w_completed) - (p_ios[i]->r_completed + p_ios[i]->w_completed)) ?
-            ((c_ios[i]->r_sectors - p_ios[i]->r_sectors) + (c_ios[i]->w_sectors - p_ios[i]->w_sectors)) /
-            ((double) ((c_ios[i]->r_completed + c_ios[i]->w_completed) - (p_ios[i]->r_completed + p_ios[i]->w_completed))) : 0.0;
-
-        r_await[i] = (c_ios[i]->r_completed - p_ios[i]->r_completed) ?
-            (c_ios[i]->r_spent - p_ios[i]->r_spent) /
-            ((double) (c_ios[i]->r_completed - p_ios[i]->r_completed)) : 0.0;
-        w_await[i] = (c_ios[i]->w_completed - p_ios[i]->w_completed) ?
-            (c_ios[i]->w_spent - p_ios[i]->w_spent) /
-            ((double) (c_ios[i]->w_completed - p_ios[i]->w_completed)) : 0.0;
-    }
-
-    /* print headers */
-    wclear(window);
-    wattron(window, A_BOLD);
-    wprintw(window, "\nDevice:           rrqm/s  wrqm/s      r/s      w/s    rMB/s    wMB/s avgrq-sz avgqu-sz     await   r_await   w_await   %%util\n");
-    wattroff(window, A_BOLD);
+    char * p = *pos;
+    unsigned long long value = 0;
 
-    /* print statistics */
-    for (i = 0; i < bdev; i++) {
-        /* skip devices without iops */
-        if (c_ios[i]->r_completed == 0 && c_ios[i]->w_completed == 0) {
-            continue;
-        }
-        wprintw(window, "%6s:\t\t", c_ios[i]->devname);
-        wprintw(window, "%8.2f%8.2f",
-                S_VALUE(p_ios[i]->r_merged, c_ios[i]->r_merged, itv),
-                S_VALUE(p_ios[i]->w_merged, c_ios[i]->w_merged, itv));
-        wprintw(window, "%9.2f%9.2f",
-                S_VALUE(p_ios[i]->r_completed, c_ios[i]->r_completed, itv),
-                S_VALUE(p_ios[i]->w_completed, c_ios[i]->w_completed, itv));
-        wprintw(window, "%9.2f%9.2f%9.2f%9.2f",
-                S_VALUE(p_ios[i]->r_sectors, c_ios[i]->r_sectors, itv) / 2048,
-                S_VALUE(p_ios[i]->w_sectors, c_ios[i]->w_sectors, itv) / 2048,
-                c_ios[i]->arqsz,
-                S_VALUE(p_ios[i]->t_weighted, c_ios[i]->t_weighted, itv) / 1000.0);
-        wprintw(window, "%10.2f%10.2f%10.2f", c_ios[i]->await, r_await[i], w_await[i]);
-        wprintw(window, "%8.2f", c_ios[i]->util / 10.0);
-        wprintw(window, "\n");
-    }
-    wrefresh(window);
+    while (*p == ' ' || *p == '\t')
+        p++;
+    while (*p >= '0' && *p <= '9')
+        value = value * 10 + (*p++ - '0');
+    *pos = p;
 
-    /* save current stats snapshot */
-    replace_iodata(c_ios, p_ios, bdev);
-    curr ^= 1;
+    return value;
 }
 
 /*
- ******************************************************** routine function **
- * Get interface speed and duplex settings.
+ ****************************************************** proc file function **
+ * Scan word in /proc file line, leading blanks are skipped. Word ends with
+ * blank or delimiter, delimiter is skipped. Word isn't copied.
  *
  * IN:
- * @nicdata         Struct with NIC opts where speed and duplex will be saved.
+ * @pos             Position in line.
+ * @delim           Delimiter which ends word, e.g. ':' after key.
+ *
+ * OUT:
+ * @len             Word length.
+ *
+ * RETURNS:
+ * Pointer to the word in line.
  ****************************************************************************
  */
-void get_speed_duplex(struct nicdata_s * nicdata)
+char * scan_proc_word(char ** pos, char delim, unsigned int * len)
 {
-    struct ifreq ifr;
-    struct ethtool_cmd edata;
-    int status, sock;
-
-    sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (sock < 0) {
-        return;
-    }
-
-    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", nicdata->ifname);
-    ifr.ifr_data = (void *) &edata;
-    edata.cmd = ETHTOOL_GSET;
-    status = ioctl(sock, SIOCETHTOOL, &ifr);
-    close(sock);
-    
-    if (status < 0) {
-        return;
-    }
-
-    nicdata->speed = edata.speed * 1000000;
-    nicdata->duplex = edata.duplex;
-
+    char * p = *pos, * word;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+    word = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != delim)
+        p++;
+    *len = p - word;
+    if (*p == delim && delim != '\0')
+        p++;
+    *pos = p;
+
+    return word;
 }
 
 /*
- ****************************************************** subscreen function **
- * Print NIC statistics from /proc/net/dev.
+ ****************************************************** proc file function **
+ * Scan cpu times of /proc/stat line, in order of their columns.
  *
  * IN:
- * @window          Window where stat will be printed.
- * @w_cmd           Window for errors and messaged.
- * @c_nicd          Snapshot for current stat.
- * @p_nicd          Snapshot for previous stat.
- * @idev            Number of devices.
- * @repaint         Repaint subscreen flag.
+ * @pos             Position in line after cpu name.
+ *
+ * OUT:
+ * @cpu             Cpu times.
  ****************************************************************************
  */
-void print_nicstat(WINDOW * window, WINDOW * w_cmd, struct nicdata_s *c_nicd[],
-        struct nicdata_s *p_nicd[], unsigned int idev, bool * repaint)
+void scan_proc_cpu(char ** pos, struct cpu_s * cpu)
 {
-    /* if number of devices is changed, we should realloc structs and repaint subscreen */
-    if (idev != count_nic_devices()) {
-        wprintw(w_cmd, "The number of devices is changed.");
-        *repaint = true;
-        return;
-    }
-
-    FILE *fp;
-    static unsigned long long uptime0[2] = {0, 0};
-    static unsigned long long itv;
-    static unsigned int curr = 1;
-    unsigned int i = 0,
-        j = 0;
-    char line[L_BUF_LEN];
-    char ifname[IF_NAMESIZE + 1];
-    unsigned long lu[16];
-    static bool first = true;
-
-    uptime0[curr] = 0;
-    read_uptime(&(uptime0[curr]));
+    cpu->cpu_user = scan_proc_number(pos);
+    cpu->cpu_nice = scan_proc_number(pos);
+    cpu->cpu_sys = scan_proc_number(pos);
+    cpu->cpu_idle = scan_proc_number(pos);
+    cpu->cpu_iowait = scan_proc_number(pos);
+    cpu->cpu_hardirq = scan_proc_number(pos);
+    cpu->cpu_softirq = scan_proc_number(pos);
+    cpu->cpu_steal = scan_proc_number(pos);
+    cpu->cpu_guest = scan_proc_number(pos);
+    cpu->cpu_guest_nice = scan_proc_number(pos);
+}
 
-    /*
-     * If read /proc/net/dev failed, fire up repaint flag.
-     * Next when subscreen repainting fails, subscreen will be closed.
-     */
-    if ((fp = fopen(NETDEV_FILE, "r")) == NULL) {
-        wclear(window);
-        wprintw(window, "Do nothing. Can't open %s", NETDEV_FILE);
-        *repaint = true;
-        return;
-    }
+/*
+ ****************************************************** proc file function **
+ * Find backend process in the cache, process which isn't cached yet is
+ * added. /proc directory is opened on first call, then soft limit of open
+ * files is raised up to the hard one, and it defines how many processes
+ * files are kept open.
+ *
+ * IN:
+ * @cache           Processes cache of the screen.
+ * @pid             Backend pid.
+ *
+ * RETURNS:
+ * Cached process, or NULL if /proc can't be opened.
+ ****************************************************************************
+ */
+struct backend_proc_s * get_backend_proc(struct backends_cache_s * cache, int pid)
+{
+    struct backends_proc_s * bps = &backends_proc;
+    struct backend_proc_s * bp;
+    unsigned int lo = 0, hi = cache->n_pids, mid;
+    struct rlimit rl;
 
-    while (fgets(line, sizeof(line), fp) != NULL) {
-        if (j < 2) {
-            j++;
-            continue;       /* skip headers */
+    if (bps->dir_fd == -1) {
+        if ((bps->dir_fd = open(PROC_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+            return NULL;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
+            getrlimit(RLIMIT_NOFILE, &rl);
+            if (rl.rlim_cur > BACKEND_FD_RESERVE)
+                bps->max_fds = MIN(rl.rlim_cur - BACKEND_FD_RESERVE, INT_MAX);
         }
-        sscanf(line, "%s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu",
-                ifname,
-             /* rbps    rpps    rerrs   rdrop   rfifo   rframe  rcomp   rmcast */
-                &lu[0], &lu[1], &lu[2], &lu[3], &lu[4], &lu[5], &lu[6], &lu[7],
-             /* wbps    wpps    werrs    wdrop    wfifo    wcoll    wcarrier wcomp */
-                &lu[8], &lu[9], &lu[10], &lu[11], &lu[12], &lu[13], &lu[14], &lu[15]);
-        snprintf(c_nicd[i]->ifname, IF_NAMESIZE + 1, "%s", ifname);
-        c_nicd[i]->rbytes = lu[0];
-        c_nicd[i]->rpackets = lu[1];
-        c_nicd[i]->wbytes = lu[8];
-        c_nicd[i]->wpackets = lu[9];
-        c_nicd[i]->ierr = lu[2];
-        c_nicd[i]->oerr = lu[10];
-        c_nicd[i]->coll = lu[13];
-        c_nicd[i]->sat = lu[2];
-        c_nicd[i]->sat += lu[3];
-        c_nicd[i]->sat += lu[11];
-        c_nicd[i]->sat += lu[12];
-        c_nicd[i]->sat += lu[13];
-        c_nicd[i]->sat += lu[14];
-        i++;
     }
-    fclose(fp);
 
-    if (first) {
-        for (i = 0; i < idev; i++)
-            get_speed_duplex(c_nicd[i]);
-        first = false;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (cache->pids[mid].pid == pid)
+            return &cache->pids[mid];
+        if (cache->pids[mid].pid < pid)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
-    itv = get_interval(uptime0[!curr], uptime0[curr]);
+    if (cache->n_pids == cache->size) {
+        cache->size = (cache->size > 0) ? cache->size * 2 : 64;
+        if ((cache->pids = realloc(cache->pids, sizeof(struct backend_proc_s) * cache->size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for backends processes failed.\n");
+        }
+    }
+    memmove(&cache->pids[lo + 1], &cache->pids[lo], sizeof(struct backend_proc_s) * (cache->n_pids - lo));
+    cache->n_pids++;
 
-    /* print headers */
-    wclear(window);
-    wattron(window, A_BOLD);
-    wprintw(window, "\n    Interface:   rMbps   wMbps    rPk/s    wPk/s     rAvs     wAvs     IErr     OErr     Coll      Sat   %%rUtil   %%wUtil    %%Util\n");
-    wattroff(window, A_BOLD);
+    bp = &cache->pids[lo];
+    bp->pid = pid;
+    bp->stat_fd = bp->io_fd = -1;
+    bp->seen = false;
 
-    double rbps, rpps, wbps, wpps, ravs, wavs, ierr, oerr, coll, sat, rutil, wutil, util;
+    return bp;
+}
 
-    for (i = 0; i < idev; i++) {
-        /* skip interfaces which never seen packets */
-        if (c_nicd[i]->rpackets == 0 && c_nicd[i]->wpackets == 0) {
-           continue;
+/*
+ ****************************************************** proc file function **
+ * Release cached processes which aren't seen in the last query result and
+ * close their files. Seen flags are reset for the next result.
+ *
+ * IN:
+ * @cache           Processes cache of the screen.
+ ****************************************************************************
+ */
+void release_backends_proc(struct backends_cache_s * cache)
+{
+    struct backends_proc_s * bps = &backends_proc;
+    struct backend_proc_s * bp;
+    unsigned int i, n = 0;
+
+    for (i = 0; i < cache->n_pids; i++) {
+        bp = &cache->pids[i];
+        if (bp->seen) {
+            bp->seen = false;
+            cache->pids[n++] = *bp;
+            continue;
         }
+        if (bp->stat_fd >= 0) {
+            close(bp->stat_fd);
+            bps->n_fds--;
+        }
+        if (bp->io_fd >= 0) {
+            close(bp->io_fd);
+            bps->n_fds--;
+        }
+    }
+    cache->n_pids = n;
+}
 
-        rbps = S_VALUE(p_nicd[i]->rbytes, c_nicd[i]->rbytes, itv);
-        wbps = S_VALUE(p_nicd[i]->wbytes, c_nicd[i]->wbytes, itv);
-        rpps = S_VALUE(p_nicd[i]->rpackets, c_nicd[i]->rpackets, itv);
-        wpps = S_VALUE(p_nicd[i]->wpackets, c_nicd[i]->wpackets, itv);
-        ierr = S_VALUE(p_nicd[i]->ierr, c_nicd[i]->ierr, itv);
-        oerr = S_VALUE(p_nicd[i]->oerr, c_nicd[i]->oerr, itv);
-        coll = S_VALUE(p_nicd[i]->coll, c_nicd[i]->coll, itv);
-        sat = S_VALUE(p_nicd[i]->sat, c_nicd[i]->sat, itv);
-
-	/* if no data about pps, zeroing averages */
-        (rpps > 0) ? ( ravs = rbps / rpps ) : ( ravs = 0 );
-        (wpps > 0) ? ( wavs = wbps / wpps ) : ( wavs = 0 );
-
-        /* Calculate utilisation */
-        if (c_nicd[i]->speed > 0) {
-            /*
-             * The following have a mysterious "800",
-             * it is 100 for the % conversion, and 8 for bytes2bits.
-             */
-            rutil = min(rbps * 800 / c_nicd[i]->speed, 100);
-            wutil = min(wbps * 800 / c_nicd[i]->speed, 100);
-            if (c_nicd[i]->duplex == 2) {
-                /* Full duplex */
-                util = max(rutil, wutil);
-            } else {
-                /* Half Duplex */
-                util = min((rbps + wbps) * 800 / c_nicd[i]->speed, 100);
-            }
-        } else {
-            util = rutil = wutil = 0;
+/*
+ ****************************************************** proc file function **
+ * Read file of backend process into the common buffer. File is opened
+ * relative to /proc directory and is kept open while descriptors limit
+ * allows. Kept descriptor fails when process exits, then file is opened
+ * again, because pid might be reused by new backend.
+ *
+ * IN:
+ * @bp              Cached backend process.
+ * @fd              Kept descriptor of file.
+ * @name            File name in process directory.
+ *
+ * RETURNS:
+ * Length of contents, or -1 if file can't be read.
+ ****************************************************************************
+ */
+int read_backend_file(struct backend_proc_s * bp, int * fd, const char * name)
+{
+    struct backends_proc_s * bps = &backends_proc;
+    char path[S_BUF_LEN];
+    ssize_t n;
+    int f;
+
+    if (*fd == BACKEND_FD_DENIED)
+        return -1;
+
+    if (*fd >= 0) {
+        if ((n = pread(*fd, bps->buf, BACKEND_BUF_LEN - 1, 0)) >= 0) {
+            bps->buf[n] = '\0';
+            return n;
         }
+        close(*fd);
+        *fd = -1;
+        bps->n_fds--;
+    }
 
-        /* print statistics */
-        wprintw(window, "%14s", c_nicd[i]->ifname);
-        wprintw(window, "%8.2f%8.2f", rbps / 1024 / 128, wbps / 1024 / 128);
-        wprintw(window, "%9.2f%9.2f", rpps, wpps);
-        wprintw(window, "%9.2f%9.2f", ravs, wavs);
-        wprintw(window, "%9.2f%9.2f%9.2f%9.2f", ierr, oerr, coll, sat);
-        wprintw(window, "%9.2f%9.2f%9.2f", rutil, wutil, util);
-        wprintw(window, "\n");
+    snprintf(path, sizeof(path), "%d/%s", bp->pid, name);
+    if ((f = openat(bps->dir_fd, path, O_RDONLY | O_CLOEXEC)) == -1
+            || (n = pread(f, bps->buf, BACKEND_BUF_LEN - 1, 0)) == -1) {
+        /* io of process of another user isn't readable, it isn't tried again */
+        if (errno == EACCES)
+            *fd = BACKEND_FD_DENIED;
+        if (f != -1)
+            close(f);
+        return -1;
     }
+    bps->buf[n] = '\0';
 
-    wrefresh(window);
+    if (bps->n_fds < bps->max_fds) {
+        *fd = f;
+        bps->n_fds++;
+    } else
+        close(f);
 
-    /* save current stats snapshot */
-    replace_nicdata(c_nicd, p_nicd, idev);
-    curr ^= 1;
+    return n;
 }
 
 /*
- ******************************************************** routine function **
- * Calculate column width for output data.
+ ****************************************************** proc file function **
+ * Read stats of backend process from /proc/<pid>/stat and /proc/<pid>/io.
+ * State and RSS are taken from stat, so status isn't read. Io is readable
+ * only by owner of process, its values are zero otherwise.
  *
  * IN:
- * @n_rows          Number of rows in query result.
- * @n_cols          Number of columns in query result.
- * @screen          Screen options.
- * @res             Query result.
- * @arr             Array with sorted result.
+ * @bp              Cached backend process.
  *
  * OUT:
- * @columns         Struct with column names and their max width.
+ * @st              Process stats.
+ *
+ * RETURNS:
+ * True if stats are read, false if process isn't found.
  ****************************************************************************
  */
-void calculate_width(struct colAttrs *columns, PGresult *res,
-    struct screen_s * screen, char ***arr, unsigned int n_rows, unsigned int n_cols)
+bool read_backend_stat(struct backend_proc_s * bp, struct backend_stat_s * st)
 {
-    unsigned int i, col, row;
-    struct context_s ctx;
+    char * pos, * line, * key;
+    unsigned long long ticks;
+    unsigned int i, len;
 
-    /* determine current context */
-    if (screen != NULL)
-        for (i = 0; i < TOTAL_CONTEXTS; i++) {
-            if (screen->current_context == screen->context_list[i].context)
-                ctx = screen->context_list[i];
-        }
+    memset(st, 0, sizeof(struct backend_stat_s));
+    if (read_backend_file(bp, &bp->stat_fd, "stat") <= 0
+            || (pos = strrchr(backends_proc.buf, ')')) == NULL)
+        return false;
 
-    for (col = 0, i = 0; col < n_cols; col++, i++) {
-        /* determine length of column names */
-        if (strlen(ctx.fstrings[i]) > 0 && screen != NULL)
-            /* mark columns with filtration */
-            snprintf(columns[i].name, sizeof(columns[i].name), "%s*", PQfname(res, col));
-        else
-            snprintf(columns[i].name, sizeof(columns[i].name), "%s", PQfname(res, col));
+    /* command might contain blanks and parens, fields are counted from its end */
+    pos++;
+    st->state = *scan_proc_word(&pos, '\0', &len);
+    /* ppid..cmajflt, some of them might be negative */
+    for (i = 4; i < 14; i++)
+        scan_proc_word(&pos, '\0', &len);
+    ticks = scan_proc_number(&pos);                 /* utime */
+    ticks += scan_proc_number(&pos);                /* stime */
+    /* cutime..vsize */
+    for (i = 16; i < 24; i++)
+        scan_proc_word(&pos, '\0', &len);
+    st->rss_mb = scan_proc_number(&pos) * sysconf(_SC_PAGESIZE) / 1048576;
+    st->cpu = (HZ > 0) ? ticks * 100 / HZ : 0;
+
+    if (read_backend_file(bp, &bp->io_fd, "io") <= 0)
+        return true;
 
-        unsigned int width = strlen(PQfname(res, col));
-        if (arr == NULL) {
-            for (row = 0; row < n_rows; row++ ) {
-                unsigned int val_len = strlen(PQgetvalue(res, row, col));
-                if ( val_len >= width )
-                    width = val_len;
-            }
-        } else {
-            /* determine length of values from result array */
-            for (row = 0; row < n_rows; row++ ) {
-                unsigned int val_len = strlen(arr[row][col]);
-                if ( val_len >= width )
-                    width = val_len;
-            }
-        }
-        /* set column width equal to longest value + 2 spaces */
-        columns[i].width = width + 2;
+    pos = backends_proc.buf;
+    while ((line = next_proc_line(&pos)) != NULL) {
+        key = scan_proc_word(&line, ':', &len);
+        if (len == 10 && strncmp(key, "read_bytes", len) == 0)
+            st->read_kb = scan_proc_number(&line) / 1024;
+        else if (len == 11 && strncmp(key, "write_bytes", len) == 0)
+            st->write_kb = scan_proc_number(&line) / 1024;
     }
+
+    return true;
 }
 
 /*
- ************************************************** system window function **
- * Get PostgreSQL uptime
+ ************************************************* summary window function **
+ * Read /proc/loadavg and return load average values.
  *
- * IN:
- * @conn
+ * RETURNS:
+ * Load average for 1, 5, 15 minutes.
  ****************************************************************************
  */
-void get_pg_uptime(PGconn * conn, char * uptime)
+float * get_loadavg()
 {
-    static char errmsg[ERRSIZE];
-    PGresult * res;
+    static float la[3];
+    char * buf;
 
-    if ((res = do_query(conn, PG_UPTIME_QUERY, errmsg)) != NULL) {
-        snprintf(uptime, S_BUF_LEN, "%s", PQgetvalue(res, 0, 0));
-        PQclear(res);
+    if ((buf = read_proc_file(proc_loadavg)) != NULL) {
+        if ((sscanf(buf, "%f %f %f", &la[0], &la[1], &la[2])) != 3)
+            la[0] = la[1] = la[2] = 0;            /* something goes wrong */
     } else {
-        snprintf(uptime, S_BUF_LEN, "--:--:--");
+        la[0] = la[1] = la[2] = 0;                /* can't read statfile */
     }
+
+    return la;
 }
 
 /*
- ************************************************** system window function **
- * Print PostgreSQL general info
+ ************************************************* summary window function **
+ * Print load average to the summary window.
  *
  * IN:
- * @window          Window where result will be printed.
- * @screen          Screen with postgres version info.
- * @conn            Current connection.
+ * @window      Window where load average will be printed.
  ****************************************************************************
  */
-void print_pg_general(WINDOW * window, struct screen_s * screen, PGconn * conn)
+void print_loadavg(WINDOW * window)
 {
-    static char uptime[S_BUF_LEN];
-    get_pg_uptime(conn, uptime);
-
-    wprintw(window, " (ver: %s, up %s)", screen->pg_special.pg_version, uptime);
+    float * la = get_loadavg();
+    wprintw(window, "load average: %.2f, %.2f, %.2f\n", la[0], la[1], la[2]);
 }
 
 /*
- ************************************************** system window function **
- * Print (auto)vacuum info.
+ ************************************************* summary window function **
+ * Print current connection info.
  *
  * IN:
- * @window          Window where result will be printed.
- * @screen	    Screen information.
- * @conn            Current postgres connection.
+ * @window          Window where info will be printed.
+ * @conn            Current connection.
+ * @console_no      Current console number.
  ****************************************************************************
  */
-void print_vacuum_info(WINDOW * window, struct screen_s * screen, PGconn * conn)
+void print_conninfo(WINDOW * window, PGconn *conn, unsigned int console_no)
 {
-    unsigned int av_count = 0,		/* total number of autovacuum workers */
-		 avw_count = 0,		/* number of wraparound workers */
-		 mv_count = 0;		/* number of manual vacuums executed by user */
-    char vac_maxtime[XS_BUF_LEN] = "--:--:--";		/* the longest worker or vacuum */
-    PGresult *res;
-    static char errmsg[ERRSIZE];
-    
-    if ((res = do_query(conn, PG_STAT_ACTIVITY_AV_COUNT_QUERY, errmsg)) != NULL) {
-        av_count = atoi(PQgetvalue(res, 0, 0));
-        avw_count = atoi(PQgetvalue(res, 0, 1));
-        mv_count = atoi(PQgetvalue(res, 0, 2));
-        snprintf(vac_maxtime, sizeof(vac_maxtime), "%s", PQgetvalue(res, 0, 3));
-        PQclear(res);
+    const char * states[] = { "ok", "failed", "unknown" };
+    int st_index;
+    char buffer[CONNINFO_TITLE_LEN];
+
+    switch (PQstatus(conn)) {
+        case CONNECTION_OK:
+            st_index = 0;	/* ok */
+            break;
+        case CONNECTION_BAD:
+            st_index = 1;	/* failed */
+            break;
+        default:
+            st_index = 2;	/* unknown */
+            break;
     }
-    
-    mvwprintw(window, 2, COLS / 2, "autovacuum: %2u/%u workers/max, %2u manual, %2u wraparound, %s vac_maxtime",
-                    av_count, screen->pg_special.av_max_workers, mv_count, avw_count, vac_maxtime);
+
+    snprintf(buffer, sizeof(buffer), "conn%i [%s]: %s:%s %s@%s",
+                console_no, states[st_index],
+                PQhost(conn), PQport(conn),
+                PQuser(conn), PQdb(conn));
+
+    mvwprintw(window, 0, COLS / 2, "%s", buffer);
     wrefresh(window);
 }
 
 /*
- ****************************************************** key press function **
- * Switch console using specified number.
+ ************************************************** system window function **
+ * Get postgres stats shown in sysstat screen. All queries are sent as single 
+ * multi-statement query, so stats are collected in one round trip. Results
+ * are waited together with keys, so slow query doesn't block the console.
  *
  * IN:
- * @window          Window where cmd status will be written.
- * @screens[]       Struct array with screens options.
- * @ch              Intercepted key (number from 1 to 8).
- * @console_no      Active console number.
- * @console_index   Index of active console.
- * @first_iter      Reset previous results.
+ * @conn            Current postgres connection.
+ * @screen          Screen with postgres version info.
+ *
+ * OUT:
+ * @stats           Postgres stats, zeroed if stats aren't available.
  *
  * RETURNS:
- * Index console on which performed switching.
+ * False if query is canceled due to key press.
  ****************************************************************************
  */
-unsigned int switch_conn(WINDOW * window, struct screen_s * screens[],
-                unsigned int ch, unsigned int console_index, unsigned int console_no, PGresult * res, bool * first_iter)
+bool get_pg_stats(PGconn * conn, struct screen_s * screen, struct pg_stat_s * stats)
 {
-    wclear(window);
-    if ( screens[ch - '0' - 1]->conn_used ) {
-        console_no = ch - '0', console_index = console_no - 1;
-        wprintw(window, "Switch to console %i.", console_no);
-        *first_iter = true;
-        PQclear(res);
-    } else
-        wprintw(window, "No connection associated, stay on console %i.", console_no);
+    PGresult *res;
+    char query[QUERY_MAXLEN];
+    unsigned int i;
 
-    return console_index;
-}
+    memset(stats, 0, sizeof(struct pg_stat_s));
+    snprintf(stats->uptime, sizeof(stats->uptime), "--:--:--");
+    snprintf(stats->vac_maxtime, sizeof(stats->vac_maxtime), "--:--:--");
+    snprintf(stats->xact_maxtime, sizeof(stats->xact_maxtime), "--:--:--");
 
-/*
- ******************************************************** routine function **
- * Allocate memory for 3D pointer array.
- *
- * IN:
- * @arr             3D pointer array.
- * @n_rows          Number of rows in the current query result.
- * @n_cols          Number of columns in the current query result.
- *
- * RETURNS:
- * Returns allocated space based on rows and column numbers.
- ****************************************************************************
- */
-char *** init_array(char ***arr, unsigned int n_rows, unsigned int n_cols)
-{
-    unsigned int i, j;
+    if (PQstatus(conn) == CONNECTION_BAD)
+        return true;
 
-    if ((arr = malloc(sizeof(char **) * n_rows)) == NULL) {
-        mreport(true, msg_fatal, "FATAL: malloc for stats array failed.\n");
-    }
-    for (i = 0; i < n_rows; i++) {
-        if ((arr[i] = malloc(sizeof(char *) * n_cols)) == NULL) {
-            mreport(true, msg_fatal, "FATAL: malloc for rows stats failed.\n");
+    snprintf(query, QUERY_MAXLEN, "%s %s",
+            (atoi(screen->pg_special.pg_version_num) < PG96)
+                ? PG_SYS_STAT_ACTIVITY_95_QUERY
+                : PG_SYS_STAT_ACTIVITY_QUERY,
+            PG_STAT_STATEMENTS_SYS_QUERY);
+
+    if (PQsendQuery(conn, query) == 0)
+        return true;
+
+    /* each statement returns its own result, all of them must be consumed */
+    for (i = 0; ; i++) {
+        while (PQisBusy(conn)) {
+            if (wait_for_input(conn, -1) == false) {
+                cancel_query(conn);
+                return false;
+            }
+            if (PQconsumeInput(conn) == 0)
+                break;
         }
-        for (j = 0; j < n_cols; j++)
-            if ((arr[i][j] = malloc(sizeof(char) * BUFSIZ)) == NULL) {
-                mreport(true, msg_fatal, "FATAL: malloc for cols stats failed.\n");
+        if ((res = PQgetResult(conn)) == NULL)
+            break;
+
+        if (PQresultStatus(res) == PG_TUP_OK && PQntuples(res) > 0) {
+            switch (i) {
+                case 0:                 /* pg_stat_activity */
+                    snprintf(stats->uptime, sizeof(stats->uptime), "%s", PQgetvalue(res, 0, 0));
+                    stats->t_count = atoi(PQgetvalue(res, 0, 1));
+                    stats->i_count = atoi(PQgetvalue(res, 0, 2));
+                    stats->x_count = atoi(PQgetvalue(res, 0, 3));
+                    stats->a_count = atoi(PQgetvalue(res, 0, 4));
+                    stats->w_count = atoi(PQgetvalue(res, 0, 5));
+                    stats->o_count = atoi(PQgetvalue(res, 0, 6));
+                    stats->av_count = atoi(PQgetvalue(res, 0, 7));
+                    stats->avw_count = atoi(PQgetvalue(res, 0, 8));
+                    stats->mv_count = atoi(PQgetvalue(res, 0, 9));
+                    snprintf(stats->vac_maxtime, sizeof(stats->vac_maxtime), "%s", PQgetvalue(res, 0, 10));
+                    snprintf(stats->xact_maxtime, sizeof(stats->xact_maxtime), "%s", PQgetvalue(res, 0, 11));
+                    break;
+                case 1:                 /* pg_stat_statements */
+                    stats->avgtime = atof(PQgetvalue(res, 0, 0));
+                    stats->total_calls = atoll(PQgetvalue(res, 0, 1));
+                    stats->pgss_ok = true;
+                    break;
+                default:
+                    break;
             }
+        }
+        PQclear(res);
     }
-    return arr;
+
+    stats->ts = get_monotonic_time();
+    return true;
 }
 
 /*
- ******************************************************** routine function **
- * Free space occupied by 3D pointer arrays
- *
- * IN:      
- * @arr             3D pointer array.
- * @n_rows          Number of rows in the current query result.
- * @n_cols          Number of columns in the current query result.
+ ************************************************** system window function **
+ * Print current postgres process activity: number of total/idle/idle in 
+ * transaction/active/waiting/others backends.
  *
- * RETURNS:
- * Returns pointer to empty 3D pointer array.
+ * IN:
+ * @window          Window where info will be printed.
+ * @stats           Postgres stats collected on current iteration.
  ****************************************************************************
  */
-char *** free_array(char ***arr, unsigned int n_rows, unsigned int n_cols)
+void print_postgres_activity(WINDOW * window, struct pg_stat_s * stats)
 {
-    unsigned int i, j;
-
-    for (i = 0; i < n_rows; i++) {
-        for (j = 0; j < n_cols; j++)
-            free(arr[i][j]);
-        free(arr[i]);
-    }
-    free(arr);
-    return arr;
+    mvwprintw(window, 1, COLS / 2,
+            "  activity:%3i total,%3i idle,%3i idle_in_xact,%3i active,%3i waiting,%3i others",
+            stats->t_count, stats->i_count, stats->x_count, stats->a_count, stats->w_count, stats->o_count);
+    wrefresh(window);
 }
 
 /*
- ******************************************************** routine function **
- * Copy database query results into an array.
+ ************************************************** system window function **
+ * Print pg_stat_statements related info.
  *
  * IN:
- * @arr             3D pointer array where query results will be stored.
- * @res             Database query result.
- * @n_rows          Number of rows in the query result.
- * @n_cols          Number of cols in the query result.
+ * @window          Window where info will be printed.
+ * @stats           Postgres stats collected on current iteration.
  ****************************************************************************
  */
-void pgrescpy(char ***arr, PGresult *res, unsigned int n_rows, unsigned int n_cols)
+void print_pgss_info(WINDOW * window, struct pg_stat_s * stats)
 {
-    unsigned int i, j;
+    static unsigned int qps;
+    static long long prev_queries = 0;
+    static double prev_ts = 0;
+
+    if (stats->pgss_ok) {
+        /* rate is calculated using time elapsed between queries completion */
+        qps = (prev_ts > 0 && stats->ts > prev_ts && stats->total_calls >= prev_queries)
+            ? (stats->total_calls - prev_queries) / (stats->ts - prev_ts)
+            : 0;
+        prev_queries = stats->total_calls;
+        prev_ts = stats->ts;
+    } else {
+        qps = 0;
+    }
 
-    for (i = 0; i < n_rows; i++)
-        for (j = 0; j < n_cols; j++) {
-            snprintf(arr[i][j], XL_BUF_LEN, "%s", PQgetvalue(res, i, j));
-        }
+    mvwprintw(window, 3, COLS / 2,
+            "statements: %3i stmt/s,  %3.3f stmt_avgtime, %s xact_maxtime",
+            qps, stats->avgtime, stats->xact_maxtime);
+    wrefresh(window);
 }
 
 /*
- ******************************************************** routime function **
- * Compare arrays and build diff array with deltas.
- *
- * IN:
- * @p_arr           Array with results of previous query.
- * @c_arr           Array with results of current query.
- * @context         Current used query.
- * @n_rows          Total number of rows from query result.
- * @n_cols          Total number of columns from query result.
+ ******************************************************* get stat function **
+ * Allocate memory for statistics structs.
  *
  * OUT:
- * @res_arr         Array where difference result will be stored.
+ * @st_cpu          Struct for cpu statistics.
+ * @st_mem_short    Struct for mem statistics.
  ****************************************************************************
  */
-void diff_arrays(char ***p_arr, char ***c_arr, char ***res_arr, struct screen_s * screen,
-		unsigned int n_rows, unsigned int n_cols, unsigned long interval)
+void init_stats(struct cpu_s *st_cpu[], struct mem_s **st_mem_short)
 {
-    unsigned int i, j, min = 0, max = 0;
-    unsigned int divisor;
- 
-    switch (screen->current_context) {
-        case pg_stat_database:
-            min = PG_STAT_DATABASE_DIFF_MIN;
-            (atoi(screen->pg_special.pg_version_num) < PG92)
-                ? (max = PG_STAT_DATABASE_DIFF_MAX_91)
-                : (max = PG_STAT_DATABASE_DIFF_MAX_LT);
-            break;
-        case pg_stat_replication:
-            /* diff nothing, use returned values as-is */
-            min = max = INVALID_ORDER_KEY;
-            break;
-        case pg_stat_tables:
-            min = PG_STAT_TABLES_DIFF_MIN;
-            max = PG_STAT_TABLES_DIFF_MAX;
-            break;
-        case pg_stat_indexes:
-            min = PG_STAT_INDEXES_DIFF_MIN;
-            max = PG_STAT_INDEXES_DIFF_MAX;
-            break;
-        case pg_statio_tables:
-            min = PG_STATIO_TABLES_DIFF_MIN;
-            max = PG_STATIO_TABLES_DIFF_MAX;
-            break;
-        case pg_tables_size:
-            min = PG_TABLES_SIZE_DIFF_MIN;
-            max = PG_TABLES_SIZE_DIFF_MAX;
-            break;
-        case pg_stat_activity_long:
-            /* diff nothing, use returned values as-is */
-            min = max = INVALID_ORDER_KEY;
-            break;
-        case pg_stat_functions:
-            /* only one column for diff */
-            min = max = PG_STAT_FUNCTIONS_DIFF_MIN;
-            break;
-        case pg_stat_statements_timing:
-            if (atoi(screen->pg_special.pg_version_num) < PG92) {
-                min = PGSS_TIMING_DIFF_MIN_91;
-                max = PGSS_TIMING_DIFF_MAX_91;
-            } else {
-                min = PGSS_TIMING_DIFF_MIN_LT;
-                max = PGSS_TIMING_DIFF_MAX_LT;
-            }
-            break;
-        case pg_stat_statements_general:
-            min = PGSS_GENERAL_DIFF_MIN_LT;
-            max = PGSS_GENERAL_DIFF_MAX_LT;
-            break;
-        case pg_stat_statements_io:
-            if (atoi(screen->pg_special.pg_version_num) < PG92) {
-                min = PGSS_IO_DIFF_MIN_91;
-                max = PGSS_IO_DIFF_MAX_91;
-            } else {
-                min = PGSS_IO_DIFF_MIN_LT;
-                max = PGSS_IO_DIFF_MAX_LT;
-            }
-            break;
-        case pg_stat_statements_temp:
-            min = PGSS_TEMP_DIFF_MIN_LT;
-            max = PGSS_TEMP_DIFF_MAX_LT;
-            break;
-        case pg_stat_statements_local:
-            if (atoi(screen->pg_special.pg_version_num) < PG92) {
-                min = PGSS_LOCAL_DIFF_MIN_91;
-                max = PGSS_LOCAL_DIFF_MAX_91;
-            } else {
-                min = PGSS_LOCAL_DIFF_MIN_LT;
-                max = PGSS_LOCAL_DIFF_MAX_LT;
-            }
-            break;
-        case pg_stat_progress_vacuum:
-            /* diff nothing, use returned values as-is */
-            min = max = INVALID_ORDER_KEY;
-            break;
-        default:
-            break;
+    unsigned int i;
+    /* Allocate structures for CPUs "all" and 0 */
+    for (i = 0; i < 2; i++) {
+        if ((st_cpu[i] = (struct cpu_s *) malloc(STATS_CPU_SIZE * 2)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for cpu stats failed.\n");
+        }
+        memset(st_cpu[i], 0, STATS_CPU_SIZE * 2);
     }
 
-    divisor = interval / 1000000;
-    for (i = 0; i < n_rows; i++) {
-        for (j = 0; j < n_cols; j++)
-            if (j < min || j > max)
-                snprintf(res_arr[i][j], XL_BUF_LEN, "%s", c_arr[i][j]);     /* copy unsortable values as is */
-            else {
-                snprintf(res_arr[i][j], XL_BUF_LEN, "%lli", (atoll(c_arr[i][j]) - atoll(p_arr[i][j])) / divisor);
-            }
+    /* Allocate structures for memory */
+    if ((*st_mem_short = (struct mem_s *) malloc(STATS_MEM_SIZE)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for memory stats failed.\n");
     }
+    memset(*st_mem_short, 0, STATS_MEM_SIZE);
 }
 
 /*
- ******************************************************** routine function **
- * Sort array using specified order key (column number).
- *
- * IN:
- * @res_arr         Array which content will be sorted.
- * @n_rows          Number of rows in query result.
- * @n_cols          Number of columns in query result.
- * @screen          Current screen.
+ ******************************************************* get stat function **
+ * Allocate memory for IO statistics structs.
  *
  * OUT:
- * @res_arr         Sorted array.
+ * @c_ios       Struct for current stats snapshot.
+ * @p_ios       Struct for previous stats snapshot.
+ * @bdev        Number of block devices.
  ****************************************************************************
  */
-void sort_array(char ***res_arr, unsigned int n_rows, unsigned int n_cols, struct screen_s * screen)
+void init_iostats(struct iodata_s *c_ios[], struct iodata_s *p_ios[], unsigned int bdev)
 {
-    unsigned int i, order_key = 0;
-    bool desc = false;
-
-    for (i = 0; i < TOTAL_CONTEXTS; i++)
-        if (screen->current_context == screen->context_list[i].context) {
-            order_key = screen->context_list[i].order_key;
-            desc = screen->context_list[i].order_desc;
+    unsigned int i;
+    for (i = 0; i < bdev; i++) {
+        if ((c_ios[i] = (struct iodata_s *) malloc(STATS_IODATA_SIZE)) == NULL ||
+            (p_ios[i] = (struct iodata_s *) malloc(STATS_IODATA_SIZE)) == NULL) {
+                mreport(true, msg_fatal, "FATAL: malloc for iostat failed.\n");
         }
-
-    /* don't sort arrays with invalid key */
-    if (order_key == INVALID_ORDER_KEY)
-        return;
-
-    /* 
-     * Comparator function depends on column data type. 
-     * So check first element of an array, is it a string or number. 
-     */
-    if (check_string(&res_arr[0][order_key][0], is_number) == -1) {
-        (desc)
-            ? qsort_r(res_arr, n_rows, sizeof(char **), str_cmp_desc, &order_key)
-            : qsort_r(res_arr, n_rows, sizeof(char **), str_cmp_asc, &order_key);
-    } else {
-        (desc)
-            ? qsort_r(res_arr, n_rows, sizeof(char **), int_cmp_desc, &order_key)
-            : qsort_r(res_arr, n_rows, sizeof(char **), int_cmp_asc, &order_key);
     }
 }
 
 /*
- ******************************************************** routine function **
- * Allocate memory for column attributes struct.
+ ******************************************************* get stat function **
+ * Free memory consumed by IO statistics structs.
  *
- * IN:
- * n_cols:      Number of columns.
+ * OUT:
+ * @c_ios       Struct for current stats snapshot.
+ * @p_ios       Struct for previous stats snapshot.
+ * @bdev        Number of block devices.
  ****************************************************************************
  */
-struct colAttrs * init_colattrs(unsigned int n_cols) {
-    struct colAttrs *cols;
-    if ((cols = (struct colAttrs *) malloc(sizeof(struct colAttrs) * n_cols)) == NULL) {
-        mreport(true, msg_fatal, "FATAL: malloc for column attributes failed.\n");
+void free_iostats(struct iodata_s *c_ios[], struct iodata_s *p_ios[], unsigned int bdev)
+{
+    unsigned int i;
+    for (i = 0; i < bdev; i++) {
+        free(c_ios[i]);
+        free(p_ios[i]);
     }
-    return cols;
 }
 
 /*
- ******************************************************** routine function **
- * Set filtration pattern or reset one.
+ ******************************************************* get stat function **
+ * Allocate memory for NIC data structs.
  *
- * IN:
- * @win                 Window for diagnose messages.
- * @screen              Screen options (filtration patterns array).
- * @res                 Reset postgres query results after setup filtration.
- * @first_iter          Reset data.
- ****************************************************************************
- */
-void set_filter(WINDOW * win, struct screen_s * screen, PGresult * res, bool * first_iter) {
+ * OUT:
+ * @c_nicdata       Struct for current stats snapshot.
+ * @p_nicdata       Struct for previous stats snapshot.
+ * @idev            Number of interfaces.
+ ****************************************************************************
+ */
+void init_nicdata(struct nicdata_s *c_nicdata[], struct nicdata_s *p_nicdata[], unsigned int idev)
+{
+    unsigned int i;
+    for (i = 0; i < idev; i++) {
+        if ((c_nicdata[i] = (struct nicdata_s *) malloc(STATS_NICDATA_SIZE)) == NULL ||
+            (p_nicdata[i] = (struct nicdata_s *) malloc(STATS_NICDATA_SIZE)) == NULL ) {
+                mreport(true, msg_fatal, "FATAL: malloc for nicstat failed.\n");
+        }
+
+	/* initialize interfaces with unknown speed and duplex */
+	c_nicdata[i]->speed = -1;
+	c_nicdata[i]->duplex = DUPLEX_UNKNOWN;
+    }
+}
+
+/*
+ ******************************************************* get stat function **
+ * Free memory consumed by NIC data structs.
+ *
+ * OUT:
+ * @c_nicdata      Struct for current stats snapshot.
+ * @p_nicdata      Struct for previous stats snapshot.
+ * @idev           Number of block devices.
+ ****************************************************************************
+ */
+void free_nicdata(struct nicdata_s *c_nicdata[], struct nicdata_s *p_nicdata[], unsigned int idev)
+{
+    unsigned int i;
+    for (i = 0; i < idev; i++) {
+        free(c_nicdata[i]);
+        free(p_nicdata[i]);
+    }
+}
+
+/*
+ *************************************************** get cpu stat function **
+ * Get system clock resolution.
+ *
+ * OUT:
+ * @hz      Number of intervals per second.
+ ****************************************************************************
+ */
+void get_HZ(void)
+{
+    unsigned long ticks;
+    if ((ticks = sysconf(_SC_CLK_TCK)) == -1)
+        mreport(false, msg_error, "ERROR: sysconf failure.\n");
+            
+    hz = (unsigned int) ticks;
+}
+
+/*
+ *************************************************** get cpu stat function **
+ * Read machine uptime independently of the number of processors.
+ *
+ * OUT:
+ * @uptime          Uptime value in jiffies.
+ ****************************************************************************
+ */
+void read_uptime(unsigned long long *uptime)
+{
+    char * pos;
+    unsigned long up_sec, up_cent;
+
+    if ((pos = read_proc_file(proc_uptime)) == NULL)
+        return;
+
+    up_sec = scan_proc_number(&pos);
+    if (*pos++ != '.')
+        return;
+    up_cent = scan_proc_number(&pos);
+
+    *uptime = (unsigned long long) up_sec * HZ + (unsigned long long) up_cent * HZ / 100;
+}
+
+/*
+ **************************************************** get cpu stat function **
+ * Read cpu statistics from /proc/stat. Also calculate uptime if 
+ * read_uptime() function return NULL.
+ *
+ * IN:
+ * @st_cpu          Struct where stat will be saved.
+ * @nbr             Total number of CPU (including cpu "all").
+ *
+ * OUT:
+ * @st_cpu          Struct with statistics.
+ * @uptime          Machine uptime multiplied by the number of processors.
+ * @uptime0         Machine uptime. Filled only if previously set to zero.
+ ****************************************************************************
+ */
+void read_cpu_stat(struct cpu_s *st_cpu, unsigned int nbr,
+                            unsigned long long *uptime, unsigned long long *uptime0)
+{
+    char * pos, * line;
+    struct cpu_s *st_cpu_i;
+    struct cpu_s sc;
+    unsigned int proc_nb;
+
+    if ((pos = read_proc_file(proc_stat)) == NULL) {
+        /* zeroing stats if stats read failed */
+        memset(st_cpu, 0, STATS_CPU_SIZE);
+        return;
+    }
+
+    /* cpu lines are the first, the rest of file isn't needed */
+    while ( (line = next_proc_line(&pos)) != NULL && !strncmp(line, "cpu", 3) ) {
+        line += 3;
+        if (*line == ' ') {
+            scan_proc_cpu(&line, st_cpu);
+            *uptime = st_cpu->cpu_user + st_cpu->cpu_nice +
+                st_cpu->cpu_sys + st_cpu->cpu_idle +
+                st_cpu->cpu_iowait + st_cpu->cpu_steal +
+                st_cpu->cpu_hardirq + st_cpu->cpu_softirq +
+                st_cpu->cpu_guest + st_cpu->cpu_guest_nice;
+            if (nbr == 1)
+                break;
+            continue;
+        }
+
+        proc_nb = scan_proc_number(&line);
+        scan_proc_cpu(&line, &sc);
+
+        if (proc_nb < (nbr - 1)) {
+            st_cpu_i = st_cpu + proc_nb + 1;
+            *st_cpu_i = sc;
+        }
+
+        if (!proc_nb && !*uptime0) {
+            *uptime0 = sc.cpu_user + sc.cpu_nice   +
+            sc.cpu_sys     + sc.cpu_idle   +
+            sc.cpu_iowait  + sc.cpu_steal  +
+            sc.cpu_hardirq + sc.cpu_softirq;
+        }
+
+        /* per-cpu lines after requested cpus are skipped */
+        if (proc_nb + 2 >= nbr)
+            break;
+    }
+}
+
+/*
+ *************************************************** get cpu stat function **
+ * Compute time interval.
+ *
+ * IN:
+ * @prev_uptime     Previous uptime value in jiffies.
+ * @curr_interval   Current uptime value in jiffies.
+ *
+ * RETURNS:
+ * Interval of time in jiffies.
+ ****************************************************************************
+ */
+unsigned long long get_interval(unsigned long long prev_uptime,
+                                        unsigned long long curr_uptime)
+{
+    unsigned long long itv;
+    
+    /* first run prev_uptime=0 so displaying stats since system startup */
+    itv = curr_uptime - prev_uptime;
+
+    if (!itv) {     /* Paranoia checking */
+        itv = 1;
+    }
+
+    return itv;
+}
+
+/*
+ *************************************************** get cpu stat function **
+ * Workaround for CPU counters read from /proc/stat: Dyn-tick kernels
+ * have a race issue that can make those counters go backward.
+ ****************************************************************************
+ */
+double ll_sp_value(unsigned long long value1, unsigned long long value2,
+                unsigned long long itv)
+{
+    if (value2 < value1)
+        return (double) 0;
+    else
+        return SP_VALUE(value1, value2, itv);
+}
+
+/*
+ *************************************************** get cpu stat function **
+ * Display cpu statistics in specified window.
+ *
+ * IN:
+ * @window      Window in which spu statistics will be printed.
+ * @st_cpu      Struct with cpu statistics.
+ * @curr        Index in array for current sample statistics.
+ * @itv         Interval of time.
+ ****************************************************************************
+ */
+void write_cpu_stat_raw(WINDOW * window, struct cpu_s *st_cpu[],
+                unsigned int curr, unsigned long long itv)
+{
+    wprintw(window, 
+            "    %%cpu: %4.1f us, %4.1f sy, %4.1f ni, %4.1f id, %4.1f wa, %4.1f hi, %4.1f si, %4.1f st\n",
+            ll_sp_value(st_cpu[!curr]->cpu_user, st_cpu[curr]->cpu_user, itv),
+            ll_sp_value(st_cpu[!curr]->cpu_sys + st_cpu[!curr]->cpu_softirq + st_cpu[!curr]->cpu_hardirq,
+            st_cpu[curr]->cpu_sys + st_cpu[curr]->cpu_softirq + st_cpu[curr]->cpu_hardirq, itv),
+            ll_sp_value(st_cpu[!curr]->cpu_nice, st_cpu[curr]->cpu_nice, itv),
+            (st_cpu[curr]->cpu_idle < st_cpu[!curr]->cpu_idle) ?
+            0.0 :
+            ll_sp_value(st_cpu[!curr]->cpu_idle, st_cpu[curr]->cpu_idle, itv),
+            ll_sp_value(st_cpu[!curr]->cpu_iowait, st_cpu[curr]->cpu_iowait, itv),
+            ll_sp_value(st_cpu[!curr]->cpu_hardirq, st_cpu[curr]->cpu_hardirq, itv),
+            ll_sp_value(st_cpu[!curr]->cpu_softirq, st_cpu[curr]->cpu_softirq, itv),
+            ll_sp_value(st_cpu[!curr]->cpu_steal, st_cpu[curr]->cpu_steal, itv));
+    wrefresh(window);
+}
+
+/*
+ ************************************************** system window function **
+ * Composite function which read cpu stats and uptime then print out stats 
+ * to specified window.
+ *
+ * IN:
+ * @window      Window where cpu statistics will be printed, if NULL stats
+ *              are only sampled.
+ * @st_cpu      Struct with cpu statistics.
+ ****************************************************************************
+ */
+void print_cpu_usage(WINDOW * window, struct cpu_s *st_cpu[])
+{
+    static unsigned long long uptime[2]  = {0, 0};
+    static unsigned long long uptime0[2] = {0, 0};
+    static unsigned int curr = 1;
+    static unsigned long long itv;
+
+    uptime0[curr] = 0;
+    read_uptime(&(uptime0[curr]));
+    read_cpu_stat(st_cpu[curr], 2, &(uptime[curr]), &(uptime0[curr]));
+    itv = get_interval(uptime[!curr], uptime[curr]);
+    if (window != NULL)
+        write_cpu_stat_raw(window, st_cpu, curr, itv);
+    itv = get_interval(uptime0[!curr], uptime0[curr]);
+    curr ^= 1;
+}
+
+/*
+ *************************************************** get mem stat function **
+ * Read memory usage statistics from /proc/meminfo.
+ *
+ * OUT:
+ * @st_mem_short    Struct with mem statistics, zeroed if read failed.
+ ****************************************************************************
+ */
+void read_mem_stat(struct mem_s *st_mem_short)
+{
+    static const struct proc_key_s keys[] = {
+        { "MemTotal", 8, offsetof(struct mem_s, mem_total) },
+        { "MemFree", 7, offsetof(struct mem_s, mem_free) },
+        { "SwapTotal", 9, offsetof(struct mem_s, swap_total) },
+        { "SwapFree", 8, offsetof(struct mem_s, swap_free) },
+        { "Cached", 6, offsetof(struct mem_s, cached) },
+        { "Dirty", 5, offsetof(struct mem_s, dirty) },
+        { "Writeback", 9, offsetof(struct mem_s, writeback) },
+        { "Buffers", 7, offsetof(struct mem_s, buffers) },
+        { "Slab", 4, offsetof(struct mem_s, slab) }
+    };
+    static const struct proc_key_s * slots[MEMINFO_HASH_SIZE];
+    static bool hashed = false;
+    const struct proc_key_s * k;
+    char * pos, * line, * key;
+    unsigned int i, len, found = 0;
+
+    /* hash function has no collisions for these keys, so key is compared only once */
+    if (hashed == false) {
+        for (i = 0; i < ARRAY_SIZE(keys); i++)
+            slots[MEMINFO_HASH(keys[i].key, keys[i].len)] = &keys[i];
+        hashed = true;
+    }
+    
+    if ((pos = read_proc_file(proc_meminfo)) != NULL) {
+        while (found < ARRAY_SIZE(keys) && (line = next_proc_line(&pos)) != NULL) {
+            key = scan_proc_word(&line, ':', &len);
+            if (len == 0 || (k = slots[MEMINFO_HASH(key, len)]) == NULL
+                    || k->len != len || memcmp(k->key, key, len) != 0)
+                continue;
+            *(unsigned long long *) ((char *) st_mem_short + k->offset) = scan_proc_number(&line) / 1024;
+            found++;
+        }
+        st_mem_short->mem_used = st_mem_short->mem_total - st_mem_short->mem_free
+            - st_mem_short->cached - st_mem_short->buffers - st_mem_short->slab;
+        st_mem_short->swap_used = st_mem_short->swap_total - st_mem_short->swap_free;
+    } else {
+        /* read /proc/meminfo failed, zeroing stats */
+        st_mem_short->mem_total = st_mem_short->mem_free = st_mem_short->mem_used = 0;
+        st_mem_short->cached = st_mem_short->buffers = st_mem_short->slab = 0;
+        st_mem_short->swap_total = st_mem_short->swap_free = st_mem_short->swap_used = 0;
+        st_mem_short->dirty = st_mem_short->writeback = 0;
+    }
+}
+
+/*
+ ************************************************** system window function **
+ * Print memory usage statistics
+ *
+ * IN:
+ * @window          Window where mem statistics will be printed.
+ * @st_mem_short    Struct with mem statistics.
+ ****************************************************************************
+ */
+void print_mem_usage(WINDOW * window, struct mem_s *st_mem_short)
+{
+    read_mem_stat(st_mem_short);
+    write_mem_stat(window, st_mem_short);
+}
+
+/*
+ ************************************************** system window function **
+ * Print memory statistics in specified window.
+ *
+ * IN:
+ * @window          Window where mem statistics will be printed.
+ * @st_mem_short    Struct with mem statistics.
+ ****************************************************************************
+ */
+void write_mem_stat(WINDOW * window, struct mem_s *st_mem_short)
+{
+    wprintw(window, " MiB mem: %6llu total, %6llu free, %6llu used, %8llu buff/cached\n",
+            st_mem_short->mem_total,
+            st_mem_short->mem_free,
+            st_mem_short->mem_used,
+            st_mem_short->cached + st_mem_short->buffers + st_mem_short->slab);
+    wprintw(window, "MiB swap: %6llu total, %6llu free, %6llu used, %6llu/%llu dirty/writeback\n",
+            st_mem_short->swap_total,
+            st_mem_short->swap_free,
+            st_mem_short->swap_used,
+            st_mem_short->dirty,
+            st_mem_short->writeback);
+}
+
+/*
+ ********************************************************* cgroup function **
+ * Get cgroup v2 directory of postgres. Cgroup is taken from /proc/<pid>/cgroup
+ * of connection backend, backends stay in cgroup of postmaster. Root cgroup
+ * is accepted only if it has memory.current, so it's a container namespace
+ * and not the whole host. Mount point of cgroup2 can be overridden with
+ * PGCENTER_CGROUP_ROOT environment variable.
+ *
+ * IN:
+ * @conn            Current connection, postgres should be local.
+ * @len             Path buffer length.
+ *
+ * OUT:
+ * @path            Cgroup directory, empty if cgroup v2 isn't found.
+ ****************************************************************************
+ */
+void get_cgroup_path(PGconn * conn, char * path, size_t len)
+{
+    const char * root = getenv(CGROUP_ROOT_ENV);
+    char buf[PATH_MAX], file[PATH_MAX], * pos, * line;
+    bool is_root;
+    ssize_t n;
+    int fd;
+
+    path[0] = '\0';
+    snprintf(file, sizeof(file), PROC_PID_CGROUP, PQbackendPID(conn));
+    if ((fd = open(file, O_RDONLY | O_CLOEXEC)) == -1)
+        return;
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+        return;
+    buf[n] = '\0';
+
+    /* cgroup v2 line has zero hierarchy id and no controllers */
+    pos = buf;
+    while ((line = next_proc_line(&pos)) != NULL) {
+        if (strncmp(line, "0::", 3) != 0)
+            continue;
+        line += 3;
+        is_root = (strcmp(line, "/") == 0);
+        snprintf(path, len, "%s%s", (root != NULL) ? root : CGROUP_ROOT, is_root ? "" : line);
+        snprintf(file, sizeof(file), "%s/%s", path, is_root ? "memory.current" : "cpu.stat");
+        if (access(file, R_OK) != 0)
+            path[0] = '\0';
+        return;
+    }
+}
+
+/*
+ ********************************************************* cgroup function **
+ * Point cgroup files to cgroup directory. Files of previous cgroup are
+ * closed and its samples are dropped, so rates start from the next sample.
+ *
+ * IN:
+ * @path            Cgroup directory.
+ *
+ * RETURNS:
+ * False if cgroup is unknown.
+ ****************************************************************************
+ */
+bool open_cgroup(const char * path)
+{
+    unsigned int i;
+
+    if (path[0] == '\0')
+        return false;
+    if (strcmp(path, cgroup.path) == 0)
+        return true;
+
+    snprintf(cgroup.path, sizeof(cgroup.path), "%s", path);
+    for (i = 0; i < TOTAL_CGROUP_FILES; i++) {
+        if (proc_files[CGROUP_FIRST_FILE + i].fd != -1) {
+            close(proc_files[CGROUP_FIRST_FILE + i].fd);
+            proc_files[CGROUP_FIRST_FILE + i].fd = -1;
+        }
+        snprintf(cgroup.files[i], sizeof(cgroup.files[i]), "%s/%s", path, cgroup_files[i]);
+        proc_files[CGROUP_FIRST_FILE + i].path = cgroup.files[i];
+    }
+    memset(cgroup.stat, 0, sizeof(cgroup.stat));
+    cgroup.io_ts[0] = cgroup.io_ts[1] = 0;
+
+    return true;
+}
+
+/*
+ ********************************************************* cgroup function **
+ * Read total stall times of cgroup pressure file.
+ *
+ * IN:
+ * @file            Pressure file.
+ *
+ * OUT:
+ * @full            Time when all tasks are stalled, in microseconds.
+ *
+ * RETURNS:
+ * Time when some tasks are stalled, in microseconds.
+ ****************************************************************************
+ */
+unsigned long long read_cgroup_pressure(enum proc_file file, unsigned long long * full)
+{
+    char * pos, * line, * total;
+    unsigned long long some = 0;
+
+    *full = 0;
+    if ((pos = read_proc_file(file)) == NULL)
+        return 0;
+
+    while ((line = next_proc_line(&pos)) != NULL) {
+        if ((total = strstr(line, "total=")) == NULL)
+            continue;
+        total += 6;
+        if (strncmp(line, "some", 4) == 0)
+            some = scan_proc_number(&total);
+        else if (strncmp(line, "full", 4) == 0)
+            *full = scan_proc_number(&total);
+    }
+
+    return some;
+}
+
+/*
+ ********************************************************* cgroup function **
+ * Read cpu, memory and pressure stats of cgroup. Files which don't exist,
+ * e.g. when controller isn't enabled, leave their values zero.
+ *
+ * OUT:
+ * @st              Cgroup stats.
+ ****************************************************************************
+ */
+void read_cgroup_stat(struct cgroup_stat_s * st)
+{
+    static const struct proc_key_s keys[] = {
+        { "usage_usec", 10, offsetof(struct cgroup_stat_s, usage_usec) },
+        { "user_usec", 9, offsetof(struct cgroup_stat_s, user_usec) },
+        { "system_usec", 11, offsetof(struct cgroup_stat_s, system_usec) },
+        { "throttled_usec", 14, offsetof(struct cgroup_stat_s, throttled_usec) },
+        { "anon", 4, offsetof(struct cgroup_stat_s, anon) },
+        { "file", 4, offsetof(struct cgroup_stat_s, file) }
+    };
+    const enum proc_file files[] = { cgroup_cpu_stat, cgroup_memory_stat };
+    unsigned long long quota, period, full;
+    char * pos, * line, * key;
+    unsigned int i, j, len;
+
+    memset(st, 0, sizeof(struct cgroup_stat_s));
+    st->ts = get_monotonic_time();
+
+    for (i = 0; i < ARRAY_SIZE(files); i++) {
+        if ((pos = read_proc_file(files[i])) == NULL)
+            continue;
+        while ((line = next_proc_line(&pos)) != NULL) {
+            key = scan_proc_word(&line, '\0', &len);
+            for (j = 0; j < ARRAY_SIZE(keys); j++) {
+                if (keys[j].len == len && memcmp(keys[j].key, key, len) == 0) {
+                    *(unsigned long long *) ((char *) st + keys[j].offset) = scan_proc_number(&line);
+                    break;
+                }
+            }
+        }
+    }
+
+    /* quota is "max" when cpu isn't limited, memory limit too */
+    if ((pos = read_proc_file(cgroup_cpu_max)) != NULL && *pos != 'm') {
+        quota = scan_proc_number(&pos);
+        period = scan_proc_number(&pos);
+        st->cpu_max = (period > 0) ? (double) quota / period : 0;
+    }
+    if ((pos = read_proc_file(cgroup_memory_current)) != NULL)
+        st->mem_current = scan_proc_number(&pos);
+    if ((pos = read_proc_file(cgroup_memory_max)) != NULL)
+        st->mem_max = scan_proc_number(&pos);
+
+    st->cpu_some = read_cgroup_pressure(cgroup_cpu_pressure, &full);
+    st->mem_some = read_cgroup_pressure(cgroup_memory_pressure, &st->mem_full);
+    st->io_some = read_cgroup_pressure(cgroup_io_pressure, &st->io_full);
+}
+
+/*
+ ************************************************** system window function **
+ * Print cpu, memory and pressure stats of postgres cgroup in place of host
+ * cpu and memory stats. Cpu usage is percent of one cpu, pressure is
+ * percent of time when some or all tasks of cgroup were stalled.
+ *
+ * IN:
+ * @window          Window where cgroup stats will be printed.
+ ****************************************************************************
+ */
+void print_cgroup_usage(WINDOW * window)
+{
+    struct cgroup_stat_s * c, * p;
+    char cpu_max[S_BUF_LEN], mem_max[XS_BUF_LEN];
+    double itv;
+
+    cgroup.curr ^= 1;
+    c = &cgroup.stat[cgroup.curr];
+    p = &cgroup.stat[!cgroup.curr];
+    read_cgroup_stat(c);
+
+    /* there are no rates on first sample, interval is in microseconds */
+    itv = (p->ts > 0) ? (c->ts - p->ts) * 1000000 : 0;
+
+    (c->cpu_max > 0)
+        ? snprintf(cpu_max, sizeof(cpu_max), "%.1f cpus max", c->cpu_max)
+        : snprintf(cpu_max, sizeof(cpu_max), "no cpu max");
+    (c->mem_max > 0)
+        ? snprintf(mem_max, sizeof(mem_max), "%llu", c->mem_max >> 20)
+        : snprintf(mem_max, sizeof(mem_max), "none");
+
+    wprintw(window, " cg %%cpu: %5.1f used, %5.1f us, %5.1f sy, %5.1f throttled, %s\n",
+            CGROUP_PCT(p->usage_usec, c->usage_usec, itv),
+            CGROUP_PCT(p->user_usec, c->user_usec, itv),
+            CGROUP_PCT(p->system_usec, c->system_usec, itv),
+            CGROUP_PCT(p->throttled_usec, c->throttled_usec, itv),
+            cpu_max);
+    wprintw(window, "  cg MiB: %6llu used, %6s max, %6llu anon, %6llu file\n",
+            c->mem_current >> 20, mem_max, c->anon >> 20, c->file >> 20);
+    wprintw(window, "  cg psi: %5.1f cpu, %5.1f/%5.1f mem, %5.1f/%5.1f io, some/full %%\n",
+            CGROUP_PCT(p->cpu_some, c->cpu_some, itv),
+            CGROUP_PCT(p->mem_some, c->mem_some, itv),
+            CGROUP_PCT(p->mem_full, c->mem_full, itv),
+            CGROUP_PCT(p->io_some, c->io_some, itv),
+            CGROUP_PCT(p->io_full, c->io_full, itv));
+    wrefresh(window);
+}
+
+/*
+ ********************************************************* cgroup function **
+ * Read io.stat of cgroup, line per device. Array grows when devices don't
+ * fit into it.
+ *
+ * IN:
+ * @io              Devices array.
+ * @size            Allocated size of array.
+ *
+ * RETURNS:
+ * Number of devices, 0 if io.stat can't be read.
+ ****************************************************************************
+ */
+unsigned int read_cgroup_io(struct cgroup_io_s ** io, unsigned int * size)
+{
+    static const struct proc_key_s keys[] = {
+        { "rbytes", 6, offsetof(struct cgroup_io_s, rbytes) },
+        { "wbytes", 6, offsetof(struct cgroup_io_s, wbytes) },
+        { "rios", 4, offsetof(struct cgroup_io_s, rios) },
+        { "wios", 4, offsetof(struct cgroup_io_s, wios) },
+        { "dbytes", 6, offsetof(struct cgroup_io_s, dbytes) },
+        { "dios", 4, offsetof(struct cgroup_io_s, dios) }
+    };
+    struct cgroup_io_s * dev;
+    char * pos, * line, * key;
+    unsigned int n = 0, j, len;
+
+    if ((pos = read_proc_file(cgroup_io_stat)) == NULL)
+        return 0;
+
+    while ((line = next_proc_line(&pos)) != NULL) {
+        if (n == *size) {
+            *size = (*size > 0) ? *size * 2 : 16;
+            if ((*io = realloc(*io, sizeof(struct cgroup_io_s) * *size)) == NULL) {
+                mreport(true, msg_fatal, "FATAL: realloc for cgroup io stats failed.\n");
+            }
+        }
+        dev = &(*io)[n++];
+        memset(dev, 0, sizeof(struct cgroup_io_s));
+
+        /* device is MAJ:MIN, then key=value pairs */
+        dev->major = scan_proc_number(&line);
+        if (*line == ':')
+            line++;
+        dev->minor = scan_proc_number(&line);
+        for (key = scan_proc_word(&line, '=', &len); len > 0; key = scan_proc_word(&line, '=', &len)) {
+            for (j = 0; j < ARRAY_SIZE(keys); j++) {
+                if (keys[j].len == len && memcmp(keys[j].key, key, len) == 0) {
+                    *(unsigned long long *) ((char *) dev + keys[j].offset) = scan_proc_number(&line);
+                    break;
+                }
+            }
+        }
+    }
+
+    return n;
+}
+
+/*
+ ****************************************************** subscreen function **
+ * Print IO statistics of postgres cgroup from io.stat in place of host
+ * devices stats. Devices names are taken from /proc/diskstats, io pressure
+ * is taken from the latest cgroup stats of sysstat screen.
+ *
+ * IN:
+ * @window          Window where stat will be printed.
+ * @c_ios           Snapshot used for devices names.
+ * @bdev            Number of devices.
+ ****************************************************************************
+ */
+void print_cgroup_iostat(WINDOW * window, struct iodata_s * c_ios[], unsigned int bdev)
+{
+    struct cgroup_stat_s * st = &cgroup.stat[cgroup.curr],
+                         * pst = &cgroup.stat[!cgroup.curr];
+    struct cgroup_io_s * c, * p;
+    unsigned int i, j, ndev = 0, curr;
+    double itv, st_itv;
+    char devname[S_BUF_LEN];
+
+    curr = (cgroup.io_curr ^= 1);
+    cgroup.n_io[curr] = read_cgroup_io(&cgroup.io[curr], &cgroup.io_size[curr]);
+    cgroup.io_ts[curr] = get_monotonic_time();
+    itv = (cgroup.io_ts[!curr] > 0) ? cgroup.io_ts[curr] - cgroup.io_ts[!curr] : 0;
+    st_itv = (pst->ts > 0) ? (st->ts - pst->ts) * 1000000 : 0;
+
+    read_diskstats(c_ios, bdev, &ndev);
+
+    wclear(window);
+    wprintw(window, "cgroup %s, io pressure: %.1f%% some, %.1f%% full\n", cgroup.path,
+            CGROUP_PCT(pst->io_some, st->io_some, st_itv),
+            CGROUP_PCT(pst->io_full, st->io_full, st_itv));
+    wattron(window, A_BOLD);
+    wprintw(window, CGROUP_IOSTAT_HEADER);
+    wattroff(window, A_BOLD);
+
+    for (i = 0; i < cgroup.n_io[curr]; i++) {
+        c = &cgroup.io[curr][i];
+        /* skip devices without iops */
+        if (c->rios == 0 && c->wios == 0)
+            continue;
+
+        /* device which appeared since previous sample has no rates yet */
+        for (p = c, j = 0; j < cgroup.n_io[!curr]; j++) {
+            if (cgroup.io[!curr][j].major == c->major && cgroup.io[!curr][j].minor == c->minor) {
+                p = &cgroup.io[!curr][j];
+                break;
+            }
+        }
+
+        snprintf(devname, sizeof(devname), "%u:%u", c->major, c->minor);
+        for (j = 0; j < MIN(ndev, bdev); j++) {
+            if ((unsigned int) c_ios[j]->major == c->major && (unsigned int) c_ios[j]->minor == c->minor) {
+                snprintf(devname, sizeof(devname), "%s", c_ios[j]->devname);
+                break;
+            }
+        }
+
+        wprintw(window, "%6s:\t\t%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f\n", devname,
+                CGROUP_RATE(p->rios, c->rios, itv),
+                CGROUP_RATE(p->wios, c->wios, itv),
+                CGROUP_RATE(p->rbytes, c->rbytes, itv) / 1048576,
+                CGROUP_RATE(p->wbytes, c->wbytes, itv) / 1048576,
+                CGROUP_RATE(p->dios, c->dios, itv),
+                CGROUP_RATE(p->dbytes, c->dbytes, itv) / 1048576);
+    }
+    wrefresh(window);
+}
+
+/*
+ ************************************************** system window function **
+ * Save current io statistics snapshot.
+ *
+ * IN:
+ * @curr        Current statistics snapshot which must be saved.
+ * @prev        Struct for saving stat snapshot.
+ * @bdev       Number of block devices.
+ ****************************************************************************
+ */
+void replace_iodata(struct iodata_s *curr[], struct iodata_s *prev[], unsigned int bdev)
+{
+    unsigned int i;
+    for (i = 0; i < bdev; i++) {
+        prev[i]->r_completed = curr[i]->r_completed;
+        prev[i]->r_merged = curr[i]->r_merged;
+        prev[i]->r_sectors = curr[i]->r_sectors;
+        prev[i]->r_spent = curr[i]->r_spent;
+        prev[i]->w_completed = curr[i]->w_completed;
+        prev[i]->w_merged = curr[i]->w_merged;
+        prev[i]->w_sectors = curr[i]->w_sectors;
+        prev[i]->w_spent = curr[i]->w_spent;
+        prev[i]->io_in_progress = curr[i]->io_in_progress;
+        prev[i]->t_spent = curr[i]->t_spent;
+        prev[i]->t_weighted = curr[i]->t_weighted;
+    }
+}
+
+/*
+ ************************************************** system window function **
+ * Save current nicstat snapshot.
+ *
+ * IN:
+ * @curr        Current statistics snapshot which must be saved.
+ * @prev        Struct for saving stat snapshot.
+ * @idev        Number of interfaces.
+ ****************************************************************************
+ */
+void replace_nicdata(struct nicdata_s *curr[], struct nicdata_s *prev[], unsigned int idev)
+{
+    unsigned int i;
+    for (i = 0; i < idev; i++) {
+        prev[i]->rbytes = curr[i]->rbytes;
+        prev[i]->rpackets = curr[i]->rpackets;
+        prev[i]->wbytes = curr[i]->wbytes;
+        prev[i]->wpackets = curr[i]->wpackets;
+        prev[i]->ierr = curr[i]->ierr;
+        prev[i]->oerr = curr[i]->oerr;
+        prev[i]->coll = curr[i]->coll;
+        prev[i]->sat = curr[i]->sat;
+    }
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Read IO statistics from /proc/diskstats.
+ *
+ * IN:
+ * @bdev            Number of devices.
+ *
+ * OUT:
+ * @c_ios           Snapshot for current stat.
+ * @ndev            Number of devices in /proc/diskstats, differs from @bdev
+ *                  when devices are changed.
+ *
+ * RETURNS:
+ * False if /proc/diskstats can't be read.
+ ****************************************************************************
+ */
+bool read_diskstats(struct iodata_s *c_ios[], unsigned int bdev, unsigned int * ndev)
+{
+    char * pos, * line, * devname;
+    unsigned int i = 0, len;
+    struct iodata_s * io;
+
+    if ((pos = read_proc_file(proc_diskstats)) == NULL)
+        return false;
+
+    /* devices which don't fit into snapshot are only counted */
+    for (; (line = next_proc_line(&pos)) != NULL; i++) {
+        if (i >= bdev)
+            continue;
+        io = c_ios[i];
+        io->major = scan_proc_number(&line);
+        io->minor = scan_proc_number(&line);
+        devname = scan_proc_word(&line, '\0', &len);
+        len = MIN(len, S_BUF_LEN - 1);
+        memcpy(io->devname, devname, len);
+        io->devname[len] = '\0';
+        io->r_completed = scan_proc_number(&line);
+        io->r_merged = scan_proc_number(&line);
+        io->r_sectors = scan_proc_number(&line);
+        io->r_spent = scan_proc_number(&line);
+        io->w_completed = scan_proc_number(&line);
+        io->w_merged = scan_proc_number(&line);
+        io->w_sectors = scan_proc_number(&line);
+        io->w_spent = scan_proc_number(&line);
+        io->io_in_progress = scan_proc_number(&line);
+        io->t_spent = scan_proc_number(&line);
+        io->t_weighted = scan_proc_number(&line);
+    }
+    *ndev = i;
+
+    return true;
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Calculate device values shown in iostat subscreen, in order of its
+ * columns.
+ *
+ * IN:
+ * @c               Current stat of device.
+ * @p               Previous stat of device.
+ * @itv             Interval between stats, in jiffies.
+ *
+ * OUT:
+ * @values          IOSTAT_COLS values.
+ ****************************************************************************
+ */
+void get_iostat_values(struct iodata_s * c, struct iodata_s * p, unsigned long long itv, double * values)
+{
+    unsigned long completed = (c->r_completed + c->w_completed) - (p->r_completed + p->w_completed);
+
+    values[0] = S_VALUE(p->r_merged, c->r_merged, itv);
+    values[1] = S_VALUE(p->w_merged, c->w_merged, itv);
+    values[2] = S_VALUE(p->r_completed, c->r_completed, itv);
+    values[3] = S_VALUE(p->w_completed, c->w_completed, itv);
+    values[4] = S_VALUE(p->r_sectors, c->r_sectors, itv) / 2048;
+    values[5] = S_VALUE(p->w_sectors, c->w_sectors, itv) / 2048;
+    values[6] = completed ?
+        ((c->r_sectors - p->r_sectors) + (c->w_sectors - p->w_sectors)) / ((double) completed) : 0.0;
+    values[7] = S_VALUE(p->t_weighted, c->t_weighted, itv) / 1000.0;
+    values[8] = completed ?
+        ((c->r_spent - p->r_spent) + (c->w_spent - p->w_spent)) / ((double) completed) : 0.0;
+    values[9] = (c->r_completed - p->r_completed) ?
+        (c->r_spent - p->r_spent) / ((double) (c->r_completed - p->r_completed)) : 0.0;
+    values[10] = (c->w_completed - p->w_completed) ?
+        (c->w_spent - p->w_spent) / ((double) (c->w_completed - p->w_completed)) : 0.0;
+    values[11] = S_VALUE(p->t_spent, c->t_spent, itv) / 10.0;
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Format device line of iostat subscreen.
+ *
+ * IN:
+ * @len             Buffer length.
+ * @devname         Device name.
+ * @values          Values from get_iostat_values().
+ *
+ * OUT:
+ * @buf             Formatted line.
+ ****************************************************************************
+ */
+void format_iostat_row(char * buf, size_t len, const char * devname, const double * values)
+{
+    snprintf(buf, len, "%6s:\t\t%8.2f%8.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f%10.2f%10.2f%10.2f%8.2f\n",
+            devname, values[0], values[1], values[2], values[3], values[4], values[5],
+            values[6], values[7], values[8], values[9], values[10], values[11]);
+}
+
+/*
+ ****************************************************** subscreen function **
+ * Print IO statistics from /proc/diskstats.
+ *
+ * IN:
+ * @window          Window where stat will be printed.
+ * @w_cmd           Window for errors and messages.
+ * @c_ios           Snapshot for current stat.
+ * @p_ios           Snapshot for previous stat.
+ * @bdev            Number of devices.
+ * @repaint         Repaint subscreen flag.
+ ****************************************************************************
+ */
+void print_iostat(WINDOW * window, WINDOW * w_cmd, struct iodata_s *c_ios[],
+        struct iodata_s *p_ios[], unsigned int bdev, bool * repaint)
+{
+    static unsigned long long uptime0[2] = {0, 0};
+    static unsigned long long itv;
+    static unsigned int curr = 1;
+    unsigned int i, ndev;
+    double values[IOSTAT_COLS];
+    char line[L_BUF_LEN];
+    
+    uptime0[curr] = 0;
+    read_uptime(&(uptime0[curr]));
+
+    /*
+     * If /proc/diskstats read failed, fire up repaint flag.
+     * Next when subscreen repainting fails, subscreen will be closed.
+     */
+    if (read_diskstats(c_ios, bdev, &ndev) == false) {
+        wclear(window);
+        wprintw(window, "Do nothing. Can't open %s", DISKSTATS_FILE);
+        *repaint = true;
+        return;
+    }
+
+    /* if number of devices is changed, we should realloc structs and repaint subscreen */
+    if (ndev != bdev) {
+        wprintw(w_cmd, "The number of devices is changed. ");
+        *repaint = true;
+        return;
+    }
+
+    itv = get_interval(uptime0[!curr], uptime0[curr]);
+
+    /* print headers */
+    wclear(window);
+    wattron(window, A_BOLD);
+    wprintw(window, "\n" IOSTAT_HEADER);
+    wattroff(window, A_BOLD);
+
+    /* print statistics */
+    for (i = 0; i < bdev; i++) {
+        /* skip devices without iops */
+        if (c_ios[i]->r_completed == 0 && c_ios[i]->w_completed == 0) {
+            continue;
+        }
+        get_iostat_values(c_ios[i], p_ios[i], itv, values);
+        format_iostat_row(line, sizeof(line), c_ios[i]->devname, values);
+        wprintw(window, "%s", line);
+    }
+    wrefresh(window);
+
+    /* save current stats snapshot */
+    replace_iodata(c_ios, p_ios, bdev);
+    curr ^= 1;
+}
+
+/*
+ ******************************************************** routine function **
+ * Get interface speed and duplex settings.
+ *
+ * IN:
+ * @nicdata         Struct with NIC opts where speed and duplex will be saved.
+ ****************************************************************************
+ */
+void get_speed_duplex(struct nicdata_s * nicdata)
+{
+    struct ifreq ifr;
+    struct ethtool_cmd edata;
+    int status, sock;
+
+    sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        return;
+    }
+
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", nicdata->ifname);
+    ifr.ifr_data = (void *) &edata;
+    edata.cmd = ETHTOOL_GSET;
+    status = ioctl(sock, SIOCETHTOOL, &ifr);
+    close(sock);
+    
+    if (status < 0) {
+        return;
+    }
+
+    nicdata->speed = edata.speed * 1000000;
+    nicdata->duplex = edata.duplex;
+
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Read NIC statistics from /proc/net/dev.
+ *
+ * IN:
+ * @idev            Number of devices.
+ *
+ * OUT:
+ * @c_nicd          Snapshot for current stat.
+ * @ndev            Number of interfaces in /proc/net/dev, differs from @idev
+ *                  when interfaces are changed.
+ *
+ * RETURNS:
+ * False if /proc/net/dev can't be read.
+ ****************************************************************************
+ */
+bool read_netdev(struct nicdata_s *c_nicd[], unsigned int idev, unsigned int * ndev)
+{
+    char * pos, * line, * ifname;
+    unsigned int i = 0,
+        j = 0,
+        len;
+    unsigned long lu[16];
+
+    if ((pos = read_proc_file(proc_netdev)) == NULL)
+        return false;
+
+    /* skip headers */
+    for (j = 0; j < 2; j++)
+        next_proc_line(&pos);
+
+    /* interfaces which don't fit into snapshot are only counted */
+    for (; (line = next_proc_line(&pos)) != NULL; i++) {
+        if (i >= idev)
+            continue;
+        /* interface name is kept with colon, as it's shown in nicstat */
+        ifname = scan_proc_word(&line, '\0', &len);
+        len = MIN(len, IF_NAMESIZE);
+        memcpy(c_nicd[i]->ifname, ifname, len);
+        c_nicd[i]->ifname[len] = '\0';
+        /* rbps, rpps, rerrs, rdrop, rfifo, rframe, rcomp, rmcast,
+         * wbps, wpps, werrs, wdrop, wfifo, wcoll, wcarrier, wcomp */
+        for (j = 0; j < 16; j++)
+            lu[j] = scan_proc_number(&line);
+        c_nicd[i]->rbytes = lu[0];
+        c_nicd[i]->rpackets = lu[1];
+        c_nicd[i]->wbytes = lu[8];
+        c_nicd[i]->wpackets = lu[9];
+        c_nicd[i]->ierr = lu[2];
+        c_nicd[i]->oerr = lu[10];
+        c_nicd[i]->coll = lu[13];
+        c_nicd[i]->sat = lu[2];
+        c_nicd[i]->sat += lu[3];
+        c_nicd[i]->sat += lu[11];
+        c_nicd[i]->sat += lu[12];
+        c_nicd[i]->sat += lu[13];
+        c_nicd[i]->sat += lu[14];
+    }
+    *ndev = i;
+
+    return true;
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Calculate interface values shown in nicstat subscreen, in order of its
+ * columns.
+ *
+ * IN:
+ * @c               Current stat of interface.
+ * @p               Previous stat of interface.
+ * @itv             Interval between stats, in jiffies.
+ *
+ * OUT:
+ * @values          NICSTAT_COLS values.
+ ****************************************************************************
+ */
+void get_nicstat_values(struct nicdata_s * c, struct nicdata_s * p, unsigned long long itv, double * values)
+{
+    double rbps, rpps, wbps, wpps, ravs, wavs, rutil, wutil, util;
+
+    rbps = S_VALUE(p->rbytes, c->rbytes, itv);
+    wbps = S_VALUE(p->wbytes, c->wbytes, itv);
+    rpps = S_VALUE(p->rpackets, c->rpackets, itv);
+    wpps = S_VALUE(p->wpackets, c->wpackets, itv);
+
+    /* if no data about pps, zeroing averages */
+    (rpps > 0) ? ( ravs = rbps / rpps ) : ( ravs = 0 );
+    (wpps > 0) ? ( wavs = wbps / wpps ) : ( wavs = 0 );
+
+    /* Calculate utilisation */
+    if (c->speed > 0) {
+        /*
+         * The following have a mysterious "800",
+         * it is 100 for the % conversion, and 8 for bytes2bits.
+         */
+        rutil = min(rbps * 800 / c->speed, 100);
+        wutil = min(wbps * 800 / c->speed, 100);
+        if (c->duplex == 2) {
+            /* Full duplex */
+            util = max(rutil, wutil);
+        } else {
+            /* Half Duplex */
+            util = min((rbps + wbps) * 800 / c->speed, 100);
+        }
+    } else {
+        util = rutil = wutil = 0;
+    }
+
+    values[0] = rbps / 1024 / 128;
+    values[1] = wbps / 1024 / 128;
+    values[2] = rpps;
+    values[3] = wpps;
+    values[4] = ravs;
+    values[5] = wavs;
+    values[6] = S_VALUE(p->ierr, c->ierr, itv);
+    values[7] = S_VALUE(p->oerr, c->oerr, itv);
+    values[8] = S_VALUE(p->coll, c->coll, itv);
+    values[9] = S_VALUE(p->sat, c->sat, itv);
+    values[10] = rutil;
+    values[11] = wutil;
+    values[12] = util;
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Format interface line of nicstat subscreen.
+ *
+ * IN:
+ * @len             Buffer length.
+ * @ifname          Interface name.
+ * @values          Values from get_nicstat_values().
+ *
+ * OUT:
+ * @buf             Formatted line.
+ ****************************************************************************
+ */
+void format_nicstat_row(char * buf, size_t len, const char * ifname, const double * values)
+{
+    snprintf(buf, len, "%14s%8.2f%8.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f%9.2f\n",
+            ifname, values[0], values[1], values[2], values[3], values[4], values[5], values[6],
+            values[7], values[8], values[9], values[10], values[11], values[12]);
+}
+
+/*
+ ****************************************************** subscreen function **
+ * Print NIC statistics from /proc/net/dev.
+ *
+ * IN:
+ * @window          Window where stat will be printed.
+ * @w_cmd           Window for errors and messaged.
+ * @c_nicd          Snapshot for current stat.
+ * @p_nicd          Snapshot for previous stat.
+ * @idev            Number of devices.
+ * @repaint         Repaint subscreen flag.
+ ****************************************************************************
+ */
+void print_nicstat(WINDOW * window, WINDOW * w_cmd, struct nicdata_s *c_nicd[],
+        struct nicdata_s *p_nicd[], unsigned int idev, bool * repaint)
+{
+    static unsigned long long uptime0[2] = {0, 0};
+    static unsigned long long itv;
+    static unsigned int curr = 1;
+    unsigned int i, ndev;
+    static bool first = true;
+    double values[NICSTAT_COLS];
+    char line[L_BUF_LEN];
+
+    uptime0[curr] = 0;
+    read_uptime(&(uptime0[curr]));
+
+    /*
+     * If read /proc/net/dev failed, fire up repaint flag.
+     * Next when subscreen repainting fails, subscreen will be closed.
+     */
+    if (read_netdev(c_nicd, idev, &ndev) == false) {
+        wclear(window);
+        wprintw(window, "Do nothing. Can't open %s", NETDEV_FILE);
+        *repaint = true;
+        return;
+    }
+
+    /* if number of devices is changed, we should realloc structs and repaint subscreen */
+    if (ndev != idev) {
+        wprintw(w_cmd, "The number of devices is changed.");
+        *repaint = true;
+        return;
+    }
+
+    if (first) {
+        for (i = 0; i < idev; i++)
+            get_speed_duplex(c_nicd[i]);
+        first = false;
+    }
+
+    itv = get_interval(uptime0[!curr], uptime0[curr]);
+
+    /* print headers */
+    wclear(window);
+    wattron(window, A_BOLD);
+    wprintw(window, "\n" NICSTAT_HEADER);
+    wattroff(window, A_BOLD);
+
+    for (i = 0; i < idev; i++) {
+        /* skip interfaces which never seen packets */
+        if (c_nicd[i]->rpackets == 0 && c_nicd[i]->wpackets == 0) {
+           continue;
+        }
+
+        /* print statistics */
+        get_nicstat_values(c_nicd[i], p_nicd[i], itv, values);
+        format_nicstat_row(line, sizeof(line), c_nicd[i]->ifname, values);
+        wprintw(window, "%s", line);
+    }
+
+    wrefresh(window);
+
+    /* save current stats snapshot */
+    replace_nicdata(c_nicd, p_nicd, idev);
+    curr ^= 1;
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Calculate cpu values shown in cpustat subscreen, in order of its columns.
+ * Values are percents of time elapsed on this cpu, so offline or hotplugged
+ * cpus don't distort values of others.
+ *
+ * IN:
+ * @c               Current stat of cpu.
+ * @p               Previous stat of cpu.
+ *
+ * OUT:
+ * @values          CPUSTAT_COLS values.
+ *
+ * RETURNS:
+ * Busy percent, -1 if cpu has no stats (e.g. it's offline).
+ ****************************************************************************
+ */
+double get_cpustat_values(struct cpu_s * c, struct cpu_s * p, double * values)
+{
+    unsigned long long deltas[CPUSTAT_COLS], total = 0;
+    unsigned int i;
+
+    deltas[0] = COUNTER_DELTA(p->cpu_user + p->cpu_nice, c->cpu_user + c->cpu_nice);
+    deltas[1] = COUNTER_DELTA(p->cpu_sys, c->cpu_sys);
+    deltas[2] = COUNTER_DELTA(p->cpu_iowait, c->cpu_iowait);
+    deltas[3] = COUNTER_DELTA(p->cpu_hardirq, c->cpu_hardirq);
+    deltas[4] = COUNTER_DELTA(p->cpu_softirq, c->cpu_softirq);
+    deltas[5] = COUNTER_DELTA(p->cpu_steal, c->cpu_steal);
+    deltas[6] = COUNTER_DELTA(p->cpu_idle, c->cpu_idle);
+
+    for (i = 0; i < CPUSTAT_COLS; i++)
+        total += deltas[i];
+    if (total == 0)
+        return -1;
+
+    for (i = 0; i < CPUSTAT_COLS; i++)
+        values[i] = (double) deltas[i] / total * 100;
+
+    /* iowait is idle time */
+    return 100 - values[2] - values[6];
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Compare cpus by busy percent, used for ordering the busiest cpus first.
+ ****************************************************************************
+ */
+int cpustat_cmp_desc(const void * a, const void * b)
+{
+    const struct cpustat_row_s * x = a, * y = b;
+
+    if (x->busy != y->busy)
+        return (x->busy < y->busy) ? 1 : -1;
+    return (x->cpu > y->cpu) ? 1 : -1;
+}
+
+/*
+ ****************************************************** subscreen function **
+ * Print per-cpu utilization from /proc/stat. Cpus are laid out in columns,
+ * when all of them don't fit into subscreen the busiest cpus are shown.
+ * Hot cpus are highlighted, so single saturated core is visible, which is
+ * hidden in aggregated cpu line.
+ *
+ * IN:
+ * @window          Window where stat will be printed.
+ * @c_cpus          Current stats, cpu "all" and ncpu cpus.
+ * @p_cpus          Previous stats.
+ * @ncpu            Number of configured cpus.
+ ****************************************************************************
+ */
+void print_cpustat(WINDOW * window, struct cpu_s * c_cpus, struct cpu_s * p_cpus, unsigned int ncpu)
+{
+    static unsigned long long uptime[2] = {0, 0};
+    static unsigned long long uptime0[2] = {0, 0};
+    static unsigned int curr = 1;
+    struct cpustat_row_s rows[ncpu];
+    double values[CPUSTAT_COLS];
+    unsigned int i, n = 0, hot = 0, shown, per_line, lines, win_lines, win_cols;
+
+    uptime0[curr] = 0;
+    read_uptime(&(uptime0[curr]));
+    /* cpus which aren't in /proc/stat (offline) are left zeroed */
+    memset(c_cpus, 0, STATS_CPU_SIZE * (ncpu + 1));
+    read_cpu_stat(c_cpus, ncpu + 1, &(uptime[curr]), &(uptime0[curr]));
+
+    for (i = 0; i < ncpu; i++) {
+        rows[n].cpu = i;
+        if ((rows[n].busy = get_cpustat_values(&c_cpus[i + 1], &p_cpus[i + 1], values)) < 0)
+            continue;
+        if (rows[n].busy >= CPUSTAT_HOT)
+            hot++;
+        n++;
+    }
+
+    getmaxyx(window, win_lines, win_cols);
+    per_line = MAX((win_cols + CPUSTAT_GAP) / (CPUSTAT_WIDTH + CPUSTAT_GAP), 1);
+    lines = (win_lines > 2) ? win_lines - 2 : 1;
+    shown = MIN(n, per_line * lines);
+    if (shown < n)
+        qsort(rows, n, sizeof(struct cpustat_row_s), cpustat_cmp_desc);
+
+    /* print headers */
+    wclear(window);
+    wprintw(window, "cpus: %u online of %u configured, %u hot (busy >= %.0f%%)", n, ncpu, hot, CPUSTAT_HOT);
+    if (shown < n)
+        wprintw(window, ", the busiest %u are shown", shown);
+    wprintw(window, "\n");
+    wattron(window, A_BOLD);
+    for (i = 0; i < MIN(per_line, MAX(shown, 1)); i++)
+        wprintw(window, "%*s" CPUSTAT_HEADER, (i > 0) ? CPUSTAT_GAP : 0, "");
+    wprintw(window, "\n");
+    wattroff(window, A_BOLD);
+
+    /* print statistics */
+    for (i = 0; i < shown; i++) {
+        get_cpustat_values(&c_cpus[rows[i].cpu + 1], &p_cpus[rows[i].cpu + 1], values);
+        if (i % per_line > 0)
+            wprintw(window, "%*s", CPUSTAT_GAP, "");
+        if (rows[i].busy >= CPUSTAT_HOT)
+            wattron(window, COLOR_PAIR(1) | A_BOLD);
+        wprintw(window, "%6u%7.1f%7.1f%7.1f%7.1f%7.1f%7.1f%7.1f",
+                rows[i].cpu, values[0], values[1], values[2], values[3], values[4], values[5], values[6]);
+        if (rows[i].busy >= CPUSTAT_HOT)
+            wattroff(window, COLOR_PAIR(1) | A_BOLD);
+        if (i % per_line == per_line - 1)
+            wprintw(window, "\n");
+    }
+    wrefresh(window);
+
+    /* save current stats snapshot */
+    memcpy(p_cpus, c_cpus, STATS_CPU_SIZE * (ncpu + 1));
+    curr ^= 1;
+}
+
+/*
+ ******************************************************** routine function **
+ * Calculate column width for output data.
+ *
+ * IN:
+ * @n_rows          Number of rows in query result.
+ * @n_cols          Number of columns in query result.
+ * @screen          Screen options.
+ * @res             Query result.
+ * @snap            Snapshot with sorted result.
+ *
+ * OUT:
+ * @columns         Struct with column names and their max width.
+ ****************************************************************************
+ */
+void calculate_width(struct colAttrs *columns, PGresult *res,
+    struct screen_s * screen, struct snapshot_s * snap, unsigned int n_rows, unsigned int n_cols)
+{
+    unsigned int i, col, row;
+    struct context_s ctx;
+
+    /* determine current context */
+    if (screen != NULL)
+        for (i = 0; i < TOTAL_CONTEXTS; i++) {
+            if (screen->current_context == screen->context_list[i].context)
+                ctx = screen->context_list[i];
+        }
+
+    for (col = 0, i = 0; col < n_cols; col++, i++) {
+        const char * name = (snap == NULL) ? PQfname(res, col) : snap->cols[col].name;
+
+        /* determine length of column names */
+        if (screen != NULL && strlen(ctx.fstrings[i]) > 0)
+            /* mark columns with filtration */
+            snprintf(columns[i].name, sizeof(columns[i].name), "%s*", name);
+        else
+            snprintf(columns[i].name, sizeof(columns[i].name), "%s", name);
+
+        unsigned int width = strlen(name);
+        if (snap == NULL) {
+            for (row = 0; row < n_rows; row++ ) {
+                unsigned int val_len = strlen(PQgetvalue(res, row, col));
+                if ( val_len >= width )
+                    width = val_len;
+            }
+        } else if (snap->cols[col].type == col_counter) {
+            /* determine length of deltas without formatting them */
+            for (row = 0; row < n_rows; row++ ) {
+                unsigned int val_len = int_len((long long) snap->cols[col].rates[row]);
+                if ( val_len >= width )
+                    width = val_len;
+            }
+        } else {
+            /* determine length of values from result snapshot */
+            for (row = 0; row < n_rows; row++ ) {
+                unsigned int val_len = SNAPSHOT_CELL(snap, row, col)->len;
+                if ( val_len >= width )
+                    width = val_len;
+            }
+        }
+        /* set column width equal to longest value + 2 spaces */
+        columns[i].width = width + 2;
+    }
+}
+
+/*
+ ************************************************** system window function **
+ * Print PostgreSQL general info
+ *
+ * IN:
+ * @window          Window where result will be printed.
+ * @screen          Screen with postgres version info.
+ * @stats           Postgres stats collected on current iteration.
+ ****************************************************************************
+ */
+void print_pg_general(WINDOW * window, struct screen_s * screen, struct pg_stat_s * stats)
+{
+    wprintw(window, " (ver: %s, up %s)", screen->pg_special.pg_version, stats->uptime);
+}
+
+/*
+ ************************************************** system window function **
+ * Print (auto)vacuum info.
+ *
+ * IN:
+ * @window          Window where result will be printed.
+ * @screen	    Screen information.
+ * @stats           Postgres stats collected on current iteration.
+ ****************************************************************************
+ */
+void print_vacuum_info(WINDOW * window, struct screen_s * screen, struct pg_stat_s * stats)
+{
+    mvwprintw(window, 2, COLS / 2, "autovacuum: %2u/%u workers/max, %2u manual, %2u wraparound, %s vac_maxtime",
+                    stats->av_count, screen->pg_special.av_max_workers, stats->mv_count, stats->avw_count,
+                    stats->vac_maxtime);
+    wrefresh(window);
+}
+
+/*
+ ****************************************************** key press function **
+ * Switch console using specified number.
+ *
+ * IN:
+ * @window          Window where cmd status will be written.
+ * @screens[]       Struct array with screens options.
+ * @ch              Intercepted key (number from 1 to 8).
+ * @console_no      Active console number.
+ * @console_index   Index of active console.
+ *
+ * RETURNS:
+ * Index console on which performed switching. Previous results aren't reset,
+ * all consoles are sampled in background.
+ ****************************************************************************
+ */
+unsigned int switch_conn(WINDOW * window, struct screen_s * screens[],
+                unsigned int ch, unsigned int console_index, unsigned int console_no)
+{
+    wclear(window);
+    if ( screens[ch - '0' - 1]->conn_used ) {
+        console_no = ch - '0', console_index = console_no - 1;
+        wprintw(window, "Switch to console %i.", console_no);
+    } else
+        wprintw(window, "No connection associated, stay on console %i.", console_no);
+
+    return console_index;
+}
+
+/*
+ ****************************************************** key press function **
+ * Switch to previous or next console, used when there are more consoles than
+ * number keys.
+ *
+ * IN:
+ * @window          Window where cmd status will be written.
+ * @screens[]       Struct array with screens options.
+ * @console_index   Index of active console.
+ * @forward         Switch to next console, otherwise to previous.
+ *
+ * RETURNS:
+ * Index console on which performed switching.
+ ****************************************************************************
+ */
+unsigned int switch_conn_relative(WINDOW * window, struct screen_s * screens[],
+                unsigned int console_index, bool forward)
+{
+    unsigned int i = console_index,
+                 n = count_screens(screens);
+
+    /* used screens are always packed at the beginning of registry */
+    do {
+        i = forward ? (i + 1) % n : (i + n - 1) % n;
+    } while (screens[i]->conn_used == false && i != console_index);
+
+    wclear(window);
+    if (i != console_index)
+        wprintw(window, "Switch to console %i.", i + 1);
+    else
+        wprintw(window, "No other connections, stay on console %i.", console_index + 1);
+
+    return i;
+}
+
+/*
+ ******************************************************** routine function **
+ * Allocate memory for empty snapshot.
+ *
+ * RETURNS:
+ * Pointer to the snapshot, its storages are allocated on first use.
+ ****************************************************************************
+ */
+struct snapshot_s * init_snapshot(void)
+{
+    struct snapshot_s * snap;
+
+    if ((snap = (struct snapshot_s *) malloc(SNAPSHOT_SIZE)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for snapshot failed.\n");
+    }
+    memset(snap, 0, SNAPSHOT_SIZE);
+    return snap;
+}
+
+/*
+ ******************************************************** routine function **
+ * Resize array of the snapshot. Unallocated arrays stay unallocated, they
+ * are allocated when column of appropriate type is used.
+ *
+ * IN:
+ * @ptr             Array which should be resized.
+ * @size            New size of the array in bytes.
+ *
+ * RETURNS:
+ * Pointer to resized array.
+ ****************************************************************************
+ */
+void * resize_snapshot_array(void * ptr, size_t size)
+{
+    if (ptr == NULL)
+        return NULL;
+
+    if ((ptr = realloc(ptr, size)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: realloc for snapshot failed.\n");
+    }
+    return ptr;
+}
+
+/*
+ ******************************************************** routine function **
+ * Prepare snapshot for storing new values. Memory is allocated only when
+ * snapshot storages are too small for new values, otherwise already 
+ * allocated memory is reused.
+ *
+ * IN:
+ * @snap            Snapshot which should be prepared.
+ * @n_rows          Number of rows which will be stored.
+ * @n_cols          Number of columns which will be stored.
+ * @data_len        Total length of text values (including trailing zeroes).
+ ****************************************************************************
+ */
+void reserve_snapshot(struct snapshot_s * snap, unsigned int n_rows, unsigned int n_cols, size_t data_len)
+{
+    unsigned int i;
+
+    if (data_len > snap->data_size) {
+        snap->data_size = (data_len > snap->data_size * 2) ? data_len : snap->data_size * 2;
+        if ((snap->data = realloc(snap->data, snap->data_size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for snapshot arena failed.\n");
+        }
+    }
+    if (n_cols > snap->cols_size) {
+        if ((snap->cols = realloc(snap->cols, sizeof(struct column_s) * n_cols)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for snapshot columns failed.\n");
+        }
+        memset(snap->cols + snap->cols_size, 0, sizeof(struct column_s) * (n_cols - snap->cols_size));
+        snap->cols_size = n_cols;
+    }
+    if (n_rows > snap->rows_size) {
+        snap->rows_size = (n_rows > snap->rows_size * 2) ? n_rows : snap->rows_size * 2;
+        if ((snap->order = realloc(snap->order, sizeof(unsigned int) * snap->rows_size)) == NULL
+            || (snap->prev = realloc(snap->prev, sizeof(int) * snap->rows_size)) == NULL
+            || (snap->aligned = realloc(snap->aligned, sizeof(long long) * snap->rows_size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for snapshot rows failed.\n");
+        }
+        for (i = 0; i < snap->cols_size; i++) {
+            snap->cols[i].cells = resize_snapshot_array(snap->cols[i].cells, sizeof(struct cell_s) * snap->rows_size);
+            snap->cols[i].numbers = resize_snapshot_array(snap->cols[i].numbers, sizeof(double) * snap->rows_size);
+            snap->cols[i].counters = resize_snapshot_array(snap->cols[i].counters, sizeof(long long) * snap->rows_size);
+            snap->cols[i].rates = resize_snapshot_array(snap->cols[i].rates, sizeof(double) * snap->rows_size);
+        }
+    }
+
+    snap->n_rows = n_rows;
+    snap->n_cols = n_cols;
+    snap->data_used = 0;
+    for (i = 0; i < n_rows; i++) {
+        snap->order[i] = i;
+        snap->prev[i] = -1;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Set name and type of the snapshot column and allocate arrays required for
+ * values of this type.
+ *
+ * IN:
+ * @snap            Snapshot which column should be set.
+ * @col             Column number.
+ * @name            Column name.
+ * @type            Type of column values.
+ ****************************************************************************
+ */
+void set_snapshot_column(struct snapshot_s * snap, unsigned int col, const char * name, enum col_type type)
+{
+    struct column_s * column = &snap->cols[col];
+    size_t rows = (snap->rows_size > 0) ? snap->rows_size : 1;
+
+    snprintf(column->name, sizeof(column->name), "%s", name);
+    column->type = type;
+
+    if (type != col_counter && column->cells == NULL)
+        if ((column->cells = malloc(sizeof(struct cell_s) * rows)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for snapshot cells failed.\n");
+        }
+    if (type == col_number && column->numbers == NULL)
+        if ((column->numbers = malloc(sizeof(double) * rows)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for snapshot numbers failed.\n");
+        }
+    if (type == col_counter && (column->counters == NULL || column->rates == NULL)) {
+        if ((column->counters = realloc(column->counters, sizeof(long long) * rows)) == NULL
+            || (column->rates = realloc(column->rates, sizeof(double) * rows)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for snapshot counters failed.\n");
+        }
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Free space occupied by snapshot.
+ *
+ * IN:      
+ * @snap            Snapshot which should be freed.
+ ****************************************************************************
+ */
+void free_snapshot(struct snapshot_s * snap)
+{
+    unsigned int i;
+
+    for (i = 0; i < snap->cols_size; i++) {
+        free(snap->cols[i].cells);
+        free(snap->cols[i].numbers);
+        free(snap->cols[i].counters);
+        free(snap->cols[i].rates);
+    }
+    free(snap->cols);
+    free(snap->data);
+    free(snap->order);
+    free(snap->prev);
+    free(snap->aligned);
+    free(snap->hash);
+    free(snap);
+}
+
+/*
+ ******************************************************** routine function **
+ * Parse integer counter. Fractional part is truncated.
+ *
+ * IN:
+ * @value           String with counter value.
+ *
+ * RETURNS:
+ * Parsed value.
+ ****************************************************************************
+ */
+long long parse_counter(const char * value)
+{
+    long long result = 0;
+    bool negative = false;
+
+    if (*value == '-') {
+        negative = true;
+        value++;
+    }
+    while (*value >= '0' && *value <= '9')
+        result = result * 10 + (*value++ - '0');
+
+    return negative ? -result : result;
+}
+
+/*
+ ******************************************************** routine function **
+ * Calculate length of printed integer without printing it.
+ *
+ * IN:
+ * @value           Integer value.
+ *
+ * RETURNS:
+ * Number of chars required for printing value.
+ ****************************************************************************
+ */
+unsigned int int_len(long long value)
+{
+    unsigned int len = (value < 0) ? 2 : 1;
+
+    while (value >= 10 || value <= -10) {
+        value /= 10;
+        len++;
+    }
+    return len;
+}
+
+/*
+ ******************************************************** routine function **
+ * Append text value to the snapshot arena.
+ *
+ * IN:
+ * @snap            Snapshot where value will be stored.
+ * @row, @col       Cell position.
+ * @value           Value which should be stored.
+ * @len             Value length.
+ ****************************************************************************
+ */
+void add_snapshot_text(struct snapshot_s * snap, unsigned int row, unsigned int col,
+                const char * value, unsigned int len)
+{
+    struct cell_s * cell = &snap->cols[col].cells[row];
+
+    cell->offset = snap->data_used;
+    cell->len = len;
+    memcpy(snap->data + snap->data_used, value, len);
+    snap->data[snap->data_used + len] = '\0';
+    snap->data_used += len + 1;
+}
+
+/*
+ ******************************************************** routine function **
+ * Store value into the snapshot. Text values are appended to the snapshot
+ * arena, counters are parsed and stored as integers.
+ *
+ * IN:
+ * @snap            Snapshot where value will be stored.
+ * @row, @col       Cell position.
+ * @value           Value which should be stored.
+ * @len             Value length.
+ ****************************************************************************
+ */
+void add_snapshot_value(struct snapshot_s * snap, unsigned int row, unsigned int col,
+                const char * value, unsigned int len)
+{
+    struct column_s * column = &snap->cols[col];
+
+    if (column->type == col_counter) {
+        column->counters[row] = parse_counter(value);
+        column->rates[row] = 0;
+        return;
+    }
+
+    add_snapshot_text(snap, row, col, value, len);
+
+    if (column->type == col_number)
+        column->numbers[row] = strtod(value, NULL);
+}
+
+/*
+ ******************************************************** routine function **
+ * Decode integer value (int2, int4, int8, oid) received in binary format.
+ *
+ * IN:
+ * @value           Value in network byte order.
+ * @len             Value length.
+ *
+ * RETURNS:
+ * Decoded value.
+ ****************************************************************************
+ */
+long long decode_int(const char * value, unsigned int len)
+{
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+
+    switch (len) {
+        case 2:
+            memcpy(&v16, value, 2);
+            return (int16_t) be16toh(v16);
+        case 4:
+            memcpy(&v32, value, 4);
+            return (int32_t) be32toh(v32);
+        case 8:
+            memcpy(&v64, value, 8);
+            return (int64_t) be64toh(v64);
+        default:
+            return 0;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Decode floating point value (float4, float8) received in binary format.
+ *
+ * IN:
+ * @value           Value in network byte order.
+ * @len             Value length.
+ *
+ * RETURNS:
+ * Decoded value.
+ ****************************************************************************
+ */
+double decode_float(const char * value, unsigned int len)
+{
+    uint32_t v32;
+    uint64_t v64;
+    float f;
+    double d;
+
+    switch (len) {
+        case 4:
+            memcpy(&v32, value, 4);
+            v32 = be32toh(v32);
+            memcpy(&f, &v32, 4);
+            return f;
+        case 8:
+            memcpy(&v64, value, 8);
+            v64 = be64toh(v64);
+            memcpy(&d, &v64, 8);
+            return d;
+        default:
+            return 0;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Decode integer part of numeric value received in binary format. Numeric 
+ * is a header followed by base 10000 digits, the first digit is multiplied
+ * by 10000^weight.
+ *
+ * IN:
+ * @value           Value in network byte order.
+ * @len             Value length.
+ *
+ * RETURNS:
+ * Integer part of the value, fraction is truncated.
+ ****************************************************************************
+ */
+long long decode_numeric_int(const char * value, unsigned int len)
+{
+    int ndigits, weight, sign, i;
+    long long result = 0;
+
+    if (len < NUMERIC_HDRSZ)
+        return 0;
+
+    ndigits = decode_int(value, 2);
+    weight = decode_int(value + 2, 2);
+    sign = (uint16_t) decode_int(value + 4, 2);
+
+    if (sign == NUMERIC_NAN || len < NUMERIC_HDRSZ + (unsigned int) ndigits * 2)
+        return 0;
+
+    for (i = 0; i <= weight; i++)
+        result = result * NUMERIC_NBASE + ((i < ndigits) ? decode_int(value + NUMERIC_HDRSZ + i * 2, 2) : 0);
+
+    return (sign == NUMERIC_NEG) ? -result : result;
+}
+
+/*
+ ******************************************************** routine function **
+ * Decode numeric value received in binary format into text, the same way 
+ * as postgres prints it: integer part and dscale digits after the point.
+ *
+ * IN:
+ * @value           Value in network byte order.
+ * @len             Value length.
+ * @size            Size of output buffer.
+ *
+ * OUT:
+ * @buf             Text representation of the value.
+ *
+ * RETURNS:
+ * Length of text representation.
+ ****************************************************************************
+ */
+unsigned int decode_numeric(const char * value, unsigned int len, char * buf, unsigned int size)
+{
+    int ndigits, weight, sign, dscale, i, digit;
+    unsigned int pos = 0, frac;
+    char tmp[12];                       /* any int, digits of corrupted value aren't limited by 9999 */
+
+    if (len < NUMERIC_HDRSZ)
+        return snprintf(buf, size, "0");
+
+    ndigits = decode_int(value, 2);
+    weight = decode_int(value + 2, 2);
+    sign = (uint16_t) decode_int(value + 4, 2);
+    dscale = decode_int(value + 6, 2);
+
+    if (sign == NUMERIC_NAN)
+        return snprintf(buf, size, "NaN");
+    if (len < NUMERIC_HDRSZ + (unsigned int) ndigits * 2)
+        return snprintf(buf, size, "0");
+
+    if (sign == NUMERIC_NEG && ndigits > 0)
+        pos += snprintf(buf + pos, size - pos, "-");
+
+    /* integer part, the first digit is printed without leading zeroes */
+    if (weight < 0)
+        pos += snprintf(buf + pos, size - pos, "0");
+    for (i = 0; i <= weight && pos < size; i++) {
+        digit = (i < ndigits) ? decode_int(value + NUMERIC_HDRSZ + i * 2, 2) : 0;
+        pos += snprintf(buf + pos, size - pos, (i == 0) ? "%d" : "%04d", digit);
+    }
+
+    /* fractional part, truncated to dscale decimal digits */
+    if (dscale > 0 && pos < size)
+        pos += snprintf(buf + pos, size - pos, ".");
+    for (i = weight + 1, frac = 0; frac < (unsigned int) dscale && pos < size; i++, frac += NUMERIC_DEC_DIGITS) {
+        digit = (i >= 0 && i < ndigits) ? decode_int(value + NUMERIC_HDRSZ + i * 2, 2) : 0;
+        snprintf(tmp, sizeof(tmp), "%04d", digit);
+        pos += snprintf(buf + pos, size - pos, "%.*s", (int) MIN(NUMERIC_DEC_DIGITS, dscale - frac), tmp);
+    }
+
+    return MIN(pos, size - 1);
+}
+
+/*
+ ******************************************************** routine function **
+ * Store value received in binary format into the snapshot. Numeric values
+ * are decoded directly into counters, text is produced only for columns 
+ * which are printed as is.
+ *
+ * IN:
+ * @snap            Snapshot where value will be stored.
+ * @row, @col       Cell position.
+ * @type            Value type OID.
+ * @value           Value in binary format.
+ * @len             Value length, zero for NULLs.
+ ****************************************************************************
+ */
+void add_snapshot_binary(struct snapshot_s * snap, unsigned int row, unsigned int col,
+                Oid type, const char * value, unsigned int len)
+{
+    struct column_s * column = &snap->cols[col];
+    char buf[BINARY_TEXT_MAXLEN];
+    long long ll = 0;
+    double d = 0;
+
+    /* NULLs and text values are stored the same way as in text format */
+    if (len == 0) {
+        add_snapshot_value(snap, row, col, "", 0);
+        return;
+    }
+
+    switch (type) {
+        case INT2OID: case INT4OID: case INT8OID: case OIDOID:
+            ll = (type == OIDOID) ? (unsigned int) decode_int(value, len) : decode_int(value, len);
+            d = ll;
+            if (column->type != col_counter)
+                len = snprintf(buf, sizeof(buf), "%lli", ll);
+            break;
+        case FLOAT4OID: case FLOAT8OID:
+            d = decode_float(value, len);
+            ll = d;
+            if (column->type != col_counter)
+                len = snprintf(buf, sizeof(buf), (type == FLOAT4OID) ? "%.6g" : "%.15g", d);
+            break;
+        case NUMERICOID:
+            ll = decode_numeric_int(value, len);
+            if (column->type != col_counter) {
+                len = decode_numeric(value, len, buf, sizeof(buf));
+                d = strtod(buf, NULL);
+            }
+            break;
+        case BOOLOID:
+            add_snapshot_value(snap, row, col, (*value) ? "t" : "f", 1);
+            return;
+        default:
+            add_snapshot_value(snap, row, col, value, len);
+            return;
+    }
+
+    switch (column->type) {
+        case col_counter:
+            column->counters[row] = ll;
+            column->rates[row] = 0;
+            break;
+        case col_number:
+            add_snapshot_text(snap, row, col, buf, MIN(len, sizeof(buf) - 1));
+            column->numbers[row] = d;
+            break;
+        case col_text: default:
+            add_snapshot_text(snap, row, col, buf, MIN(len, sizeof(buf) - 1));
+            break;
+    }
+}
+
+
+/*
+ ******************************************************** routine function **
+ * Get printable value from the snapshot. Counters are formatted on demand,
+ * so only printed values are formatted.
+ *
+ * IN:
+ * @snap            Snapshot with values.
+ * @row, @col       Cell position.
+ * @buf             Buffer used for formatting counters.
+ * @len             Buffer length.
+ *
+ * RETURNS:
+ * Pointer to the value string.
+ ****************************************************************************
+ */
+const char * get_snapshot_value(struct snapshot_s * snap, unsigned int row, unsigned int col,
+                char * buf, size_t len)
+{
+    if (snap->cols[col].type == col_counter) {
+        snprintf(buf, len, "%lli", (long long) snap->cols[col].rates[row]);
+        return buf;
+    }
+
+    return SNAPSHOT_VALUE(snap, row, col);
+}
+
+/*
+ ******************************************************** routine function **
+ * Get range of columns with counters and mask of columns used as rows key
+ * for the current context.
+ *
+ * IN:
+ * @screen          Current screen, used for getting context.
+ *
+ * OUT:
+ * @min, @max       Range of columns with counters.
+ * @key             Mask of columns used as rows key.
+ ****************************************************************************
+ */
+void get_diff_opts(struct screen_s * screen, unsigned int * min, unsigned int * max, unsigned int * key)
+{
+    *min = *max = INVALID_ORDER_KEY;
+    *key = 0;
+
+    switch (screen->current_context) {
+        case pg_stat_database:
+            *min = PG_STAT_DATABASE_DIFF_MIN;
+            *key = PG_STAT_DATABASE_DIFF_KEY;
+            (atoi(screen->pg_special.pg_version_num) < PG92)
+                ? (*max = PG_STAT_DATABASE_DIFF_MAX_91)
+                : (*max = PG_STAT_DATABASE_DIFF_MAX_LT);
+            break;
+        case pg_stat_replication:
+            /* diff nothing, use returned values as-is */
+            *min = *max = INVALID_ORDER_KEY;
+            break;
+        case pg_stat_tables:
+            *min = PG_STAT_TABLES_DIFF_MIN;
+            *max = PG_STAT_TABLES_DIFF_MAX;
+            *key = PG_STAT_TABLES_DIFF_KEY;
+            break;
+        case pg_stat_indexes:
+            *min = PG_STAT_INDEXES_DIFF_MIN;
+            *max = PG_STAT_INDEXES_DIFF_MAX;
+            *key = PG_STAT_INDEXES_DIFF_KEY;
+            break;
+        case pg_statio_tables:
+            *min = PG_STATIO_TABLES_DIFF_MIN;
+            *max = PG_STATIO_TABLES_DIFF_MAX;
+            *key = PG_STATIO_TABLES_DIFF_KEY;
+            break;
+        case pg_tables_size:
+            *min = PG_TABLES_SIZE_DIFF_MIN;
+            *max = PG_TABLES_SIZE_DIFF_MAX;
+            *key = PG_TABLES_SIZE_DIFF_KEY;
+            break;
+        case pg_stat_activity_long:
+            /* diff nothing, use returned values as-is */
+            *min = *max = INVALID_ORDER_KEY;
+            break;
+        case pg_stat_functions:
+            /* only one column for diff */
+            *min = *max = PG_STAT_FUNCTIONS_DIFF_MIN;
+            *key = PG_STAT_FUNCTIONS_DIFF_KEY;
+            break;
+        case pg_stat_statements_timing:
+            if (atoi(screen->pg_special.pg_version_num) < PG92) {
+                *min = PGSS_TIMING_DIFF_MIN_91;
+                *max = PGSS_TIMING_DIFF_MAX_91;
+                *key = PGSS_TIMING_DIFF_KEY_91;
+            } else {
+                *min = PGSS_TIMING_DIFF_MIN_LT;
+                *max = PGSS_TIMING_DIFF_MAX_LT;
+                *key = PGSS_TIMING_DIFF_KEY_LT;
+            }
+            break;
+        case pg_stat_statements_general:
+            *min = PGSS_GENERAL_DIFF_MIN_LT;
+            *max = PGSS_GENERAL_DIFF_MAX_LT;
+            *key = PGSS_GENERAL_DIFF_KEY_LT;
+            break;
+        case pg_stat_statements_io:
+            if (atoi(screen->pg_special.pg_version_num) < PG92) {
+                *min = PGSS_IO_DIFF_MIN_91;
+                *max = PGSS_IO_DIFF_MAX_91;
+                *key = PGSS_IO_DIFF_KEY_91;
+            } else {
+                *min = PGSS_IO_DIFF_MIN_LT;
+                *max = PGSS_IO_DIFF_MAX_LT;
+                *key = PGSS_IO_DIFF_KEY_LT;
+            }
+            break;
+        case pg_stat_statements_temp:
+            *min = PGSS_TEMP_DIFF_MIN_LT;
+            *max = PGSS_TEMP_DIFF_MAX_LT;
+            *key = PGSS_TEMP_DIFF_KEY_LT;
+            break;
+        case pg_stat_statements_local:
+            if (atoi(screen->pg_special.pg_version_num) < PG92) {
+                *min = PGSS_LOCAL_DIFF_MIN_91;
+                *max = PGSS_LOCAL_DIFF_MAX_91;
+                *key = PGSS_LOCAL_DIFF_KEY_91;
+            } else {
+                *min = PGSS_LOCAL_DIFF_MIN_LT;
+                *max = PGSS_LOCAL_DIFF_MAX_LT;
+                *key = PGSS_LOCAL_DIFF_KEY_LT;
+            }
+            break;
+        case pg_stat_progress_vacuum:
+            /* diff nothing, use returned values as-is */
+            *min = *max = INVALID_ORDER_KEY;
+            break;
+        case pg_stat_backends:
+            *min = PG_STAT_BACKENDS_DIFF_MIN;
+            *max = PG_STAT_BACKENDS_DIFF_MAX;
+            *key = PG_STAT_BACKENDS_DIFF_KEY;
+            break;
+        case pg_fleet:
+            *min = PG_FLEET_DIFF_MIN;
+            *max = PG_FLEET_DIFF_MAX;
+            *key = PG_FLEET_DIFF_KEY;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Skip type cast (e.g. ::int) in the query text.
+ *
+ * IN:
+ * @query           Query text.
+ * @pos             Position where cast might start.
+ * @len             Query length.
+ *
+ * RETURNS:
+ * Position after the cast, or @pos if there is no cast.
+ ****************************************************************************
+ */
+unsigned int skip_query_cast(const char * query, unsigned int pos, unsigned int len)
+{
+    unsigned int i = pos + 2;
+
+    if (pos + 2 >= len || query[pos] != ':' || query[pos + 1] != ':')
+        return pos;
+    while (i < len && (isalpha((unsigned char) query[i]) || query[i] == '_'))
+        i++;
+
+    return (i > pos + 2) ? i : pos;
+}
+
+/*
+ ******************************************************** routine function **
+ * Skip list of placeholders (e.g. "?, ?::int" or "$1, $2") in the query 
+ * text, list items are separated by commas surrounded by spaces.
+ *
+ * IN:
+ * @query           Query text.
+ * @pos             Position of the first placeholder.
+ * @len             Query length.
+ * @mark            Placeholder mark, '?' or '$'.
+ *
+ * RETURNS:
+ * Position after the last placeholder in the list.
+ ****************************************************************************
+ */
+unsigned int skip_query_list(const char * query, unsigned int pos, unsigned int len, char mark)
+{
+    unsigned int end, i;
+
+    for (;;) {
+        /* placeholder itself and its optional cast */
+        i = pos + 1;
+        if (mark == '$')
+            while (i < len && isdigit((unsigned char) query[i]))
+                i++;
+        end = i = skip_query_cast(query, i, len);
+
+        /* separator, then the next placeholder should follow */
+        while (i < len && query[i] == ' ')
+            i++;
+        if (i >= len || query[i] != ',')
+            return end;
+        i++;
+        while (i < len && query[i] == ' ')
+            i++;
+        if (i >= len || query[i] != mark
+                || (mark == '$' && (i + 1 >= len || !isdigit((unsigned char) query[i + 1]))))
+            return end;
+        pos = i;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Normalize query text in single pass: lists of '?' are replaced with single
+ * '?', parameters and their lists are replaced with '$N', comments are 
+ * removed and whitespaces are squeezed into single space. Quoted literals 
+ * and identifiers are kept as is. Normalized query is never longer than 
+ * original, so normalization is done in place.
+ *
+ * IN:
+ * @query           Query text.
+ * @len             Query length.
+ *
+ * OUT:
+ * @query           Normalized query text.
+ *
+ * RETURNS:
+ * Normalized query length.
+ ****************************************************************************
+ */
+unsigned int normalize_query(char * query, unsigned int len)
+{
+    unsigned int r = 0, w = 0, next;
+    char quote;
+
+    while (r < len) {
+        switch (query[r]) {
+            case '\'': case '"':
+                /* quoted literal or identifier, doubled quote is an escaped one */
+                quote = query[r];
+                query[w++] = query[r++];
+                while (r < len) {
+                    query[w++] = query[r++];
+                    if (query[r - 1] == quote) {
+                        if (r < len && query[r] == quote)
+                            query[w++] = query[r++];
+                        else
+                            break;
+                    }
+                }
+                break;
+            case '-':
+                if (r + 1 < len && query[r + 1] == '-') {
+                    /* comment till the end of line, newline becomes a space */
+                    while (r < len && query[r] != '\n')
+                        r++;
+                } else
+                    query[w++] = query[r++];
+                break;
+            case '/':
+                if (r + 1 < len && query[r + 1] == '*') {
+                    /* comment till the nearest end mark, unterminated comment is kept */
+                    for (next = r + 2; next + 1 < len && !(query[next] == '*' && query[next + 1] == '/'); next++)
+                        ;
+                    if (next + 1 < len) {
+                        r = next + 2;
+                        break;
+                    }
+                }
+                query[w++] = query[r++];
+                break;
+            case '?':
+                /* list of '?' becomes single '?', standalone '?' is kept with its cast */
+                next = skip_query_list(query, r, len, '?');
+                if (next != skip_query_cast(query, r + 1, len)) {
+                    query[w++] = '?';
+                    r = next;
+                } else
+                    query[w++] = query[r++];
+                break;
+            case '$':
+                if (r + 1 < len && isdigit((unsigned char) query[r + 1])) {
+                    next = skip_query_list(query, r, len, '$');
+                    query[w++] = '$';
+                    query[w++] = 'N';
+                    r = next;
+                } else
+                    query[w++] = query[r++];
+                break;
+            case ' ': case '\t': case '\n': case '\r': case '\f': case '\v':
+                if (w == 0 || query[w - 1] != ' ')
+                    query[w++] = ' ';
+                r++;
+                break;
+            default:
+                query[w++] = query[r++];
+                break;
+        }
+    }
+
+    query[w] = '\0';
+    return w;
+}
+
+/*
+ ******************************************************** routine function **
+ * Get cache of normalized query texts, it's shared by all connections since
+ * queryid already includes database and user names.
+ *
+ * RETURNS:
+ * Query texts cache.
+ ****************************************************************************
+ */
+struct query_cache_s * get_query_cache(void)
+{
+    static struct query_cache_s cache = { NULL, 0, 0, NULL, 0 };
+
+    if (cache.slots == NULL) {
+        if ((cache.slots = calloc(QUERY_CACHE_SLOTS, sizeof(struct query_cache_slot_s))) == NULL)
+            mreport(true, msg_fatal, "FATAL: calloc for query cache failed.\n");
+    }
+
+    return &cache;
+}
+
+/*
+ ******************************************************** routine function **
+ * Find cache slot of the query. Open addressing is used, cache never has 
+ * more than half of slots used.
+ *
+ * IN:
+ * @cache           Query texts cache.
+ * @queryid         Query identifier used as a cache key.
+ *
+ * RETURNS:
+ * Slot with the query or empty slot where query should be stored.
+ ****************************************************************************
+ */
+struct query_cache_slot_s * find_query_cache_slot(struct query_cache_s * cache, const char * queryid)
+{
+    unsigned int hash = 2166136261U, i;
+
+    for (i = 0; queryid[i] != '\0'; i++) {
+        hash ^= (unsigned char) queryid[i];
+        hash *= 16777619U;
+    }
+
+    for (i = hash & (QUERY_CACHE_SLOTS - 1); cache->slots[i].used; i = (i + 1) & (QUERY_CACHE_SLOTS - 1))
+        if (strcmp(cache->data + cache->slots[i].key, queryid) == 0)
+            break;
+
+    return &cache->slots[i];
+}
+
+/*
+ ******************************************************** routine function **
+ * Get normalized query text from the cache.
+ *
+ * IN:
+ * @queryid         Query identifier used as a cache key.
+ *
+ * OUT:
+ * @len             Normalized query length.
+ *
+ * RETURNS:
+ * Normalized query text or NULL if query isn't cached.
+ ****************************************************************************
+ */
+const char * lookup_query_cache(const char * queryid, unsigned int * len)
+{
+    struct query_cache_s * cache = get_query_cache();
+    struct query_cache_slot_s * slot = find_query_cache_slot(cache, queryid);
+
+    if (!slot->used)
+        return NULL;
+
+    *len = slot->len;
+    return cache->data + slot->value;
+}
+
+/*
+ ******************************************************** routine function **
+ * Normalize query text and store it into the cache, so each distinct query
+ * is normalized and transferred once per session. Cache is flushed entirely
+ * when it becomes full.
+ *
+ * IN:
+ * @queryid         Query identifier used as a cache key.
+ * @query           Query text, it's normalized in place.
+ * @len             Query length.
+ ****************************************************************************
+ */
+void store_query_cache(const char * queryid, char * query, unsigned int len)
+{
+    struct query_cache_s * cache = get_query_cache();
+    struct query_cache_slot_s * slot;
+    size_t key_len = strlen(queryid), need;
+
+    if (find_query_cache_slot(cache, queryid)->used)
+        return;
+
+    /* too long queries are not cached */
+    len = normalize_query(query, len);
+    need = key_len + len + 2;
+    if (need > QUERY_CACHE_MAXLEN)
+        return;
+
+    if (cache->n_entries >= QUERY_CACHE_SLOTS / 2 || cache->data_used + need > QUERY_CACHE_MAXLEN) {
+        memset(cache->slots, 0, QUERY_CACHE_SLOTS * sizeof(struct query_cache_slot_s));
+        cache->data_used = 0;
+        cache->n_entries = 0;
+    }
+
+    if (cache->data_used + need > cache->data_size) {
+        cache->data_size = MIN(QUERY_CACHE_MAXLEN, MAX(cache->data_size * 2, cache->data_used + need));
+        if ((cache->data = realloc(cache->data, cache->data_size)) == NULL)
+            mreport(true, msg_fatal, "FATAL: realloc for query cache failed.\n");
+    }
+
+    slot = find_query_cache_slot(cache, queryid);
+    slot->used = true;
+    slot->key = cache->data_used;
+    memcpy(cache->data + cache->data_used, queryid, key_len + 1);
+    slot->value = cache->data_used + key_len + 1;
+    memcpy(cache->data + slot->value, query, len + 1);
+    slot->len = len;
+    cache->data_used += need;
+    cache->n_entries++;
+}
+
+/*
+ ******************************************************** routine function **
+ * Fetch texts of pg_stat_statements queries which aren't cached yet. Texts
+ * are fetched in one query using array of queryids.
+ *
+ * IN:
+ * @conn            Current postgres connection.
+ * @res             Result of pg_stat_statements query with queryid column.
+ *
+ * OUT:
+ * @errmsg          Error message returned by postgres.
+ * @canceled        Query is canceled due to key press.
+ *
+ * RETURNS:
+ * False if texts can't be fetched.
+ ****************************************************************************
+ */
+bool fetch_query_texts(PGconn * conn, PGresult * res, char errmsg[], bool * canceled)
+{
+    int id_col = PQfnumber(res, "queryid");
+    unsigned int i, n_rows = PQntuples(res), len;
+    size_t ids_len = 0, ids_size = 0;
+    char * ids = NULL;
+    const char * params[1];
+    PGresult * texts;
+
+    *canceled = false;
+    if (id_col == -1)
+        return true;
+
+    /* build array literal from missing queryids, they are hex strings and don't need quoting */
+    for (i = 0; i < n_rows; i++) {
+        if (lookup_query_cache(PQgetvalue(res, i, id_col), &len) != NULL)
+            continue;
+        len = PQgetlength(res, i, id_col);
+        if (ids_len + len + 3 > ids_size) {
+            ids_size = MAX(ids_size * 2, ids_len + len + 3 + S_BUF_LEN);
+            if ((ids = realloc(ids, ids_size)) == NULL)
+                mreport(true, msg_fatal, "FATAL: realloc for queryids failed.\n");
+        }
+        ids[ids_len] = (ids_len == 0) ? '{' : ',';
+        ids_len++;
+        memcpy(ids + ids_len, PQgetvalue(res, i, id_col), len);
+        ids_len += len;
+    }
+    if (ids == NULL)
+        return true;
+    ids[ids_len++] = '}';
+    ids[ids_len] = '\0';
+
+    params[0] = ids;
+    if (PQsendQueryParams(conn, PG_STAT_STATEMENTS_TEXTS_QUERY, 1, NULL, params, NULL, NULL, 0) == 0) {
+        snprintf(errmsg, ERRSIZE, "%s", PQerrorMessage(conn));
+        free(ids);
+        return false;
+    }
+    free(ids);
+
+    if ((texts = wait_query_result(conn, errmsg, canceled)) == NULL)
+        return false;
+
+    for (i = 0; i < (unsigned int) PQntuples(texts); i++)
+        store_query_cache(PQgetvalue(texts, i, 0), PQgetvalue(texts, i, 1), PQgetlength(texts, i, 1));
+    PQclear(texts);
+
+    return true;
+}
+
+/*
+ ******************************************************** routine function **
+ * Copy database query results into a snapshot. Values are parsed once, 
+ * counters columns are defined by the current context.
+ *
+ * IN:
+ * @snap            Snapshot where query results will be stored.
+ * @res             Database query result.
+ * @screen          Current screen, used for getting context.
+ ****************************************************************************
+ */
+void pgrescpy(struct snapshot_s * snap, PGresult *res, struct screen_s * screen)
+{
+    unsigned int i, j, min, max, len;
+    unsigned int n_rows = PQntuples(res),
+                 n_cols = PQnfields(res);
+    size_t data_len = 0;
+    enum col_type type;
+    bool binary = PQbinaryTuples(res);
+    int id_col = -1;
+    const char * text;
+
+    get_diff_opts(screen, &min, &max, &snap->key);
+    /* tables sizes may decrease, their deltas are not clamped */
+    snap->monotonic = (screen->current_context != pg_tables_size);
+
+    /* calculate space required for text values, binary values need space for their text */
+    for (i = 0; i < n_rows; i++)
+        for (j = 0; j < n_cols; j++)
+            if (j < min || j > max)
+                data_len += MAX((unsigned int) PQgetlength(res, i, j), binary ? BINARY_TEXT_MAXLEN : 0) + 1;
+
+    /* pg_stat_statements results have no query texts, they are taken from cache */
+    if (PGSS_CONTEXT(screen->current_context) && (id_col = PQfnumber(res, "queryid")) != -1) {
+        for (i = 0; i < n_rows; i++)
+            if (lookup_query_cache(PQgetvalue(res, i, id_col), &len) != NULL)
+                data_len += len;
+        data_len += n_rows;
+    }
+
+    reserve_snapshot(snap, n_rows, (id_col != -1) ? n_cols + 1 : n_cols, data_len);
+
+    for (j = 0; j < n_cols; j++) {
+        if (j >= min && j <= max)
+            type = col_counter;
+        else {
+            switch (PQftype(res, j)) {
+                case INT8OID: case INT2OID: case INT4OID: case OIDOID:
+                case FLOAT4OID: case FLOAT8OID: case NUMERICOID:
+                    type = col_number;
+                    break;
+                default:
+                    type = col_text;
+                    break;
+            }
+        }
+        set_snapshot_column(snap, j, PQfname(res, j), type);
+    }
+
+    if (binary) {
+        for (i = 0; i < n_rows; i++)
+            for (j = 0; j < n_cols; j++)
+                add_snapshot_binary(snap, i, j, PQftype(res, j), PQgetvalue(res, i, j), PQgetlength(res, i, j));
+    } else {
+        for (i = 0; i < n_rows; i++)
+            for (j = 0; j < n_cols; j++)
+                add_snapshot_value(snap, i, j, PQgetvalue(res, i, j), PQgetlength(res, i, j));
+    }
+
+    /* query column is synthesized from cached texts, texts missing in cache are left empty */
+    if (id_col != -1) {
+        set_snapshot_column(snap, n_cols, PGSS_QUERY_COLUMN, col_text);
+        for (i = 0; i < n_rows; i++) {
+            if ((text = lookup_query_cache(PQgetvalue(res, i, id_col), &len)) == NULL)
+                text = "", len = 0;
+            add_snapshot_text(snap, i, n_cols, text, len);
+        }
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Calculate hash of the snapshot row using values of key columns.
+ *
+ * IN:
+ * @snap            Snapshot which contains row.
+ * @row             Row number.
+ * @key             Mask of key columns.
+ *
+ * RETURNS:
+ * Hash value (FNV-1a) of the key columns values.
+ ****************************************************************************
+ */
+unsigned int hash_snapshot_row(struct snapshot_s * snap, unsigned int row, unsigned int key)
+{
+    unsigned int col, i, hash = 2166136261U;
+    struct cell_s * cell;
+    const char * value;
+
+    for (col = 0; col < snap->n_cols; col++) {
+        if ((key & DIFF_KEY(col)) == 0)
+            continue;
+        cell = SNAPSHOT_CELL(snap, row, col);
+        value = snap->data + cell->offset;
+        /* hash also trailing zero, it separates values of the key columns */
+        for (i = 0; i <= cell->len; i++) {
+            hash ^= (unsigned char) value[i];
+            hash *= 16777619U;
+        }
+    }
+
+    return hash;
+}
+
+/*
+ ******************************************************** routine function **
+ * Compare key columns of rows from two snapshots.
+ *
+ * IN:
+ * @a, @a_row       First snapshot and its row number.
+ * @b, @b_row       Second snapshot and its row number.
+ * @key             Mask of key columns.
+ *
+ * RETURNS:
+ * True if key columns values are equal, false otherwise.
+ ****************************************************************************
+ */
+bool cmp_snapshot_rows(struct snapshot_s * a, unsigned int a_row,
+                struct snapshot_s * b, unsigned int b_row, unsigned int key)
+{
+    unsigned int col;
+    struct cell_s *ca, *cb;
+
+    for (col = 0; col < a->n_cols && col < b->n_cols; col++) {
+        if ((key & DIFF_KEY(col)) == 0)
+            continue;
+        ca = SNAPSHOT_CELL(a, a_row, col);
+        cb = SNAPSHOT_CELL(b, b_row, col);
+        if (ca->len != cb->len || memcmp(a->data + ca->offset, b->data + cb->offset, ca->len) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ ******************************************************** routine function **
+ * Build open addressing hash table of the snapshot rows. Hash table memory
+ * is reused and grows only when snapshot grows.
+ *
+ * IN:
+ * @snap            Snapshot which rows should be hashed.
+ * @key             Mask of key columns.
+ ****************************************************************************
+ */
+void build_snapshot_hash(struct snapshot_s * snap, unsigned int key)
+{
+    unsigned int i, slot, size = 16;
+
+    /* keep load factor below 0.5 */
+    while (size < snap->n_rows * 2)
+        size <<= 1;
+
+    if (size > snap->hash_size) {
+        free(snap->hash);
+        if ((snap->hash = malloc(sizeof(unsigned int) * size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for snapshot hash failed.\n");
+        }
+        snap->hash_size = size;
+    }
+
+    memset(snap->hash, 0, sizeof(unsigned int) * snap->hash_size);
+    snap->hash_key = key;
+
+    for (i = 0; i < snap->n_rows; i++) {
+        slot = hash_snapshot_row(snap, i, key) & (snap->hash_size - 1);
+        while (snap->hash[slot] != 0)
+            slot = (slot + 1) & (snap->hash_size - 1);
+        snap->hash[slot] = i + 1;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Find row in the snapshot, which has the same key as row in other snapshot.
+ *
+ * IN:
+ * @snap            Snapshot with built hash table, where row is searched.
+ * @from            Snapshot with row which key is used for searching.
+ * @row             Row number in @from snapshot.
+ * @key             Mask of key columns.
+ *
+ * RETURNS:
+ * Row number in @snap, or -1 if row is not found.
+ ****************************************************************************
+ */
+int find_snapshot_row(struct snapshot_s * snap, struct snapshot_s * from, unsigned int row, unsigned int key)
+{
+    unsigned int slot;
+
+    if (snap->hash_size == 0 || snap->hash_key != key)
+        return -1;
+
+    slot = hash_snapshot_row(from, row, key) & (snap->hash_size - 1);
+    while (snap->hash[slot] != 0) {
+        if (cmp_snapshot_rows(snap, snap->hash[slot] - 1, from, row, key))
+            return snap->hash[slot] - 1;
+        slot = (slot + 1) & (snap->hash_size - 1);
+    }
+
+    return -1;
+}
+
+/*
+ ******************************************************** routine function **
+ * Calculate rates of counters, scalar version. Negative deltas which occur 
+ * after stats reset are clamped to zero, the same way as ll_sp_value() does.
+ *
+ * IN:
+ * @curr            Current counters values.
+ * @prev            Previous counters values.
+ * @n               Number of values.
+ * @divisor         Interval in seconds.
+ * @clamp           Clamp negative deltas.
+ *
+ * OUT:
+ * @rates           Deltas per second.
+ ****************************************************************************
+ */
+void calc_rates_scalar(double * rates, const long long * curr, const long long * prev,
+                unsigned int n, double divisor, bool clamp)
+{
+    unsigned int i;
+    long long delta;
+
+    for (i = 0; i < n; i++) {
+        delta = curr[i] - prev[i];
+        if (clamp && delta < 0)
+            delta = 0;
+        rates[i] = (double) delta / divisor;
+    }
+}
+
+#ifdef __SSE2__
+/*
+ * Constants used for converting unsigned 64-bit integers into doubles without
+ * AVX-512: low and high 32-bit halves are placed into mantissas of 2^52 and 
+ * 2^84, then magic values are subtracted and halves are summed.
+ */
+#define RATES_MAGIC_LO      4503599627370496.0                  /* 2^52 */
+#define RATES_MAGIC_HI      19342813113834066795298816.0        /* 2^84 */
+#define RATES_MAGIC_ALL     19342813118337666422669312.0        /* 2^84 + 2^52 */
+
+/*
+ ******************************************************** routine function **
+ * Calculate rates of counters, SSE2 version (two counters per step). 
+ * Negative deltas are clamped to zero.
+ *
+ * IN:
+ * @curr            Current counters values.
+ * @prev            Previous counters values.
+ * @n               Number of values.
+ * @divisor         Interval in seconds.
+ *
+ * OUT:
+ * @rates           Deltas per second.
+ ****************************************************************************
+ */
+void calc_rates_sse2(double * rates, const long long * curr, const long long * prev,
+                unsigned int n, double divisor)
+{
+    unsigned int i;
+    const __m128i lo_mask = _mm_set1_epi64x(0xFFFFFFFFLL);
+    const __m128d magic_lo = _mm_set1_pd(RATES_MAGIC_LO),
+                  magic_hi = _mm_set1_pd(RATES_MAGIC_HI),
+                  magic_all = _mm_set1_pd(RATES_MAGIC_ALL),
+                  div = _mm_set1_pd(divisor);
+    __m128i delta, sign, hi, lo;
+    __m128d value;
+
+    for (i = 0; i + 2 <= n; i += 2) {
+        delta = _mm_sub_epi64(_mm_loadu_si128((const __m128i *) &curr[i]),
+                              _mm_loadu_si128((const __m128i *) &prev[i]));
+        /* SSE2 has no 64-bit compare, spread sign of the high halves instead */
+        sign = _mm_shuffle_epi32(_mm_srai_epi32(delta, 31), _MM_SHUFFLE(3, 3, 1, 1));
+        delta = _mm_andnot_si128(sign, delta);
+
+        hi = _mm_or_si128(_mm_srli_epi64(delta, 32), _mm_castpd_si128(magic_hi));
+        lo = _mm_or_si128(_mm_and_si128(delta, lo_mask), _mm_castpd_si128(magic_lo));
+        value = _mm_add_pd(_mm_sub_pd(_mm_castsi128_pd(hi), magic_all), _mm_castsi128_pd(lo));
+        _mm_storeu_pd(&rates[i], _mm_div_pd(value, div));
+    }
+
+    calc_rates_scalar(rates + i, curr + i, prev + i, n - i, divisor, true);
+}
+
+/*
+ ******************************************************** routine function **
+ * Calculate rates of counters, AVX2 version (four counters per step). 
+ * Negative deltas are clamped to zero.
+ *
+ * IN:
+ * @curr            Current counters values.
+ * @prev            Previous counters values.
+ * @n               Number of values.
+ * @divisor         Interval in seconds.
+ *
+ * OUT:
+ * @rates           Deltas per second.
+ ****************************************************************************
+ */
+__attribute__((target("avx2")))
+void calc_rates_avx2(double * rates, const long long * curr, const long long * prev,
+                unsigned int n, double divisor)
+{
+    unsigned int i;
+    const __m256i zero = _mm256_setzero_si256(),
+                  lo_mask = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    const __m256d magic_lo = _mm256_set1_pd(RATES_MAGIC_LO),
+                  magic_hi = _mm256_set1_pd(RATES_MAGIC_HI),
+                  magic_all = _mm256_set1_pd(RATES_MAGIC_ALL),
+                  div = _mm256_set1_pd(divisor);
+    __m256i delta, hi, lo;
+    __m256d value;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        delta = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *) &curr[i]),
+                                 _mm256_loadu_si256((const __m256i *) &prev[i]));
+        delta = _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, delta), delta);
+
+        hi = _mm256_or_si256(_mm256_srli_epi64(delta, 32), _mm256_castpd_si256(magic_hi));
+        lo = _mm256_or_si256(_mm256_and_si256(delta, lo_mask), _mm256_castpd_si256(magic_lo));
+        value = _mm256_add_pd(_mm256_sub_pd(_mm256_castsi256_pd(hi), magic_all), _mm256_castsi256_pd(lo));
+        _mm256_storeu_pd(&rates[i], _mm256_div_pd(value, div));
+    }
+
+    calc_rates_sse2(rates + i, curr + i, prev + i, n - i, divisor);
+}
+#endif /* __SSE2__ */
+
+/*
+ ******************************************************** routine function **
+ * Calculate rates of counters. Vectorized version is selected at runtime
+ * depending on CPU features, scalar version is used for counters which may
+ * decrease.
+ *
+ * IN:
+ * @curr            Current counters values.
+ * @prev            Previous counters values.
+ * @n               Number of values.
+ * @divisor         Interval in seconds.
+ * @clamp           Clamp negative deltas.
+ *
+ * OUT:
+ * @rates           Deltas per second.
+ ****************************************************************************
+ */
+void calc_rates(double * rates, const long long * curr, const long long * prev,
+                unsigned int n, double divisor, bool clamp)
+{
+#ifdef __SSE2__
+    static int use_avx2 = -1;
+
+    if (clamp) {
+        if (use_avx2 == -1) {
+            __builtin_cpu_init();
+            use_avx2 = __builtin_cpu_supports("avx2");
+        }
+        (use_avx2)
+            ? calc_rates_avx2(rates, curr, prev, n, divisor)
+            : calc_rates_sse2(rates, curr, prev, n, divisor);
+        return;
+    }
+#endif
+    calc_rates_scalar(rates, curr, prev, n, divisor, clamp);
+}
+
+/*
+ ******************************************************** routime function **
+ * Compare snapshots and calculate rates of current snapshot counters. Rows
+ * of snapshots are matched by context specific key columns, so rows order
+ * and added or removed rows don't affect deltas.
+ *
+ * IN:
+ * @p_snap          Snapshot with results of previous query.
+ * @c_snap          Snapshot with results of current query.
+ *
+ * OUT:
+ * @c_snap          Snapshot with calculated rates.
+ *
+ * RETURNS:
+ * True if rows are matched with previous snapshot and rates are calculated.
+ ****************************************************************************
+ */
+bool diff_arrays(struct snapshot_s * p_snap, struct snapshot_s * c_snap)
+{
+    unsigned int i, j;
+    double divisor = c_snap->ts - p_snap->ts;
+    long long * curr, * prev;
+
+    /* snapshots with different columns can't be compared */
+    if (c_snap->key == 0 || p_snap->n_cols != c_snap->n_cols || divisor <= 0)
+        return false;
+
+    /* rows of previous snapshot are matched using key columns, not by position */
+    build_snapshot_hash(p_snap, c_snap->key);
+    for (i = 0; i < c_snap->n_rows; i++)
+        c_snap->prev[i] = find_snapshot_row(p_snap, c_snap, i, c_snap->key);
+
+    for (j = 0; j < c_snap->n_cols; j++) {
+        if (c_snap->cols[j].type != col_counter || p_snap->cols[j].type != col_counter)
+            continue;
+
+        curr = c_snap->cols[j].counters;
+        prev = p_snap->cols[j].counters;
+
+        /* 
+         * gather previous values in order of current rows, rows appeared 
+         * since previous snapshot have no delta yet
+         */
+        for (i = 0; i < c_snap->n_rows; i++)
+            c_snap->aligned[i] = (c_snap->prev[i] == -1) ? curr[i] : prev[c_snap->prev[i]];
+
+        calc_rates(c_snap->cols[j].rates, curr, c_snap->aligned, c_snap->n_rows, divisor, c_snap->monotonic);
+    }
+
+    return true;
+}
+
+/*
+ ******************************************************** routine function **
+ * Sort snapshot rows using specified order key (column number).
+ *
+ * IN:
+ * @snap            Snapshot which content will be sorted.
+ * @screen          Current screen.
+ *
+ * OUT:
+ * @snap            Snapshot with sorted rows order.
+ ****************************************************************************
+ */
+void sort_array(struct snapshot_s * snap, struct screen_s * screen)
+{
+    unsigned int i;
+    struct sort_key_s order_key = { snap, 0, NULL };
+    bool desc = false;
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        if (screen->current_context == screen->context_list[i].context) {
+            order_key.key = screen->context_list[i].order_key;
+            desc = screen->context_list[i].order_desc;
+        }
+
+    /* don't sort arrays with invalid key */
+    if (order_key.key == INVALID_ORDER_KEY || order_key.key >= snap->n_cols || snap->n_rows == 0)
+        return;
+
+    /* comparator function depends on column data type */
+    switch (snap->cols[order_key.key].type) {
+        case col_counter:
+        case col_number:
+            order_key.values = (snap->cols[order_key.key].type == col_counter)
+                ? snap->cols[order_key.key].rates
+                : snap->cols[order_key.key].numbers;
+            (desc)
+                ? qsort_r(snap->order, snap->n_rows, sizeof(unsigned int), num_cmp_desc, &order_key)
+                : qsort_r(snap->order, snap->n_rows, sizeof(unsigned int), num_cmp_asc, &order_key);
+            break;
+        case col_text: default:
+            (desc)
+                ? qsort_r(snap->order, snap->n_rows, sizeof(unsigned int), str_cmp_desc, &order_key)
+                : qsort_r(snap->order, snap->n_rows, sizeof(unsigned int), str_cmp_asc, &order_key);
+            break;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Allocate memory for column attributes struct.
+ *
+ * IN:
+ * n_cols:      Number of columns.
+ ****************************************************************************
+ */
+struct colAttrs * init_colattrs(unsigned int n_cols) {
+    struct colAttrs *cols;
+    if ((cols = (struct colAttrs *) malloc(sizeof(struct colAttrs) * n_cols)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for column attributes failed.\n");
+    }
+    return cols;
+}
+
+/*
+ ******************************************************** routine function **
+ * Set filtration pattern or reset one.
+ *
+ * IN:
+ * @win                 Window for diagnose messages.
+ * @screen              Screen options (filtration patterns array).
+ * @first_iter          Reset data.
+ ****************************************************************************
+ */
+void set_filter(WINDOW * win, struct screen_s * screen, bool * first_iter) {
     int i;
     bool with_esc;
-    char pattern[S_BUF_LEN], msg[S_BUF_LEN];
-    struct context_s ctx;
+    char pattern[S_BUF_LEN], msg[S_BUF_LEN];
+    struct context_s ctx;
+
+    /* get current context and its filter strings array */
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        if (screen->current_context == screen->context_list[i].context)
+            ctx = screen->context_list[i];
+
+    snprintf(msg, S_BUF_LEN, "Set filter, current: \"%s\": ", ctx.fstrings[ctx.order_key]);
+
+    cmd_readline(win, msg, strlen(msg), &with_esc, pattern, sizeof(pattern), true);
+    if (strlen(pattern) > 0 && with_esc == false) {
+        snprintf(ctx.fstrings[ctx.order_key], sizeof(ctx.fstrings[ctx.order_key]), "%s", pattern);
+    } else if (strlen(pattern) == 0 && with_esc == false ) {
+        wprintw(win, "Reset filtering.");
+        snprintf(ctx.fstrings[ctx.order_key], sizeof(ctx.fstrings[ctx.order_key]), "%s", "");
+    }
+
+    /* Save pattern to context */
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        if (screen->current_context == screen->context_list[i].context)
+            screen->context_list[i] = ctx;
+
+    *first_iter = true;
+}
+
+/*
+ ******************************************************** routine function **
+ * Print array content to the ncurses screen.
+ *
+ * IN:
+ * @window          Ncurses window where result will be printed.
+ * @snap            Snapshot which content will be printed.
+ * @screen          Current screen, used for getting order key and highlight 
+ *                  appropriate column.
+ ****************************************************************************
+ */
+void print_data(WINDOW *window, struct snapshot_s * snap, struct screen_s * screen)
+{
+    unsigned int i, j, x, row, printed;
+    unsigned int n_rows = snap->n_rows,
+                 n_cols = snap->n_cols;
+    unsigned int winsz_x, winsz_y;
+    char value[XS_BUF_LEN * 2];
+    static struct colAttrs *columns = NULL;
+    static unsigned int columns_size = 0;
+    struct context_s ctx;
+    bool print = true, filter = false;
+
+    /* columns attributes are reused between refreshes */
+    if (n_cols > columns_size) {
+        free(columns);
+        columns = init_colattrs(n_cols);
+        columns_size = n_cols;
+    }
+
+    calculate_width(columns, NULL, screen, snap, n_rows, n_cols);
+    wclear(window);
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        if (screen->current_context == screen->context_list[i].context)
+            ctx = screen->context_list[i];
+
+    /* enable filtration if there is an any filter pattern */
+    for (i = 0; i < MAX_COLS; i++) {
+        if (strlen(ctx.fstrings[i]) > 0) {
+            filter = true;
+            break;
+        } else
+            filter = false;
+    }
+
+    /* print header */
+    wattron(window, A_BOLD);
+    for (j = 0, x = 0; j < n_cols; j++, x++) {
+        /* truncate last field length to end of screen */
+        if (j == n_cols - 1) {
+            getyx(window, winsz_y, winsz_x);
+            columns[x].width = COLS - winsz_x - 1;
+            /* dirty hack for supress gcc warning about "variable set but not used" */
+            winsz_y--;
+        } 
+        /* mark sort column */
+        if (j == ctx.order_key) {
+            wattron(window, A_REVERSE);
+            wprintw(window, "%-*s", columns[x].width, columns[x].name);
+            wattroff(window, A_REVERSE);
+        } else
+            wprintw(window, "%-*s", columns[x].width, columns[x].name);
+    }
+    wprintw(window, "\n");
+    wattroff(window, A_BOLD);
+
+    /* print data from snapshot, only rows which fit into the window are formatted */
+    for (i = 0, printed = 0; i < n_rows && printed < (unsigned int) getmaxy(window) - 1; i++) {
+        row = snap->order[i];
+        /* filtering cycle - searching filter pattern */
+        if (filter)
+            for (j = 0; j < n_cols; j++) {
+                if (strlen(ctx.fstrings[j]) == 0)
+                    continue;               /* skip empty pattern */
+                else if (!strstr(get_snapshot_value(snap, row, j, value, sizeof(value)), ctx.fstrings[j]))
+                    print = false;          /* pattern not found */
+                else {
+                    print = true;           /* pattern found */
+                    break;
+                }
+            }
+        /* printing cycle - don't print filtered rows */
+        if (!print)
+            continue;
+        for (j = 0, x = 0; j < n_cols; j++, x++) {
+            /* truncate last field length to end of screen */
+            if (j == n_cols - 1) {
+                getyx(window, winsz_y, winsz_x);
+                columns[x].width = COLS - winsz_x;
+            }
+            wprintw(window, "%-*.*s", columns[x].width, columns[x].width,
+                    get_snapshot_value(snap, row, j, value, sizeof(value)));
+        }
+        printed++;
+    }
+    wrefresh(window);
+}
+
+/*
+ ********************************************************** sink function **
+ * Initialize output sink. Csv and json sinks write into file or stdout.
+ *
+ * IN:
+ * @type            Sink type.
+ * @window          Window used by ncurses sink.
+ * @path            Output file path, stdout is used if path is empty.
+ *
+ * OUT:
+ * @sink            Output sink.
+ ****************************************************************************
+ */
+void init_sink(struct sink_s * sink, enum sink_type type, WINDOW * window, const char * path)
+{
+    memset(sink, 0, sizeof(struct sink_s));
+    sink->type = type;
+    sink->window = window;
+    sink->fd = STDOUT_FILENO;
+
+    if (type == sink_ncurses)
+        return;
+
+    if (path != NULL && strlen(path) != 0
+            && (sink->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644)) == -1) {
+        mreport(true, msg_fatal, "FATAL: can't open %s: %s.\n", path, strerror(errno));
+    }
+    sink->size = SINK_BUF_LEN;
+    if ((sink->buf = malloc(sink->size)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for output buffer failed.\n");
+    }
+}
+
+/*
+ ********************************************************** sink function **
+ * Write data into the sink file.
+ *
+ * IN:
+ * @sink            Output sink.
+ * @data            Data.
+ * @len             Data length.
+ ****************************************************************************
+ */
+void write_sink(struct sink_s * sink, const char * data, size_t len)
+{
+    size_t written = 0;
+    ssize_t n;
+
+    while (written < len) {
+        if ((n = write(sink->fd, data + written, len - written)) == -1) {
+            if (errno == EINTR)
+                continue;
+            mreport(true, msg_fatal, "FATAL: write of output failed: %s.\n", strerror(errno));
+        }
+        written += n;
+    }
+}
+
+/*
+ ********************************************************** sink function **
+ * Write buffered rows of the sink.
+ *
+ * IN:
+ * @sink            Output sink.
+ ****************************************************************************
+ */
+void flush_sink(struct sink_s * sink)
+{
+    write_sink(sink, sink->buf, sink->used);
+    sink->used = 0;
+}
+
+/*
+ ********************************************************** sink function **
+ * Append string to the sink buffer, buffer is written when it's full.
+ *
+ * IN:
+ * @sink            Output sink.
+ * @str             String, it may be not zero terminated.
+ * @len             String length.
+ ****************************************************************************
+ */
+void sink_append(struct sink_s * sink, const char * str, size_t len)
+{
+    if (sink->used + len > sink->size)
+        flush_sink(sink);
+    /* too long value is written directly */
+    if (len > sink->size) {
+        write_sink(sink, str, len);
+        return;
+    }
+    memcpy(sink->buf + sink->used, str, len);
+    sink->used += len;
+}
+
+/*
+ ********************************************************** sink function **
+ * Append csv field. Fields with separators, quotes or line breaks are
+ * quoted, quotes are doubled.
+ *
+ * IN:
+ * @sink            Output sink.
+ * @value           Field value.
+ ****************************************************************************
+ */
+void sink_append_csv(struct sink_s * sink, const char * value)
+{
+    const char * p;
+
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        sink_append(sink, value, strlen(value));
+        return;
+    }
+
+    sink_append(sink, "\"", 1);
+    while ((p = strchr(value, '"')) != NULL) {
+        sink_append(sink, value, p - value + 1);
+        sink_append(sink, "\"", 1);
+        value = p + 1;
+    }
+    sink_append(sink, value, strlen(value));
+    sink_append(sink, "\"", 1);
+}
+
+/*
+ ********************************************************** sink function **
+ * Append json string. Quotes, backslashes and control characters are
+ * escaped.
+ *
+ * IN:
+ * @sink            Output sink.
+ * @value           String value.
+ ****************************************************************************
+ */
+void sink_append_json(struct sink_s * sink, const char * value)
+{
+    const char * p;
+    char esc[8];
+
+    sink_append(sink, "\"", 1);
+    for (p = value; *p != '\0'; p++) {
+        if (*p != '"' && *p != '\\' && (unsigned char) *p >= 0x20)
+            continue;
+        sink_append(sink, value, p - value);
+        if (*p == '"' || *p == '\\') {
+            esc[0] = '\\';
+            esc[1] = *p;
+            sink_append(sink, esc, 2);
+        } else
+            sink_append(sink, esc, snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char) *p));
+        value = p + 1;
+    }
+    sink_append(sink, value, p - value);
+    sink_append(sink, "\"", 1);
+}
+
+/*
+ ********************************************************** sink function **
+ * Write snapshot rows into the sink. Ncurses sink prints snapshot into its
+ * window. Csv sink writes a row per snapshot row prefixed with time and
+ * context name, header is written before the first rows of the context.
+ * Json sink writes an object per snapshot row. Counters are written as
+ * rates, as they are shown in console.
+ *
+ * IN:
+ * @sink            Output sink.
+ * @snap            Snapshot with calculated rates.
+ * @screen          Current screen.
+ * @context         Snapshot context.
+ * @t               Sampling time.
+ ****************************************************************************
+ */
+void write_sink_snapshot(struct sink_s * sink, struct snapshot_s * snap, struct screen_s * screen,
+        enum context context, time_t t)
+{
+    unsigned int i, j, row;
+    char strtime[32], value[XS_BUF_LEN * 2], * end;
+    const char * v;
+    size_t len;
+
+    if (sink->type == sink_ncurses) {
+        print_data(sink->window, snap, screen);
+        return;
+    }
+
+    strftime(strtime, sizeof(strtime), "%Y-%m-%dT%H:%M:%S%z", localtime(&t));
+
+    if (sink->type == sink_csv && sink->header_cols[context] != snap->n_cols) {
+        sink_append(sink, "time,context", 12);
+        for (j = 0; j < snap->n_cols; j++) {
+            sink_append(sink, ",", 1);
+            sink_append_csv(sink, snap->cols[j].name);
+        }
+        sink_append(sink, "\n", 1);
+        sink->header_cols[context] = snap->n_cols;
+    }
+
+    for (i = 0; i < snap->n_rows; i++) {
+        row = snap->order[i];
+        if (sink->type == sink_csv) {
+            sink_append(sink, strtime, strlen(strtime));
+            sink_append(sink, ",", 1);
+            sink_append(sink, context_names[context], strlen(context_names[context]));
+            for (j = 0; j < snap->n_cols; j++) {
+                sink_append(sink, ",", 1);
+                sink_append_csv(sink, get_snapshot_value(snap, row, j, value, sizeof(value)));
+            }
+            sink_append(sink, "\n", 1);
+            continue;
+        }
+
+        sink_append(sink, "{\"time\":\"", 9);
+        sink_append(sink, strtime, strlen(strtime));
+        sink_append(sink, "\",\"context\":\"", 13);
+        sink_append(sink, context_names[context], strlen(context_names[context]));
+        sink_append(sink, "\"", 1);
+        for (j = 0; j < snap->n_cols; j++) {
+            sink_append(sink, ",", 1);
+            sink_append_json(sink, snap->cols[j].name);
+            sink_append(sink, ":", 1);
+            v = get_snapshot_value(snap, row, j, value, sizeof(value));
+            len = strlen(v);
+            if (snap->cols[j].type == col_text) {
+                sink_append_json(sink, v);
+                continue;
+            }
+            if (len == 0) {
+                sink_append(sink, "null", 4);
+                continue;
+            }
+            /* numbers are written as is only if they are valid json numbers, e.g. not NaN */
+            strtod(v, &end);
+            if (*end == '\0' && (v[0] == '-' || isdigit((unsigned char) v[0])) && isdigit((unsigned char) v[len - 1]))
+                sink_append(sink, v, len);
+            else
+                sink_append_json(sink, v);
+        }
+        sink_append(sink, "}\n", 2);
+    }
+}
+
+/*
+ ****************************************************** key-press function **
+ * Change column-based sort
+ *
+ * IN:
+ * @screen              Current screen.
+ * @increment           Direction (left or right column).
+ * @first_iter          Flag for resetting previous query results.
+ ****************************************************************************
+ */
+void change_sort_order(struct screen_s * screen, bool increment, bool * first_iter)
+{
+    unsigned int max = 0, i;
+
+    /* Determine max limit of range where cursor can move */
+    switch (screen->current_context) {
+        case pg_stat_database:
+            (atoi(screen->pg_special.pg_version_num) < PG92)
+                ? (max = PG_STAT_DATABASE_CMAX_91)
+                : (max = PG_STAT_DATABASE_CMAX_LT);
+            break;
+        case pg_stat_replication:
+            max = PG_STAT_REPLICATION_CMAX_LT;
+            break;
+        case pg_stat_tables:
+            max = PG_STAT_TABLES_CMAX_LT;
+            break;
+        case pg_stat_indexes:
+            max = PG_STAT_INDEXES_CMAX_LT;
+            break;
+        case pg_statio_tables:
+            max = PG_STATIO_TABLES_CMAX_LT;
+            break;
+        case pg_tables_size:
+            max = PG_TABLES_SIZE_CMAX_LT;
+            break;
+        case pg_stat_activity_long:
+            if (atoi(screen->pg_special.pg_version_num) < PG92)
+                max = PG_STAT_ACTIVITY_LONG_CMAX_91;
+            else if (atoi(screen->pg_special.pg_version_num) < PG96)
+                max = PG_STAT_ACTIVITY_LONG_CMAX_95;
+            else
+                max = PG_STAT_ACTIVITY_LONG_CMAX_LT;
+            break;
+        case pg_stat_functions:
+            max = PG_STAT_FUNCTIONS_CMAX_LT;
+            *first_iter = true;
+            break;
+        case pg_stat_statements_timing:
+            (atoi(screen->pg_special.pg_version_num) < PG92)
+                ? (max = PGSS_TIMING_CMAX_91)
+                : (max = PGSS_TIMING_CMAX_LT);
+            *first_iter = true;
+            break;
+        case pg_stat_statements_general:
+            max = PGSS_GENERAL_CMAX_LT;
+            *first_iter = true;
+            break;
+        case pg_stat_statements_io:
+            (atoi(screen->pg_special.pg_version_num) < PG92)
+                ? (max = PGSS_IO_CMAX_91)
+                : (max = PGSS_IO_CMAX_LT);
+            *first_iter = true;
+            break;
+        case pg_stat_statements_temp:
+            max = PGSS_TEMP_CMAX_LT;
+            *first_iter = true;
+            break;
+        case pg_stat_statements_local:
+            (atoi(screen->pg_special.pg_version_num) < PG92)
+                ? (max = PGSS_LOCAL_CMAX_91)
+                : (max = PGSS_LOCAL_CMAX_LT);
+            *first_iter = true;
+            break;
+        case pg_stat_progress_vacuum:
+            max = PG_STAT_PROGRESS_VACUUM_CMAX_LT;
+            break;
+        case pg_stat_backends:
+            if (atoi(screen->pg_special.pg_version_num) < PG92)
+                max = PG_STAT_BACKENDS_CMAX_91;
+            else if (atoi(screen->pg_special.pg_version_num) < PG96)
+                max = PG_STAT_BACKENDS_CMAX_95;
+            else
+                max = PG_STAT_BACKENDS_CMAX_LT;
+            break;
+        case pg_fleet:
+            max = PG_FLEET_CMAX_LT;
+            break;
+        default:
+            break;
+    }
+
+    /* Change number of column used for sort */
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        if (screen->current_context == screen->context_list[i].context) {
+            if (increment) {
+                /* switch from last to first column */
+                if (++screen->context_list[i].order_key > max) {
+                    screen->context_list[i].order_key = 0;
+                }
+            } else {
+                /* switch from first to last column */
+                if (--screen->context_list[i].order_key < 0) {
+                    screen->context_list[i].order_key = max;
+                }
+            }
+        }
+    }
+}
+
+/*
+ ****************************************************** key-press function **
+ * Change column-based sort from desc to asc and vice-versa.
+ *
+ * IN:
+ * @screen              Current screen.
+ ****************************************************************************
+ */
+void change_sort_order_direction(struct screen_s * screen, bool * first_iter)
+{
+    unsigned int i;
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        if (screen->current_context == screen->context_list[i].context) {
+	    screen->context_list[i].order_desc ^= 1;
+        }
+        *first_iter = true;
+    }
+}
+
+/*
+ ***************************************************** cmd window function **
+ * Read input from cmd window.
+ *
+ * IN:
+ * @window          Window where prompt will be printed.
+ * @msg             Message prompt.
+ * @pos             At deleting wrong input, cursor do not moving beyond that pos.
+ * @len             Max allowed length of string.
+ * @echoing         Show characters typed by the user.
+ *
+ * OUT:
+ * @with_esc        Flag which determines when function finish with ESC.
+ * @str             Entered string.             
+ ****************************************************************************
+ */
+void cmd_readline(WINDOW *window, const char * msg, unsigned int pos, bool * with_esc, char * str, unsigned int len, bool echoing)
+{
+    int ch;
+    int i = 0;
+    bool done = false;
+
+    if (echoing)
+        echo();
+    cbreak();
+    nodelay(window, FALSE);
+    keypad(window, TRUE);
+
+    /* show prompt if msg not empty */
+    if (strlen(msg) != 0) {
+        wprintw(window, "%s", msg);
+        wrefresh(window);
+    }
+
+    memset(str, 0, len);
+    while (1) {
+        if (done)
+            break;
+        ch = wgetch(window);
+        switch (ch) {
+            case ERR:
+                str[0] = '\0';
+                flushinp();
+                done = true;
+                break;
+            case 27:                            /* Esc */
+                wclear(window);
+                wprintw(window, "Do nothing. Operation canceled. ");
+                nodelay(window, TRUE);
+                *with_esc = true;
+                str[0] = '\0';
+                flushinp();
+                done = true;
+                break;
+            case 10:                            /* Enter */
+                str[len] = '\0';
+                flushinp();
+                nodelay(window, TRUE);
+                *with_esc = false;              /* normal finish with \n */
+                done = true;
+                break;
+            case 263: case 330: case 127:       /* Backspace, Delete, */
+                if (i > 0) {
+                    i--;
+                    wdelch(window);
+                    continue;
+                } else {
+                    wmove(window, 0, pos);
+                    continue;
+                }
+                break;
+            default:
+                if (strlen(str) < len + 1) {
+                    str[i] = ch;
+                    i++;
+                }
+                break;
+        }
+    }
+
+    noecho();
+    cbreak();
+    nodelay(window, TRUE);
+    keypad(window, FALSE);
+}
+
+/*
+ ****************************************************** key-press function **
+ * Change pg_stat_activity long queries min age
+ *
+ * IN:
+ * @window              Ncurses window where msg will be printed.
+ * @screen              Current screen.
+ ****************************************************************************
+ */
+void change_min_age(WINDOW * window, struct screen_s * screen, bool *first_iter)
+{
+    if (screen->current_context != pg_stat_activity_long) {
+        wprintw(window, "Long query min age is not allowed here.");
+        return;
+    }
+
+    unsigned int hour, min, sec;
+    bool with_esc;
+    char min_age[XS_BUF_LEN],
+         msg[] = "Enter new min age, format: HH:MM:SS[.NN]: ";
+
+    cmd_readline(window, msg, strlen(msg), &with_esc, min_age, sizeof(min_age), true);
+    if (strlen(min_age) != 0 && with_esc == false) {
+        if ((sscanf(min_age, "%u:%u:%u", &hour, &min, &sec)) == 0 || (hour > 23 || min > 59 || sec > 59)) {
+            wprintw(window, "Nothing to do. Failed read or invalid value.");
+        } else {
+	    snprintf(screen->pg_stat_activity_min_age, sizeof(screen->pg_stat_activity_min_age), "%s", min_age);
+        }
+    } else if (strlen(min_age) == 0 && with_esc == false ) {
+        wprintw(window, "Nothing to do. Leave min age %s", screen->pg_stat_activity_min_age);
+    }
+   
+    *first_iter = true;
+}
+
+/*
+ ******************************************************** routine function **
+ * Clear single connection options.
+ *
+ * IN:
+ * @screens         Screens array.
+ * @i               Index of entry in conn_opts array which should cleared.
+ ****************************************************************************
+ */
+void clear_screen_connopts(struct screen_s * screens[], unsigned int i)
+{
+    screens[i]->host[0] = '\0';
+    screens[i]->port[0] = '\0';
+    screens[i]->user[0] = '\0';
+    screens[i]->dbname[0] = '\0';
+    screens[i]->password[0] = '\0';
+    screens[i]->conninfo[0] = '\0';
+    screens[i]->conn_used = false;
+    screens[i]->sampled = false;
+    screens[i]->query_sent = false;
+    screens[i]->connect_events = 0;
+    screens[i]->background_conn = false;
+    screens[i]->pg_special.prepared = 0;
+    /* settings of closed screen aren't inherited by new one */
+    free(screens[i]->context_list);
+    screens[i]->context_list = NULL;
+    /* all cached processes are unseen between results, so their files are closed */
+    release_backends_proc(&screens[i]->backends);
+    free(screens[i]->backends.pids);
+    memset(&screens[i]->backends, 0, sizeof(struct backends_cache_s));
+}
+
+/*
+ ******************************************************** routine function **
+ * Shift screens when current screen closes.
+ *
+ * IN:
+ * @screens         Screens array.
+ * @conns           Connections array.
+ * @i               Index of closed console.
+ *
+ * RETURNS:
+ * Array of screens without closed connection.
+ ****************************************************************************
+ */
+void shift_screens(struct screen_s * screens[], PGconn * conns[], unsigned int i)
+{
+    struct snapshot_s * tmp_snap;
+    struct context_s * tmp_list;
+    struct backends_cache_s tmp_cache;
+
+    while (screens[i + 1] != NULL && screens[i + 1]->conn_used != false) {
+        snprintf(screens[i]->host, sizeof(screens[i]->host), "%s", screens[i + 1]->host);
+        snprintf(screens[i]->port, sizeof(screens[i]->port), "%s", screens[i + 1]->port);
+        snprintf(screens[i]->user, sizeof(screens[i]->user), "%s", screens[i + 1]->user);
+        snprintf(screens[i]->dbname, sizeof(screens[i]->dbname), "%s", screens[i + 1]->dbname);
+        snprintf(screens[i]->password, sizeof(screens[i]->password), "%s", screens[i + 1]->password);
+        snprintf(screens[i]->conninfo, sizeof(screens[i]->conninfo), "%s", screens[i + 1]->conninfo);
+        snprintf(screens[i]->pg_special.pg_version_num, sizeof(screens[i]->pg_special.pg_version_num), "%s",
+		screens[i + 1]->pg_special.pg_version_num);
+        snprintf(screens[i]->pg_special.pg_version, sizeof(screens[i]->pg_special.pg_version), "%s",
+		screens[i + 1]->pg_special.pg_version);
+        screens[i]->subscreen =        screens[i + 1]->subscreen;
+        snprintf(screens[i]->log_path, sizeof(screens[i]->log_path), "%s", screens[i + 1]->log_path);
+        screens[i]->log_fd =            screens[i + 1]->log_fd;
+        screens[i]->current_context =   screens[i + 1]->current_context;
+        snprintf(screens[i]->pg_stat_activity_min_age, sizeof(screens[i]->pg_stat_activity_min_age), "%s",
+		screens[i + 1]->pg_stat_activity_min_age);
+        screens[i]->signal_options =    screens[i + 1]->signal_options;
+        screens[i]->pg_stat_sys =       screens[i + 1]->pg_stat_sys;
+        screens[i]->pg_special.prepared = screens[i + 1]->pg_special.prepared;
+        screens[i]->pg_special.pg_is_local = screens[i + 1]->pg_special.pg_is_local;
+        snprintf(screens[i]->pg_special.pg_cgroup, sizeof(screens[i]->pg_special.pg_cgroup), "%s",
+		screens[i + 1]->pg_special.pg_cgroup);
+        screens[i]->host_view =         screens[i + 1]->host_view;
+
+        /* contexts, snapshots and processes follow their connection, memory of closed one is reused */
+        tmp_list = screens[i]->context_list, screens[i]->context_list = screens[i + 1]->context_list, screens[i + 1]->context_list = tmp_list;
+        tmp_snap = screens[i]->p_snap, screens[i]->p_snap = screens[i + 1]->p_snap, screens[i + 1]->p_snap = tmp_snap;
+        tmp_snap = screens[i]->c_snap, screens[i]->c_snap = screens[i + 1]->c_snap, screens[i + 1]->c_snap = tmp_snap;
+        tmp_cache = screens[i]->backends, screens[i]->backends = screens[i + 1]->backends, screens[i + 1]->backends = tmp_cache;
+        screens[i]->sampled =           screens[i + 1]->sampled;
+        screens[i]->query_sent =        screens[i + 1]->query_sent;
+        screens[i]->connect_events =    screens[i + 1]->connect_events;
+        screens[i]->background_conn =   screens[i + 1]->background_conn;
+
+        conns[i] = conns[i + 1];
+        i++;
+    }
+    clear_screen_connopts(screens, i);
+    conns[i] = NULL;
+}
+
+/*
+ ****************************************************** key press function **
+ * Open new one connection.
+ *
+ * IN:
+ * @window          Window where result is printed.
+ * @screen          Current screen.
+ *
+ * OUT:
+ * @conns_ptr       Array of connections, grows when all screens are used.
+ * @screens_ptr     Connections options array, grows together with conns.
+ * @console_index   Index of screen (for internal usage).
+ *
+ * RETURNS:
+ * Add connection into conns array and return new console index.
+ ****************************************************************************
+ */
+unsigned int add_connection(WINDOW * window, struct screen_s ** screens_ptr[],
+                PGconn ** conns_ptr[], unsigned int console_index)
+{
+    unsigned int i, n;
+    char params[CONNINFO_MAXLEN],
+         msg[] = "Enter new connection parameters, format \"host port username dbname\": ",
+         msg2[] = "Required password: ";
+    bool with_esc, with_esc2;
+    struct screen_s ** screens;
+    PGconn ** conns;
+
+    /* all screens are used, grow the registry */
+    n = count_screens(*screens_ptr);
+    if ((*screens_ptr)[n - 1]->conn_used)
+        grow_screens(screens_ptr, conns_ptr, n * 2);
+    screens = *screens_ptr;
+    conns = *conns_ptr;
+
+    for (i = 0; screens[i] != NULL; i++) {
+        /* search free screen */
+        if (screens[i]->conn_used == false) {
+
+            /* read user input */
+            cmd_readline(window, msg, strlen(msg), &with_esc, params, sizeof(params), true);
+            if (strlen(params) != 0 && with_esc == false) {
+                /* parse user input */
+                if ((sscanf(params, "%s %s %s %s",
+                    screens[i]->host,   screens[i]->port,
+                    screens[i]->user,   screens[i]->dbname)) == 0) {
+                        wprintw(window, "Nothing to do. Failed read or invalid value.");
+                        break;
+                }
+                /* setup screen conninfo settings */
+                screens[i]->conn_used = true;
+                activate_screen(screens[i]);
+		snprintf(screens[i]->conninfo, sizeof(screens[i]->conninfo),
+			 "host=%s port=%s user=%s dbname=%s",
+			 screens[i]->host, screens[i]->port,  screens[i]->user, screens[i]->dbname);
+
+                /* establish new connection */
+                conns[i] = PQconnectdb(screens[i]->conninfo);
+                /* if password required, ask user for password */
+                if ( PQstatus(conns[i]) == CONNECTION_BAD && PQconnectionNeedsPassword(conns[i]) == 1) {
+                    PQfinish(conns[i]);
+                    wclear(window);
+
+                    /* read password and add to conn options */
+                    cmd_readline(window, msg2, strlen(msg2), &with_esc2, params, sizeof(params), false);
+                    if (strlen(params) != 0 && with_esc2 == false) {
+                        snprintf(screens[i]->password, sizeof(screens[i]->password), "%s", params);
+			snprintf(screens[i]->conninfo + strlen(screens[i]->conninfo),
+				 sizeof(screens[i]->conninfo) - strlen(screens[i]->conninfo), " password=%s", screens[i]->password);
+                        /* try establish connection and finish work */
+                        conns[i] = PQconnectdb(screens[i]->conninfo);
+                        if ( PQstatus(conns[i]) == CONNECTION_BAD ) {
+                            wclear(window);
+                            wprintw(window, "Nothing to fo. Connection failed.");
+                            PQfinish(conns[i]);
+                            clear_screen_connopts(screens, i);
+                        } else {
+                            wclear(window);
+                            wprintw(window, "Successfully connected.");
+                            console_index = screens[i]->screen;
+                            get_pg_special(conns[i], screens[i]);
+                        }
+                    } else if (with_esc) {
+                        clear_screen_connopts(screens, i);
+                    }
+                /* finish work if connection establish failed */
+                } else if ( PQstatus(conns[i]) == CONNECTION_BAD ) {
+                    wprintw(window, "Nothing to do. Connection failed.");
+                    PQfinish(conns[i]);
+                    clear_screen_connopts(screens, i);
+                /* if no error occured, print about success and finish work */
+                } else {
+                    wclear(window);
+                    wprintw(window, "Successfully connected.");
+                    console_index = screens[i]->screen;
+                    get_pg_special(conns[i], screens[i]);
+                }
+                break;
+            /* finish work if user input empty or cancelled */
+            } else if (strlen(params) == 0 && with_esc == false) {
+                wprintw(window, "Nothing to do.");
+                break;
+            } else 
+                break;
+        }
+    }
+
+    return console_index;
+}
+
+/*
+ ***************************************************** key press functions **
+ * Close current connection.
+ *
+ * IN:
+ * @window          Window where result is printed.
+ * @screens         Screens array.
+ *
+ * OUT:
+ * @conns           Array of connections.
+ * @screens         Modified screens array.
+ * @first_iter      Reset stats counters.
+ *
+ * RETURNS:
+ * Close current connection (remove from conns array) and return prvious
+ * console index.
+ ****************************************************************************
+ */
+unsigned int close_connection(WINDOW * window, struct screen_s * screens[],
+                PGconn * conns[], unsigned int console_index, bool * first_iter)
+{
+    unsigned int i = console_index;
+    PQfinish(conns[console_index]);
+    conns[console_index] = NULL;
+
+    wprintw(window, "Close current connection.");
+    if (i == 0) {                               /* first active console */
+        if (screens[i + 1] != NULL && screens[i + 1]->conn_used) {
+        shift_screens(screens, conns, i);
+        } else {
+            wrefresh(window);
+            endwin();
+            exit(EXIT_SUCCESS);
+        }
+    } else if (screens[i + 1] == NULL) {        /* last possible active console */
+        clear_screen_connopts(screens, i);
+        console_index = console_index - 1;
+    } else {                                    /* middle active console */
+        if (screens[i + 1]->conn_used) {
+            shift_screens(screens, conns, i);
+        } else {
+            clear_screen_connopts(screens, i);
+            console_index = console_index - 1;
+        }
+    }
+
+    *first_iter = true;
+    return console_index;
+}
+
+/*
+ ****************************************************** key press function **
+ * Write connection information into ~/.pgcenterrc.
+ *
+ * IN:
+ * @window          Window where result will be printed.
+ * @screens         Array of screens options.
+ * @args            Struct where stored input args.
+ ****************************************************************************
+ */
+void write_pgcenterrc(WINDOW * window, struct screen_s * screens[], PGconn * conns[], struct args_s * args)
+{
+    unsigned int i = 0;
+    FILE *fp;
+    static char pgcenterrc_path[PATH_MAX];
+    struct passwd *pw = getpwuid(getuid());
+    struct stat statbuf;
+
+    /* 
+     * write conninfo into file which specified in --file=FILENAME,
+     * or use default ~/.pgcenterrc
+     */
+    if (strlen(args->connfile) != 0)
+        snprintf(pgcenterrc_path, sizeof(pgcenterrc_path), "%s", args->connfile);
+    else {
+        snprintf(pgcenterrc_path, sizeof(pgcenterrc_path), "%s/%s", pw->pw_dir, PGCENTERRC_FILE);
+    }
+
+    if ((fp = fopen(pgcenterrc_path, "w")) != NULL ) {
+        for (i = 0; screens[i] != NULL; i++) {
+            if (screens[i]->conn_used && conns[i] != NULL) {
+                fprintf(fp, "%s:%s:%s:%s:%s\n",
+                        PQhost(conns[i]), PQport(conns[i]),
+                        PQdb(conns[i]), PQuser(conns[i]),
+                        PQpass(conns[i]));
+            /* screens which never were viewed have no connections, use their options */
+            } else if (screens[i]->conn_used) {
+                fprintf(fp, "%s:%s:%s:%s:%s\n",
+                        (strlen(screens[i]->host) != 0) ? screens[i]->host : "(null)",
+                        screens[i]->port, screens[i]->dbname,
+                        screens[i]->user, screens[i]->password);
+            }
+        }
+        wprintw(window, "Wrote configuration to '%s'", pgcenterrc_path);
+
+        fclose(fp);
+
+        stat(pgcenterrc_path, &statbuf);
+        if (statbuf.st_mode & (S_IRWXG | S_IRWXO)) {
+            chmod(pgcenterrc_path, S_IRUSR|S_IWUSR);
+        }
+    } else {
+        wprintw(window, "Failed to write configuration into '%s'", pgcenterrc_path);
+    }
+}
+
+/*
+ ****************************************************** key press function **
+ * Show the current configuration settings, one per row.
+ *
+ * IN:
+ * @window      Window where result will be printed.
+ * @conn        Current postgres connection.
+ ****************************************************************************
+ */
+void show_config(WINDOW * window, PGconn * conn)
+{
+    unsigned int  row_count, col_count, row, col, i;
+    FILE * fpout;
+    PGresult * res;
+    char errmsg[ERRSIZE],
+         pager[S_BUF_LEN] = "";
+    struct colAttrs * columns;
+
+    if (getenv("PAGER") != NULL)
+        snprintf(pager, sizeof(pager), "%s", getenv("PAGER"));
+    else
+        snprintf(pager, sizeof(pager), "%s", DEFAULT_PAGER);
+    if ((fpout = popen(pager, "w")) == NULL) {
+        wprintw(window, "Do nothing. Failed to open pipe to %s", pager);
+        return;
+    }
+
+    /* escape from ncurses mode */
+    refresh();
+    endwin();
+
+    res = do_query(conn, PG_SETTINGS_QUERY, errmsg);
+    row_count = PQntuples(res);
+    col_count = PQnfields(res);
+    columns = init_colattrs(col_count);
+    calculate_width(columns, res, NULL, NULL, row_count, col_count);
+    
+    fprintf(fpout, " PostgreSQL configuration: %i rows\n", row_count);
+    /* print column names */
+    for (col = 0, i = 0; col < col_count; col++, i++)
+        fprintf(fpout, " %-*s", columns[i].width, PQfname(res, col));
+    fprintf(fpout, "\n\n");
+    /* print rows */
+    for (row = 0; row < row_count; row++) {
+        for (col = 0, i = 0; col < col_count; col++, i++)
+            fprintf(fpout, " %-*s", columns[i].width, PQgetvalue(res, row, col));
+        fprintf(fpout, "\n");
+    }
+
+    PQclear(res);
+    pclose(fpout);
+    free(columns);
+    
+    /* return to ncurses mode */
+    refresh();
+}
+
+/*
+ ****************************************************** key press function **
+ * Reload postgres
+ *
+ * IN:
+ * @window      Window where resilt will be printed.
+ * @conn        Current postgres connection.
+ ****************************************************************************
+ */
+void reload_conf(WINDOW * window, PGconn * conn)
+{
+    PGresult * res;
+    bool with_esc;
+    char errmsg[ERRSIZE],
+         confirmation[1],
+         msg[] = "Reload configuration files (y/n): ";
+
+    cmd_readline(window, msg, strlen(msg), &with_esc, confirmation, 1, true);
+    if (!strcmp(confirmation, "n") || !strcmp(confirmation, "N"))
+        wprintw(window, "Do nothing. Canceled.");
+    else if (!strcmp(confirmation, "y") || !strcmp(confirmation, "Y")) {
+        res = do_query(conn, PG_RELOAD_CONF_QUERY, errmsg);
+        if (res != NULL) {
+            wprintw(window, "Reload issued.");
+            PQclear(res);
+        } else {
+            wclear(window);
+            wprintw(window, "Reload failed. %s", errmsg);
+        }
+    } else if (strlen(confirmation) == 0 && with_esc == false) {
+        wprintw(window, "Do nothing. Nothing entered.");
+    } else if (with_esc) {
+        ;
+    } else 
+        wprintw(window, "Do nothing. Not confirmed.");
+}
+
+/*
+ ******************************************************** routine function **
+ * Get postgres listen_addresses and check is that local address or not.
+ *
+ * IN:
+ * @screen       Connections options.
+ *
+ * RETURNS:
+ * Return true if listen_addresses is local and false if not.
+ ****************************************************************************
+ */
+bool check_pg_listen_addr(struct screen_s * screen, PGconn * conn)
+{
+    /* an absoulute path means the unix socket is used and it is always local */
+    if (!strncmp(screen->host, "/", 1)
+	|| ((PQhost(conn)!= NULL) && !strncmp(PQhost(conn), "/", 1))
+	|| (PQstatus(conn) == CONNECTION_OK && PQhost(conn) == NULL)) {
+        return true;
+    }
+
+    struct ifaddrs *ifaddr, *ifa;
+    int family, s;
+    char host[NI_MAXHOST];
+    
+    if (getifaddrs(&ifaddr) == -1) {
+        freeifaddrs(ifaddr);
+        return false;
+    }
+    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL)
+            continue;
+
+        family = ifa->ifa_addr->sa_family;
+
+        /* Check AF_INET* interface addresses */
+        if (family == AF_INET || family == AF_INET6) {
+            s = getnameinfo(ifa->ifa_addr,
+                            (family == AF_INET) ? sizeof(struct sockaddr_in) :
+                                                  sizeof(struct sockaddr_in6),
+                            host, NI_MAXHOST,
+                            NULL, 0, NI_NUMERICHOST);
+            if (s != 0) {
+                mreport(false, msg_warning,
+                        "WARNING: getnameinfo() failed: %s\n", gai_strerror(s));
+                return false;
+            }
+            if (!strcmp(host, screen->host)) {
+                freeifaddrs(ifaddr);
+                return true;
+                break;
+            }
+        }
+    }
+
+    freeifaddrs(ifaddr);
+    return false;
+}
+
+/*
+ ******************************************************** routine function **
+ * Get GUC value from postgres config.
+ *
+ * IN:
+ * @window                  Window for printing errors if occurs.
+ * @conn                    Current connection.
+ * @config_option_name      Option name.
+ *
+ * OUT:
+ * @config_option_value     Config option value or empty string.
+ ****************************************************************************
+ */
+void get_conf_value(PGconn * conn, const char * config_option_name, char * config_option_value)
+{
+    PGresult * res;
+    char errmsg[ERRSIZE],
+         query[QUERY_MAXLEN];
+
+    snprintf(query, sizeof(query), "%s%s%s", PG_SETTINGS_SINGLE_OPT_P1, config_option_name, PG_SETTINGS_SINGLE_OPT_P2);
+
+    res = do_query(conn, query, errmsg);
+    
+    if (PQntuples(res) != 0 && !strcmp(PQgetvalue(res, 0, 0), config_option_name))
+        snprintf(config_option_value, M_BUF_LEN, "%s", PQgetvalue(res, 0, 1));
+    else
+        config_option_value[0] = '\0';
+    
+    PQclear(res);
+}
+
+/*
+ ******************************************************** routine function **
+ * Get postgres various information and save into screen opts.
+ *
+ * IN:
+ * @conn                    Current connection.
+ * @screen                  Current screen.
+ ****************************************************************************
+ */
+void get_pg_special(PGconn * conn, struct screen_s * screen)
+{
+    PGresult * res;
+    char errmsg[ERRSIZE];
+    char av_max_workers[8];
+
+    /* get postgres version information */
+    get_conf_value(conn, GUC_SERVER_VERSION_NUM, screen->pg_special.pg_version_num);
+    get_conf_value(conn, GUC_SERVER_VERSION, screen->pg_special.pg_version);
+    if (strlen(screen->pg_special.pg_version_num) == 0)
+        snprintf(screen->pg_special.pg_version_num, sizeof(screen->pg_special.pg_version_num), "-.-.-");
+    if (strlen(screen->pg_special.pg_version) == 0)
+        snprintf(screen->pg_special.pg_version, sizeof(screen->pg_special.pg_version_num), "-.-.-");
+
+    /* pg_is_in_recovery() */
+    if ((res = do_query(conn, PG_IS_IN_RECOVERY_QUERY, errmsg)) != NULL) {
+        (!strcmp(PQgetvalue(res, 0, 0), "f"))
+	    ? (screen->pg_special.pg_is_in_recovery = false)
+	    : (screen->pg_special.pg_is_in_recovery = true);
+        PQclear(res);
+    }
+
+    /* get autovacuum_max_workers */
+    get_conf_value(conn, GUC_AV_MAX_WORKERS, av_max_workers);
+    (strlen(av_max_workers) == 0)
+	? (screen->pg_special.av_max_workers = 0)
+	: (screen->pg_special.av_max_workers = atoi(av_max_workers));
+
+    /* processes of backends are seen only when postgres is local */
+    screen->pg_special.pg_is_local = check_pg_listen_addr(screen, conn);
+
+    /* cgroup of local postgres is shown instead of host stats */
+    if (screen->pg_special.pg_is_local)
+        get_cgroup_path(conn, screen->pg_special.pg_cgroup, sizeof(screen->pg_special.pg_cgroup));
+    else
+        screen->pg_special.pg_cgroup[0] = '\0';
+}
+
+/*
+ ****************************************************** key press function **
+ * Edit the current configuration settings.
+ *
+ * IN:
+ * @window          Window where errors will be displayed.
+ * @screen          Screen options.
+ * @conn            Current connection.
+ * @config_file_guc GUC option associated with postgresql/pg_hba/pg_ident
+ *
+ * RETURNS:
+ * Open configuration file in $EDITOR.
+ ****************************************************************************
+ */
+void edit_config(WINDOW * window, struct screen_s * screen, PGconn * conn, const char * config_file_guc)
+{
+    static char config_path[PATH_MAX];
+    pid_t pid;
+
+    if (check_pg_listen_addr(screen, conn)) {
+        get_conf_value(conn, config_file_guc, config_path);
+        if (strlen(config_path) != 0) {
+            /* if we want edit recovery.conf, attach config name to data_directory path */
+            if (!strcmp(config_file_guc, GUC_DATA_DIRECTORY)) {
+		snprintf(config_path + strlen(config_path), sizeof(config_path) - strlen(config_path), "/%s", PG_RECOVERY_FILE);
+            }
+            /* escape from ncurses mode */
+            refresh();
+            endwin();
+            pid = fork();                   /* start child */
+            if (pid == 0) {
+                /* use editor from environment variables, otherwise use default editor */
+                static char editor[S_BUF_LEN];
+                if (getenv("EDITOR") != NULL)
+                    snprintf(editor, sizeof(editor), "%s", getenv("EDITOR"));
+                else
+                    snprintf(editor, sizeof(editor), "%s", DEFAULT_EDITOR);
+                execlp(editor, editor, config_path, NULL);
+                exit(EXIT_FAILURE);
+            } else if (pid < 0) {
+                wprintw(window, "ERROR: fork failed, can't open %s", config_path);
+                return;
+            } else if (waitpid(pid, NULL, 0) != pid) {
+                wprintw(window, "ERROR: waitpid failed.");
+                return;
+            }
+        } else {
+            wprintw(window, "Do nothing. Config option not found (not SUPERUSER?).");
+        }
+    } else {
+        wprintw(window, "Do nothing. Edit config not supported for remote hosts.");
+    }
+
+    /* return to ncurses mode */
+    refresh();
+    return;
+}
+
+/*
+ ******************************************************** routine function **
+ * Allocate memory for menu items.
+ *
+ * IN:
+ * @n_choices       Number of menu items.
+ *
+ * RETURNS:
+ * Pointer to memory for menu items.
+ ****************************************************************************
+ */
+ITEM ** init_menuitems(unsigned int n_choices) {
+    ITEM ** items;
+    if ((items = (ITEM**) malloc(sizeof(ITEM *) * (n_choices))) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for menu items failed.");
+    }
+    return items;
+}
+
+/*
+ ****************************************************** key press function **
+ * Invoke menu for config editing.
+ *
+ * IN:
+ * @w_cmd           Window where errors will be displayed.
+ * @w_dba           Window where db answers printed.
+ * @screen          Current screen settings.
+ * @conn            Current connection.
+ * @first_iter      Reset counters when function ends.
+ ****************************************************************************
+ */
+void edit_config_menu(WINDOW * w_cmd, WINDOW * w_dba, struct screen_s * screen, PGconn * conn, bool *first_iter)
+{
+    const char * choices[] = { "postgresql.conf", "pg_hba.conf", "pg_ident.conf", "recovery.conf" };
+    WINDOW *menu_win;
+    MENU *menu;
+    ITEM **items;
+    unsigned int n_choices, i;
+    int ch;
+    bool done = false;
+
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+
+    /* allocate stuff */
+    n_choices = ARRAY_SIZE(choices);
+    items = init_menuitems(n_choices + 1);
+    for (i = 0; i < n_choices; i++)
+        items[i] = new_item(choices[i], NULL);
+    items[n_choices] = (ITEM *)NULL;
+    menu = new_menu((ITEM **)items);
+
+    /* construct menu, outer window for header and inner window for menu */
+    menu_win = newwin(10,54,5,0);
+    keypad(menu_win, TRUE);
+    set_menu_win(menu, menu_win);
+    set_menu_sub(menu, derwin(menu_win, 4,20,1,0));
+
+    /* clear stuff from db answer window */
+    wclear(w_dba);
+    wrefresh(w_dba);
+    /* print menu header */
+    mvwprintw(menu_win, 0, 0, "Edit configuration file (Enter to edit, Esc to exit):");
+    post_menu(menu);
+    wrefresh(menu_win);
+    
+    while (1) {
+        if (done)
+            break;
+        ch = wgetch(menu_win);
+        switch (ch) {
+            case KEY_DOWN:
+                menu_driver(menu, REQ_DOWN_ITEM);
+                break;
+            case KEY_UP:
+                menu_driver(menu, REQ_UP_ITEM);
+                break;
+            case 10:
+                if (!strcmp(item_name(current_item(menu)), PG_CONF_FILE))
+                    edit_config(w_cmd, screen, conn, GUC_CONFIG_FILE);
+                else if (!strcmp(item_name(current_item(menu)), PG_HBA_FILE))
+                    edit_config(w_cmd, screen, conn, GUC_HBA_FILE);
+                else if (!strcmp(item_name(current_item(menu)), PG_IDENT_FILE))
+                    edit_config(w_cmd, screen, conn, GUC_IDENT_FILE);
+                else if (!strcmp(item_name(current_item(menu)), PG_RECOVERY_FILE))
+                    edit_config(w_cmd, screen, conn, GUC_DATA_DIRECTORY);
+                else
+                    wprintw(w_cmd, "Do nothing. Unknown file.");     /* never should be here. */
+                done = true;
+                break;
+            case 27:
+                done = true;
+                break;
+        }       
+    }
+ 
+    /* clear menu items from screen */
+    clear();
+    refresh();
+
+    /* free stuff */
+    unpost_menu(menu);
+    for (i = 0; i < n_choices; i++)
+        free_item(items[i]);
+    free_menu(menu);
+    delwin(menu_win);
+    *first_iter = true;
+}
+
+/*
+ ****************************************************** key press function **
+ * Invoke menu for pg_stat_statements contexts.
+ *
+ * IN:
+ * @w_cmd           Window where errors will be displayed.
+ * @w_dba           Window where db answers printed.
+ * @screen          Current screen settings.
+ * @first_iter      Reset counters when function ends.
+ ****************************************************************************
+ */
+void pgss_menu(WINDOW * w_cmd, WINDOW * w_dba, struct screen_s * screen, bool *first_iter)
+{
+    const char * choices[] = { 
+	"pg_stat_statements timings",
+	"pg_stat_statements general",
+	"pg_stat_statements input/output",
+	"pg_stat_statements temp input/output",
+	"pg_stat_statements local input/output" };
+    WINDOW *menu_win;
+    MENU *menu;
+    ITEM **items;
+    unsigned int n_choices, i;
+    int ch;
+    bool done = false;
+
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+
+    /* allocate stuff */
+    n_choices = ARRAY_SIZE(choices);
+    items = init_menuitems(n_choices + 1);
+    for (i = 0; i < n_choices; i++)
+        items[i] = new_item(choices[i], NULL);
+    items[n_choices] = (ITEM *)NULL;
+    menu = new_menu((ITEM **)items);
+
+    /* construct menu, outer window for header and inner window for menu */
+    menu_win = newwin(11,64,5,0);
+    keypad(menu_win, TRUE);
+    set_menu_win(menu, menu_win);
+    set_menu_sub(menu, derwin(menu_win, 5,40,1,0));
+
+    /* clear stuff from db answer window */
+    wclear(w_dba);
+    wrefresh(w_dba);
+    /* print menu header */
+    mvwprintw(menu_win, 0, 0, "Choose pg_stat_statements mode (Enter to choose, Esc to exit):");
+    post_menu(menu);
+    wrefresh(menu_win);
+    
+    while (1) {
+        if (done)
+            break;
+        ch = wgetch(menu_win);
+        switch (ch) {
+            case KEY_DOWN:
+                menu_driver(menu, REQ_DOWN_ITEM);
+                break;
+            case KEY_UP:
+                menu_driver(menu, REQ_UP_ITEM);
+                break;
+            case 10:
+                if (!strcmp(item_name(current_item(menu)), "pg_stat_statements timings"))
+                    screen->current_context = pg_stat_statements_timing;
+                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements general"))
+                    screen->current_context = pg_stat_statements_general;
+                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements input/output"))
+                    screen->current_context = pg_stat_statements_io;
+                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements temp input/output"))
+                    screen->current_context = pg_stat_statements_temp;
+                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements local input/output"))
+                    screen->current_context = pg_stat_statements_local;
+                else
+                    wprintw(w_cmd, "Do nothing. Unknown mode.");     /* never should be here. */
+                done = true;
+                break;
+            case 27:
+                done = true;
+                break;
+        }       
+    }
+ 
+    /* clear menu items from screen */
+    clear();
+    refresh();
+
+    /* free stuff */
+    unpost_menu(menu);
+    for (i = 0; i < n_choices; i++)
+        free_item(items[i]);
+    free_menu(menu);
+    delwin(menu_win);
+    *first_iter = true;
+}
+
+/*
+ ****************************************************** key press function **
+ * Switch pg_stat_statements contexts to next.
+ *
+ * IN:
+ * @w_cmd           Window where errors will be displayed.
+ * @screen          Current screen settings.
+ * @first_iter      Reset counters when function ends.
+ ****************************************************************************
+ */
+void pgss_switch(WINDOW * w_cmd, struct screen_s * screen, bool *first_iter)
+{
+    /*
+     * Check current context and switch to pg_stat_statements.
+     * any -> pgss_timing -> pgss_general -> pgss_io -> pgss_temp -> pgss_local -> pgss_timing -> ...
+     */
+    switch (screen->current_context) {
+	case pg_stat_statements_timing:
+            switch_context(w_cmd, screen, pg_stat_statements_general, first_iter);
+            break;
+	case pg_stat_statements_general:
+            switch_context(w_cmd, screen, pg_stat_statements_io, first_iter);
+            break;
+	case pg_stat_statements_io:
+            switch_context(w_cmd, screen, pg_stat_statements_temp, first_iter);
+            break;
+	case pg_stat_statements_temp:
+            switch_context(w_cmd, screen, pg_stat_statements_local, first_iter);
+            break;
+	case pg_stat_statements_local: default:
+            switch_context(w_cmd, screen, pg_stat_statements_timing, first_iter);
+            break;
+    }
+}
+/*
+ ****************************************************** key press function **
+ * Cancel or terminate postgres backend.
+ *
+ * IN:
+ * @window          Window where resilt will be printed.
+ * @screen          Current screen info.
+ * @conn            Current postgres connection.
+ * @do_terminate    Do terminate backend if true or cancel if false.
+ ****************************************************************************
+ */
+void signal_single_backend(WINDOW * window, struct screen_s *screen, PGconn * conn, bool do_terminate)
+{
+    if (screen->current_context != pg_stat_activity_long) {
+        wprintw(window, "Terminate or cancel backend allowed in long queries screen.");
+        return;
+    } 
+
+    char errmsg[ERRSIZE],
+         query[QUERY_MAXLEN],
+         msg[S_BUF_LEN],
+         pid[6];
+    char * actions[] = { "Terminate", "Cancel" };
+    int actions_idx;
+    PGresult * res;
+    bool with_esc;
+
+    if (do_terminate) {
+        actions_idx = 0;	/* Terminate */
+        snprintf(msg, sizeof(msg), "Terminate single backend, enter pid: ");
+    } else {
+        actions_idx = 1;	/* Cancel */
+        snprintf(msg, sizeof(msg), "Cancel single backend, enter pid: ");
+    }
+
+    cmd_readline(window, msg, strlen(msg), &with_esc, pid, sizeof(pid), true);
+    if (atoi(pid) > 0) {
+        if (do_terminate) {
+	    snprintf(query, sizeof(query), "%s%s%s", PG_TERM_BACKEND_P1, pid, PG_TERM_BACKEND_P2);
+        } else {
+	    snprintf(query, sizeof(query), "%s%s%s", PG_CANCEL_BACKEND_P1, pid, PG_CANCEL_BACKEND_P2);
+        }
+
+        res = do_query(conn, query, errmsg);
+        if (res != NULL) {
+            wprintw(window, "%s backend with pid %s.", actions[actions_idx], pid);
+            PQclear(res);
+        } else {
+            wprintw(window, "%s backend failed. %s", actions[actions_idx], errmsg);
+        }
+    } else if (strlen(pid) == 0 && with_esc == false) {
+        wprintw(window, "Do nothing. Nothing etntered.");
+    } else if (with_esc) {
+        ;
+    } else
+        wprintw(window, "Do nothing. Incorrect input value.");
+}
+
+/*
+ ****************************************************** key press function **
+ * Print current mask for group cancel/terminate
+ *
+ * IN:
+ * @window          Window where resilt will be printed.
+ * @screen          Current screen info.
+ ****************************************************************************
+ */
+void get_statemask(WINDOW * window, struct screen_s * screen)
+{
+    if (screen->current_context != pg_stat_activity_long) {
+        wprintw(window, "Current mask can viewed in activity screen.");
+        return;
+    }
+
+    wprintw(window, "Mask: ");
+    if (screen->signal_options == 0)
+        wprintw(window, "empty");
+    if (screen->signal_options & GROUP_ACTIVE)
+        wprintw(window, "active ");
+    if (screen->signal_options & GROUP_IDLE)
+        wprintw(window, "idle ");
+    if (screen->signal_options & GROUP_IDLE_IN_XACT)
+        wprintw(window, "idle in xact ");
+    if (screen->signal_options & GROUP_WAITING)
+        wprintw(window, "waiting ");
+    if (screen->signal_options & GROUP_OTHER)
+        wprintw(window, "other ");
+}
+
+/*
+ ****************************************************** key press function **
+ * Set state mask for group cancel/terminate
+ *
+ * IN:
+ * @window          Window where resilt will be printed.
+ * @screen          Current screen info.
+ ****************************************************************************
+ */
+void set_statemask(WINDOW * window, struct screen_s * screen)
+{
+    if (screen->current_context != pg_stat_activity_long) {
+        wprintw(window, "State mask setup allowed in activity screen.");
+        return;
+    } 
+
+    unsigned int i;
+    char mask[5] = "",
+         msg[] = "";        /* set empty message, we don't want show msg from cmd_readline */
+    bool with_esc;
+
+    wprintw(window, "Set state mask for group backends [");
+    wattron(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "a");
+    wattroff(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "ctive/");
+    wattron(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "i");
+    wattroff(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "dle/idle_in_");
+    wattron(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "x");
+    wattroff(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "act/");
+    wattron(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "w");
+    wattroff(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "aiting/");
+    wattron(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "o");
+    wattroff(window, A_BOLD | A_UNDERLINE);
+    wprintw(window, "ther]: ");
+
+    /* use offset 77 that equals message constructed above and printed by ncurses */
+    cmd_readline(window, msg, 77, &with_esc, mask, sizeof(mask), true);
+    if (strlen(mask) == 0 && with_esc == false) {           /* mask not entered */
+        wprintw(window, "Do nothing. Mask not specified.");
+    } else if (with_esc) {                                  /* user escaped */
+        ;			/* do nothing here, info message will be printed by cmd_readline */
+    } else {                                                /* user enter string with valid length */
+        /* reset previous mask */
+        screen->signal_options = 0;
+        for (i = 0; i < strlen(mask); i++) {
+            switch (mask[i]) {
+                case 'a':
+                    screen->signal_options |= GROUP_ACTIVE;
+                    break;
+                case 'i':
+                    screen->signal_options |= GROUP_IDLE;
+                    break;
+                case 'x':
+                    screen->signal_options |= GROUP_IDLE_IN_XACT;
+                    break;
+                case 'w':
+                    screen->signal_options |= GROUP_WAITING;
+                    break;
+                case 'o':
+                    screen->signal_options |= GROUP_OTHER;
+                    break;
+            }
+        }
+        get_statemask(window, screen);
+    }
+}
+
+/*
+ ****************************************************** key press function **
+ * Cancel or terminate postgres backends using state mask.
+ *
+ * IN:
+ * @window          Window where resilt will be printed.
+ * @screen          Current screen info.
+ * @conn            Current postgres connection.
+ * @do_terminate    Do terminate backend if true or cancel if false.
+ ****************************************************************************
+ */
+void signal_group_backend(WINDOW * window, struct screen_s *screen, PGconn * conn, bool do_terminate)
+{
+    if (screen->current_context != pg_stat_activity_long) {
+        wprintw(window, "Terminate or cancel backend allowed in long queries screen.");
+        return;
+    } 
+    if (screen->signal_options == 0) {
+        wprintw(window, "Do nothing. Mask not specified.");
+        return;
+    }
+
+    char query[QUERY_MAXLEN],
+         mask[5] = "",
+         state[M_BUF_LEN];
+    const char * actions[] = { "terminate", "cancel" };
+    PGresult * res;
+    unsigned int i, actions_idx, signaled = 0;
+
+    if (do_terminate)
+	actions_idx = 0;		/* terminate */
+    else
+        actions_idx = 1;		/* cancel */
+    
+    if (screen->signal_options & GROUP_ACTIVE)
+        strncat(mask, "a", sizeof(mask));
+    if (screen->signal_options & GROUP_IDLE)
+        strncat(mask, "i", sizeof(mask));
+    if (screen->signal_options & GROUP_IDLE_IN_XACT)
+        strncat(mask, "x", sizeof(mask));
+    if (screen->signal_options & GROUP_WAITING)
+        strncat(mask, "w", sizeof(mask));
+    if (screen->signal_options & GROUP_OTHER)
+        strncat(mask, "o", sizeof(mask));
+
+    for (i = 0; i < strlen(mask); i++) {
+        switch (mask[i]) {
+            case 'a':
+                snprintf(state, sizeof(state), "state = 'active'");
+                break;
+            case 'i':
+                snprintf(state, sizeof(state), "state = 'idle'");
+                break;
+            case 'x':
+                snprintf(state, sizeof(state), "state IN ('idle in transaction (aborted)', 'idle in transaction')");
+                break;
+            case 'w':
+		if (atoi(screen->pg_special.pg_version_num) < PG96)
+	            snprintf(state, sizeof(state), "waiting");
+		else 
+	            snprintf(state, sizeof(state), "wait_event IS NOT NULL OR wait_event_type IS NOT NULL");
+                break;
+            case 'o':
+                snprintf(state, sizeof(state), "state IN ('fastpath function call', 'disabled')");
+                break;
+            default:
+                break;
+        }
+	snprintf(query, sizeof(query), "%s%s%s%s%s%s%s%s%s",
+		 PG_SIG_GROUP_BACKEND_P1, actions[actions_idx],
+		 PG_SIG_GROUP_BACKEND_P2, state,
+		 PG_SIG_GROUP_BACKEND_P3, screen->pg_stat_activity_min_age,
+		 PG_SIG_GROUP_BACKEND_P4, screen->pg_stat_activity_min_age,
+		 PG_SIG_GROUP_BACKEND_P5);
+        
+        char errmsg[ERRSIZE];
+        res = do_query(conn, query, errmsg);
+        signaled = signaled + PQntuples(res);
+        PQclear(res);
+    }
+
+    if (do_terminate)
+        wprintw(window, "Terminated %i processes.", signaled);
+    else
+        wprintw(window, "Canceled %i processes.", signaled);
+}
+
+/*
+ ****************************************************** key press function **
+ * Start psql using screen connection options.
+ *
+ * IN:
+ * @window          Window where errors will be displayed if occurs.
+ * @screen          Screen options.
+ ****************************************************************************
+ */
+void start_psql(WINDOW * window, struct screen_s * screen)
+{
+    pid_t pid;
+    char psql[XS_BUF_LEN] = DEFAULT_PSQL;
+
+    /* escape from ncurses mode */
+    refresh();
+    endwin();
+    /* ignore Ctrl+C in child when psql running */
+    signal(SIGINT, SIG_IGN);
+    pid = fork();                   /* start child */
+    if (pid == 0) {
+        execlp(psql, psql,
+                "-h", screen->host,
+                "-p", screen->port,
+                "-U", screen->user,
+                "-d", screen->dbname,
+                NULL);
+        exit(EXIT_SUCCESS);         /* finish child */
+    } else if (pid < 0) {
+        wprintw(window, "ERROR: fork failed, can't exec %s.", psql);
+    } else if (waitpid(pid, NULL, 0) != pid) {
+        wprintw(window, "ERROR: waitpid failed.");
+    }
+
+    /* 
+     * Reinit signals handling. After psql session, pgcenter may not reset terminal properly.
+     */
+    signal(SIGINT, SIG_DFL);
+    init_signal_handlers();
+
+    /* return to ncurses mode */
+    refresh();
+}
+
+/*
+ ****************************************************** key press function **
+ * Change refresh interval.
+ *
+ * IN:
+ * @window              Window where prompt will be printed.
+ * 
+ * OUT:
+ * @interval            Interval.
+ ****************************************************************************
+ */
+unsigned long change_refresh(WINDOW * window, unsigned long interval)
+{
+    unsigned long interval_save = interval;
+    static char msg[S_BUF_LEN],                 /* prompt */
+                str[XS_BUF_LEN];                /* entered value */
+    bool with_esc;
+    double value;
+    char * end;
+
+    snprintf(msg, sizeof(msg), "Change refresh (min %.1f, max %i, current %g) to ",
+            (double) INTERVAL_MIN / 1000000, INTERVAL_MAXLEN, (double) interval / 1000000);
+    cmd_readline(window, msg, strlen(msg), &with_esc, str, sizeof(str), true);
+
+    if (strlen(str) != 0 && with_esc == false) {
+        /* fractional values are allowed, e.g. 0.5 */
+        errno = 0;
+        value = strtod(str, &end);
+        if (errno != 0 || end == str || *end != '\0') {
+            wprintw(window, "Invalid value, leave old value: %g seconds.", (double) interval_save / 1000000);
+            interval = interval_save;
+        } else if (value * 1000000 < INTERVAL_MIN) {
+            wprintw(window, "Should not be less than %.1f second.", (double) INTERVAL_MIN / 1000000);
+            interval = interval_save;
+        } else if (value > INTERVAL_MAXLEN) {
+            wprintw(window, "Should not be more than %i seconds.", INTERVAL_MAXLEN);
+            interval = INTERVAL_MAXLEN * 1000000;
+        } else {
+            interval = value * 1000000;
+        }
+    } else if (strlen(str) == 0 && with_esc == false ) {
+        wprintw(window, "Leave old value: %g seconds.", (double) interval_save / 1000000);
+        interval = interval_save;
+    }
+
+    return interval;
+}
+
+/*
+ ****************************************************** key press function **
+ * Pause pgcenter execution.
+ *
+ * IN:
+ * @window              Window where diag message will be printed.
+ * @interval            Sleep interval.
+ ****************************************************************************
+ */
+void do_noop(WINDOW * window, unsigned long interval)
+{
+    bool paused = true;
+    unsigned int sleep_usec;
+    int ch;
+
+    while (paused != false) {
+        wprintw(window, "Pause, press any key to resume.");
+        wrefresh(window);
+        /* sleep */
+        for (sleep_usec = 0; sleep_usec < interval; sleep_usec += INTERVAL_STEP) {
+            if ((ch = getch()) != ERR) {
+                paused = false;
+                break;
+            } else {
+                usleep(MIN(INTERVAL_STEP, interval - sleep_usec));
+                if (interval > DEFAULT_INTERVAL && sleep_usec == DEFAULT_INTERVAL) {
+                    wrefresh(window);
+                    wclear(window);
+                }
+            }
+        }
+        wclear(window);
+    }
+}
+
+/*
+ ****************************************************** key-press function **
+ * Switch on/off displaying content from system view
+ *
+ * IN:
+ * @window              Window where diag messages will be printed.
+ * @screen              Current screen.
+ * @first_iter          Reset counters flag.
+ ****************************************************************************
+ */
+void system_view_toggle(WINDOW * window, struct screen_s * screen, bool * first_iter)
+{
+    screen->pg_stat_sys ^= 1;
+    if (screen->pg_stat_sys)
+        wprintw(window, "Show system tables: on");
+    else
+        wprintw(window, "Show system tables: off");
+
+    *first_iter = true;
+
+}
+
+/*
+ ****************************************************** key-press function **
+ * Switch on/off displaying cgroup stats of postgres instead of host stats.
+ *
+ * IN:
+ * @window              Window where diag messages will be printed.
+ * @screen              Current screen.
+ ****************************************************************************
+ */
+void cgroup_view_toggle(WINDOW * window, struct screen_s * screen)
+{
+    if (screen->pg_special.pg_cgroup[0] == '\0') {
+        wprintw(window, "Do nothing. Postgres cgroup v2 not found (remote host?).");
+        return;
+    }
+
+    screen->host_view ^= 1;
+    if (screen->host_view)
+        wprintw(window, "Show cgroup stats: off");
+    else
+        wprintw(window, "Show cgroup stats: on");
+}
+
+/*
+ ***************************************************** log process routine **
+ * Get current postgresql logfile path
+ *
+ * IN:
+ * @path                Log file location.
+ * @conn                Current postgresql connection.
+ ****************************************************************************
+ */
+void get_logfile_path(char * path, PGconn * conn)
+{
+    PGresult *res;
+    char errmsg[ERRSIZE],
+         q1[] = "show data_directory",
+         q2[] = "show log_directory",
+         q3[] = "show log_filename",
+         q4[] = "select to_char(pg_postmaster_start_time(), 'HH24MISS')",
+         logdir[PATH_MAX], logfile[NAME_MAX], datadir[PATH_MAX],
+         path_tpl[PATH_MAX + NAME_MAX],
+         path_log[PATH_MAX + NAME_MAX],
+         path_log_fallback[PATH_MAX + NAME_MAX] = "";
+
+    path[0] = '\0';
+    if ((res = do_query(conn, q2, errmsg)) == NULL) {
+        PQclear(res);
+        return;
+    }
+    snprintf(logdir, sizeof(logdir), "%s", PQgetvalue(res, 0, 0));
+    PQclear(res);
+
+    if ( logdir[0] != '/' ) {
+        if ((res = do_query(conn, q1, errmsg)) == NULL) {
+            PQclear(res);
+            return;
+        }
+	snprintf(datadir, sizeof(datadir), "%s", PQgetvalue(res, 0, 0));
+	snprintf(path_tpl, sizeof(path_tpl), "%s/%s/", datadir, logdir);
+        PQclear(res);
+    } else {
+	snprintf(path_tpl, sizeof(path_tpl), "%s/", logdir);
+    }
+
+    if ((res = do_query(conn, q3, errmsg)) == NULL) {
+        PQclear(res);
+        return;
+    }
+    snprintf(logfile, sizeof(logfile), "%s", PQgetvalue(res, 0, 0));
+    snprintf(path_tpl + strlen(path_tpl), sizeof(path_tpl) - strlen(path_tpl), "%s", logfile);
+    PQclear(res);
+    
+    /*
+     * PostgreSQL defaults for log_filename is postgresql-%Y-%m-%d_%H%M%S.log. 
+     * It can be issue, because log file named by this template on postamster startup.
+     * Therefore we must know postmaster startup time for determining real log name.
+     * But, on log rotation, new log name get _000000.log suffix. Thus log can have two names:
+     * _123456.log (example) or _000000.log. If first log doesn't exist we try to use _000000.log.
+     */
+    /* check that the log_filename have %H%M%S pattern */
+    if (strstr(path_tpl, "%H%M%S") != NULL) {
+        snprintf(path_log, sizeof(path_log), "%s", path_tpl);
+        snprintf(path_log_fallback, sizeof(path_log_fallback), "%s", path_tpl);
+        if((res = do_query(conn, q4, errmsg)) == NULL) {
+            PQclear(res);
+            return;
+        }
+        strrpl(path_log, "%H%M%S", PQgetvalue(res, 0, 0), sizeof(path_log));
+        strrpl(path_log_fallback, "%H%M%S", "000000", sizeof(path_log_fallback));
+        PQclear(res);
+    } else {
+        snprintf(path_log, sizeof(path_log), "%s", path_tpl);
+    }
+
+    /* translate log_filename pattern string in real path */
+    time_t rawtime;
+    struct tm *info;
+
+    time( &rawtime );
+    info = localtime( &rawtime );
+    strftime(path, PATH_MAX, path_log, info);
+
+    /* if file exists, return path */
+    if (access(path, F_OK ) != -1 ) {
+        return;
+    } 
+    
+    /* if previous condition failed, try use _000000.log name */
+    if (strlen(path_log_fallback) != 0) {
+        strftime(path, PATH_MAX, path_log_fallback, info);
+        return;
+    } else {
+        path[0] = '\0';
+        return;
+    }
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Count block devices in /proc/diskstat.
+ *
+ * RETURNS:
+ * Return number of block devices.
+ ****************************************************************************
+ */
+unsigned int count_block_devices(void)
+{
+    unsigned int bdev;
+
+    /* At program start, if statfile read failed, then allocate array for 10 devices. */
+    if ((bdev = count_proc_lines(proc_diskstats)) == 0 && proc_files[proc_diskstats].fd == -1)
+        return 10;
+
+    return bdev;
+}
+
+/*
+ *************************************************** iostat stuff function **
+ * Count NIC devices in /proc/net/dev.
+ *
+ * RETURNS:
+ * Return number of interfaces.
+ ****************************************************************************
+ */
+unsigned int count_nic_devices(void)
+{
+    unsigned int idev;
+
+    /* At program start, if statfile read failed, then allocate array for 10 devices. */
+    if ((idev = count_proc_lines(proc_netdev)) == 0 && proc_files[proc_netdev].fd == -1)
+        return 10;
+
+    /* header has two lines */
+    return (idev > 2) ? idev - 2 : 0;
+}
+/*
+ ****************************************************** key press function **
+ * Log processing, open log in separate window or close if already opened.
+ *
+ * IN:
+ * @window              Window where cmd status will be printed.
+ * @w_sub               Pointer to window where log will be shown.
+ * @screen              Array of connections options.
+ * @conn                Current postgresql connection.
+ ****************************************************************************
+ */
+void subscreen_process(WINDOW * window, WINDOW ** w_sub, struct screen_s * screen, PGconn * conn, unsigned int subscreen)
+{
+    if (!screen->subscreen_enabled) {
+        /* open subscreen */
+        switch (subscreen) {
+            case SUBSCREEN_LOGTAIL:
+                if (check_pg_listen_addr(screen, conn)) {
+                    *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
+                    wrefresh(window);
+                    /* get logfile path  */
+                    get_logfile_path(screen->log_path, conn);
+    
+                    if (strlen(screen->log_path) == 0) {
+                        wprintw(window, "Do nothing. Unable to determine log filename or no access permissions.");
+                        return;
+                    }
+                    if ((screen->log_fd = open(screen->log_path, O_RDONLY)) == -1 ) {
+                        wprintw(window, "Do nothing. Failed to open %s", screen->log_path);
+                        return;
+                    }
+                    screen->subscreen = SUBSCREEN_LOGTAIL;
+                    screen->subscreen_enabled = true;
+                    wprintw(window, "Open postgresql log: %s", screen->log_path);
+                    return;
+                } else {
+                    wprintw(window, "Do nothing. Log file view is not supported for remote hosts.");
+                    return;
+                }
+                break;
+            case SUBSCREEN_IOSTAT:
+                if (access(DISKSTATS_FILE, R_OK) == -1) {
+                    wprintw(window, "Do nothing. No access to %s.", DISKSTATS_FILE);
+                    return;
+                }
+                wprintw(window, "Show iostat");
+                *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
+                screen->subscreen = SUBSCREEN_IOSTAT;
+                screen->subscreen_enabled = true;
+                break;
+            case SUBSCREEN_NICSTAT:
+                if (access(NETDEV_FILE, R_OK) == -1) {
+                    wprintw(window, "Do nothing. No access to %s.", NETDEV_FILE);
+                    return;
+                }
+                wprintw(window, "Show nicstat");
+                *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
+                screen->subscreen = SUBSCREEN_NICSTAT;
+                screen->subscreen_enabled = true;
+                break;
+            case SUBSCREEN_CPUSTAT:
+                if (access(STAT_FILE, R_OK) == -1) {
+                    wprintw(window, "Do nothing. No access to %s.", STAT_FILE);
+                    return;
+                }
+                wprintw(window, "Show per-cpu stat");
+                *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
+                screen->subscreen = SUBSCREEN_CPUSTAT;
+                screen->subscreen_enabled = true;
+                break;
+            case SUBSCREEN_NONE:
+                screen->subscreen = SUBSCREEN_NONE;
+                screen->subscreen_enabled = false;
+        }
+    } else {
+        /* close subscreen */
+        wclear(*w_sub);
+        wrefresh(*w_sub);
+        if (screen->log_fd > 0)
+            close(screen->log_fd);
+        screen->subscreen = SUBSCREEN_NONE;
+        screen->subscreen_enabled = false;
+        return;
+    }
+}
+
+/*
+ ******************************************************** routine function **
+ * Tail postgresql log. 
+ *
+ * IN:
+ * @window          Window where log will be printed.
+ * @w_cmd           Window where diag messages will be printed.
+ * @screen          Current screen.
+ * @conn            Current postgresql connection.
+ ****************************************************************************
+ */
+void print_log(WINDOW * window, WINDOW * w_cmd, struct screen_s * screen, PGconn * conn)
+{
+    unsigned int x, y;                                          /* window coordinates */
+    unsigned int n_lines = 1, n_cols = 1;                       /* number of rows and columns for printing */
+    struct stat stats;                                          /* file stat struct */
+    off_t end_pos;                                              /* end of file position */
+    off_t pos;                                                  /* from this position start read of file */
+    size_t bytes_read;                                          /* bytes read from file to buffer */
+    char buffer[XL_BUF_LEN] = "";                               /* init empty buffer */
+    unsigned int i, nl_count = 0, len, scan_pos;                /* iterator, newline counter, buffer length, in-buffer scan position */
+    char *nl_ptr;                                               /* in-buffer newline pointer */
+
+    getbegyx(window, y, x);                                     /* get window coordinates */
+    /* calculate number of rows for log tailing, 2 is the number of lines for screen header */
+    n_lines = LINES - y - 2;                                    /* calculate number of rows for log tailing */
+    n_cols = COLS - x - 1;                                      /* calculate number of chars in row for cutting multiline log entries */
+    wclear(window);                                             /* clear log window */
+
+    if ((fstat(screen->log_fd, &stats)) == -1) {
+	wprintw(w_cmd, "Failed to stat %s", screen->log_path);
+	wrefresh(w_cmd);
+	return;
+    }
+    if (S_ISREG (stats.st_mode) && stats.st_size != 0) {        /* log should be a non-empty regular file */
+        end_pos = lseek(screen->log_fd, 0, SEEK_END);           /* get end of file position */
+        pos = end_pos;                                          /* set position to the end of file */
+        bytes_read = XL_BUF_LEN;                                /* read with 8KB block */
+        if (end_pos < XL_BUF_LEN)                               /* if end file pos less than buffer */
+            pos = 0;                                            /* than set read position to the begin of file */
+        else                                                    /* if end file pos more than buffer */
+            pos = pos - bytes_read;                             /* than set read position into end of file minus buffer size */
+        lseek(screen->log_fd, pos, SEEK_SET);                       /* set determined position in file */
+        bytes_read = read(screen->log_fd, buffer, bytes_read);      /* read file to the buffer */
+
+        len = strlen(buffer);                                   /* determine the buffer length */
+        scan_pos = len;                                         /* set in-buffer scan position equal buffer length */
+
+        /* print header */
+        wattron(window, A_BOLD);
+        wprintw(window, "\ntail %s\n", screen->log_path);
+        wattroff(window, A_BOLD);
+
+        for (i = 0; i < len; i++)                               /* get number of newlines in the buffer */
+            if (buffer[i] == '\n')
+                nl_count++;
+        if (n_lines > nl_count) {                               /* if number of newlines less than required */
+            wprintw(window, "%s", buffer);                      /* then print out buffer content */
+            wrefresh(window);
+            return;                                             /* and finish work */
+        }
+
+        /*
+         * at this place, log size more than buffersize, fill the buffer 
+         * and find \n position from which start printing.
+         */
+        unsigned int n_lines_save = n_lines;                    /* save number of lines need for tail. */
+        do {
+            nl_ptr = memrchr(buffer, '\n', scan_pos);           /* find \n from scan_pos */
+            if (nl_ptr != NULL) {                               /* if found */
+                scan_pos = (nl_ptr - buffer);                   /* remember this place */
+            } else {                                            /* if not found */
+                break;                                          /* finish work */
+            }
+            n_lines--;                                          /* after each iteration decrement the line counter */
+        } while (n_lines != 0);                                 /* stop cycle when line counter equal zero - we found need amount of lines */
+
+        /* now we should cut multiline log entries to screen length */
+        char str[n_cols];                                       /* use var for one line */
+        char tmp[XL_BUF_LEN];                                   /* tmp var for line from buffer */
+        do {                                                    /* scan buffer from begin */
+            nl_ptr = strstr(buffer, "\n");                      /* find \n in buffer */
+            if (nl_ptr != NULL) {                               /* if found */
+                if (nl_count > n_lines_save) {                              /* and if lines too much, skip them */
+                    snprintf(buffer, sizeof(buffer), "%s", nl_ptr + 1);     /* decrease buffer, cut skipped line */
+                    nl_count--;                                             /* decrease newline counter */
+                    continue;                                   /* start next iteration */
+                }                                                       /* at this place we have sufficient number of lines for tail */
+                snprintf(tmp, nl_ptr - buffer + 1, "%s", buffer);       /* copy log line into temp buffer */
+                if (strlen(tmp) > n_cols) {                             /* if line longer than screen size (multiline), truncate line to screen size */
+                    snprintf(str, n_cols - 4, "%s", buffer);
+                } else {                                                /* if line have normal size, copy line as is */
+                    snprintf(str, strlen(tmp) + 1, "%s", buffer);
+                }
+                wprintw(window, "%s\n", str);                           /* print line to log screen */
+                snprintf(buffer, sizeof(buffer), "%s", nl_ptr + 1);     /* decrease buffer, cut printed line */
+            } else {
+                break;                                                  /* if \n not found, finish work */
+            }
+            n_lines++;                                                  /* after each iteration, increase newline counter */
+        } while (n_lines != n_lines_save);                              /* print lines until newline counter not equal saved newline counter */
+    } else {
+        wprintw(w_cmd, "Do nothing. Log is not a regular file or empty.");     /* if file not regular or empty */
+        subscreen_process(w_cmd, &window, screen, conn, SUBSCREEN_NONE);    /* close log file and log screen */
+    }
+    
+    wrefresh(window);
+}
+
+/*
+ ****************************************************** key press function **
+ * Open log in $PAGER.
+ *
+ * IN:
+ * @window          Window where errors will be displayed.
+ * @screen          Screen options.
+ * @conn            Current connection.
+ ****************************************************************************
+ */
+void show_full_log(WINDOW * window, struct screen_s * screen, PGconn * conn)
+{
+    pid_t pid;
+
+    if (check_pg_listen_addr(screen, conn)) {
+        /* get logfile path  */
+        get_logfile_path(screen->log_path, conn);
+        if (strlen(screen->log_path) != 0) {
+            /* escape from ncurses mode */
+            refresh();
+            endwin();
+            pid = fork();                   /* start child */
+            if (pid == 0) {
+                /* get pager from environment variables, otherwise use default pager */
+                static char pager[S_BUF_LEN];
+                if (getenv("PAGER") != NULL)
+                    snprintf(pager, sizeof(pager), "%s", getenv("PAGER"));
+                else
+                    snprintf(pager, sizeof(pager), "%s", DEFAULT_PAGER);
+                execlp(pager, pager, screen->log_path, NULL);
+                exit(EXIT_SUCCESS);
+            } else if (pid < 0) {
+                wprintw(window, "ERROR: fork failed, can't open %s.", screen->log_path);
+                return;
+            } else if (waitpid(pid, NULL, 0) != pid) {
+                wprintw(window, "ERROR: waitpid failed.");
+                return;
+            }
+        } else {
+            wprintw(window, "Do nothing. Unable to determine log filename (not SUPERUSER?) or no access permissions.");
+        }
+    } else {
+        wprintw(window, "Do nothing. Log file viewing is not supported for remote hosts.");
+    }
+
+    /* return to ncurses mode */
+    refresh();
+    return;
+}
+
+/*
+ ****************************************************** key-press function **
+ * Reset PostgreSQL stat counters
+ *
+ * IN:
+ * @window              Window where result will be printed.
+ * @conn                Current PostgreSQL connection.
+ ****************************************************************************
+ */
+void pg_stat_reset(WINDOW * window, PGconn * conn, bool * reseted)
+{
+    char errmsg[ERRSIZE];
+    PGresult * res;
+
+    if ((res = do_query(conn, PG_STAT_RESET_QUERY, errmsg)) != NULL) {
+        wprintw(window, "Reset statistics");
+        *reseted = true;
+    } else
+        wprintw(window, "Reset statistics failed: %s", errmsg);
+    
+    PQclear(res);
+}
+
+/*
+ ****************************************************** key-press function **
+ * Get query text using pseudo pg_stat_statements.queryid.
+ *
+ * IN:
+ * @window              Window where result will be printed.
+ * @screen              Current screen settings.
+ * @conn                Current PostgreSQL connection.
+ ****************************************************************************
+ */
+void get_query_by_id(WINDOW * window, struct screen_s * screen, PGconn * conn)
+{
+    if (screen->current_context != pg_stat_statements_timing
+            && screen->current_context != pg_stat_statements_general
+            && screen->current_context != pg_stat_statements_io
+            && screen->current_context != pg_stat_statements_temp
+            && screen->current_context != pg_stat_statements_local) {
+        wprintw(window, "Get query text is not allowed here.");
+        return;
+    }
+    
+    PGresult * res;
+    bool with_esc;
+    char msg[] = "Enter queryid: ",
+         query[QUERY_MAXLEN],
+         pager[M_BUF_LEN] = "";
+    char queryid[XS_BUF_LEN];
+    char errmsg[ERRSIZE];
+    FILE * fpout;
+
+    cmd_readline(window, msg, strlen(msg), &with_esc, queryid, sizeof(queryid), true);
+    if (check_string(queryid, is_alfanum) == -1) {
+        wprintw(window, "Do nothing. Value is not valid.");
+        return;
+    }
+
+    if (strlen(queryid) != 0 && with_esc == false) {
+        /* do query and send result into less */
+	snprintf(query, sizeof(query), "%s%s%s", PG_GET_QUERYREP_BY_QUERYID_QUERY_P1, queryid, PG_GET_QUERYREP_BY_QUERYID_QUERY_P2);
+        if ((res = do_query(conn, query, errmsg)) == NULL) {
+            wprintw(window, "%s", errmsg);
+            return;
+        }
+
+        /* finish work if empty answer */
+        if (PQntuples(res) == 0) {
+            wprintw(window, "Do nothing. Empty answer for %s", queryid);
+            PQclear(res);
+            return;
+        }
+
+        if (getenv("PAGER") != NULL)
+            snprintf(pager, sizeof(pager), "%s", getenv("PAGER"));
+        else
+            snprintf(pager, sizeof(pager), "%s", DEFAULT_PAGER);
+        
+        if ((fpout = popen(pager, "w")) == NULL) {
+            wprintw(window, "Do nothing. Failed to open pipe to %s", pager);
+            return;
+        }
+
+        /* escape from ncurses mode */
+        refresh();
+        endwin();
+
+        /* print result */
+        fprintf(fpout, "summary:\n\ttotal_time: %s, cpu_time: %s, io_time: %s (ALL: %s%%, CPU: %s%%, IO: %s%%),\ttotal queries: %s\n\
+query info:\n\
+\tusename:\t\t\t\t%s,\n\
+\tdatname:\t\t\t\t%s,\n\
+\tcalls (relative to all queries):\t%s (%s%%),\n\
+\trows (relative to all queries):\t\t%s (%s%%),\n\
+\ttotal time (relative to all queries):\t%s (ALL: %s%%, CPU: %s%%, IO: %s%%),\n\
+\taverage time (only for this query):\t%sms, cpu_time: %sms, io_time: %sms, (ALL: %s%%, CPU: %s%%, IO: %s%%),\n\n\
+query text (id: %s):\n%s",
+        /* summary */
+        PQgetvalue(res, 0, REP_ALL_TOTAL_TIME), PQgetvalue(res, 0, REP_ALL_CPU_TIME), PQgetvalue(res, 0, REP_ALL_IO_TIME),
+        PQgetvalue(res, 0, REP_ALL_TOTAL_TIME_PCT), PQgetvalue(res, 0, REP_ALL_CPU_TIME_PCT), PQgetvalue(res, 0, REP_ALL_IO_TIME_PCT), 
+        PQgetvalue(res, 0, REP_ALL_TOTAL_QUERIES),
+        /* user, dbname */
+        PQgetvalue(res, 0, REP_USER), PQgetvalue(res, 0, REP_DBNAME),
+        /* calls and rows */
+        PQgetvalue(res, 0, REP_CALLS), PQgetvalue(res, 0, REP_CALLS_PCT),
+        PQgetvalue(res, 0, REP_ROWS), PQgetvalue(res, 0, REP_ROWS_PCT),
+        /* timings */
+        PQgetvalue(res, 0, REP_TOTAL_TIME), PQgetvalue(res, 0, REP_TOTAL_TIME_PCT), PQgetvalue(res, 0, REP_CPU_TIME_PCT), PQgetvalue(res, 0, REP_IO_TIME_PCT),
+        /* averages */
+        PQgetvalue(res, 0, REP_AVG_TIME), PQgetvalue(res, 0, REP_AVG_CPU_TIME), PQgetvalue(res, 0, REP_AVG_IO_TIME), 
+        PQgetvalue(res, 0, REP_AVG_TIME_PCT), PQgetvalue(res, 0, REP_AVG_CPU_TIME_PCT), PQgetvalue(res, 0, REP_AVG_IO_TIME_PCT),
+        /* query */
+        queryid, PQgetvalue(res, 0, REP_QUERY));
+
+        /* clean */
+        PQclear(res);
+        pclose(fpout);
+
+        /* return to ncurses mode */
+        refresh();
+    } else if (strlen(queryid) == 0 && with_esc == false) {
+        wprintw(window, "Nothing to do. Nothing entered");
+    } else if (with_esc) {
+        ;
+    } else {
+        wprintw(window, "Nothing to do.");
+    }
+}
+
+/*
+ *********************************************************** init function **
+ * Init output colors.
+ *
+ * IN:
+ * @ws_color            Sysstat window current color.
+ * @wc_color            Cmdline window current color.
+ * @wa_color            Database answer window current color.
+ * @wl_color            Subscreen window current color.
+ ****************************************************************************
+ */
+void init_colors(unsigned int * ws_color, unsigned int * wc_color, unsigned int * wa_color, unsigned int * wl_color)
+{
+    start_color();
+    init_pair(0, COLOR_BLACK,   COLOR_BLACK);
+    init_pair(1, COLOR_RED,     COLOR_BLACK);
+    init_pair(2, COLOR_GREEN,   COLOR_BLACK);
+    init_pair(3, COLOR_YELLOW,  COLOR_BLACK);
+    init_pair(4, COLOR_BLUE,    COLOR_BLACK);
+    init_pair(5, COLOR_MAGENTA, COLOR_BLACK);
+    init_pair(6, COLOR_CYAN,    COLOR_BLACK);
+    init_pair(7, COLOR_WHITE,   COLOR_BLACK);
+    /* set defaults */
+    *ws_color = 7;
+    *wc_color = 7;
+    *wa_color = 7;
+    *wl_color = 7;
+}
+
+/*
+ ************************************************** color-related function **
+ * Draw help of color-change screen.
+ *
+ * IN:
+ * @ws_color            Sysstat window current color.
+ * @wc_color            Cmdline window current color.
+ * @wa_color            Database answer window current color.
+ * @wl_color            Subscreen window current color.
+ * @target              Short name of the area which color will be changed.
+ * @target_color        Next color of the area.
+ ****************************************************************************
+ */
+void draw_color_help(WINDOW * w, unsigned int * ws_color, unsigned int * wc_color,
+		unsigned int * wa_color, unsigned int * wl_color, unsigned int target, unsigned int * target_color)
+{
+    wclear(w);
+    wprintw(w, "Help for color mapping - %s, version %.1f.%d\n\n",
+            PROGRAM_NAME, PROGRAM_VERSION, PROGRAM_RELEASE);
+    wattron(w, COLOR_PAIR(*ws_color));
+    wprintw(w, "\tpgcenter: 2015-08-03 16:12:16, load average: 0.54, 0.43, 0.41\n\
+\t    %%cpu:  4.8 us,  5.0 sy,  0.0 ni, 90.2 id,  0.0 wa,  0.0 hi,  0.0 si,  \n\
+\t  conn 1: 127.0.0.1:5432 postgres@pgbench        conn state: ok\n\
+\tactivity:  9 total,  8 idle,  0 idle_in_xact,  1 active,  0 waiting,\n");
+    wattroff(w, COLOR_PAIR(*ws_color));
+
+    wattron(w, COLOR_PAIR(*wc_color));
+    wprintw(w, "\tNasty message or input prompt.\n");
+    wattroff(w, COLOR_PAIR(*wc_color));
+
+    wattron(w, COLOR_PAIR(*wa_color));
+    wattron(w, A_BOLD);
+    wprintw(w, "\tuser      database  calls  calls/s  total_time  read_time  write_time  cpu_\n");
+    wattroff(w, A_BOLD);
+    wprintw(w, "\tpostgres  pgbench   83523  3        9294.62     0.00       0.00        9294\n\
+\tadmin     pgbench   24718  0        30731.86    28672.12   0.00        2059\n\n");
+    wattroff(w, COLOR_PAIR(*wa_color));
+
+    wattron(w, COLOR_PAIR(*wl_color));
+    wprintw(w, "\t< 2015-08-03 16:17:55.848 YEKT >LOG:  database system is ready to accept co\n\
+\t< 2015-08-03 16:17:55.848 YEKT >LOG:  autovacuum launcher started\n\n");
+    wattroff(w, COLOR_PAIR(*wl_color));
+
+    wprintw(w, "1) Select a target as an upper case letter, current target is  %c :\n\
+\tS = Summary Data, M = Messages/Prompt, P = PostgreSQL Information, L = Additional screen\n", target);
+    wprintw(w, "2) Select a color as a number, current color is  %i :\n\
+\t0 = black,  1 = red,      2 = green,  3 = yellow,\n\
+\t4 = blue,   5 = magenta,  6 = cyan,   7 = white\n", *target_color);
+    wprintw(w, "3) Then use keys: 'Esc' to abort changes, 'Enter' to commit and end.\n");
+
+    touchwin(w);
+    wrefresh(w);
+}
+
+/*
+ ****************************************************** key press function **
+ * Change output colors.
+ *
+ * IN:
+ * @ws_color            Sysstat window current color.
+ * @wc_color            Cmdline window current color.
+ * @wa_color            Database answer window current color.
+ * @wl_color            Subscreen window current color.
+ ****************************************************************************
+ */
+void change_colors(unsigned int * ws_color, unsigned int * wc_color, unsigned int * wa_color, unsigned int * wl_color)
+{
+    WINDOW * w;
+    int ch;
+    unsigned int target = 'S',
+        * target_color = ws_color;
+    unsigned int ws_save = *ws_color,
+        wc_save = *wc_color,
+        wa_save = *wa_color,
+        wl_save = *wl_color;
+    
+    w = subwin(stdscr, 0, 0, 0, 0);
+    echo();
+    cbreak();
+    nodelay(w, FALSE);
+    keypad(w, TRUE);
+
+    do {
+        draw_color_help(w, ws_color, wc_color, wa_color, wl_color, target, target_color);
+        ch = wgetch(w);
+        switch (ch) {
+            case 'S':
+                target = 'S';
+                target_color = ws_color;
+                break;
+            case 'M':
+                target = 'M';
+                target_color = wc_color;
+                break;
+            case 'P':
+                target = 'P';
+                target_color = wa_color;
+                break;
+            case 'L':
+                target = 'L';
+                target_color = wl_color;
+                break;
+            case '0': case '1': case '2': case '3':
+            case '4': case '5': case '6': case '7':
+                *target_color = ch - '0';
+                break;
+            default:
+                break;
+        }
+    } while (ch != '\n' && ch != 27);
+
+    /* if Esc entered, restore previous colors */
+    if (ch == 27) {
+        *ws_color = ws_save;
+        *wc_color = wc_save;
+        *wa_color = wa_save;
+        *wl_color = wl_save;
+    }
+
+    noecho();
+    cbreak();
+    nodelay(w, TRUE);
+    keypad(w, FALSE);
+    delwin(w);
+}
+
+/*
+ ****************************************************** key-press function **
+ * Switch statistics context.
+ *
+ * IN:
+ * @window              Window for printing diag messages.
+ * @screen              Current screen.
+ * @context             New statistics context.
+ * @first_iter          Flag for resetting previous query results.
+ ****************************************************************************
+ */
+void switch_context(WINDOW * window, struct screen_s * screen, 
+                    enum context context, bool * first_iter)
+{
+    wclear(window);
+    switch (context) {
+        case pg_stat_database:
+            wprintw(window, "Show databases statistics");
+            break;
+        case pg_stat_replication:
+            wprintw(window, "Show replication statistics");
+            break;
+        case pg_stat_tables:
+            wprintw(window, "Show tables statistics");
+            break;
+        case pg_stat_indexes:
+            wprintw(window, "Show indexes statistics");
+            break;
+        case pg_statio_tables:
+            wprintw(window, "Show tables IO statistics");
+            break;
+        case pg_tables_size:
+            wprintw(window, "Show tables sizes");
+            break;
+        case pg_stat_activity_long:
+            wprintw(window, "Show activity (age threshold: %s)", screen->pg_stat_activity_min_age);
+            break;
+        case pg_stat_functions:
+            wprintw(window, "Show functions statistics");
+            break;
+        case pg_stat_statements_timing:
+            wprintw(window, "Show pg_stat_statements timings");
+            break;
+        case pg_stat_statements_general:
+            wprintw(window, "Show pg_stat_statements general");
+            break;
+        case pg_stat_statements_io:
+            wprintw(window, "Show pg_stat_statements io");
+            break;
+        case pg_stat_statements_temp:
+            wprintw(window, "Show pg_stat_statements temp");
+            break;
+        case pg_stat_statements_local:
+            wprintw(window, "Show pg_stat_statements local io");
+            break;
+        case pg_stat_progress_vacuum:
+            wprintw(window, "Show vacuum progress");
+            break;
+        case pg_stat_backends:
+            wprintw(window, "Show backends processes");
+            break;
+        case pg_fleet:
+            wprintw(window, "Show fleet overview");
+            break;
+        default:
+            break;
+    }
+
+    screen->current_context = context;
+    *first_iter = true;
+}
+
+/*
+ ****************************************************** key press function **
+ * Print on-program help.
+ *
+ * IN:
+ * @first_iter              Reset stats counter after help.
+ ****************************************************************************
+ */
+void print_help_screen(bool * first_iter)
+{
+    WINDOW * w;
+    int ch;
 
-    /* get current context and its filter strings array */
-    for (i = 0; i < TOTAL_CONTEXTS; i++)
-        if (screen->current_context == screen->context_list[i].context)
-            ctx = screen->context_list[i];
+    w = subwin(stdscr, 0, 0, 0, 0);
+    cbreak();
+    nodelay(w, FALSE);
+    keypad(w, TRUE);
 
-    snprintf(msg, S_BUF_LEN, "Set filter, current: \"%s\": ", ctx.fstrings[ctx.order_key]);
+    wclear(w);
+    wprintw(w, "Help for interactive commands - %s version %.1f.%d\n\n",
+                PROGRAM_NAME, PROGRAM_VERSION, PROGRAM_RELEASE);
+    wprintw(w, "general actions:\n\
+  a,d,i,f,r       mode: 'a' activity, 'd' databases, 'i' indexes, 'f' functions, 'r' replication,\n\
+  s,t,T,v         's' tables sizes, 't' tables, 'T' tables IO, 'v' vacuum progress,\n\
+  b               'b' backends processes: cpu, io, rss joined with activity,\n\
+  O               'O' fleet overview, one row per server of all connections,\n\
+  x,X             'x' pg_stat_statements switch, 'X' pg_stat_statements menu.\n\
+  Left,Right,/,F  'Left,Right' change column sort, '/' change sort desc/asc, 'F' set filter.\n\
+  C,E,R           config: 'C' show config, 'E' edit configs, 'R' reload config.\n\
+  p                       'p' start psql session.\n\
+  l               'l' open log file with pager.\n\
+  N,Ctrl+D,W      'N' add new connection, Ctrl+D close current connection, 'W' write connections info.\n\
+  1..8,[,]        switch between consoles: '1..8' first eight consoles, '[' previous, ']' next.\n\
+subscreen actions:\n\
+  B,I,K,L         'B' iostat, 'I' nicstat, 'K' per-cpu, 'L' logtail.\n\
+activity actions:\n\
+  -,_             '-' cancel backend by pid, '_' terminate backend by pid.\n\
+  >,.             '>' set new mask, '.' show current mask.\n\
+  Del,Shift+Del   'Del' cancel backend group using mask, 'Shift+Del' terminate backend group using mask.\n\
+  A               change activity age threshold.\n\
+  G               get report about query using hash.\n\n\
+other actions:\n\
+  , Q             ',' show system tables on/off, 'Q' reset postgresql statistics counters.\n\
+  c               'c' show cgroup stats of postgres on/off, in sysstat and iostat.\n\
+  z,Z             'z' set refresh interval, 'Z' change color scheme.\n\
+  space           pause program execution.\n\
+  h,F1            show help screen.\n\
+  q               quit.\n\n");
+    wprintw(w, "Type 'Esc' to continue.\n");
 
-    cmd_readline(win, msg, strlen(msg), &with_esc, pattern, sizeof(pattern), true);
-    if (strlen(pattern) > 0 && with_esc == false) {
-        snprintf(ctx.fstrings[ctx.order_key], sizeof(ctx.fstrings[ctx.order_key]), "%s", pattern);
-    } else if (strlen(pattern) == 0 && with_esc == false ) {
-        wprintw(win, "Reset filtering.");
-        snprintf(ctx.fstrings[ctx.order_key], sizeof(ctx.fstrings[ctx.order_key]), "%s", "");
+    do {
+        ch = wgetch(w);
+    } while (ch != 27);
+
+    *first_iter = true;
+    cbreak();
+    nodelay(w, TRUE);
+    keypad(w, FALSE);
+    delwin(w);
+}
+
+/*
+ ********************************************************* record function **
+ * Reserve space in the frame buffer, buffer memory is reused between frames.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @len             Number of bytes which will be appended.
+ ****************************************************************************
+ */
+void record_reserve(struct record_buf_s * buf, size_t len)
+{
+    if (buf->used + len <= buf->size)
+        return;
+
+    buf->size = (buf->used + len > buf->size * 2) ? buf->used + len : buf->size * 2;
+    if ((buf->data = realloc(buf->data, buf->size)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: realloc for record buffer failed.\n");
     }
+}
 
-    /* Save pattern to context */
-    for (i = 0; i < TOTAL_CONTEXTS; i++)
-        if (screen->current_context == screen->context_list[i].context)
-            screen->context_list[i] = ctx;
+/*
+ ********************************************************* record function **
+ * Append single byte to the frame buffer.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @value           Byte value.
+ ****************************************************************************
+ */
+void record_put_byte(struct record_buf_s * buf, unsigned char value)
+{
+    record_reserve(buf, 1);
+    buf->data[buf->used++] = value;
+}
 
-    PQclear(res);
-    *first_iter = true;
+/*
+ ********************************************************* record function **
+ * Append fixed size little-endian integer to the frame buffer.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @value           Integer value.
+ * @len             Number of bytes.
+ ****************************************************************************
+ */
+void record_put_fixed(struct record_buf_s * buf, unsigned long long value, unsigned int len)
+{
+    unsigned int i;
+
+    record_reserve(buf, len);
+    for (i = 0; i < len; i++)
+        buf->data[buf->used++] = (value >> (8 * i)) & 0xFF;
 }
 
 /*
- ******************************************************** routine function **
- * Print array content to the ncurses screen.
+ ********************************************************* record function **
+ * Append unsigned integer as varint (7 bits per byte, high bit means that
+ * more bytes follow).
  *
  * IN:
- * @window          Ncurses window where result will be printed.
- * @res             Query result, used for column width calculation.
- * @arr             Array which content will be printed.
- * @n_rows          Number of rows in query result.
- * @n_cols          Number of columns in query result.
- * @screen          Current screen, used for getting order key and highlight 
- *                  appropriate column.
+ * @buf             Frame buffer.
+ * @value           Integer value.
  ****************************************************************************
  */
-void print_data(WINDOW *window, PGresult *res, char ***arr, unsigned int n_rows, unsigned int n_cols, struct screen_s * screen)
+void record_put_varint(struct record_buf_s * buf, unsigned long long value)
 {
-    unsigned int i, j, x;
-    unsigned int winsz_x, winsz_y;
-    struct colAttrs *columns = init_colattrs(n_cols);
-    struct context_s ctx;
-    bool print = true, filter = false;
+    record_reserve(buf, 10);
+    while (value >= 0x80) {
+        buf->data[buf->used++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf->data[buf->used++] = value;
+}
 
-    calculate_width(columns, res, screen, arr, n_rows, n_cols);
-    wclear(window);
+/*
+ ********************************************************* record function **
+ * Append signed integer as zigzag varint, so small negative deltas are as
+ * short as positive ones.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @value           Integer value.
+ ****************************************************************************
+ */
+void record_put_svarint(struct record_buf_s * buf, long long value)
+{
+    record_put_varint(buf, ((unsigned long long) value << 1) ^ (unsigned long long) (value >> 63));
+}
 
-    for (i = 0; i < TOTAL_CONTEXTS; i++)
-        if (screen->current_context == screen->context_list[i].context)
-            ctx = screen->context_list[i];
+/*
+ ********************************************************* record function **
+ * Append double value as its 8 bytes representation.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @value           Double value.
+ ****************************************************************************
+ */
+void record_put_double(struct record_buf_s * buf, double value)
+{
+    unsigned long long bits;
 
-    /* enable filtration if there is an any filter pattern */
-    for (i = 0; i < MAX_COLS; i++) {
-        if (strlen(ctx.fstrings[i]) > 0) {
-            filter = true;
-            break;
-        } else
-            filter = false;
+    memcpy(&bits, &value, sizeof(bits));
+    record_put_fixed(buf, bits, sizeof(bits));
+}
+
+/*
+ ********************************************************* record function **
+ * Append string prefixed with its length.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @value           String value, it may be not zero terminated.
+ * @len             String length.
+ ****************************************************************************
+ */
+void record_put_string(struct record_buf_s * buf, const char * value, unsigned int len)
+{
+    record_put_varint(buf, len);
+    record_reserve(buf, len);
+    memcpy(buf->data + buf->used, value, len);
+    buf->used += len;
+}
+
+/*
+ ********************************************************* record function **
+ * Append pending run of unchanged snapshot rows.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @skip            Number of unchanged rows, it's reset.
+ ****************************************************************************
+ */
+void record_put_skip(struct record_buf_s * buf, unsigned int * skip)
+{
+    if (*skip == 0)
+        return;
+
+    record_put_byte(buf, op_skip);
+    record_put_varint(buf, *skip);
+    *skip = 0;
+}
+
+/*
+ ********************************************************* record function **
+ * Read fixed size little-endian integer.
+ *
+ * IN:
+ * @data            Encoded integer.
+ * @len             Number of bytes.
+ *
+ * RETURNS:
+ * Integer value.
+ ****************************************************************************
+ */
+unsigned long long record_get_fixed(const unsigned char * data, unsigned int len)
+{
+    unsigned long long value = 0;
+    unsigned int i;
+
+    for (i = 0; i < len; i++)
+        value |= (unsigned long long) data[i] << (8 * i);
+
+    return value;
+}
+
+/*
+ ********************************************************* record function **
+ * Append deltas of cpu statistics.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @c, @p           Current and previous cpu statistics.
+ ****************************************************************************
+ */
+void record_put_cpu(struct record_buf_s * buf, struct cpu_s * c, struct cpu_s * p)
+{
+    RECORD_PUT_DELTA(buf, c, p, cpu_user);
+    RECORD_PUT_DELTA(buf, c, p, cpu_nice);
+    RECORD_PUT_DELTA(buf, c, p, cpu_sys);
+    RECORD_PUT_DELTA(buf, c, p, cpu_idle);
+    RECORD_PUT_DELTA(buf, c, p, cpu_iowait);
+    RECORD_PUT_DELTA(buf, c, p, cpu_steal);
+    RECORD_PUT_DELTA(buf, c, p, cpu_hardirq);
+    RECORD_PUT_DELTA(buf, c, p, cpu_softirq);
+    RECORD_PUT_DELTA(buf, c, p, cpu_guest);
+    RECORD_PUT_DELTA(buf, c, p, cpu_guest_nice);
+}
+
+/*
+ ********************************************************* record function **
+ * Append deltas of memory statistics.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @c, @p           Current and previous memory statistics.
+ ****************************************************************************
+ */
+void record_put_mem(struct record_buf_s * buf, struct mem_s * c, struct mem_s * p)
+{
+    RECORD_PUT_DELTA(buf, c, p, mem_total);
+    RECORD_PUT_DELTA(buf, c, p, mem_free);
+    RECORD_PUT_DELTA(buf, c, p, mem_used);
+    RECORD_PUT_DELTA(buf, c, p, swap_total);
+    RECORD_PUT_DELTA(buf, c, p, swap_free);
+    RECORD_PUT_DELTA(buf, c, p, swap_used);
+    RECORD_PUT_DELTA(buf, c, p, cached);
+    RECORD_PUT_DELTA(buf, c, p, buffers);
+    RECORD_PUT_DELTA(buf, c, p, dirty);
+    RECORD_PUT_DELTA(buf, c, p, writeback);
+    RECORD_PUT_DELTA(buf, c, p, slab);
+}
+
+/*
+ ********************************************************* record function **
+ * Append postgres stats of the sysstat screen. Short text values are 
+ * written as is.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @c, @p           Current and previous postgres stats.
+ ****************************************************************************
+ */
+void record_put_pgstat(struct record_buf_s * buf, struct pg_stat_s * c, struct pg_stat_s * p)
+{
+    record_put_string(buf, c->uptime, strlen(c->uptime));
+    RECORD_PUT_DELTA(buf, c, p, t_count);
+    RECORD_PUT_DELTA(buf, c, p, i_count);
+    RECORD_PUT_DELTA(buf, c, p, x_count);
+    RECORD_PUT_DELTA(buf, c, p, a_count);
+    RECORD_PUT_DELTA(buf, c, p, w_count);
+    RECORD_PUT_DELTA(buf, c, p, o_count);
+    RECORD_PUT_DELTA(buf, c, p, av_count);
+    RECORD_PUT_DELTA(buf, c, p, avw_count);
+    RECORD_PUT_DELTA(buf, c, p, mv_count);
+    record_put_string(buf, c->vac_maxtime, strlen(c->vac_maxtime));
+    record_put_string(buf, c->xact_maxtime, strlen(c->xact_maxtime));
+    record_put_double(buf, c->avgtime);
+    RECORD_PUT_DELTA(buf, c, p, total_calls);
+    record_put_double(buf, c->ts);
+    record_put_byte(buf, c->pgss_ok);
+}
+
+/*
+ ********************************************************* record function **
+ * Append deltas of device counters. Most devices are idle, so only mask of
+ * changed counters is written for them.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @delta           Deltas of counters.
+ * @n               Number of counters.
+ ****************************************************************************
+ */
+void record_put_deltas(struct record_buf_s * buf, const long long * delta, unsigned int n)
+{
+    unsigned int i, mask = 0;
+
+    for (i = 0; i < n; i++)
+        if (delta[i] != 0)
+            mask |= 1U << i;
+
+    record_put_varint(buf, mask);
+    for (i = 0; i < n; i++)
+        if (delta[i] != 0)
+            record_put_svarint(buf, delta[i]);
+}
+
+/*
+ ********************************************************* record function **
+ * Append deltas of IO statistics. Devices are written when their list is 
+ * changed, in this case deltas are taken from zero.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @c_ios, @p_ios   Current and previous IO statistics.
+ * @bdev            Number of devices.
+ * @names           Devices list is written.
+ ****************************************************************************
+ */
+void record_put_iostat(struct record_buf_s * buf, struct iodata_s *c_ios[], struct iodata_s *p_ios[],
+        unsigned int bdev, bool names)
+{
+    static struct iodata_s zero;
+    struct iodata_s * c, * p;
+    long long delta[11];
+    unsigned int i;
+
+    record_put_varint(buf, bdev);
+    record_put_byte(buf, names);
+    for (i = 0; i < bdev; i++) {
+        c = c_ios[i];
+        p = names ? &zero : p_ios[i];
+        if (names) {
+            record_put_svarint(buf, c->major);
+            record_put_svarint(buf, c->minor);
+            record_put_string(buf, c->devname, strlen(c->devname));
+        }
+        delta[0] = RECORD_DELTA(c, p, r_completed);
+        delta[1] = RECORD_DELTA(c, p, r_merged);
+        delta[2] = RECORD_DELTA(c, p, r_sectors);
+        delta[3] = RECORD_DELTA(c, p, r_spent);
+        delta[4] = RECORD_DELTA(c, p, w_completed);
+        delta[5] = RECORD_DELTA(c, p, w_merged);
+        delta[6] = RECORD_DELTA(c, p, w_sectors);
+        delta[7] = RECORD_DELTA(c, p, w_spent);
+        delta[8] = RECORD_DELTA(c, p, io_in_progress);
+        delta[9] = RECORD_DELTA(c, p, t_spent);
+        delta[10] = RECORD_DELTA(c, p, t_weighted);
+        record_put_deltas(buf, delta, 11);
     }
+}
 
-    /* print header */
-    wattron(window, A_BOLD);
-    for (j = 0, x = 0; j < n_cols; j++, x++) {
-        /* truncate last field length to end of screen */
-        if (j == n_cols - 1) {
-            getyx(window, winsz_y, winsz_x);
-            columns[x].width = COLS - winsz_x - 1;
-            /* dirty hack for supress gcc warning about "variable set but not used" */
-            winsz_y--;
-        } 
-        /* mark sort column */
-        if (j == ctx.order_key) {
-            wattron(window, A_REVERSE);
-            wprintw(window, "%-*s", columns[x].width, columns[x].name);
-            wattroff(window, A_REVERSE);
-        } else
-            wprintw(window, "%-*s", columns[x].width, columns[x].name);
+/*
+ ********************************************************* record function **
+ * Append deltas of NIC statistics. Interfaces and their settings are 
+ * written when their list is changed, in this case deltas are taken from 
+ * zero.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @c_nicd, @p_nicd Current and previous NIC statistics.
+ * @idev            Number of interfaces.
+ * @names           Interfaces list is written.
+ ****************************************************************************
+ */
+void record_put_nicstat(struct record_buf_s * buf, struct nicdata_s *c_nicd[], struct nicdata_s *p_nicd[],
+        unsigned int idev, bool names)
+{
+    static struct nicdata_s zero;
+    struct nicdata_s * c, * p;
+    long long delta[8];
+    unsigned int i;
+
+    record_put_varint(buf, idev);
+    record_put_byte(buf, names);
+    for (i = 0; i < idev; i++) {
+        c = c_nicd[i];
+        p = names ? &zero : p_nicd[i];
+        if (names) {
+            record_put_string(buf, c->ifname, strlen(c->ifname));
+            record_put_svarint(buf, c->speed);
+            record_put_svarint(buf, c->duplex);
+        }
+        delta[0] = RECORD_DELTA(c, p, rbytes);
+        delta[1] = RECORD_DELTA(c, p, rpackets);
+        delta[2] = RECORD_DELTA(c, p, ierr);
+        delta[3] = RECORD_DELTA(c, p, wbytes);
+        delta[4] = RECORD_DELTA(c, p, wpackets);
+        delta[5] = RECORD_DELTA(c, p, oerr);
+        delta[6] = RECORD_DELTA(c, p, coll);
+        delta[7] = RECORD_DELTA(c, p, sat);
+        record_put_deltas(buf, delta, 8);
     }
-    wprintw(window, "\n");
-    wattroff(window, A_BOLD);
+}
 
-    /* print data from array */
-    for (i = 0; i < n_rows; i++) {
-        /* filtering cycle - searching filter pattern */
-        if (filter)
-            for (j = 0; j < n_cols; j++) {
-                if (!strstr(arr[i][j], ctx.fstrings[j]) && strlen(ctx.fstrings[j]) > 0)
-                    print = false;          /* pattern not found */
-                else if (strlen(ctx.fstrings[j]) == 0)
-                    continue;               /* skip empty pattern */
-                else {
-                    print = true;           /* pattern found */
-                    break;
-                }
-            }
-        /* printing cycle - don't print filtered rows */
-        for (j = 0, x = 0; j < n_cols; j++, x++) {
-            /* truncate last field length to end of screen */
-            if (j == n_cols - 1) {
-                getyx(window, winsz_y, winsz_x);
-                columns[x].width = COLS - winsz_x;
-                arr[i][j][columns[x].width] = '\0';
+/*
+ ********************************************************* record function **
+ * Append snapshot of context query results. Columns are written only when
+ * they differ from previous snapshot. Rows are matched with rows of previous
+ * snapshot by key columns (by position if context has no key) and written
+ * as stream of operations: runs of unchanged rows, changed columns of 
+ * matched rows (counters as deltas) and new rows.
+ *
+ * IN:
+ * @buf             Frame buffer.
+ * @c               Current snapshot.
+ * @p               Previous snapshot, NULL if snapshot is written entirely.
+ ****************************************************************************
+ */
+void record_put_snapshot(struct record_buf_s * buf, struct snapshot_s * c, struct snapshot_s * p)
+{
+    unsigned int i, j, cursor = 0, skip = 0;
+    unsigned long long mask;
+    struct cell_s * cc, * pc;
+    bool header = (p == NULL || p->n_cols != c->n_cols || p->key != c->key || p->monotonic != c->monotonic);
+    int m;
+
+    for (j = 0; header == false && j < c->n_cols; j++)
+        if (c->cols[j].type != p->cols[j].type || strcmp(c->cols[j].name, p->cols[j].name) != 0)
+            header = true;
+
+    record_put_varint(buf, c->n_cols);
+    record_put_byte(buf, header);
+    if (header) {
+        record_put_varint(buf, c->key);
+        record_put_byte(buf, c->monotonic);
+        for (j = 0; j < c->n_cols; j++) {
+            record_put_byte(buf, c->cols[j].type);
+            record_put_string(buf, c->cols[j].name, strlen(c->cols[j].name));
+        }
+        /* rows with other columns can't be compared */
+        p = NULL;
+    }
+    record_put_double(buf, c->ts);
+    record_put_varint(buf, c->n_rows);
+
+    /* too wide rows don't fit into changed columns mask, they are written entirely */
+    if (c->n_cols > RECORD_MAX_COLS)
+        p = NULL;
+    if (p != NULL && c->key != 0)
+        build_snapshot_hash(p, c->key);
+
+    for (i = 0; i < c->n_rows; i++) {
+        if (p == NULL)
+            m = -1;
+        else if (c->key != 0)
+            m = find_snapshot_row(p, c, i, c->key);
+        else
+            m = (i < p->n_rows) ? (int) i : -1;
+
+        /* row appeared since previous snapshot */
+        if (m == -1) {
+            record_put_skip(buf, &skip);
+            record_put_byte(buf, op_insert);
+            for (j = 0; j < c->n_cols; j++) {
+                if (c->cols[j].type == col_counter)
+                    record_put_svarint(buf, c->cols[j].counters[i]);
+                else
+                    record_put_string(buf, SNAPSHOT_VALUE(c, i, j), SNAPSHOT_CELL(c, i, j)->len);
             }
-            if (print)
-                wprintw(window, "%-*s", columns[x].width, arr[i][j]);
+            continue;
+        }
+
+        for (j = 0, mask = 0; j < c->n_cols; j++) {
+            if (c->cols[j].type == col_counter) {
+                if (c->cols[j].counters[i] != p->cols[j].counters[m])
+                    mask |= 1ULL << j;
+            } else {
+                cc = SNAPSHOT_CELL(c, i, j);
+                pc = SNAPSHOT_CELL(p, m, j);
+                if (cc->len != pc->len || memcmp(c->data + cc->offset, p->data + pc->offset, cc->len) != 0)
+                    mask |= 1ULL << j;
+            }
+        }
+
+        /* unchanged rows which keep their order are written as single run */
+        if ((unsigned int) m == cursor && mask == 0) {
+            skip++;
+            cursor++;
+            continue;
         }
+
+        record_put_skip(buf, &skip);
+        record_put_byte(buf, op_update);
+        record_put_svarint(buf, (long long) m - cursor);
+        record_put_varint(buf, mask);
+        for (j = 0; j < c->n_cols; j++) {
+            if ((mask & (1ULL << j)) == 0)
+                continue;
+            if (c->cols[j].type == col_counter)
+                record_put_svarint(buf, c->cols[j].counters[i] - p->cols[j].counters[m]);
+            else
+                record_put_string(buf, SNAPSHOT_VALUE(c, i, j), SNAPSHOT_CELL(c, i, j)->len);
+        }
+        cursor = m + 1;
     }
-    wrefresh(window);
-    free(columns);
+
+    record_put_skip(buf, &skip);
+    record_put_byte(buf, op_end);
 }
 
 /*
- ****************************************************** key-press function **
- * Change column-based sort
+ ********************************************************* record function **
+ * Append entry of the keyframes index.
  *
  * IN:
- * @screen              Current screen.
- * @increment           Direction (left or right column).
- * @first_iter          Flag for resetting previous query results.
+ * @rec             Recorder state.
+ * @wall            Wall clock time of keyframe, in microseconds.
+ * @offset          Keyframe offset in time-series file.
  ****************************************************************************
  */
-void change_sort_order(struct screen_s * screen, bool increment, bool * first_iter)
+void write_record_index(struct record_s * rec, long long wall, off_t offset)
 {
-    unsigned int max = 0, i;
+    unsigned char entry[RECORD_INDEX_ENTRY_LEN];
+    unsigned int i;
 
-    /* Determine max limit of range where cursor can move */
-    switch (screen->current_context) {
-        case pg_stat_database:
-            (atoi(screen->pg_special.pg_version_num) < PG92)
-                ? (max = PG_STAT_DATABASE_CMAX_91)
-                : (max = PG_STAT_DATABASE_CMAX_LT);
-            break;
-        case pg_stat_replication:
-            max = PG_STAT_REPLICATION_CMAX_LT;
-            break;
-        case pg_stat_tables:
-            max = PG_STAT_TABLES_CMAX_LT;
-            break;
-        case pg_stat_indexes:
-            max = PG_STAT_INDEXES_CMAX_LT;
-            break;
-        case pg_statio_tables:
-            max = PG_STATIO_TABLES_CMAX_LT;
-            break;
-        case pg_tables_size:
-            max = PG_TABLES_SIZE_CMAX_LT;
-            break;
-        case pg_stat_activity_long:
-            if (atoi(screen->pg_special.pg_version_num) < PG92)
-                max = PG_STAT_ACTIVITY_LONG_CMAX_91;
-            else if (atoi(screen->pg_special.pg_version_num) < PG96)
-                max = PG_STAT_ACTIVITY_LONG_CMAX_95;
-            else
-                max = PG_STAT_ACTIVITY_LONG_CMAX_LT;
-            break;
-        case pg_stat_functions:
-            max = PG_STAT_FUNCTIONS_CMAX_LT;
-            *first_iter = true;
-            break;
-        case pg_stat_statements_timing:
-            (atoi(screen->pg_special.pg_version_num) < PG92)
-                ? (max = PGSS_TIMING_CMAX_91)
-                : (max = PGSS_TIMING_CMAX_LT);
-            *first_iter = true;
-            break;
-        case pg_stat_statements_general:
-            max = PGSS_GENERAL_CMAX_LT;
-            *first_iter = true;
-            break;
-        case pg_stat_statements_io:
-            (atoi(screen->pg_special.pg_version_num) < PG92)
-                ? (max = PGSS_IO_CMAX_91)
-                : (max = PGSS_IO_CMAX_LT);
-            *first_iter = true;
-            break;
-        case pg_stat_statements_temp:
-            max = PGSS_TEMP_CMAX_LT;
-            *first_iter = true;
-            break;
-        case pg_stat_statements_local:
-            (atoi(screen->pg_special.pg_version_num) < PG92)
-                ? (max = PGSS_LOCAL_CMAX_91)
-                : (max = PGSS_LOCAL_CMAX_LT);
-            *first_iter = true;
-            break;
-        case pg_stat_progress_vacuum:
-            max = PG_STAT_PROGRESS_VACUUM_CMAX_LT;
+    for (i = 0; i < 8; i++) {
+        entry[i] = ((unsigned long long) wall >> (8 * i)) & 0xFF;
+        entry[i + 8] = ((unsigned long long) offset >> (8 * i)) & 0xFF;
+    }
+
+    if (fwrite(entry, 1, sizeof(entry), rec->idx) != sizeof(entry) || fflush(rec->idx) != 0) {
+        mreport(true, msg_fatal, "FATAL: write to stats record index failed: %s.\n", strerror(errno));
+    }
+}
+
+/*
+ ********************************************************* record function **
+ * Open time-series file for appending. New file gets header, existing file
+ * is checked, its incomplete last frame (left after crash) is cut off and 
+ * keyframes index is rebuilt. Index is rebuilt into temporary file which
+ * replaces old index, so readers which mapped old index aren't broken.
+ *
+ * IN:
+ * @rec             Recorder state.
+ * @path            Time-series file path.
+ ****************************************************************************
+ */
+void open_record_file(struct record_s * rec, const char * path)
+{
+    char idx_path[PATH_MAX + sizeof(RECORD_INDEX_SUFFIX)],
+         tmp_path[PATH_MAX + sizeof(RECORD_INDEX_SUFFIX) + sizeof(RECORD_TMP_SUFFIX)];
+    unsigned char head[RECORD_HEADER_LEN],
+                  frame[13];
+    struct stat st;
+    off_t pos = RECORD_HEADER_LEN;
+    unsigned int len;
+    int fd;
+
+    if ((fd = open(path, O_RDWR | O_CREAT, 0644)) == -1 || (rec->fp = fdopen(fd, "r+")) == NULL) {
+        mreport(true, msg_fatal, "FATAL: can't open %s: %s.\n", path, strerror(errno));
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        mreport(true, msg_fatal, "FATAL: %s is already recorded by other process.\n", path);
+    }
+    if (fstat(fd, &st) == -1) {
+        mreport(true, msg_fatal, "FATAL: can't stat %s: %s.\n", path, strerror(errno));
+    }
+
+    /* index is rebuilt from the frames, so it's always consistent with them */
+    snprintf(idx_path, sizeof(idx_path), "%s%s", path, RECORD_INDEX_SUFFIX);
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", idx_path, RECORD_TMP_SUFFIX);
+    if ((rec->idx = fopen(tmp_path, "w")) == NULL) {
+        mreport(true, msg_fatal, "FATAL: can't open %s: %s.\n", tmp_path, strerror(errno));
+    }
+
+    if (st.st_size == 0) {
+        memcpy(head, RECORD_MAGIC, RECORD_MAGIC_LEN);
+        for (len = 0; len < 4; len++)
+            head[RECORD_MAGIC_LEN + len] = (hz >> (8 * len)) & 0xFF;
+        if (fwrite(head, 1, sizeof(head), rec->fp) != sizeof(head) || fflush(rec->fp) != 0) {
+            mreport(true, msg_fatal, "FATAL: write to %s failed: %s.\n", path, strerror(errno));
+        }
+        /* header is read back below, as header of existing file */
+        st.st_size = pos;
+        rewind(rec->fp);
+    }
+
+    if (fread(head, 1, sizeof(head), rec->fp) != sizeof(head)
+            || memcmp(head, RECORD_MAGIC, RECORD_MAGIC_LEN) != 0) {
+        mreport(true, msg_fatal, "FATAL: %s is not a %s stats record.\n", path, PROGRAM_NAME);
+    }
+    if (record_get_fixed(head + RECORD_MAGIC_LEN, 4) != hz) {
+        mreport(true, msg_fatal, "FATAL: %s is recorded with other HZ value.\n", path);
+    }
+
+    /* walk over frames using their lengths, frame header is length, type and wall time */
+    while (pos + (off_t) sizeof(frame) <= st.st_size) {
+        if (fseeko(rec->fp, pos, SEEK_SET) != 0 || fread(frame, 1, sizeof(frame), rec->fp) != sizeof(frame))
             break;
-        default:
+        len = record_get_fixed(frame, 4);
+        if (len < sizeof(frame) || pos + 4 + len > st.st_size)
             break;
+        if (frame[4] == frame_keyframe)
+            write_record_index(rec, record_get_fixed(frame + 5, 8), pos);
+        pos += 4 + len;
     }
 
-    /* Change number of column used for sort */
-    for (i = 0; i < TOTAL_CONTEXTS; i++) {
-        if (screen->current_context == screen->context_list[i].context) {
-            if (increment) {
-                /* switch from last to first column */
-                if (++screen->context_list[i].order_key > max) {
-                    screen->context_list[i].order_key = 0;
-                }
-            } else {
-                /* switch from first to last column */
-                if (--screen->context_list[i].order_key < 0) {
-                    screen->context_list[i].order_key = max;
-                }
-            }
+    if (pos < st.st_size) {
+        mreport(false, msg_warning, "WARNING: incomplete frame at the end of %s is cut off.\n", path);
+        if (fflush(rec->fp) != 0 || ftruncate(fd, pos) == -1) {
+            mreport(true, msg_fatal, "FATAL: can't truncate %s: %s.\n", path, strerror(errno));
         }
     }
+
+    if (fflush(rec->idx) != 0 || rename(tmp_path, idx_path) == -1) {
+        mreport(true, msg_fatal, "FATAL: can't replace %s: %s.\n", idx_path, strerror(errno));
+    }
+    fseeko(rec->fp, 0, SEEK_END);
 }
 
 /*
- ****************************************************** key-press function **
- * Change column-based sort from desc to asc and vice-versa.
+ ********************************************************* record function **
+ * Prepare recorder state and open time-series file.
  *
  * IN:
- * @screen              Current screen.
+ * @path            Time-series file path.
+ *
+ * OUT:
+ * @rec             Recorder state.
  ****************************************************************************
  */
-void change_sort_order_direction(struct screen_s * screen, bool * first_iter)
+void init_record(struct record_s * rec, const char * path)
 {
     unsigned int i;
+
+    memset(rec, 0, sizeof(struct record_s));
     for (i = 0; i < TOTAL_CONTEXTS; i++) {
-        if (screen->current_context == screen->context_list[i].context) {
-	    screen->context_list[i].order_desc ^= 1;
-        }
-        *first_iter = true;
+        rec->c_snaps[i] = init_snapshot();
+        rec->p_snaps[i] = init_snapshot();
     }
+
+    open_record_file(rec, path);
 }
 
 /*
- ***************************************************** cmd window function **
- * Read input from cmd window.
+ ********************************************************* record function **
+ * Reallocate IO statistics for new number of devices, devices list must be
+ * written into next frame.
  *
  * IN:
- * @window          Window where prompt will be printed.
- * @msg             Message prompt.
- * @pos             At deleting wrong input, cursor do not moving beyond that pos.
- * @len             Max allowed length of string.
- * @echoing         Show characters typed by the user.
- *
- * OUT:
- * @with_esc        Flag which determines when function finish with ESC.
- * @str             Entered string.             
+ * @rec             Recorder state.
+ * @bdev            Number of devices.
  ****************************************************************************
  */
-void cmd_readline(WINDOW *window, const char * msg, unsigned int pos, bool * with_esc, char * str, unsigned int len, bool echoing)
+void resize_record_iostats(struct record_s * rec, unsigned int bdev)
 {
-    int ch;
-    int i = 0;
-    bool done = false;
+    unsigned int i;
 
-    if (echoing)
-        echo();
-    cbreak();
-    nodelay(window, FALSE);
-    keypad(window, TRUE);
+    free_iostats(rec->c_ios, rec->p_ios, rec->bdev);
+    if ((rec->c_ios = realloc(rec->c_ios, sizeof(struct iodata_s *) * MAX(bdev, 1))) == NULL
+            || (rec->p_ios = realloc(rec->p_ios, sizeof(struct iodata_s *) * MAX(bdev, 1))) == NULL) {
+        mreport(true, msg_fatal, "FATAL: realloc for iostat failed.\n");
+    }
+    rec->bdev = bdev;
+    init_iostats(rec->c_ios, rec->p_ios, rec->bdev);
+    for (i = 0; i < rec->bdev; i++) {
+        memset(rec->c_ios[i], 0, STATS_IODATA_SIZE);
+        memset(rec->p_ios[i], 0, STATS_IODATA_SIZE);
+    }
+    rec->ios_names = true;
+}
 
-    /* show prompt if msg not empty */
-    if (strlen(msg) != 0) {
-        wprintw(window, "%s", msg);
-        wrefresh(window);
+/*
+ ********************************************************* record function **
+ * Reallocate NIC statistics for new number of interfaces, interfaces list 
+ * must be written into next frame.
+ *
+ * IN:
+ * @rec             Recorder state.
+ * @idev            Number of interfaces.
+ ****************************************************************************
+ */
+void resize_record_nicdata(struct record_s * rec, unsigned int idev)
+{
+    unsigned int i;
+
+    free_nicdata(rec->c_nicd, rec->p_nicd, rec->idev);
+    if ((rec->c_nicd = realloc(rec->c_nicd, sizeof(struct nicdata_s *) * MAX(idev, 1))) == NULL
+            || (rec->p_nicd = realloc(rec->p_nicd, sizeof(struct nicdata_s *) * MAX(idev, 1))) == NULL) {
+        mreport(true, msg_fatal, "FATAL: realloc for nicstat failed.\n");
+    }
+    rec->idev = idev;
+    init_nicdata(rec->c_nicd, rec->p_nicd, rec->idev);
+    for (i = 0; i < rec->idev; i++) {
+        memset(rec->c_nicd[i], 0, STATS_NICDATA_SIZE);
+        memset(rec->p_nicd[i], 0, STATS_NICDATA_SIZE);
     }
+    rec->nicd_names = true;
+}
 
-    memset(str, 0, len);
-    while (1) {
-        if (done)
-            break;
-        ch = wgetch(window);
-        switch (ch) {
-            case ERR:
-                str[0] = '\0';
-                flushinp();
-                done = true;
-                break;
-            case 27:                            /* Esc */
-                wclear(window);
-                wprintw(window, "Do nothing. Operation canceled. ");
-                nodelay(window, TRUE);
-                *with_esc = true;
-                str[0] = '\0';
-                flushinp();
-                done = true;
-                break;
-            case 10:                            /* Enter */
-                str[len] = '\0';
-                flushinp();
-                nodelay(window, TRUE);
-                *with_esc = false;              /* normal finish with \n */
-                done = true;
-                break;
-            case 263: case 330: case 127:       /* Backspace, Delete, */
-                if (i > 0) {
-                    i--;
-                    wdelch(window);
-                    continue;
-                } else {
-                    wmove(window, 0, pos);
-                    continue;
-                }
-                break;
-            default:
-                if (strlen(str) < len + 1) {
-                    str[i] = ch;
-                    i++;
-                }
-                break;
+/*
+ ********************************************************* record function **
+ * Take sample of all stats: system stats, sysstat screen postgres stats and
+ * results of all contexts queries. Contexts which queries fail (e.g. 
+ * pg_stat_statements isn't installed) are disabled.
+ *
+ * IN:
+ * @rec             Recorder state.
+ * @screen          Screen which connection is recorded.
+ * @conn            Recorded connection.
+ ****************************************************************************
+ */
+void sample_record(struct record_s * rec, struct screen_s * screen, PGconn * conn)
+{
+    unsigned int i, n, curr = rec->curr;
+    float * la;
+
+    /* system stats */
+    rec->uptime0[curr] = 0;
+    read_uptime(&(rec->uptime0[curr]));
+    read_cpu_stat(rec->cpu[curr], 2, &(rec->uptime[curr]), &(rec->uptime0[curr]));
+    la = get_loadavg();
+    for (i = 0; i < 3; i++)
+        rec->la[curr][i] = (long long) (la[i] * 100 + 0.5);
+    read_mem_stat(&rec->mem[curr]);
+
+    /* devices list is rewritten when number of devices or their names are changed */
+    if (rec->c_ios == NULL)
+        resize_record_iostats(rec, 0);
+    if (read_diskstats(rec->c_ios, rec->bdev, &n) == false) {
+        for (i = 0; i < rec->bdev; i++)
+            memset(rec->c_ios[i], 0, STATS_IODATA_SIZE);
+    } else if (n != rec->bdev) {
+        /* number of devices is known from parsing, file is read again only when it's changed */
+        resize_record_iostats(rec, n);
+        read_diskstats(rec->c_ios, rec->bdev, &n);
+    }
+    for (i = 0; i < rec->bdev; i++)
+        if (strcmp(rec->c_ios[i]->devname, rec->p_ios[i]->devname) != 0)
+            rec->ios_names = true;
+
+    if (rec->c_nicd == NULL)
+        resize_record_nicdata(rec, 0);
+    if (read_netdev(rec->c_nicd, rec->idev, &n) == false) {
+        for (i = 0; i < rec->idev; i++)
+            memset(rec->c_nicd[i], 0, STATS_NICDATA_SIZE);
+    } else if (n != rec->idev) {
+        resize_record_nicdata(rec, n);
+        read_netdev(rec->c_nicd, rec->idev, &n);
+    }
+    for (i = 0; i < rec->idev; i++)
+        if (strcmp(rec->c_nicd[i]->ifname, rec->p_nicd[i]->ifname) != 0)
+            rec->nicd_names = true;
+    /* interfaces settings are asked only when interfaces list is changed */
+    for (i = 0; i < rec->idev; i++) {
+        if (rec->nicd_names) {
+            rec->c_nicd[i]->speed = 0;
+            rec->c_nicd[i]->duplex = DUPLEX_UNKNOWN;
+            get_speed_duplex(rec->c_nicd[i]);
+        } else {
+            rec->c_nicd[i]->speed = rec->p_nicd[i]->speed;
+            rec->c_nicd[i]->duplex = rec->p_nicd[i]->duplex;
         }
     }
 
-    noecho();
-    cbreak();
-    nodelay(window, TRUE);
-    keypad(window, FALSE);
+    /* postgres stats */
+    get_pg_stats(conn, screen, &rec->pg_stats[curr]);
+    sample_record_contexts(rec, screen, conn);
+}
+
+/*
+ ********************************************************* record function **
+ * Take results of all contexts queries. Contexts which queries fail (e.g.
+ * pg_stat_statements isn't installed) are disabled.
+ *
+ * IN:
+ * @rec             Recorder state.
+ * @screen          Screen which connection is recorded.
+ * @conn            Recorded connection.
+ ****************************************************************************
+ */
+void sample_record_contexts(struct record_s * rec, struct screen_s * screen, PGconn * conn)
+{
+    char errmsg[ERRSIZE];
+    PGresult * res;
+    unsigned int i;
+    bool canceled;
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        rec->sampled[i] = false;
+        /* fleet overview needs all connections, only one is recorded */
+        if (i == pg_fleet || rec->disabled[i] || PQstatus(conn) != CONNECTION_OK)
+            continue;
+        /* processes of remote host aren't seen, its backends aren't recorded */
+        if (i == pg_stat_backends && screen->pg_special.pg_is_local == false) {
+            rec->disabled[i] = true;
+            mreport(false, msg_warning, "WARNING: context %u isn't recorded: postgres isn't local.\n", i);
+            continue;
+        }
+
+        screen->current_context = i;
+        if (send_context_query(conn, screen, errmsg) == false
+                || (res = finish_context_query(conn, screen, errmsg, &canceled)) == NULL) {
+            /* lost connection is restored later, other errors repeat on each sample */
+            if (PQstatus(conn) == CONNECTION_OK) {
+                rec->disabled[i] = true;
+                mreport(false, msg_warning, "WARNING: context %u isn't recorded: %s\n", i, errmsg);
+            }
+            continue;
+        }
+
+        rec->c_snaps[i]->ts = get_monotonic_time();
+        pgrescpy(rec->c_snaps[i], res, screen);
+        PQclear(res);
+        rec->sampled[i] = true;
+    }
 }
 
 /*
- ****************************************************** key-press function **
- * Change pg_stat_activity long queries min age
+ ********************************************************* record function **
+ * Zero previous sample before keyframe, so keyframe deltas are taken from
+ * zero. Devices lists and snapshots are written entirely.
  *
  * IN:
- * @window              Ncurses window where msg will be printed.
- * @screen              Current screen.
+ * @rec             Recorder state.
  ****************************************************************************
  */
-void change_min_age(WINDOW * window, struct screen_s * screen, PGresult *res, bool *first_iter)
+void reset_record_prev(struct record_s * rec)
 {
-    if (screen->current_context != pg_stat_activity_long) {
-        wprintw(window, "Long query min age is not allowed here.");
-        return;
-    }
-
-    unsigned int hour, min, sec;
-    bool with_esc;
-    char min_age[XS_BUF_LEN],
-         msg[] = "Enter new min age, format: HH:MM:SS[.NN]: ";
-
-    cmd_readline(window, msg, strlen(msg), &with_esc, min_age, sizeof(min_age), true);
-    if (strlen(min_age) != 0 && with_esc == false) {
-        if ((sscanf(min_age, "%u:%u:%u", &hour, &min, &sec)) == 0 || (hour > 23 || min > 59 || sec > 59)) {
-            wprintw(window, "Nothing to do. Failed read or invalid value.");
-        } else {
-	    snprintf(screen->pg_stat_activity_min_age, sizeof(screen->pg_stat_activity_min_age), "%s", min_age);
-        }
-    } else if (strlen(min_age) == 0 && with_esc == false ) {
-        wprintw(window, "Nothing to do. Leave min age %s", screen->pg_stat_activity_min_age);
-    }
-   
-    PQclear(res);
-    *first_iter = true;
+    unsigned int prev = !rec->curr;
+
+    rec->uptime[prev] = rec->uptime0[prev] = 0;
+    memset(rec->cpu[prev], 0, sizeof(rec->cpu[prev]));
+    memset(rec->la[prev], 0, sizeof(rec->la[prev]));
+    memset(&rec->mem[prev], 0, STATS_MEM_SIZE);
+    memset(&rec->pg_stats[prev], 0, sizeof(struct pg_stat_s));
+    rec->ios_names = rec->nicd_names = true;
+    memset(rec->recorded, 0, sizeof(rec->recorded));
 }
 
 /*
- ******************************************************** routine function **
- * Clear single connection options.
+ ********************************************************* record function **
+ * Encode current sample as frame and append it to time-series file. 
+ * Every RECORD_KEYFRAME_EVERY frame is keyframe, it's written entirely and 
+ * its offset is written into index. After writing, current sample becomes
+ * previous one.
  *
  * IN:
- * @screens         Screens array.
- * @i               Index of entry in conn_opts array which should cleared.
+ * @rec             Recorder state.
  ****************************************************************************
  */
-void clear_screen_connopts(struct screen_s * screens[], unsigned int i)
+void write_record_frame(struct record_s * rec)
 {
-    screens[i]->host[0] = '\0';
-    screens[i]->port[0] = '\0';
-    screens[i]->user[0] = '\0';
-    screens[i]->dbname[0] = '\0';
-    screens[i]->password[0] = '\0';
-    screens[i]->conninfo[0] = '\0';
-    screens[i]->conn_used = false;
+    struct record_buf_s * buf = &rec->buf;
+    unsigned int i, curr = rec->curr;
+    bool keyframe = (rec->frames == 0);
+    struct timespec now;
+    long long wall;
+    off_t offset;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    wall = (long long) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+    /* keyframe doesn't depend on previous frames, its deltas are taken from zero */
+    if (keyframe)
+        reset_record_prev(rec);
+
+    buf->used = 0;
+    record_put_fixed(buf, 0, 4);                        /* frame length, set below */
+    record_put_byte(buf, keyframe ? frame_keyframe : frame_delta);
+    record_put_fixed(buf, wall, 8);
+    record_put_double(buf, get_monotonic_time());
+
+    record_put_byte(buf, sec_cpu);
+    record_put_svarint(buf, (long long) rec->uptime[curr] - (long long) rec->uptime[!curr]);
+    record_put_svarint(buf, (long long) rec->uptime0[curr] - (long long) rec->uptime0[!curr]);
+    record_put_cpu(buf, &rec->cpu[curr][0], &rec->cpu[!curr][0]);
+    record_put_cpu(buf, &rec->cpu[curr][1], &rec->cpu[!curr][1]);
+    for (i = 0; i < 3; i++)
+        record_put_svarint(buf, rec->la[curr][i] - rec->la[!curr][i]);
+
+    record_put_byte(buf, sec_mem);
+    record_put_mem(buf, &rec->mem[curr], &rec->mem[!curr]);
+
+    record_put_byte(buf, sec_pgstat);
+    record_put_pgstat(buf, &rec->pg_stats[curr], &rec->pg_stats[!curr]);
+
+    record_put_byte(buf, sec_iostat);
+    record_put_iostat(buf, rec->c_ios, rec->p_ios, rec->bdev, rec->ios_names);
+
+    record_put_byte(buf, sec_nicstat);
+    record_put_nicstat(buf, rec->c_nicd, rec->p_nicd, rec->idev, rec->nicd_names);
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        if (rec->sampled[i] == false)
+            continue;
+        record_put_byte(buf, sec_context);
+        record_put_varint(buf, i);
+        record_put_snapshot(buf, rec->c_snaps[i], rec->recorded[i] ? rec->p_snaps[i] : NULL);
+    }
+    record_put_byte(buf, sec_end);
+
+    /* length doesn't include itself */
+    for (i = 0; i < 4; i++)
+        buf->data[i] = ((buf->used - 4) >> (8 * i)) & 0xFF;
+
+    offset = ftello(rec->fp);
+    if (fwrite(buf->data, 1, buf->used, rec->fp) != buf->used || fflush(rec->fp) != 0) {
+        mreport(true, msg_fatal, "FATAL: write to stats record failed: %s.\n", strerror(errno));
+    }
+    /* index points only to completely written frames */
+    if (keyframe)
+        write_record_index(rec, wall, offset);
+
+    rec->frames = (rec->frames + 1) % RECORD_KEYFRAME_EVERY;
+    shift_record_sample(rec);
 }
 
 /*
- ******************************************************** routine function **
- * Shift screens when current screen closes.
+ ********************************************************* record function **
+ * Current sample becomes previous, its memory is reused on next sample.
  *
  * IN:
- * @screens         Screens array.
- * @conns           Connections array.
- * @i               Index of closed console.
- *
- * RETURNS:
- * Array of screens without closed connection.
+ * @rec             Recorder state.
  ****************************************************************************
  */
-void shift_screens(struct screen_s * screens[], PGconn * conns[], unsigned int i)
+void shift_record_sample(struct record_s * rec)
 {
-    while (screens[i + 1]->conn_used != false) {
-        snprintf(screens[i]->host, sizeof(screens[i]->host), "%s", screens[i + 1]->host);
-        snprintf(screens[i]->port, sizeof(screens[i]->port), "%s", screens[i + 1]->port);
-        snprintf(screens[i]->user, sizeof(screens[i]->user), "%s", screens[i + 1]->user);
-        snprintf(screens[i]->dbname, sizeof(screens[i]->dbname), "%s", screens[i + 1]->dbname);
-        snprintf(screens[i]->password, sizeof(screens[i]->password), "%s", screens[i + 1]->password);
-        snprintf(screens[i]->pg_special.pg_version_num, sizeof(screens[i]->pg_special.pg_version_num), "%s",
-		screens[i + 1]->pg_special.pg_version_num);
-        snprintf(screens[i]->pg_special.pg_version, sizeof(screens[i]->pg_special.pg_version), "%s",
-		screens[i + 1]->pg_special.pg_version);
-        screens[i]->subscreen =        screens[i + 1]->subscreen;
-        snprintf(screens[i]->log_path, sizeof(screens[i]->log_path), "%s", screens[i + 1]->log_path);
-        screens[i]->log_fd =            screens[i + 1]->log_fd;
-        screens[i]->current_context =   screens[i + 1]->current_context;
-        snprintf(screens[i]->pg_stat_activity_min_age, sizeof(screens[i]->pg_stat_activity_min_age), "%s",
-		screens[i + 1]->pg_stat_activity_min_age);
-        screens[i]->signal_options =    screens[i + 1]->signal_options;
-        screens[i]->pg_stat_sys =       screens[i + 1]->pg_stat_sys;
+    struct iodata_s ** ios;
+    struct nicdata_s ** nicd;
+    struct snapshot_s * snap;
+    unsigned int i;
 
-        conns[i] = conns[i + 1];
-        i++;
-        if (i == MAX_SCREEN - 1)
-            break;
+    rec->curr ^= 1;
+    ios = rec->p_ios;
+    rec->p_ios = rec->c_ios;
+    rec->c_ios = ios;
+    nicd = rec->p_nicd;
+    rec->p_nicd = rec->c_nicd;
+    rec->c_nicd = nicd;
+    rec->ios_names = rec->nicd_names = false;
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        rec->recorded[i] = rec->sampled[i];
+        if (rec->sampled[i]) {
+            snap = rec->p_snaps[i];
+            rec->p_snaps[i] = rec->c_snaps[i];
+            rec->c_snaps[i] = snap;
+        }
     }
-    clear_screen_connopts(screens, i);
 }
 
 /*
- ****************************************************** key press function **
- * Open new one connection.
+ ********************************************************* record function **
+ * Headless record mode: stats are sampled every second and appended to the
+ * time-series file until SIGINT or SIGTERM is received. ncurses isn't used,
+ * so it can run as a service. Lost connection is restored on each sample.
  *
  * IN:
- * @window          Window where result is printed.
- * @screen          Current screen.
- *
- * OUT:
- * @conns           Array of connections.
- * @screen          Connections options array.
- * @console_index   Index of screen (for internal usage).
- *
- * RETURNS:
- * Add connection into conns array and return new console index.
+ * @args            Input arguments with time-series file path.
+ * @screen          Screen which connection is recorded.
+ * @conn            Recorded connection.
  ****************************************************************************
  */
-unsigned int add_connection(WINDOW * window, struct screen_s * screens[],
-                PGconn * conns[], unsigned int console_index)
+void record_stats(struct args_s * args, struct screen_s * screen, PGconn * conn)
 {
-    unsigned int i;
-    char params[CONNINFO_MAXLEN],
-         msg[] = "Enter new connection parameters, format \"host port username dbname\": ",
-         msg2[] = "Required password: ";
-    bool with_esc, with_esc2;
-    
-    for (i = 0; i < MAX_SCREEN; i++) {
-        /* search free screen */
-        if (screens[i]->conn_used == false) {
+    struct record_s rec;
+    double started, elapsed;
 
-            /* read user input */
-            cmd_readline(window, msg, strlen(msg), &with_esc, params, sizeof(params), true);
-            if (strlen(params) != 0 && with_esc == false) {
-                /* parse user input */
-                if ((sscanf(params, "%s %s %s %s",
-                    screens[i]->host,   screens[i]->port,
-                    screens[i]->user,   screens[i]->dbname)) == 0) {
-                        wprintw(window, "Nothing to do. Failed read or invalid value.");
-                        break;
-                }
-                /* setup screen conninfo settings */
-                screens[i]->conn_used = true;
-		snprintf(screens[i]->conninfo, sizeof(screens[i]->conninfo),
-			 "host=%s port=%s user=%s dbname=%s",
-			 screens[i]->host, screens[i]->port,  screens[i]->user, screens[i]->dbname);
+    headless = true;
+    init_record(&rec, args->record_file);
+    mreport(false, msg_notice, "Recording stats into %s.\n", args->record_file);
+    fflush(stdout);
 
-                /* establish new connection */
-                conns[i] = PQconnectdb(screens[i]->conninfo);
-                /* if password required, ask user for password */
-                if ( PQstatus(conns[i]) == CONNECTION_BAD && PQconnectionNeedsPassword(conns[i]) == 1) {
-                    PQfinish(conns[i]);
-                    wclear(window);
+    while (stop_requested == 0) {
+        started = get_monotonic_time();
 
-                    /* read password and add to conn options */
-                    cmd_readline(window, msg2, strlen(msg2), &with_esc2, params, sizeof(params), false);
-                    if (strlen(params) != 0 && with_esc2 == false) {
-                        snprintf(screens[i]->password, sizeof(screens[i]->password), "%s", params);
-			snprintf(screens[i]->conninfo + strlen(screens[i]->conninfo),
-				 sizeof(screens[i]->conninfo) - strlen(screens[i]->conninfo), " password=%s", screens[i]->password);
-                        /* try establish connection and finish work */
-                        conns[i] = PQconnectdb(screens[i]->conninfo);
-                        if ( PQstatus(conns[i]) == CONNECTION_BAD ) {
-                            wclear(window);
-                            wprintw(window, "Nothing to fo. Connection failed.");
-                            PQfinish(conns[i]);
-                            clear_screen_connopts(screens, i);
-                        } else {
-                            wclear(window);
-                            wprintw(window, "Successfully connected.");
-                            console_index = screens[i]->screen;
-                            get_pg_special(conns[i], screens[i]);
-                        }
-                    } else if (with_esc) {
-                        clear_screen_connopts(screens, i);
-                    }
-                /* finish work if connection establish failed */
-                } else if ( PQstatus(conns[i]) == CONNECTION_BAD ) {
-                    wprintw(window, "Nothing to do. Connection failed.");
-                    PQfinish(conns[i]);
-                    clear_screen_connopts(screens, i);
-                /* if no error occured, print about success and finish work */
-                } else {
-                    wclear(window);
-                    wprintw(window, "Successfully connected.");
-                    console_index = screens[i]->screen;
-                    get_pg_special(conns[i], screens[i]);
-                }
-                break;
-            /* finish work if user input empty or cancelled */
-            } else if (strlen(params) == 0 && with_esc == false) {
-                wprintw(window, "Nothing to do.");
-                break;
-            } else 
-                break;
-        /* also finish work if no available screens */
-        } else if (i == MAX_SCREEN - 1) {
-            wprintw(window, "No free consoles.");
+        if (PQstatus(conn) == CONNECTION_BAD) {
+            PQreset(conn);
+            if (PQstatus(conn) == CONNECTION_OK)
+                init_connection(conn, screen);
         }
+
+        sample_record(&rec, screen, conn);
+        write_record_frame(&rec);
+
+        /* samples are taken with fixed rate, sampling time is subtracted from sleep */
+        elapsed = (get_monotonic_time() - started) * 1000000;
+        if (elapsed < DEFAULT_INTERVAL && stop_requested == 0)
+            usleep(DEFAULT_INTERVAL - elapsed);
     }
 
-    return console_index;
+    fclose(rec.fp);
+    fclose(rec.idx);
+    PQfinish(conn);
+    exit(EXIT_SUCCESS);
 }
 
 /*
- ***************************************************** key press functions **
- * Close current connection.
+ ********************************************************* record function **
+ * Headless export mode: results of all contexts are sampled every second,
+ * rates are calculated as in console and rows are streamed into csv or json
+ * sink until SIGINT or SIGTERM is received. Rows of one sample are written
+ * together, so output is written by large chunks.
  *
  * IN:
- * @window          Window where result is printed.
- * @screens         Screens array.
- *
- * OUT:
- * @conns           Array of connections.
- * @screens         Modified screens array.
- * @first_iter      Reset stats counters.
- *
- * RETURNS:
- * Close current connection (remove from conns array) and return prvious
- * console index.
+ * @args            Input arguments with output format and file.
+ * @screen          Screen which connection is exported.
+ * @conn            Exported connection.
  ****************************************************************************
  */
-unsigned int close_connection(WINDOW * window, struct screen_s * screens[],
-                PGconn * conns[], unsigned int console_index, bool * first_iter)
+void export_stats(struct args_s * args, struct screen_s * screen, PGconn * conn)
 {
-    unsigned int i = console_index;
-    PQfinish(conns[console_index]);
+    struct record_s rec;
+    struct sink_s sink;
+    struct snapshot_s * snap;
+    double started, elapsed;
+    unsigned int i;
 
-    wprintw(window, "Close current connection.");
-    if (i == 0) {                               /* first active console */
-        if (screens[i + 1]->conn_used) {
-        shift_screens(screens, conns, i);
-        } else {
-            wrefresh(window);
-            endwin();
-            exit(EXIT_SUCCESS);
+    headless = true;
+    memset(&rec, 0, sizeof(struct record_s));
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        rec.c_snaps[i] = init_snapshot();
+        rec.p_snaps[i] = init_snapshot();
+    }
+    init_sink(&sink, (strcmp(args->output_format, "csv") == 0) ? sink_csv : sink_json, NULL, args->output_file);
+
+    while (stop_requested == 0) {
+        started = get_monotonic_time();
+
+        if (PQstatus(conn) == CONNECTION_BAD) {
+            PQreset(conn);
+            if (PQstatus(conn) == CONNECTION_OK)
+                init_connection(conn, screen);
         }
-    } else if (i == (MAX_SCREEN - 1)) {         /* last possible active console */
-        clear_screen_connopts(screens, i);
-        console_index = console_index - 1;
-    } else {                                    /* middle active console */
-        if (screens[i + 1]->conn_used) {
-            shift_screens(screens, conns, i);
-        } else {
-            clear_screen_connopts(screens, i);
-            console_index = console_index - 1;
+
+        sample_record_contexts(&rec, screen, conn);
+
+        /* contexts get rates since the second sample */
+        for (i = 0; i < TOTAL_CONTEXTS; i++) {
+            if (rec.sampled[i] == false) {
+                rec.recorded[i] = false;
+                continue;
+            }
+            if (rec.recorded[i]) {
+                diff_arrays(rec.p_snaps[i], rec.c_snaps[i]);
+                screen->current_context = i;
+                write_sink_snapshot(&sink, rec.c_snaps[i], screen, i, time(NULL));
+            }
+            snap = rec.p_snaps[i];
+            rec.p_snaps[i] = rec.c_snaps[i];
+            rec.c_snaps[i] = snap;
+            rec.recorded[i] = true;
         }
+        flush_sink(&sink);
+
+        /* samples are taken with fixed rate, sampling time is subtracted from sleep */
+        elapsed = (get_monotonic_time() - started) * 1000000;
+        if (elapsed < DEFAULT_INTERVAL && stop_requested == 0)
+            usleep(DEFAULT_INTERVAL - elapsed);
     }
 
-    *first_iter = true;
-    return console_index;
+    flush_sink(&sink);
+    close(sink.fd);
+    PQfinish(conn);
+    exit(EXIT_SUCCESS);
 }
 
 /*
- ****************************************************** key press function **
- * Write connection information into ~/.pgcenterrc.
+ ******************************************************** metrics function **
+ * Append formatted text to metrics buffer, buffer grows when it's full.
  *
  * IN:
- * @window          Window where result will be printed.
- * @screens         Array of screens options.
- * @args            Struct where stored input args.
+ * @buf             Metrics buffer.
+ * @fmt             Format string and arguments.
  ****************************************************************************
  */
-void write_pgcenterrc(WINDOW * window, struct screen_s * screens[], PGconn * conns[], struct args_s * args)
+void add_metrics(struct metrics_buf_s * buf, const char * fmt, ...)
 {
-    unsigned int i = 0;
-    FILE *fp;
-    static char pgcenterrc_path[PATH_MAX];
-    struct passwd *pw = getpwuid(getuid());
-    struct stat statbuf;
+    va_list ap;
+    int len;
 
-    /* 
-     * write conninfo into file which specified in --file=FILENAME,
-     * or use default ~/.pgcenterrc
-     */
-    if (strlen(args->connfile) != 0)
-        snprintf(pgcenterrc_path, sizeof(pgcenterrc_path), "%s", args->connfile);
-    else {
-        snprintf(pgcenterrc_path, sizeof(pgcenterrc_path), "%s/%s", pw->pw_dir, PGCENTERRC_FILE);
-    }
-
-    if ((fp = fopen(pgcenterrc_path, "w")) != NULL ) {
-        for (i = 0; i < MAX_SCREEN; i++) {
-            if (screens[i]->conn_used) {
-                fprintf(fp, "%s:%s:%s:%s:%s\n",
-                        PQhost(conns[i]), PQport(conns[i]),
-                        PQdb(conns[i]), PQuser(conns[i]),
-                        PQpass(conns[i]));
-            }
+    while (1) {
+        va_start(ap, fmt);
+        len = vsnprintf(buf->data + buf->used, buf->size - buf->used, fmt, ap);
+        va_end(ap);
+        if (len < 0) {
+            mreport(true, msg_fatal, "FATAL: formatting of metrics failed.\n");
         }
-        wprintw(window, "Wrote configuration to '%s'", pgcenterrc_path);
-
-        fclose(fp);
-
-        stat(pgcenterrc_path, &statbuf);
-        if (statbuf.st_mode & (S_IRWXG | S_IRWXO)) {
-            chmod(pgcenterrc_path, S_IRUSR|S_IWUSR);
+        if ((size_t) len < buf->size - buf->used)
+            break;
+        buf->size *= 2;
+        if ((buf->data = realloc(buf->data, buf->size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for metrics failed.\n");
         }
-    } else {
-        wprintw(window, "Failed to write configuration into '%s'", pgcenterrc_path);
+    }
+    buf->used += len;
+}
+
+/*
+ ******************************************************** metrics function **
+ * Append label value, backslashes, quotes and line breaks are escaped.
+ *
+ * IN:
+ * @buf             Metrics buffer.
+ * @value           Label value.
+ ****************************************************************************
+ */
+void add_metrics_label(struct metrics_buf_s * buf, const char * value)
+{
+    for (; *value != '\0'; value++) {
+        if (*value == '\\' || *value == '"')
+            add_metrics(buf, "\\%c", *value);
+        else if (*value == '\n')
+            add_metrics(buf, "\\n");
+        else
+            add_metrics(buf, "%c", *value);
     }
 }
 
 /*
- ****************************************************** key press function **
- * Show the current configuration settings, one per row.
+ ******************************************************** metrics function **
+ * Render sample in Prometheus text exposition format. Counters are exported
+ * as they are, rates are calculated by Prometheus.
  *
  * IN:
- * @window      Window where result will be printed.
- * @conn        Current postgres connection.
+ * @rec             Sampled stats.
+ * @up              Postgres connection is alive.
+ *
+ * OUT:
+ * @buf             Metrics buffer.
  ****************************************************************************
  */
-void show_config(WINDOW * window, PGconn * conn)
+void render_metrics(struct metrics_buf_s * buf, struct record_s * rec, bool up)
 {
-    unsigned int  row_count, col_count, row, col, i;
-    FILE * fpout;
-    PGresult * res;
-    char errmsg[ERRSIZE],
-         pager[S_BUF_LEN] = "";
-    struct colAttrs * columns;
+    static const char * cpu_modes[] = { "user", "nice", "system", "idle", "iowait",
+                                        "steal", "irq", "softirq", "guest", "guest_nice" };
+    static const char * mem_types[] = { "total", "free", "used", "swap_total", "swap_free",
+                                        "swap_used", "cached", "buffers", "dirty", "writeback", "slab" };
+    unsigned int i, j, curr = rec->curr;
+    struct cpu_s * cpu = &rec->cpu[curr][0];
+    unsigned long long cpu_values[] = { cpu->cpu_user, cpu->cpu_nice, cpu->cpu_sys, cpu->cpu_idle,
+        cpu->cpu_iowait, cpu->cpu_steal, cpu->cpu_hardirq, cpu->cpu_softirq, cpu->cpu_guest, cpu->cpu_guest_nice };
+    struct mem_s * mem = &rec->mem[curr];
+    unsigned long long mem_values[] = { mem->mem_total, mem->mem_free, mem->mem_used, mem->swap_total,
+        mem->swap_free, mem->swap_used, mem->cached, mem->buffers, mem->dirty, mem->writeback, mem->slab };
+    struct pg_stat_s * pg = &rec->pg_stats[curr];
+    struct snapshot_s * snap = rec->c_snaps[pg_stat_database];
+    struct iodata_s * io;
+    struct nicdata_s * nic;
+
+    buf->used = 0;
+    add_metrics(buf, "# TYPE pgcenter_up gauge\npgcenter_up %d\n", up);
+
+    /* system stats, cpu time is in jiffies and memory is in megabytes */
+    add_metrics(buf, "# TYPE pgcenter_cpu_seconds_total counter\n");
+    for (i = 0; i < ARRAY_SIZE(cpu_modes); i++)
+        add_metrics(buf, "pgcenter_cpu_seconds_total{mode=\"%s\"} %.2f\n", cpu_modes[i], (double) cpu_values[i] / HZ);
+    add_metrics(buf, "# TYPE pgcenter_load_average gauge\n");
+    add_metrics(buf, "pgcenter_load_average{period=\"1m\"} %.2f\npgcenter_load_average{period=\"5m\"} %.2f\n"
+            "pgcenter_load_average{period=\"15m\"} %.2f\n",
+            rec->la[curr][0] / 100.0, rec->la[curr][1] / 100.0, rec->la[curr][2] / 100.0);
+    add_metrics(buf, "# TYPE pgcenter_memory_bytes gauge\n");
+    for (i = 0; i < ARRAY_SIZE(mem_types); i++)
+        add_metrics(buf, "pgcenter_memory_bytes{type=\"%s\"} %llu\n", mem_types[i], mem_values[i] * 1024 * 1024);
+
+    add_metrics(buf, "# TYPE pgcenter_disk_reads_completed_total counter\n"
+            "# TYPE pgcenter_disk_reads_merged_total counter\n"
+            "# TYPE pgcenter_disk_read_bytes_total counter\n"
+            "# TYPE pgcenter_disk_read_time_seconds_total counter\n"
+            "# TYPE pgcenter_disk_writes_completed_total counter\n"
+            "# TYPE pgcenter_disk_writes_merged_total counter\n"
+            "# TYPE pgcenter_disk_written_bytes_total counter\n"
+            "# TYPE pgcenter_disk_write_time_seconds_total counter\n"
+            "# TYPE pgcenter_disk_io_now gauge\n"
+            "# TYPE pgcenter_disk_io_time_seconds_total counter\n"
+            "# TYPE pgcenter_disk_io_time_weighted_seconds_total counter\n");
+    for (i = 0; i < rec->bdev; i++) {
+        io = rec->c_ios[i];
+        add_metrics(buf, "pgcenter_disk_reads_completed_total{device=\"%s\"} %lu\n", io->devname, io->r_completed);
+        add_metrics(buf, "pgcenter_disk_reads_merged_total{device=\"%s\"} %lu\n", io->devname, io->r_merged);
+        add_metrics(buf, "pgcenter_disk_read_bytes_total{device=\"%s\"} %llu\n", io->devname, io->r_sectors * 512ULL);
+        add_metrics(buf, "pgcenter_disk_read_time_seconds_total{device=\"%s\"} %.3f\n", io->devname, io->r_spent / 1000.0);
+        add_metrics(buf, "pgcenter_disk_writes_completed_total{device=\"%s\"} %lu\n", io->devname, io->w_completed);
+        add_metrics(buf, "pgcenter_disk_writes_merged_total{device=\"%s\"} %lu\n", io->devname, io->w_merged);
+        add_metrics(buf, "pgcenter_disk_written_bytes_total{device=\"%s\"} %llu\n", io->devname, io->w_sectors * 512ULL);
+        add_metrics(buf, "pgcenter_disk_write_time_seconds_total{device=\"%s\"} %.3f\n", io->devname, io->w_spent / 1000.0);
+        add_metrics(buf, "pgcenter_disk_io_now{device=\"%s\"} %lu\n", io->devname, io->io_in_progress);
+        add_metrics(buf, "pgcenter_disk_io_time_seconds_total{device=\"%s\"} %.3f\n", io->devname, io->t_spent / 1000.0);
+        add_metrics(buf, "pgcenter_disk_io_time_weighted_seconds_total{device=\"%s\"} %.3f\n", io->devname, io->t_weighted / 1000.0);
+    }
 
-    if (getenv("PAGER") != NULL)
-        snprintf(pager, sizeof(pager), "%s", getenv("PAGER"));
-    else
-        snprintf(pager, sizeof(pager), "%s", DEFAULT_PAGER);
-    if ((fpout = popen(pager, "w")) == NULL) {
-        wprintw(window, "Do nothing. Failed to open pipe to %s", pager);
-        return;
+    add_metrics(buf, "# TYPE pgcenter_network_receive_bytes_total counter\n"
+            "# TYPE pgcenter_network_receive_packets_total counter\n"
+            "# TYPE pgcenter_network_receive_errors_total counter\n"
+            "# TYPE pgcenter_network_transmit_bytes_total counter\n"
+            "# TYPE pgcenter_network_transmit_packets_total counter\n"
+            "# TYPE pgcenter_network_transmit_errors_total counter\n"
+            "# TYPE pgcenter_network_collisions_total counter\n"
+            "# TYPE pgcenter_network_saturation_total counter\n"
+            "# TYPE pgcenter_network_speed_bits_per_second gauge\n");
+    for (i = 0; i < rec->idev; i++) {
+        nic = rec->c_nicd[i];
+        add_metrics(buf, "pgcenter_network_receive_bytes_total{interface=\"%s\"} %lu\n", nic->ifname, nic->rbytes);
+        add_metrics(buf, "pgcenter_network_receive_packets_total{interface=\"%s\"} %lu\n", nic->ifname, nic->rpackets);
+        add_metrics(buf, "pgcenter_network_receive_errors_total{interface=\"%s\"} %lu\n", nic->ifname, nic->ierr);
+        add_metrics(buf, "pgcenter_network_transmit_bytes_total{interface=\"%s\"} %lu\n", nic->ifname, nic->wbytes);
+        add_metrics(buf, "pgcenter_network_transmit_packets_total{interface=\"%s\"} %lu\n", nic->ifname, nic->wpackets);
+        add_metrics(buf, "pgcenter_network_transmit_errors_total{interface=\"%s\"} %lu\n", nic->ifname, nic->oerr);
+        add_metrics(buf, "pgcenter_network_collisions_total{interface=\"%s\"} %lu\n", nic->ifname, nic->coll);
+        add_metrics(buf, "pgcenter_network_saturation_total{interface=\"%s\"} %lu\n", nic->ifname, nic->sat);
+        add_metrics(buf, "pgcenter_network_speed_bits_per_second{interface=\"%s\"} %ld\n", nic->ifname, nic->speed);
     }
 
-    /* escape from ncurses mode */
-    refresh();
-    endwin();
+    if (up == false)
+        return;
 
-    res = do_query(conn, PG_SETTINGS_QUERY, errmsg);
-    row_count = PQntuples(res);
-    col_count = PQnfields(res);
-    columns = init_colattrs(col_count);
-    calculate_width(columns, res, NULL, NULL, row_count, col_count);
-    
-    fprintf(fpout, " PostgreSQL configuration: %i rows\n", row_count);
-    /* print column names */
-    for (col = 0, i = 0; col < col_count; col++, i++)
-        fprintf(fpout, " %-*s", columns[i].width, PQfname(res, col));
-    fprintf(fpout, "\n\n");
-    /* print rows */
-    for (row = 0; row < row_count; row++) {
-        for (col = 0, i = 0; col < col_count; col++, i++)
-            fprintf(fpout, " %-*s", columns[i].width, PQgetvalue(res, row, col));
-        fprintf(fpout, "\n");
+    /* postgres activity, autovacuum and statements stats of sysstat screen */
+    add_metrics(buf, "# TYPE pgcenter_pg_backends gauge\n");
+    add_metrics(buf, "pgcenter_pg_backends{state=\"idle\"} %u\npgcenter_pg_backends{state=\"idle_in_transaction\"} %u\n"
+            "pgcenter_pg_backends{state=\"active\"} %u\npgcenter_pg_backends{state=\"waiting\"} %u\n"
+            "pgcenter_pg_backends{state=\"other\"} %u\n",
+            pg->i_count, pg->x_count, pg->a_count, pg->w_count, pg->o_count);
+    add_metrics(buf, "# TYPE pgcenter_pg_autovacuum_workers gauge\npgcenter_pg_autovacuum_workers %u\n", pg->av_count);
+    add_metrics(buf, "# TYPE pgcenter_pg_autovacuum_wraparound_workers gauge\npgcenter_pg_autovacuum_wraparound_workers %u\n", pg->avw_count);
+    add_metrics(buf, "# TYPE pgcenter_pg_manual_vacuums gauge\npgcenter_pg_manual_vacuums %u\n", pg->mv_count);
+    if (pg->pgss_ok)
+        add_metrics(buf, "# TYPE pgcenter_pg_statements_calls_total counter\npgcenter_pg_statements_calls_total %lli\n", pg->total_calls);
+
+    /* pg_stat_database counters, metrics are named by context columns */
+    if (rec->sampled[pg_stat_database] == false)
+        return;
+    for (j = 0; j < snap->n_cols; j++) {
+        if (snap->cols[j].type != col_counter)
+            continue;
+        add_metrics(buf, "# TYPE pgcenter_pg_stat_database_%s_total counter\n", snap->cols[j].name);
+        for (i = 0; i < snap->n_rows; i++) {
+            add_metrics(buf, "pgcenter_pg_stat_database_%s_total{datname=\"", snap->cols[j].name);
+            add_metrics_label(buf, SNAPSHOT_VALUE(snap, i, 0));
+            add_metrics(buf, "\"} %lli\n", snap->cols[j].counters[i]);
+        }
     }
-
-    PQclear(res);
-    pclose(fpout);
-    free(columns);
-    
-    /* return to ncurses mode */
-    refresh();
 }
 
 /*
- ****************************************************** key press function **
- * Reload postgres
+ ******************************************************** metrics function **
+ * Publish rendered back buffer. It's exchanged with the middle buffer, so
+ * scraper takes it without waiting for collector, and collector gets
+ * buffer which isn't read by scraper.
  *
  * IN:
- * @window      Window where resilt will be printed.
- * @conn        Current postgres connection.
+ * @m               Metrics state.
  ****************************************************************************
  */
-void reload_conf(WINDOW * window, PGconn * conn)
+void publish_metrics(struct metrics_s * m)
 {
-    PGresult * res;
-    bool with_esc;
-    char errmsg[ERRSIZE],
-         confirmation[1],
-         msg[] = "Reload configuration files (y/n): ";
+    m->back = __atomic_exchange_n(&m->middle, m->back | METRICS_FRESH, __ATOMIC_ACQ_REL) & ~METRICS_FRESH;
+}
 
-    cmd_readline(window, msg, strlen(msg), &with_esc, confirmation, 1, true);
-    if (!strcmp(confirmation, "n") || !strcmp(confirmation, "N"))
-        wprintw(window, "Do nothing. Canceled.");
-    else if (!strcmp(confirmation, "y") || !strcmp(confirmation, "Y")) {
-        res = do_query(conn, PG_RELOAD_CONF_QUERY, errmsg);
-        if (res != NULL) {
-            wprintw(window, "Reload issued.");
-            PQclear(res);
-        } else {
-            wclear(window);
-            wprintw(window, "Reload failed. %s", errmsg);
-        }
-    } else if (strlen(confirmation) == 0 && with_esc == false) {
-        wprintw(window, "Do nothing. Nothing entered.");
-    } else if (with_esc) {
-        ;
-    } else 
-        wprintw(window, "Do nothing. Not confirmed.");
+/*
+ ******************************************************** metrics function **
+ * Take the latest published buffer for scraper. Previously taken buffer is
+ * used if nothing is published since then.
+ *
+ * IN:
+ * @m               Metrics state.
+ *
+ * RETURNS:
+ * Buffer with the latest metrics.
+ ****************************************************************************
+ */
+struct metrics_buf_s * take_metrics(struct metrics_s * m)
+{
+    if (__atomic_load_n(&m->middle, __ATOMIC_ACQUIRE) & METRICS_FRESH)
+        m->front = __atomic_exchange_n(&m->middle, m->front, __ATOMIC_ACQ_REL) & ~METRICS_FRESH;
+    return &m->bufs[m->front];
 }
 
 /*
- ******************************************************** routine function **
- * Get postgres listen_addresses and check is that local address or not.
+ ******************************************************** metrics function **
+ * Open listening socket of metrics endpoint.
  *
  * IN:
- * @screen       Connections options.
+ * @listen_addr     [ADDR:]PORT, local address is used by default.
  *
  * RETURNS:
- * Return true if listen_addresses is local and false if not.
+ * Listening socket.
  ****************************************************************************
  */
-bool check_pg_listen_addr(struct screen_s * screen, PGconn * conn)
+int open_metrics_listener(const char * listen_addr)
 {
-    /* an absoulute path means the unix socket is used and it is always local */
-    if (!strncmp(screen->host, "/", 1)
-	|| ((PQhost(conn)!= NULL) && !strncmp(PQhost(conn), "/", 1))
-	|| (PQstatus(conn) == CONNECTION_OK && PQhost(conn) == NULL)) {
-        return true;
+    char addr[S_BUF_LEN], * host = addr, * port;
+    struct addrinfo hints, * res;
+    int fd, err, on = 1;
+
+    snprintf(addr, sizeof(addr), "%s", listen_addr);
+    if ((port = strrchr(addr, ':')) != NULL) {
+        *port++ = '\0';
+        /* IPv6 address is enclosed in brackets */
+        if (host[0] == '[' && host[strlen(host) - 1] == ']') {
+            host[strlen(host) - 1] = '\0';
+            host++;
+        }
+    } else {
+        port = addr;
+        host = METRICS_DEFAULT_ADDR;
     }
 
-    struct ifaddrs *ifaddr, *ifa;
-    int family, s;
-    char host[NI_MAXHOST];
-    
-    if (getifaddrs(&ifaddr) == -1) {
-        freeifaddrs(ifaddr);
-        return false;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if ((err = getaddrinfo(strlen(host) > 0 ? host : NULL, port, &hints, &res)) != 0) {
+        mreport(true, msg_fatal, "FATAL: invalid listen address %s: %s.\n", listen_addr, gai_strerror(err));
     }
-    for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-        if (ifa->ifa_addr == NULL)
-            continue;
 
-        family = ifa->ifa_addr->sa_family;
+    if ((fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) == -1
+            || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1
+            || bind(fd, res->ai_addr, res->ai_addrlen) == -1
+            || listen(fd, METRICS_BACKLOG) == -1) {
+        mreport(true, msg_fatal, "FATAL: can't listen on %s: %s.\n", listen_addr, strerror(errno));
+    }
+    freeaddrinfo(res);
+    return fd;
+}
 
-        /* Check AF_INET* interface addresses */
-        if (family == AF_INET || family == AF_INET6) {
-            s = getnameinfo(ifa->ifa_addr,
-                            (family == AF_INET) ? sizeof(struct sockaddr_in) :
-                                                  sizeof(struct sockaddr_in6),
-                            host, NI_MAXHOST,
-                            NULL, 0, NI_NUMERICHOST);
-            if (s != 0) {
-                mreport(false, msg_warning,
-                        "WARNING: getnameinfo() failed: %s\n", gai_strerror(s));
-                return false;
-            }
-            if (!strcmp(host, screen->host)) {
-                freeifaddrs(ifaddr);
-                return true;
+/*
+ ******************************************************** metrics function **
+ * Serve scrapes of metrics endpoint. Each connection gets the latest
+ * published metrics and is closed, scrapes never query postgres. Slow
+ * clients are dropped by timeout.
+ *
+ * IN:
+ * @arg             Metrics state.
+ ****************************************************************************
+ */
+void * serve_metrics(void * arg)
+{
+    struct metrics_s * m = (struct metrics_s *) arg;
+    struct timeval tv = { METRICS_TIMEOUT, 0 };
+    char req[METRICS_REQUEST_LEN], hdr[M_BUF_LEN * 2];
+    struct metrics_buf_s * buf;
+    size_t used;
+    ssize_t n;
+    int fd, len;
+
+    while (1) {
+        if ((fd = accept(m->listen_fd, NULL, NULL)) == -1) {
+            /* errors like EMFILE persist until fds are freed, don't spin on them */
+            if (errno != EINTR)
+                usleep(METRICS_ACCEPT_PAUSE);
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        /* only request line is used, headers are read up to the empty line */
+        for (used = 0; used < sizeof(req) - 1; used += n) {
+            if ((n = recv(fd, req + used, sizeof(req) - 1 - used, 0)) <= 0)
+                break;
+            req[used + n] = '\0';
+            if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL) {
+                used += n;
                 break;
             }
         }
+        req[used] = '\0';
+
+        buf = take_metrics(m);
+        if (strncmp(req, "GET /metrics ", 13) != 0 && strncmp(req, "GET / ", 6) != 0)
+            len = snprintf(hdr, sizeof(hdr), "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        else if (buf->used == 0)
+            len = snprintf(hdr, sizeof(hdr), "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        else
+            len = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: %zu\r\nConnection: close\r\n\r\n", buf->used);
+
+        /* scraper might go away, it mustn't kill the daemon with SIGPIPE */
+        if (send(fd, hdr, len, MSG_NOSIGNAL) == len && strncmp(hdr + 9, "200", 3) == 0)
+            for (used = 0; used < buf->used; used += n)
+                if ((n = send(fd, buf->data + used, buf->used - used, MSG_NOSIGNAL)) <= 0)
+                    break;
+        close(fd);
     }
 
-    freeifaddrs(ifaddr);
-    return false;
+    return NULL;
 }
 
 /*
- ******************************************************** routine function **
- * Get GUC value from postgres config.
+ ******************************************************** metrics function **
+ * Daemon mode: system stats, sysstat screen postgres stats and
+ * pg_stat_database counters are sampled every second and published for
+ * metrics endpoint, which is served by separate thread.
  *
  * IN:
- * @window                  Window for printing errors if occurs.
- * @conn                    Current connection.
- * @config_option_name      Option name.
- *
- * OUT:
- * @config_option_value     Config option value or empty string.
+ * @args            Input arguments with listen address.
+ * @screen          Screen which connection is exported.
+ * @conn            Exported connection.
  ****************************************************************************
  */
-void get_conf_value(PGconn * conn, const char * config_option_name, char * config_option_value)
+void daemon_stats(struct args_s * args, struct screen_s * screen, PGconn * conn)
 {
-    PGresult * res;
-    char errmsg[ERRSIZE],
-         query[QUERY_MAXLEN];
+    static struct metrics_s m;
+    struct record_s rec;
+    pthread_t thread;
+    double started, elapsed;
+    unsigned int i;
 
-    snprintf(query, sizeof(query), "%s%s%s", PG_SETTINGS_SINGLE_OPT_P1, config_option_name, PG_SETTINGS_SINGLE_OPT_P2);
+    headless = true;
+    memset(&rec, 0, sizeof(struct record_s));
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        rec.c_snaps[i] = init_snapshot();
+        rec.p_snaps[i] = init_snapshot();
+        /* only pg_stat_database is exported */
+        rec.disabled[i] = (i != pg_stat_database);
+    }
 
-    res = do_query(conn, query, errmsg);
-    
-    if (PQntuples(res) != 0 && !strcmp(PQgetvalue(res, 0, 0), config_option_name))
-        snprintf(config_option_value, M_BUF_LEN, "%s", PQgetvalue(res, 0, 1));
-    else
-        config_option_value[0] = '\0';
-    
-    PQclear(res);
+    for (i = 0; i < 3; i++) {
+        m.bufs[i].size = METRICS_BUF_LEN;
+        if ((m.bufs[i].data = malloc(m.bufs[i].size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: malloc for metrics failed.\n");
+        }
+    }
+    m.back = 0;
+    m.middle = 1;
+    m.front = 2;
+    m.listen_fd = open_metrics_listener(args->listen);
+    if ((errno = pthread_create(&thread, NULL, serve_metrics, &m)) != 0) {
+        mreport(true, msg_fatal, "FATAL: can't start metrics thread: %s.\n", strerror(errno));
+    }
+    mreport(false, msg_notice, "Serving metrics on %s.\n", args->listen);
+    fflush(stdout);
+
+    while (stop_requested == 0) {
+        started = get_monotonic_time();
+
+        if (PQstatus(conn) == CONNECTION_BAD) {
+            PQreset(conn);
+            if (PQstatus(conn) == CONNECTION_OK)
+                init_connection(conn, screen);
+        }
+
+        sample_record(&rec, screen, conn);
+        render_metrics(&m.bufs[m.back], &rec, PQstatus(conn) == CONNECTION_OK);
+        publish_metrics(&m);
+        shift_record_sample(&rec);
+
+        /* samples are taken with fixed rate, sampling time is subtracted from sleep */
+        elapsed = (get_monotonic_time() - started) * 1000000;
+        if (elapsed < DEFAULT_INTERVAL && stop_requested == 0)
+            usleep(DEFAULT_INTERVAL - elapsed);
+    }
+
+    close(m.listen_fd);
+    PQfinish(conn);
+    exit(EXIT_SUCCESS);
 }
 
 /*
- ******************************************************** routine function **
- * Get postgres various information and save into screen opts.
+ ********************************************************* record function **
+ * Read single byte of the frame.
  *
  * IN:
- * @conn                    Current connection.
- * @screen                  Current screen.
+ * @cur             Frame cursor.
+ *
+ * RETURNS:
+ * Byte value, 0 if frame is truncated.
  ****************************************************************************
  */
-void get_pg_special(PGconn * conn, struct screen_s * screen)
+unsigned char record_read_byte(struct record_cursor_s * cur)
 {
-    PGresult * res;
-    char errmsg[ERRSIZE];
-    char av_max_workers[8];
-
-    /* get postgres version information */
-    get_conf_value(conn, GUC_SERVER_VERSION_NUM, screen->pg_special.pg_version_num);
-    get_conf_value(conn, GUC_SERVER_VERSION, screen->pg_special.pg_version);
-    if (strlen(screen->pg_special.pg_version_num) == 0)
-        snprintf(screen->pg_special.pg_version_num, sizeof(screen->pg_special.pg_version_num), "-.-.-");
-    if (strlen(screen->pg_special.pg_version) == 0)
-        snprintf(screen->pg_special.pg_version, sizeof(screen->pg_special.pg_version_num), "-.-.-");
-
-    /* pg_is_in_recovery() */
-    if ((res = do_query(conn, PG_IS_IN_RECOVERY_QUERY, errmsg)) != NULL) {
-        (!strcmp(PQgetvalue(res, 0, 0), "f"))
-	    ? (screen->pg_special.pg_is_in_recovery = false)
-	    : (screen->pg_special.pg_is_in_recovery = true);
-        PQclear(res);
+    if (cur->pos >= cur->len) {
+        cur->error = true;
+        return 0;
     }
-
-    /* get autovacuum_max_workers */
-    get_conf_value(conn, GUC_AV_MAX_WORKERS, av_max_workers);
-    (strlen(av_max_workers) == 0)
-	? (screen->pg_special.av_max_workers = 0)
-	: (screen->pg_special.av_max_workers = atoi(av_max_workers));
+    return cur->data[cur->pos++];
 }
 
 /*
- ****************************************************** key press function **
- * Edit the current configuration settings.
+ ********************************************************* record function **
+ * Read unsigned integer encoded as varint.
  *
  * IN:
- * @window          Window where errors will be displayed.
- * @screen          Screen options.
- * @conn            Current connection.
- * @config_file_guc GUC option associated with postgresql/pg_hba/pg_ident
+ * @cur             Frame cursor.
  *
  * RETURNS:
- * Open configuration file in $EDITOR.
+ * Integer value, 0 if frame is truncated.
  ****************************************************************************
  */
-void edit_config(WINDOW * window, struct screen_s * screen, PGconn * conn, const char * config_file_guc)
+unsigned long long record_read_varint(struct record_cursor_s * cur)
 {
-    static char config_path[PATH_MAX];
-    pid_t pid;
+    unsigned long long value = 0;
+    unsigned int shift = 0;
+    unsigned char byte;
 
-    if (check_pg_listen_addr(screen, conn)) {
-        get_conf_value(conn, config_file_guc, config_path);
-        if (strlen(config_path) != 0) {
-            /* if we want edit recovery.conf, attach config name to data_directory path */
-            if (!strcmp(config_file_guc, GUC_DATA_DIRECTORY)) {
-		snprintf(config_path + strlen(config_path), sizeof(config_path) - strlen(config_path), "/%s", PG_RECOVERY_FILE);
-            }
-            /* escape from ncurses mode */
-            refresh();
-            endwin();
-            pid = fork();                   /* start child */
-            if (pid == 0) {
-                /* use editor from environment variables, otherwise use default editor */
-                static char editor[S_BUF_LEN];
-                if (getenv("EDITOR") != NULL)
-                    snprintf(editor, sizeof(editor), "%s", getenv("EDITOR"));
-                else
-                    snprintf(editor, sizeof(editor), "%s", DEFAULT_EDITOR);
-                execlp(editor, editor, config_path, NULL);
-                exit(EXIT_FAILURE);
-            } else if (pid < 0) {
-                wprintw(window, "ERROR: fork failed, can't open %s", config_path);
-                return;
-            } else if (waitpid(pid, NULL, 0) != pid) {
-                wprintw(window, "ERROR: waitpid failed.");
-                return;
-            }
-        } else {
-            wprintw(window, "Do nothing. Config option not found (not SUPERUSER?).");
+    do {
+        if (cur->pos >= cur->len || shift > 63) {
+            cur->error = true;
+            return 0;
         }
-    } else {
-        wprintw(window, "Do nothing. Edit config not supported for remote hosts.");
-    }
+        byte = cur->data[cur->pos++];
+        value |= (unsigned long long) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
 
-    /* return to ncurses mode */
-    refresh();
-    return;
+    return value;
 }
 
 /*
- ******************************************************** routine function **
- * Allocate memory for menu items.
+ ********************************************************* record function **
+ * Read signed integer encoded as zigzag varint.
  *
  * IN:
- * @n_choices       Number of menu items.
+ * @cur             Frame cursor.
  *
  * RETURNS:
- * Pointer to memory for menu items.
+ * Integer value, 0 if frame is truncated.
  ****************************************************************************
  */
-ITEM ** init_menuitems(unsigned int n_choices) {
-    ITEM ** items;
-    if ((items = (ITEM**) malloc(sizeof(ITEM *) * (n_choices))) == NULL) {
-        mreport(true, msg_fatal, "FATAL: malloc for menu items failed.");
-    }
-    return items;
+long long record_read_svarint(struct record_cursor_s * cur)
+{
+    unsigned long long value = record_read_varint(cur);
+
+    return (long long) (value >> 1) ^ -(long long) (value & 1);
 }
 
 /*
- ****************************************************** key press function **
- * Invoke menu for config editing.
+ ********************************************************* record function **
+ * Read double value from its 8 bytes representation.
  *
  * IN:
- * @w_cmd           Window where errors will be displayed.
- * @w_dba           Window where db answers printed.
- * @screen          Current screen settings.
- * @conn            Current connection.
- * @first_iter      Reset counters when function ends.
+ * @cur             Frame cursor.
+ *
+ * RETURNS:
+ * Double value, 0 if frame is truncated.
  ****************************************************************************
  */
-void edit_config_menu(WINDOW * w_cmd, WINDOW * w_dba, struct screen_s * screen, PGconn * conn, bool *first_iter)
+double record_read_double(struct record_cursor_s * cur)
 {
-    const char * choices[] = { "postgresql.conf", "pg_hba.conf", "pg_ident.conf", "recovery.conf" };
-    WINDOW *menu_win;
-    MENU *menu;
-    ITEM **items;
-    unsigned int n_choices, i;
-    int ch;
-    bool done = false;
-
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
+    unsigned long long bits;
+    double value;
 
-    /* allocate stuff */
-    n_choices = ARRAY_SIZE(choices);
-    items = init_menuitems(n_choices + 1);
-    for (i = 0; i < n_choices; i++)
-        items[i] = new_item(choices[i], NULL);
-    items[n_choices] = (ITEM *)NULL;
-    menu = new_menu((ITEM **)items);
+    if (cur->len - cur->pos < sizeof(bits)) {
+        cur->error = true;
+        return 0;
+    }
+    bits = record_get_fixed(cur->data + cur->pos, sizeof(bits));
+    cur->pos += sizeof(bits);
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
 
-    /* construct menu, outer window for header and inner window for menu */
-    menu_win = newwin(10,54,5,0);
-    keypad(menu_win, TRUE);
-    set_menu_win(menu, menu_win);
-    set_menu_sub(menu, derwin(menu_win, 4,20,1,0));
+/*
+ ********************************************************* record function **
+ * Read string prefixed with its length.
+ *
+ * IN:
+ * @cur             Frame cursor.
+ *
+ * OUT:
+ * @len             String length.
+ *
+ * RETURNS:
+ * Pointer to the string inside the frame, it isn't zero terminated.
+ ****************************************************************************
+ */
+const char * record_read_string(struct record_cursor_s * cur, unsigned int * len)
+{
+    unsigned long long value_len = record_read_varint(cur);
+    const char * value = (const char *) cur->data + cur->pos;
 
-    /* clear stuff from db answer window */
-    wclear(w_dba);
-    wrefresh(w_dba);
-    /* print menu header */
-    mvwprintw(menu_win, 0, 0, "Edit configuration file (Enter to edit, Esc to exit):");
-    post_menu(menu);
-    wrefresh(menu_win);
-    
-    while (1) {
-        if (done)
-            break;
-        ch = wgetch(menu_win);
-        switch (ch) {
-            case KEY_DOWN:
-                menu_driver(menu, REQ_DOWN_ITEM);
-                break;
-            case KEY_UP:
-                menu_driver(menu, REQ_UP_ITEM);
-                break;
-            case 10:
-                if (!strcmp(item_name(current_item(menu)), PG_CONF_FILE))
-                    edit_config(w_cmd, screen, conn, GUC_CONFIG_FILE);
-                else if (!strcmp(item_name(current_item(menu)), PG_HBA_FILE))
-                    edit_config(w_cmd, screen, conn, GUC_HBA_FILE);
-                else if (!strcmp(item_name(current_item(menu)), PG_IDENT_FILE))
-                    edit_config(w_cmd, screen, conn, GUC_IDENT_FILE);
-                else if (!strcmp(item_name(current_item(menu)), PG_RECOVERY_FILE))
-                    edit_config(w_cmd, screen, conn, GUC_DATA_DIRECTORY);
-                else
-                    wprintw(w_cmd, "Do nothing. Unknown file.");     /* never should be here. */
-                done = true;
-                break;
-            case 27:
-                done = true;
-                break;
-        }       
+    if (cur->error || value_len > cur->len - cur->pos) {
+        cur->error = true;
+        *len = 0;
+        return "";
     }
- 
-    /* clear menu items from screen */
-    clear();
-    refresh();
-
-    /* free stuff */
-    unpost_menu(menu);
-    for (i = 0; i < n_choices; i++)
-        free_item(items[i]);
-    free_menu(menu);
-    delwin(menu_win);
-    *first_iter = true;
+    cur->pos += value_len;
+    *len = value_len;
+    return value;
 }
 
 /*
- ****************************************************** key press function **
- * Invoke menu for pg_stat_statements contexts.
+ ********************************************************* record function **
+ * Read deltas of cpu statistics.
  *
  * IN:
- * @w_cmd           Window where errors will be displayed.
- * @w_dba           Window where db answers printed.
- * @screen          Current screen settings.
- * @first_iter      Reset counters when function ends.
+ * @cur             Frame cursor.
+ * @p               Previous cpu statistics.
+ *
+ * OUT:
+ * @c               Current cpu statistics.
  ****************************************************************************
  */
-void pgss_menu(WINDOW * w_cmd, WINDOW * w_dba, struct screen_s * screen, bool *first_iter)
+void record_read_cpu(struct record_cursor_s * cur, struct cpu_s * c, struct cpu_s * p)
 {
-    const char * choices[] = { 
-	"pg_stat_statements timings",
-	"pg_stat_statements general",
-	"pg_stat_statements input/output",
-	"pg_stat_statements temp input/output",
-	"pg_stat_statements local input/output" };
-    WINDOW *menu_win;
-    MENU *menu;
-    ITEM **items;
-    unsigned int n_choices, i;
-    int ch;
-    bool done = false;
-
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
+    RECORD_GET_DELTA(cur, c, p, cpu_user);
+    RECORD_GET_DELTA(cur, c, p, cpu_nice);
+    RECORD_GET_DELTA(cur, c, p, cpu_sys);
+    RECORD_GET_DELTA(cur, c, p, cpu_idle);
+    RECORD_GET_DELTA(cur, c, p, cpu_iowait);
+    RECORD_GET_DELTA(cur, c, p, cpu_steal);
+    RECORD_GET_DELTA(cur, c, p, cpu_hardirq);
+    RECORD_GET_DELTA(cur, c, p, cpu_softirq);
+    RECORD_GET_DELTA(cur, c, p, cpu_guest);
+    RECORD_GET_DELTA(cur, c, p, cpu_guest_nice);
+}
 
-    /* allocate stuff */
-    n_choices = ARRAY_SIZE(choices);
-    items = init_menuitems(n_choices + 1);
-    for (i = 0; i < n_choices; i++)
-        items[i] = new_item(choices[i], NULL);
-    items[n_choices] = (ITEM *)NULL;
-    menu = new_menu((ITEM **)items);
+/*
+ ********************************************************* record function **
+ * Read deltas of memory statistics.
+ *
+ * IN:
+ * @cur             Frame cursor.
+ * @p               Previous memory statistics.
+ *
+ * OUT:
+ * @c               Current memory statistics.
+ ****************************************************************************
+ */
+void record_read_mem(struct record_cursor_s * cur, struct mem_s * c, struct mem_s * p)
+{
+    RECORD_GET_DELTA(cur, c, p, mem_total);
+    RECORD_GET_DELTA(cur, c, p, mem_free);
+    RECORD_GET_DELTA(cur, c, p, mem_used);
+    RECORD_GET_DELTA(cur, c, p, swap_total);
+    RECORD_GET_DELTA(cur, c, p, swap_free);
+    RECORD_GET_DELTA(cur, c, p, swap_used);
+    RECORD_GET_DELTA(cur, c, p, cached);
+    RECORD_GET_DELTA(cur, c, p, buffers);
+    RECORD_GET_DELTA(cur, c, p, dirty);
+    RECORD_GET_DELTA(cur, c, p, writeback);
+    RECORD_GET_DELTA(cur, c, p, slab);
+}
 
-    /* construct menu, outer window for header and inner window for menu */
-    menu_win = newwin(11,64,5,0);
-    keypad(menu_win, TRUE);
-    set_menu_win(menu, menu_win);
-    set_menu_sub(menu, derwin(menu_win, 5,40,1,0));
+/*
+ ********************************************************* record function **
+ * Read postgres stats of the sysstat screen.
+ *
+ * IN:
+ * @cur             Frame cursor.
+ * @p               Previous postgres stats.
+ *
+ * OUT:
+ * @c               Current postgres stats.
+ ****************************************************************************
+ */
+void record_read_pgstat(struct record_cursor_s * cur, struct pg_stat_s * c, struct pg_stat_s * p)
+{
+    const char * value;
+    unsigned int len;
+
+    value = record_read_string(cur, &len);
+    snprintf(c->uptime, sizeof(c->uptime), "%.*s", len, value);
+    RECORD_GET_DELTA(cur, c, p, t_count);
+    RECORD_GET_DELTA(cur, c, p, i_count);
+    RECORD_GET_DELTA(cur, c, p, x_count);
+    RECORD_GET_DELTA(cur, c, p, a_count);
+    RECORD_GET_DELTA(cur, c, p, w_count);
+    RECORD_GET_DELTA(cur, c, p, o_count);
+    RECORD_GET_DELTA(cur, c, p, av_count);
+    RECORD_GET_DELTA(cur, c, p, avw_count);
+    RECORD_GET_DELTA(cur, c, p, mv_count);
+    value = record_read_string(cur, &len);
+    snprintf(c->vac_maxtime, sizeof(c->vac_maxtime), "%.*s", len, value);
+    value = record_read_string(cur, &len);
+    snprintf(c->xact_maxtime, sizeof(c->xact_maxtime), "%.*s", len, value);
+    c->avgtime = record_read_double(cur);
+    RECORD_GET_DELTA(cur, c, p, total_calls);
+    c->ts = record_read_double(cur);
+    c->pgss_ok = record_read_byte(cur);
+}
 
-    /* clear stuff from db answer window */
-    wclear(w_dba);
-    wrefresh(w_dba);
-    /* print menu header */
-    mvwprintw(menu_win, 0, 0, "Choose pg_stat_statements mode (Enter to choose, Esc to exit):");
-    post_menu(menu);
-    wrefresh(menu_win);
-    
-    while (1) {
-        if (done)
-            break;
-        ch = wgetch(menu_win);
-        switch (ch) {
-            case KEY_DOWN:
-                menu_driver(menu, REQ_DOWN_ITEM);
-                break;
-            case KEY_UP:
-                menu_driver(menu, REQ_UP_ITEM);
-                break;
-            case 10:
-                if (!strcmp(item_name(current_item(menu)), "pg_stat_statements timings"))
-                    screen->current_context = pg_stat_statements_timing;
-                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements general"))
-                    screen->current_context = pg_stat_statements_general;
-                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements input/output"))
-                    screen->current_context = pg_stat_statements_io;
-                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements temp input/output"))
-                    screen->current_context = pg_stat_statements_temp;
-                else if (!strcmp(item_name(current_item(menu)), "pg_stat_statements local input/output"))
-                    screen->current_context = pg_stat_statements_local;
-                else
-                    wprintw(w_cmd, "Do nothing. Unknown mode.");     /* never should be here. */
-                done = true;
-                break;
-            case 27:
-                done = true;
-                break;
-        }       
-    }
- 
-    /* clear menu items from screen */
-    clear();
-    refresh();
+/*
+ ********************************************************* record function **
+ * Read deltas of device counters written with mask of changed counters.
+ *
+ * IN:
+ * @cur             Frame cursor.
+ * @n               Number of counters.
+ *
+ * OUT:
+ * @delta           Deltas of counters.
+ ****************************************************************************
+ */
+void record_read_deltas(struct record_cursor_s * cur, long long * delta, unsigned int n)
+{
+    unsigned long long mask = record_read_varint(cur);
+    unsigned int i;
 
-    /* free stuff */
-    unpost_menu(menu);
-    for (i = 0; i < n_choices; i++)
-        free_item(items[i]);
-    free_menu(menu);
-    delwin(menu_win);
-    *first_iter = true;
+    for (i = 0; i < n; i++)
+        delta[i] = (mask & (1ULL << i)) ? record_read_svarint(cur) : 0;
 }
 
 /*
- ****************************************************** key press function **
- * Switch pg_stat_statements contexts to next.
+ ********************************************************* record function **
+ * Read IO statistics. When devices list is written, statistics are
+ * reallocated for new list and deltas are taken from zero.
  *
  * IN:
- * @w_cmd           Window where errors will be displayed.
- * @screen          Current screen settings.
- * @p_res	    Array with previous query results.
- * @first_iter      Reset counters when function ends.
+ * @cur             Frame cursor.
+ * @rec             Decoder state, previous statistics are in p_ios.
+ *
+ * OUT:
+ * @rec             Decoder state with current statistics in c_ios.
  ****************************************************************************
  */
-void pgss_switch(WINDOW * w_cmd, struct screen_s * screen, PGresult * p_res, bool *first_iter)
+void record_read_iostat(struct record_cursor_s * cur, struct record_s * rec)
 {
-    /*
-     * Check current context and switch to pg_stat_statements.
-     * any -> pgss_timing -> pgss_general -> pgss_io -> pgss_temp -> pgss_local -> pgss_timing -> ...
-     */
-    switch (screen->current_context) {
-	case pg_stat_statements_timing:
-            switch_context(w_cmd, screen, pg_stat_statements_general, p_res, first_iter);
-            break;
-	case pg_stat_statements_general:
-            switch_context(w_cmd, screen, pg_stat_statements_io, p_res, first_iter);
-            break;
-	case pg_stat_statements_io:
-            switch_context(w_cmd, screen, pg_stat_statements_temp, p_res, first_iter);
-            break;
-	case pg_stat_statements_temp:
-            switch_context(w_cmd, screen, pg_stat_statements_local, p_res, first_iter);
-            break;
-	case pg_stat_statements_local: default:
-            switch_context(w_cmd, screen, pg_stat_statements_timing, p_res, first_iter);
-            break;
+    static struct iodata_s zero;
+    struct iodata_s * c, * p;
+    unsigned long long n = record_read_varint(cur);
+    bool names = record_read_byte(cur);
+    long long delta[11];
+    const char * value;
+    unsigned int i, len;
+
+    /* each device takes at least one byte, so corrupted number doesn't lead to huge allocation */
+    if (cur->error || n > cur->len - cur->pos || (names == false && n != rec->bdev)) {
+        cur->error = true;
+        return;
+    }
+    if (names && (n != rec->bdev || rec->c_ios == NULL))
+        resize_record_iostats(rec, n);
+
+    for (i = 0; i < rec->bdev; i++) {
+        c = rec->c_ios[i];
+        p = names ? &zero : rec->p_ios[i];
+        if (names) {
+            c->major = record_read_svarint(cur);
+            c->minor = record_read_svarint(cur);
+            value = record_read_string(cur, &len);
+            snprintf(c->devname, sizeof(c->devname), "%.*s", len, value);
+        } else {
+            c->major = p->major;
+            c->minor = p->minor;
+            snprintf(c->devname, sizeof(c->devname), "%s", p->devname);
+        }
+        record_read_deltas(cur, delta, 11);
+        c->r_completed = p->r_completed + delta[0];
+        c->r_merged = p->r_merged + delta[1];
+        c->r_sectors = p->r_sectors + delta[2];
+        c->r_spent = p->r_spent + delta[3];
+        c->w_completed = p->w_completed + delta[4];
+        c->w_merged = p->w_merged + delta[5];
+        c->w_sectors = p->w_sectors + delta[6];
+        c->w_spent = p->w_spent + delta[7];
+        c->io_in_progress = p->io_in_progress + delta[8];
+        c->t_spent = p->t_spent + delta[9];
+        c->t_weighted = p->t_weighted + delta[10];
     }
 }
+
 /*
- ****************************************************** key press function **
- * Cancel or terminate postgres backend.
+ ********************************************************* record function **
+ * Read NIC statistics. When interfaces list is written, statistics are
+ * reallocated for new list and deltas are taken from zero, otherwise
+ * interfaces settings are kept from previous frame.
  *
  * IN:
- * @window          Window where resilt will be printed.
- * @screen          Current screen info.
- * @conn            Current postgres connection.
- * @do_terminate    Do terminate backend if true or cancel if false.
+ * @cur             Frame cursor.
+ * @rec             Decoder state, previous statistics are in p_nicd.
+ *
+ * OUT:
+ * @rec             Decoder state with current statistics in c_nicd.
  ****************************************************************************
  */
-void signal_single_backend(WINDOW * window, struct screen_s *screen, PGconn * conn, bool do_terminate)
+void record_read_nicstat(struct record_cursor_s * cur, struct record_s * rec)
 {
-    if (screen->current_context != pg_stat_activity_long) {
-        wprintw(window, "Terminate or cancel backend allowed in long queries screen.");
+    static struct nicdata_s zero;
+    struct nicdata_s * c, * p;
+    unsigned long long n = record_read_varint(cur);
+    bool names = record_read_byte(cur);
+    long long delta[8];
+    const char * value;
+    unsigned int i, len;
+
+    if (cur->error || n > cur->len - cur->pos || (names == false && n != rec->idev)) {
+        cur->error = true;
         return;
-    } 
-
-    char errmsg[ERRSIZE],
-         query[QUERY_MAXLEN],
-         msg[S_BUF_LEN],
-         pid[6];
-    char * actions[] = { "Terminate", "Cancel" };
-    int actions_idx;
-    PGresult * res;
-    bool with_esc;
-
-    if (do_terminate) {
-        actions_idx = 0;	/* Terminate */
-        snprintf(msg, sizeof(msg), "Terminate single backend, enter pid: ");
-    } else {
-        actions_idx = 1;	/* Cancel */
-        snprintf(msg, sizeof(msg), "Cancel single backend, enter pid: ");
     }
-
-    cmd_readline(window, msg, strlen(msg), &with_esc, pid, sizeof(pid), true);
-    if (atoi(pid) > 0) {
-        if (do_terminate) {
-	    snprintf(query, sizeof(query), "%s%s%s", PG_TERM_BACKEND_P1, pid, PG_TERM_BACKEND_P2);
+    if (names && (n != rec->idev || rec->c_nicd == NULL))
+        resize_record_nicdata(rec, n);
+
+    for (i = 0; i < rec->idev; i++) {
+        c = rec->c_nicd[i];
+        p = names ? &zero : rec->p_nicd[i];
+        if (names) {
+            value = record_read_string(cur, &len);
+            snprintf(c->ifname, sizeof(c->ifname), "%.*s", len, value);
+            c->speed = record_read_svarint(cur);
+            c->duplex = record_read_svarint(cur);
         } else {
-	    snprintf(query, sizeof(query), "%s%s%s", PG_CANCEL_BACKEND_P1, pid, PG_CANCEL_BACKEND_P2);
+            snprintf(c->ifname, sizeof(c->ifname), "%s", p->ifname);
+            c->speed = p->speed;
+            c->duplex = p->duplex;
         }
+        record_read_deltas(cur, delta, 8);
+        c->rbytes = p->rbytes + delta[0];
+        c->rpackets = p->rpackets + delta[1];
+        c->ierr = p->ierr + delta[2];
+        c->wbytes = p->wbytes + delta[3];
+        c->wpackets = p->wpackets + delta[4];
+        c->oerr = p->oerr + delta[5];
+        c->coll = p->coll + delta[6];
+        c->sat = p->sat + delta[7];
+    }
+}
 
-        res = do_query(conn, query, errmsg);
-        if (res != NULL) {
-            wprintw(window, "%s backend with pid %s.", actions[actions_idx], pid);
-            PQclear(res);
-        } else {
-            wprintw(window, "%s backend failed. %s", actions[actions_idx], errmsg);
-        }
-    } else if (strlen(pid) == 0 && with_esc == false) {
-        wprintw(window, "Do nothing. Nothing etntered.");
-    } else if (with_esc) {
-        ;
-    } else
-        wprintw(window, "Do nothing. Incorrect input value.");
+/*
+ ********************************************************* record function **
+ * Store decoded text value into the snapshot, number columns get parsed
+ * value too.
+ *
+ * IN:
+ * @snap            Snapshot where value will be stored.
+ * @row, @col       Cell position.
+ * @value           Value, it may be not zero terminated.
+ * @len             Value length.
+ ****************************************************************************
+ */
+void record_set_value(struct snapshot_s * snap, unsigned int row, unsigned int col,
+        const char * value, unsigned int len)
+{
+    add_snapshot_text(snap, row, col, value, len);
+
+    /* value is parsed from the arena, where it's zero terminated */
+    if (snap->cols[col].type == col_number)
+        snap->cols[col].numbers[row] = strtod(SNAPSHOT_VALUE(snap, row, col), NULL);
 }
 
 /*
- ****************************************************** key press function **
- * Print current mask for group cancel/terminate
+ ********************************************************* record function **
+ * Copy unchanged value from the row of previous snapshot.
  *
  * IN:
- * @window          Window where resilt will be printed.
- * @screen          Current screen info.
+ * @c               Current snapshot.
+ * @row             Row of current snapshot.
+ * @p               Previous snapshot.
+ * @p_row           Row of previous snapshot.
+ * @col             Column number.
  ****************************************************************************
  */
-void get_statemask(WINDOW * window, struct screen_s * screen)
+void record_copy_value(struct snapshot_s * c, unsigned int row, struct snapshot_s * p,
+        unsigned int p_row, unsigned int col)
 {
-    if (screen->current_context != pg_stat_activity_long) {
-        wprintw(window, "Current mask can viewed in activity screen.");
+    struct column_s * column = &c->cols[col];
+
+    if (column->type == col_counter) {
+        column->counters[row] = p->cols[col].counters[p_row];
+        column->rates[row] = 0;
         return;
     }
 
-    wprintw(window, "Mask: ");
-    if (screen->signal_options == 0)
-        wprintw(window, "empty");
-    if (screen->signal_options & GROUP_ACTIVE)
-        wprintw(window, "active ");
-    if (screen->signal_options & GROUP_IDLE)
-        wprintw(window, "idle ");
-    if (screen->signal_options & GROUP_IDLE_IN_XACT)
-        wprintw(window, "idle in xact ");
-    if (screen->signal_options & GROUP_WAITING)
-        wprintw(window, "waiting ");
-    if (screen->signal_options & GROUP_OTHER)
-        wprintw(window, "other ");
+    add_snapshot_text(c, row, col, SNAPSHOT_VALUE(p, p_row, col), SNAPSHOT_CELL(p, p_row, col)->len);
+    if (column->type == col_number)
+        column->numbers[row] = p->cols[col].numbers[p_row];
 }
 
 /*
- ****************************************************** key press function **
- * Set state mask for group cancel/terminate
+ ********************************************************* record function **
+ * Read stream of snapshot rows operations. Stream is read twice: first pass
+ * only checks operations and calculates space required for text values,
+ * second pass stores values into prepared snapshot.
  *
  * IN:
- * @window          Window where resilt will be printed.
- * @screen          Current screen info.
+ * @cur             Frame cursor.
+ * @p               Previous snapshot, NULL if snapshot is written entirely.
+ * @types           Types of columns.
+ * @n_cols          Number of columns.
+ * @n_rows          Number of rows.
+ * @data_len        Space required for text values, NULL on second pass.
+ *
+ * OUT:
+ * @c               Current snapshot, it's used only on second pass.
+ * @data_len        Space required for text values.
+ *
+ * RETURNS:
+ * True if stream is valid.
  ****************************************************************************
  */
-void set_statemask(WINDOW * window, struct screen_s * screen)
+bool record_read_rows(struct record_cursor_s * cur, struct snapshot_s * c, struct snapshot_s * p,
+        const enum col_type * types, unsigned int n_cols, unsigned int n_rows, size_t * data_len)
 {
-    if (screen->current_context != pg_stat_activity_long) {
-        wprintw(window, "State mask setup allowed in activity screen.");
-        return;
-    } 
+    unsigned int j, len, row = 0, cursor = 0;
+    unsigned long long n, mask;
+    const char * value;
+    long long m, delta;
+    unsigned char op;
+
+    while ((op = record_read_byte(cur)) != op_end && cur->error == false) {
+        switch (op) {
+            case op_skip:
+                n = record_read_varint(cur);
+                if (p == NULL || n > p->n_rows - cursor || n > n_rows - row)
+                    return false;
+                for (; n > 0; n--, row++, cursor++)
+                    for (j = 0; j < n_cols; j++) {
+                        if (data_len == NULL)
+                            record_copy_value(c, row, p, cursor, j);
+                        else if (types[j] != col_counter)
+                            *data_len += SNAPSHOT_CELL(p, cursor, j)->len + 1;
+                    }
+                break;
+            case op_update:
+                m = (long long) cursor + record_read_svarint(cur);
+                mask = record_read_varint(cur);
+                if (p == NULL || m < 0 || m >= p->n_rows || row >= n_rows)
+                    return false;
+                for (j = 0; j < n_cols; j++) {
+                    if ((mask & (1ULL << j)) == 0) {
+                        if (data_len == NULL)
+                            record_copy_value(c, row, p, m, j);
+                        else if (types[j] != col_counter)
+                            *data_len += SNAPSHOT_CELL(p, m, j)->len + 1;
+                    } else if (types[j] == col_counter) {
+                        delta = record_read_svarint(cur);
+                        if (data_len == NULL) {
+                            c->cols[j].counters[row] = p->cols[j].counters[m] + delta;
+                            c->cols[j].rates[row] = 0;
+                        }
+                    } else {
+                        value = record_read_string(cur, &len);
+                        if (data_len == NULL)
+                            record_set_value(c, row, j, value, len);
+                        else
+                            *data_len += len + 1;
+                    }
+                }
+                cursor = m + 1;
+                row++;
+                break;
+            case op_insert:
+                if (row >= n_rows)
+                    return false;
+                for (j = 0; j < n_cols; j++) {
+                    if (types[j] == col_counter) {
+                        delta = record_read_svarint(cur);
+                        if (data_len == NULL) {
+                            c->cols[j].counters[row] = delta;
+                            c->cols[j].rates[row] = 0;
+                        }
+                    } else {
+                        value = record_read_string(cur, &len);
+                        if (data_len == NULL)
+                            record_set_value(c, row, j, value, len);
+                        else
+                            *data_len += len + 1;
+                    }
+                }
+                row++;
+                break;
+            default:
+                return false;
+        }
+    }
 
-    unsigned int i;
-    char mask[5] = "",
-         msg[] = "";        /* set empty message, we don't want show msg from cmd_readline */
-    bool with_esc;
+    return cur->error == false && row == n_rows;
+}
 
-    wprintw(window, "Set state mask for group backends [");
-    wattron(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "a");
-    wattroff(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "ctive/");
-    wattron(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "i");
-    wattroff(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "dle/idle_in_");
-    wattron(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "x");
-    wattroff(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "act/");
-    wattron(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "w");
-    wattroff(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "aiting/");
-    wattron(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "o");
-    wattroff(window, A_BOLD | A_UNDERLINE);
-    wprintw(window, "ther]: ");
+/*
+ ********************************************************* record function **
+ * Read snapshot of context query results. Columns are taken from the frame
+ * or from previous snapshot, rows are restored from previous snapshot and
+ * operations stream.
+ *
+ * IN:
+ * @cur             Frame cursor.
+ * @p               Previous snapshot, NULL if there is no previous snapshot.
+ *
+ * OUT:
+ * @c               Current snapshot.
+ *
+ * RETURNS:
+ * True if snapshot is valid.
+ ****************************************************************************
+ */
+bool record_read_snapshot(struct record_cursor_s * cur, struct snapshot_s * c, struct snapshot_s * p)
+{
+    unsigned long long n_cols = record_read_varint(cur),
+                       n_rows;
+    bool header = record_read_byte(cur),
+         monotonic;
+    unsigned int j, key;
+    size_t start, data_len = 0;
+    char name[COL_MAXLEN];
+    double ts;
+
+    /* each column takes at least one byte, so corrupted number doesn't lead to huge arrays */
+    if (cur->error || n_cols > cur->len - cur->pos || (header == false && (p == NULL || p->n_cols != n_cols)))
+        return false;
 
-    /* use offset 77 that equals message constructed above and printed by ncurses */
-    cmd_readline(window, msg, 77, &with_esc, mask, sizeof(mask), true);
-    if (strlen(mask) == 0 && with_esc == false) {           /* mask not entered */
-        wprintw(window, "Do nothing. Mask not specified.");
-    } else if (with_esc) {                                  /* user escaped */
-        ;			/* do nothing here, info message will be printed by cmd_readline */
-    } else {                                                /* user enter string with valid length */
-        /* reset previous mask */
-        screen->signal_options = 0;
-        for (i = 0; i < strlen(mask); i++) {
-            switch (mask[i]) {
-                case 'a':
-                    screen->signal_options |= GROUP_ACTIVE;
-                    break;
-                case 'i':
-                    screen->signal_options |= GROUP_IDLE;
-                    break;
-                case 'x':
-                    screen->signal_options |= GROUP_IDLE_IN_XACT;
-                    break;
-                case 'w':
-                    screen->signal_options |= GROUP_WAITING;
-                    break;
-                case 'o':
-                    screen->signal_options |= GROUP_OTHER;
-                    break;
-            }
+    enum col_type types[n_cols + 1];
+    const char * names[n_cols + 1];
+    unsigned int lens[n_cols + 1];
+
+    if (header) {
+        key = record_read_varint(cur);
+        monotonic = record_read_byte(cur);
+        for (j = 0; j < n_cols; j++) {
+            types[j] = record_read_byte(cur);
+            names[j] = record_read_string(cur, &lens[j]);
+            if (types[j] > col_counter)
+                return false;
         }
-        get_statemask(window, screen);
+        /* rows with other columns aren't compared */
+        p = NULL;
+    } else {
+        key = p->key;
+        monotonic = p->monotonic;
+        for (j = 0; j < n_cols; j++) {
+            types[j] = p->cols[j].type;
+            names[j] = p->cols[j].name;
+            lens[j] = strlen(p->cols[j].name);
+        }
+    }
+    ts = record_read_double(cur);
+    n_rows = record_read_varint(cur);
+
+    /* too wide rows are written entirely */
+    if (n_cols > RECORD_MAX_COLS)
+        p = NULL;
+    /* rows either are skipped runs of previous rows or take at least one byte */
+    if (cur->error || n_rows > cur->len - cur->pos + (p != NULL ? p->n_rows : 0))
+        return false;
+
+    start = cur->pos;
+    if (record_read_rows(cur, NULL, p, types, n_cols, n_rows, &data_len) == false)
+        return false;
+
+    reserve_snapshot(c, n_rows, n_cols, data_len);
+    for (j = 0; j < n_cols; j++) {
+        snprintf(name, sizeof(name), "%.*s", lens[j], names[j]);
+        set_snapshot_column(c, j, name, types[j]);
     }
+    c->key = key;
+    c->monotonic = monotonic;
+    c->ts = ts;
+
+    cur->pos = start;
+    return record_read_rows(cur, c, p, types, n_cols, n_rows, NULL);
 }
 
 /*
- ****************************************************** key press function **
- * Cancel or terminate postgres backends using state mask.
+ ********************************************************* record function **
+ * Decode frame into decoder state. Last decoded sample becomes previous
+ * one and new sample is decoded using it, as it was encoded by recorder.
+ * Delta frame can be decoded only after keyframe and frames following it.
  *
  * IN:
- * @window          Window where resilt will be printed.
- * @screen          Current screen info.
- * @conn            Current postgres connection.
- * @do_terminate    Do terminate backend if true or cancel if false.
+ * @rec             Decoder state.
+ * @data            Frame without its length.
+ * @len             Frame length.
+ *
+ * OUT:
+ * @rec             Decoder state with decoded sample.
+ * @wall            Wall clock time of the frame, in microseconds.
+ *
+ * RETURNS:
+ * True if frame is decoded, false if it's corrupted or can't be decoded.
  ****************************************************************************
  */
-void signal_group_backend(WINDOW * window, struct screen_s *screen, PGconn * conn, bool do_terminate)
+bool read_record_frame(struct record_s * rec, const unsigned char * data, size_t len, long long * wall)
 {
-    if (screen->current_context != pg_stat_activity_long) {
-        wprintw(window, "Terminate or cancel backend allowed in long queries screen.");
-        return;
-    } 
-    if (screen->signal_options == 0) {
-        wprintw(window, "Do nothing. Mask not specified.");
-        return;
+    static struct record_s zero;
+    struct record_cursor_s cur = { data, len, 0, false };
+    unsigned int i, id, curr, prev;
+    struct iodata_s ** ios;
+    struct nicdata_s ** nicd;
+    struct snapshot_s * snap;
+    struct record_s * base;
+    unsigned char type, section;
+    bool continuous[TOTAL_CONTEXTS];
+    bool ok = true;
+
+    type = record_read_byte(&cur);
+    if (len < 9 || (type != frame_keyframe && (type != frame_delta || rec->frames == 0))) {
+        rec->frames = 0;
+        return false;
     }
+    *wall = record_get_fixed(data + 1, 8);
+    cur.pos = 9;
+    record_read_double(&cur);               /* sampling time, snapshots have their own */
+
+    rec->curr ^= 1;
+    curr = rec->curr;
+    ios = rec->p_ios;
+    rec->p_ios = rec->c_ios;
+    rec->c_ios = ios;
+    nicd = rec->p_nicd;
+    rec->p_nicd = rec->c_nicd;
+    rec->c_nicd = nicd;
+    memset(rec->sampled, 0, sizeof(rec->sampled));
+    memset(rec->matched, 0, sizeof(rec->matched));
 
-    char query[QUERY_MAXLEN],
-         mask[5] = "",
-         state[M_BUF_LEN];
-    const char * actions[] = { "terminate", "cancel" };
-    PGresult * res;
-    unsigned int i, actions_idx, signaled = 0;
-
-    if (do_terminate)
-	actions_idx = 0;		/* terminate */
-    else
-        actions_idx = 1;		/* cancel */
-    
-    if (screen->signal_options & GROUP_ACTIVE)
-        strncat(mask, "a", sizeof(mask));
-    if (screen->signal_options & GROUP_IDLE)
-        strncat(mask, "i", sizeof(mask));
-    if (screen->signal_options & GROUP_IDLE_IN_XACT)
-        strncat(mask, "x", sizeof(mask));
-    if (screen->signal_options & GROUP_WAITING)
-        strncat(mask, "w", sizeof(mask));
-    if (screen->signal_options & GROUP_OTHER)
-        strncat(mask, "o", sizeof(mask));
+    /*
+     * Keyframe is encoded from zero, but previous decoded sample is kept,
+     * so rates remain continuous across keyframes.
+     */
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        continuous[i] = rec->frames != 0 && rec->recorded[i];
+    if (type == frame_keyframe) {
+        if (rec->frames == 0)
+            reset_record_prev(rec);
+        memset(rec->recorded, 0, sizeof(rec->recorded));
+        base = &zero;
+        prev = 0;
+    } else {
+        base = rec;
+        prev = !curr;
+    }
 
-    for (i = 0; i < strlen(mask); i++) {
-        switch (mask[i]) {
-            case 'a':
-                snprintf(state, sizeof(state), "state = 'active'");
-                break;
-            case 'i':
-                snprintf(state, sizeof(state), "state = 'idle'");
-                break;
-            case 'x':
-                snprintf(state, sizeof(state), "state IN ('idle in transaction (aborted)', 'idle in transaction')");
-                break;
-            case 'w':
-		if (atoi(screen->pg_special.pg_version_num) < PG96)
-	            snprintf(state, sizeof(state), "waiting");
-		else 
-	            snprintf(state, sizeof(state), "wait_event IS NOT NULL OR wait_event_type IS NOT NULL");
+    while (ok && (section = record_read_byte(&cur)) != sec_end && cur.error == false) {
+        switch (section) {
+            case sec_cpu:
+                rec->uptime[curr] = base->uptime[prev] + record_read_svarint(&cur);
+                rec->uptime0[curr] = base->uptime0[prev] + record_read_svarint(&cur);
+                record_read_cpu(&cur, &rec->cpu[curr][0], &base->cpu[prev][0]);
+                record_read_cpu(&cur, &rec->cpu[curr][1], &base->cpu[prev][1]);
+                for (i = 0; i < 3; i++)
+                    rec->la[curr][i] = base->la[prev][i] + record_read_svarint(&cur);
                 break;
-            case 'o':
-                snprintf(state, sizeof(state), "state IN ('fastpath function call', 'disabled')");
+            case sec_mem:
+                record_read_mem(&cur, &rec->mem[curr], &base->mem[prev]);
                 break;
-            default:
+            case sec_pgstat:
+                record_read_pgstat(&cur, &rec->pg_stats[curr], &base->pg_stats[prev]);
                 break;
-        }
-	snprintf(query, sizeof(query), "%s%s%s%s%s%s%s%s%s",
-		 PG_SIG_GROUP_BACKEND_P1, actions[actions_idx],
-		 PG_SIG_GROUP_BACKEND_P2, state,
-		 PG_SIG_GROUP_BACKEND_P3, screen->pg_stat_activity_min_age,
-		 PG_SIG_GROUP_BACKEND_P4, screen->pg_stat_activity_min_age,
-		 PG_SIG_GROUP_BACKEND_P5);
-        
-        char errmsg[ERRSIZE];
-        res = do_query(conn, query, errmsg);
-        signaled = signaled + PQntuples(res);
-        PQclear(res);
+            case sec_iostat:
+                record_read_iostat(&cur, rec);
+                break;
+            case sec_nicstat:
+                record_read_nicstat(&cur, rec);
+                break;
+            case sec_context:
+                id = record_read_varint(&cur);
+                if (id >= TOTAL_CONTEXTS || rec->sampled[id]) {
+                    ok = false;
+                    break;
+                }
+                snap = rec->p_snaps[id];
+                rec->p_snaps[id] = rec->c_snaps[id];
+                rec->c_snaps[id] = snap;
+                if (record_read_snapshot(&cur, rec->c_snaps[id], rec->recorded[id] ? rec->p_snaps[id] : NULL) == false) {
+                    ok = false;
+                    break;
+                }
+                /* rates are calculated in the same way as in console */
+                if (continuous[id])
+                    rec->matched[id] = diff_arrays(rec->p_snaps[id], rec->c_snaps[id]);
+                rec->sampled[id] = true;
+                break;
+            default:
+                ok = false;
+                break;
+        }
     }
 
-    if (do_terminate)
-        wprintw(window, "Terminated %i processes.", signaled);
-    else
-        wprintw(window, "Canceled %i processes.", signaled);
+    /* state is broken by partially decoded frame, only keyframe can be decoded next */
+    if (ok == false || cur.error) {
+        rec->frames = 0;
+        return false;
+    }
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        rec->recorded[i] = rec->sampled[i];
+    rec->frames++;
+    return true;
 }
 
 /*
- ****************************************************** key press function **
- * Start psql using screen connection options.
+ ********************************************************* replay function **
+ * Append keyframe to the in-memory keyframes index, it's used when there
+ * is no index file. Index is kept sorted, so keyframes which are already
+ * known or out of order are ignored.
  *
  * IN:
- * @window          Window where errors will be displayed if occurs.
- * @screen          Screen options.
+ * @rep             Replay state.
+ * @wall            Wall clock time of keyframe, in microseconds.
+ * @offset          Keyframe offset in time-series file.
  ****************************************************************************
  */
-void start_psql(WINDOW * window, struct screen_s * screen)
+void add_replay_index(struct replay_s * rep, long long wall, off_t offset)
 {
-    pid_t pid;
-    char psql[XS_BUF_LEN] = DEFAULT_PSQL;
+    if (rep->n_index > 0 && (offset <= rep->index_offset[rep->n_index - 1]
+                || wall < rep->index_wall[rep->n_index - 1]))
+        return;
 
-    /* escape from ncurses mode */
-    refresh();
-    endwin();
-    /* ignore Ctrl+C in child when psql running */
-    signal(SIGINT, SIG_IGN);
-    pid = fork();                   /* start child */
-    if (pid == 0) {
-        execlp(psql, psql,
-                "-h", screen->host,
-                "-p", screen->port,
-                "-U", screen->user,
-                "-d", screen->dbname,
-                NULL);
-        exit(EXIT_SUCCESS);         /* finish child */
-    } else if (pid < 0) {
-        wprintw(window, "ERROR: fork failed, can't exec %s.", psql);
-    } else if (waitpid(pid, NULL, 0) != pid) {
-        wprintw(window, "ERROR: waitpid failed.");
+    if (rep->n_index == rep->index_size) {
+        rep->index_size = (rep->index_size > 0) ? rep->index_size * 2 : 64;
+        if ((rep->index_wall = realloc(rep->index_wall, sizeof(long long) * rep->index_size)) == NULL
+                || (rep->index_offset = realloc(rep->index_offset, sizeof(off_t) * rep->index_size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for replay index failed.\n");
+        }
     }
+    rep->index_wall[rep->n_index] = wall;
+    rep->index_offset[rep->n_index] = offset;
+    rep->n_index++;
+}
 
-    /* 
-     * Reinit signals handling. After psql session, pgcenter may not reset terminal properly.
-     */
-    signal(SIGINT, SIG_DFL);
-    init_signal_handlers();
-
-    /* return to ncurses mode */
-    refresh();
+/*
+ ********************************************************* replay function **
+ * Number of keyframes in the index file or, without it, in the in-memory
+ * index.
+ *
+ * IN:
+ * @rep             Replay state.
+ *
+ * RETURNS:
+ * Number of keyframes.
+ ****************************************************************************
+ */
+unsigned int count_replay_index(struct replay_s * rep)
+{
+    return (rep->idx_map != NULL) ? rep->idx_len / RECORD_INDEX_ENTRY_LEN : rep->n_index;
 }
 
 /*
- ****************************************************** key press function **
- * Change refresh interval.
+ ********************************************************* replay function **
+ * Get keyframe from the index. Entries of the index file are read directly
+ * from the mapping.
  *
  * IN:
- * @window              Window where prompt will be printed.
- * 
+ * @rep             Replay state.
+ * @i               Keyframe number.
+ *
  * OUT:
- * @interval            Interval.
+ * @wall            Wall clock time of keyframe, in microseconds.
+ *
+ * RETURNS:
+ * Keyframe offset in time-series file.
  ****************************************************************************
  */
-unsigned long change_refresh(WINDOW * window, unsigned long interval)
+off_t get_replay_index(struct replay_s * rep, unsigned int i, long long * wall)
 {
-    unsigned long interval_save = interval;
-    static char msg[S_BUF_LEN],                 /* prompt */
-                str[XS_BUF_LEN];                /* entered value */
-    bool with_esc;
-    unsigned int offset = 0;			/* additional offset for message */
-
-    wprintw(window, "Change refresh (min 1, max 300, current %i) to ", interval / 1000000);
-    wrefresh(window);
-
-    /* calculate additional offset equals number of digits in interval */
-    while ((interval / 1000000) != 0) {
-      interval /= 10;
-      ++offset;
-    }
-    /* restore current interval */
-    interval = interval_save;
-
-    /* use offset 45 that equals message constructed above and printed by ncurses */
-    cmd_readline(window, msg, 45 + offset, &with_esc, str, sizeof(str), true);
+    const unsigned char * entry;
 
-    if (strlen(str) != 0 && with_esc == false) {
-        if (strlen(str) != 0) {
-            interval = atol(str);
-            if (interval < 1) {
-                wprintw(window, "Should not be less than 1 second.");
-                interval = interval_save;
-            } else if (interval > INTERVAL_MAXLEN) {
-                wprintw(window, "Should not be more than 300 seconds.");
-                interval = INTERVAL_MAXLEN * 1000000;
-            } else {
-                interval = interval * 1000000;
-            }
-        }
-    } else if (strlen(str) == 0 && with_esc == false ) {
-        wprintw(window, "Leave old value: %i seconds.", interval_save / 1000000);
-        interval = interval_save;
+    if (rep->idx_map == NULL) {
+        *wall = rep->index_wall[i];
+        return rep->index_offset[i];
     }
 
-    return interval;
+    entry = rep->idx_map + (size_t) i * RECORD_INDEX_ENTRY_LEN;
+    *wall = record_get_fixed(entry, 8);
+    return record_get_fixed(entry + 8, 8);
 }
 
 /*
- ****************************************************** key press function **
- * Pause pgcenter execution.
+ ********************************************************* replay function **
+ * Map file for reading or change length of existing mapping.
  *
  * IN:
- * @window              Window where diag message will be printed.
- * @interval            Sleep interval.
+ * @map             Existing mapping, NULL if file isn't mapped yet.
+ * @len             Length of existing mapping.
+ * @fd              File descriptor, it's used only for new mapping.
+ * @size            New length of mapping.
+ *
+ * RETURNS:
+ * Pointer to the mapping, NULL if size is zero.
  ****************************************************************************
  */
-void do_noop(WINDOW * window, unsigned long interval)
+const unsigned char * map_file(const unsigned char * map, size_t len, int fd, size_t size)
 {
-    bool paused = true;
-    unsigned int sleep_usec;
-    int ch;
+    void * ptr;
 
-    while (paused != false) {
-        wprintw(window, "Pause, press any key to resume.");
-        wrefresh(window);
-        /* sleep */
-        for (sleep_usec = 0; sleep_usec < interval; sleep_usec += INTERVAL_STEP) {
-            if ((ch = getch()) != ERR) {
-                paused = false;
-                break;
-            } else {
-                usleep(INTERVAL_STEP);
-                if (interval > DEFAULT_INTERVAL && sleep_usec == DEFAULT_INTERVAL) {
-                    wrefresh(window);
-                    wclear(window);
-                }
-            }
-        }
-        wclear(window);
+    if (size == len)
+        return map;
+    if (size == 0) {
+        munmap((void *) map, len);
+        return NULL;
+    }
+
+    ptr = (map == NULL)
+        ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0)
+        : mremap((void *) map, len, size, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+        mreport(true, msg_fatal, "FATAL: mmap of stats record failed: %s.\n", strerror(errno));
     }
+    return ptr;
 }
 
 /*
- ****************************************************** key-press function **
- * Switch on/off displaying content from system view
+ ********************************************************* replay function **
+ * Map time-series file and keyframes index file, or resize mappings when
+ * files are changed by recorder. Index file is mapped again when it's
+ * replaced by restarted recorder.
  *
  * IN:
- * @window              Window where diag messages will be printed.
- * @screen              Current screen.
- * @first_iter          Reset counters flag.
+ * @rep             Replay state.
  ****************************************************************************
  */
-void system_view_toggle(WINDOW * window, struct screen_s * screen, bool * first_iter)
+void map_replay_file(struct replay_s * rep)
 {
-    screen->pg_stat_sys ^= 1;
-    if (screen->pg_stat_sys)
-        wprintw(window, "Show system tables: on");
-    else
-        wprintw(window, "Show system tables: off");
+    struct stat st;
+    int fd;
 
-    *first_iter = true;
+    if (fstat(rep->fd, &st) == -1) {
+        mreport(true, msg_fatal, "FATAL: can't stat stats record: %s.\n", strerror(errno));
+    }
+    rep->map = map_file(rep->map, rep->map_len, rep->fd, st.st_size);
+    rep->map_len = st.st_size;
 
+    /* index is optional, keyframes are found by walking over frames without it */
+    if (stat(rep->idx_path, &st) == -1)
+        return;
+
+    if (rep->idx_map != NULL && st.st_ino == rep->idx_ino) {
+        rep->idx_map = map_file(rep->idx_map, rep->idx_len, -1, st.st_size);
+        rep->idx_len = st.st_size;
+        return;
+    }
+
+    if ((fd = open(rep->idx_path, O_RDONLY)) == -1)
+        return;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        rep->idx_map = map_file(rep->idx_map, rep->idx_len, -1, 0);
+        rep->idx_map = map_file(NULL, 0, fd, st.st_size);
+        rep->idx_len = st.st_size;
+        rep->idx_ino = st.st_ino;
+    }
+    close(fd);
 }
 
 /*
- ***************************************************** log process routine **
- * Get current postgresql logfile path
+ ********************************************************* replay function **
+ * Open and map time-series file for replay. Without index file keyframes
+ * are found by walking over frames.
  *
  * IN:
- * @path                Log file location.
- * @conn                Current postgresql connection.
+ * @path            Time-series file path.
+ *
+ * OUT:
+ * @rep             Replay state.
  ****************************************************************************
  */
-void get_logfile_path(char * path, PGconn * conn)
+void open_replay_file(struct replay_s * rep, const char * path)
 {
-    PGresult *res;
-    char errmsg[ERRSIZE],
-         q1[] = "show data_directory",
-         q2[] = "show log_directory",
-         q3[] = "show log_filename",
-         q4[] = "select to_char(pg_postmaster_start_time(), 'HH24MISS')",
-         logdir[PATH_MAX], logfile[NAME_MAX], datadir[PATH_MAX],
-         path_tpl[PATH_MAX + NAME_MAX],
-         path_log[PATH_MAX + NAME_MAX],
-         path_log_fallback[PATH_MAX + NAME_MAX] = "";
+    unsigned int i, len;
+    off_t pos;
 
-    path[0] = '\0';
-    if ((res = do_query(conn, q2, errmsg)) == NULL) {
-        PQclear(res);
-        return;
+    memset(rep, 0, sizeof(struct replay_s));
+    for (i = 0; i < TOTAL_CONTEXTS; i++) {
+        rep->rec.c_snaps[i] = init_snapshot();
+        rep->rec.p_snaps[i] = init_snapshot();
     }
-    snprintf(logdir, sizeof(logdir), "%s", PQgetvalue(res, 0, 0));
-    PQclear(res);
 
-    if ( logdir[0] != '/' ) {
-        if ((res = do_query(conn, q1, errmsg)) == NULL) {
-            PQclear(res);
-            return;
-        }
-	snprintf(datadir, sizeof(datadir), "%s", PQgetvalue(res, 0, 0));
-	snprintf(path_tpl, sizeof(path_tpl), "%s/%s/", datadir, logdir);
-        PQclear(res);
-    } else {
-	snprintf(path_tpl, sizeof(path_tpl), "%s/", logdir);
+    if ((rep->fd = open(path, O_RDONLY)) == -1) {
+        mreport(true, msg_fatal, "FATAL: can't open %s: %s.\n", path, strerror(errno));
     }
+    snprintf(rep->idx_path, sizeof(rep->idx_path), "%s%s", path, RECORD_INDEX_SUFFIX);
+    map_replay_file(rep);
 
-    if ((res = do_query(conn, q3, errmsg)) == NULL) {
-        PQclear(res);
-        return;
-    }
-    snprintf(logfile, sizeof(logfile), "%s", PQgetvalue(res, 0, 0));
-    snprintf(path_tpl + strlen(path_tpl), sizeof(path_tpl) - strlen(path_tpl), "%s", logfile);
-    PQclear(res);
-    
-    /*
-     * PostgreSQL defaults for log_filename is postgresql-%Y-%m-%d_%H%M%S.log. 
-     * It can be issue, because log file named by this template on postamster startup.
-     * Therefore we must know postmaster startup time for determining real log name.
-     * But, on log rotation, new log name get _000000.log suffix. Thus log can have two names:
-     * _123456.log (example) or _000000.log. If first log doesn't exist we try to use _000000.log.
-     */
-    /* check that the log_filename have %H%M%S pattern */
-    if (strstr(path_tpl, "%H%M%S") != NULL) {
-        snprintf(path_log, sizeof(path_log), "%s", path_tpl);
-        snprintf(path_log_fallback, sizeof(path_log_fallback), "%s", path_tpl);
-        if((res = do_query(conn, q4, errmsg)) == NULL) {
-            PQclear(res);
-            return;
-        }
-        strrpl(path_log, "%H%M%S", PQgetvalue(res, 0, 0), sizeof(path_log));
-        strrpl(path_log_fallback, "%H%M%S", "000000", sizeof(path_log_fallback));
-        PQclear(res);
-    } else {
-        snprintf(path_log, sizeof(path_log), "%s", path_tpl);
+    if (rep->map_len < RECORD_HEADER_LEN || memcmp(rep->map, RECORD_MAGIC, RECORD_MAGIC_LEN) != 0) {
+        mreport(true, msg_fatal, "FATAL: %s is not a %s stats record.\n", path, PROGRAM_NAME);
     }
+    /* rates are calculated with HZ of recorded system */
+    hz = record_get_fixed(rep->map + RECORD_MAGIC_LEN, 4);
+    rep->offset = RECORD_HEADER_LEN;
 
-    /* translate log_filename pattern string in real path */
-    time_t rawtime;
-    struct tm *info;
-
-    time( &rawtime );
-    info = localtime( &rawtime );
-    strftime(path, PATH_MAX, path_log, info);
-
-    /* if file exists, return path */
-    if (access(path, F_OK ) != -1 ) {
-        return;
-    } 
-    
-    /* if previous condition failed, try use _000000.log name */
-    if (strlen(path_log_fallback) != 0) {
-        strftime(path, PATH_MAX, path_log_fallback, info);
-        return;
-    } else {
-        path[0] = '\0';
+    if (rep->idx_map != NULL)
         return;
+
+    /* frame header is length, type and wall time */
+    for (pos = RECORD_HEADER_LEN; pos + 13 <= (off_t) rep->map_len; pos += 4 + len) {
+        len = record_get_fixed(rep->map + pos, 4);
+        if (len < 13 || pos + 4 + len > (off_t) rep->map_len)
+            break;
+        if (rep->map[pos + 4] == frame_keyframe)
+            add_replay_index(rep, record_get_fixed(rep->map + pos + 5, 8), pos);
     }
 }
 
 /*
- *************************************************** iostat stuff function **
- * Count block devices in /proc/diskstat.
+ ********************************************************* replay function **
+ * Decode next frame directly from the mapping. File is mapped again when
+ * its end is reached, so file which is still recorded is followed. Pages
+ * behind current position are released by chunks, so long replay or scan
+ * doesn't grow resident memory. Corrupted frame is skipped, frames are
+ * decoded again from the next keyframe.
+ *
+ * IN:
+ * @rep             Replay state.
  *
  * RETURNS:
- * Return number of block devices.
+ * True if frame is decoded, false if there are no more complete frames or
+ * frame is corrupted.
  ****************************************************************************
  */
-unsigned int count_block_devices(void)
+bool read_replay_frame(struct replay_s * rep)
 {
-    FILE * fp;
-    unsigned int bdev = 0;
-    char ch;
+    const unsigned char * data;
+    unsigned int len;
+    long long wall;
+    off_t release;
+
+    rep->corrupted = false;
+    if (rep->offset + 4 > (off_t) rep->map_len)
+        map_replay_file(rep);
+    if (rep->offset + 4 > (off_t) rep->map_len)
+        return false;
 
-    /* At program start, if statfile read failed, then allocate array for 10 devices. */
-    if ((fp = fopen(DISKSTATS_FILE, "r")) == NULL) {
-        return 10;
+    len = record_get_fixed(rep->map + rep->offset, 4);
+    if (rep->offset + 4 + len > (off_t) rep->map_len)
+        map_replay_file(rep);
+    if (rep->offset + 4 + len > (off_t) rep->map_len)
+        return false;
+
+    data = rep->map + rep->offset + 4;
+    if (read_record_frame(&rep->rec, data, len, &wall) == false) {
+        rep->corrupted = true;
+        rep->offset += 4 + len;
+        return false;
     }
 
-    while (!feof(fp)) {
-        ch = fgetc(fp);
-        if (ch == '\n')
-            bdev++;
+    if (rep->idx_map == NULL && data[0] == frame_keyframe)
+        add_replay_index(rep, wall, rep->offset);
+    rep->offset += 4 + len;
+    rep->wall = wall;
+    rep->decoded = true;
+
+    release = rep->offset & ~((off_t) sysconf(_SC_PAGESIZE) - 1);
+    if (release - rep->released >= REPLAY_RELEASE_LEN) {
+        madvise((void *) (rep->map + rep->released), release - rep->released, MADV_DONTNEED);
+        rep->released = release;
     }
+    return true;
+}
 
-    fclose(fp);
-    return bdev;
+/*
+ ********************************************************* replay function **
+ * Seek to the last frame which isn't later than specified time. Keyframes
+ * index is binary searched for the closest preceding keyframe, frames
+ * following it are decoded up to the target time.
+ *
+ * IN:
+ * @rep             Replay state.
+ * @target          Wall clock time, in microseconds.
+ ****************************************************************************
+ */
+void seek_replay(struct replay_s * rep, long long target)
+{
+    unsigned int lo = 0, hi, mid;
+    long long wall;
+    off_t offset;
+
+    /* keyframes might be added since file was mapped */
+    map_replay_file(rep);
+    hi = count_replay_index(rep);
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        get_replay_index(rep, mid, &wall);
+        if (wall <= target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    rep->offset = RECORD_HEADER_LEN;
+    if (lo > 0 && (offset = get_replay_index(rep, lo - 1, &wall)) > RECORD_HEADER_LEN
+            && offset < (off_t) rep->map_len)
+        rep->offset = offset;
+    rep->rec.frames = 0;
+    rep->released = 0;
+
+    /* frames following keyframe are decoded while they aren't later than target */
+    while (read_replay_frame(rep) || rep->corrupted) {
+        if (rep->offset + 13 > (off_t) rep->map_len
+                || (long long) record_get_fixed(rep->map + rep->offset + 5, 8) > target)
+            break;
+    }
 }
 
 /*
- *************************************************** iostat stuff function **
- * Count NIC devices in /proc/net/dev.
+ ********************************************************* replay function **
+ * Print sysstat screen using decoded sample.
+ *
+ * IN:
+ * @window          Window where stats will be printed.
+ * @rep             Replay state.
+ * @screen          Current screen.
+ * @path            Time-series file path.
+ * @speed           Frames per refresh.
+ * @paused          Replay is paused.
+ ****************************************************************************
+ */
+void print_replay_summary(WINDOW * window, struct replay_s * rep, struct screen_s * screen,
+        const char * path, unsigned int speed, bool paused)
+{
+    struct record_s * rec = &rep->rec;
+    struct cpu_s * st_cpu[2] = { &rec->cpu[0][0], &rec->cpu[1][0] };
+    unsigned int curr = rec->curr;
+    char strtime[20];
+    time_t t = rep->wall / 1000000;
+
+    strftime(strtime, sizeof(strtime), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    wprintw(window, "%s: %s, ", PROGRAM_NAME, strtime);
+    wprintw(window, "load average: %.2f, %.2f, %.2f\n",
+            rec->la[curr][0] / 100.0, rec->la[curr][1] / 100.0, rec->la[curr][2] / 100.0);
+    write_cpu_stat_raw(window, st_cpu, curr, get_interval(rec->uptime[!curr], rec->uptime[curr]));
+    write_mem_stat(window, &rec->mem[curr]);
+
+    mvwprintw(window, 0, COLS / 2, "replay [%s x%u]: %s (up %s)",
+            paused ? "paused" : "playing", speed, path, rec->pg_stats[curr].uptime);
+    print_postgres_activity(window, &rec->pg_stats[curr]);
+    print_vacuum_info(window, screen, &rec->pg_stats[curr]);
+    print_pgss_info(window, &rec->pg_stats[curr]);
+}
+
+/*
+ ********************************************************* replay function **
+ * Parse time of recorded stats. Time without date means time of the day of
+ * base time.
+ *
+ * IN:
+ * @str             Time in YYYY-MM-DD HH:MM:SS or HH:MM:SS format.
+ * @base            Wall clock time, in microseconds.
+ *
+ * OUT:
+ * @result          Wall clock time, in microseconds.
  *
  * RETURNS:
- * Return number of interfaces.
+ * True if time is valid.
  ****************************************************************************
  */
-unsigned int count_nic_devices(void)
+bool parse_record_time(const char * str, long long base, long long * result)
 {
-    FILE * fp;
-    unsigned int idev = 0;
-    char ch;
-
-    /* At program start, if statfile read failed, then allocate array for 10 devices. */
-    if ((fp = fopen(NETDEV_FILE, "r")) == NULL) {
-        return 10;
-    }
-
-    while (!feof(fp)) {
-        ch = fgetc(fp);
-        if (ch == '\n')
-            idev++;
+    time_t t = base / 1000000;
+    struct tm tm;
+    char * end;
+
+    localtime_r(&t, &tm);
+    if ((end = strptime(str, "%Y-%m-%d %H:%M:%S", &tm)) == NULL || *end != '\0') {
+        localtime_r(&t, &tm);
+        if ((end = strptime(str, "%H:%M:%S", &tm)) == NULL || *end != '\0')
+            return false;
     }
+    tm.tm_isdst = -1;
 
-    /* header has two lines */
-    idev = idev - 2;
-
-    fclose(fp);
-    return idev;
+    *result = (long long) mktime(&tm) * 1000000;
+    return true;
 }
+
 /*
- ****************************************************** key press function **
- * Log processing, open log in separate window or close if already opened.
+ ********************************************************* replay function **
+ * Ask time and seek replay to it. Time without date means time of the
+ * currently shown day.
  *
  * IN:
- * @window              Window where cmd status will be printed.
- * @w_sub               Pointer to window where log will be shown.
- * @screen              Array of connections options.
- * @conn                Current postgresql connection.
+ * @window          Window where prompt will be printed.
+ * @rep             Replay state.
  ****************************************************************************
  */
-void subscreen_process(WINDOW * window, WINDOW ** w_sub, struct screen_s * screen, PGconn * conn, unsigned int subscreen)
+void goto_replay_time(WINDOW * window, struct replay_s * rep)
 {
-    if (!screen->subscreen_enabled) {
-        /* open subscreen */
-        switch (subscreen) {
-            case SUBSCREEN_LOGTAIL:
-                if (check_pg_listen_addr(screen, conn)) {
-                    *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
-                    wrefresh(window);
-                    /* get logfile path  */
-                    get_logfile_path(screen->log_path, conn);
-    
-                    if (strlen(screen->log_path) == 0) {
-                        wprintw(window, "Do nothing. Unable to determine log filename or no access permissions.");
-                        return;
-                    }
-                    if ((screen->log_fd = open(screen->log_path, O_RDONLY)) == -1 ) {
-                        wprintw(window, "Do nothing. Failed to open %s", screen->log_path);
-                        return;
-                    }
-                    screen->subscreen = SUBSCREEN_LOGTAIL;
-                    screen->subscreen_enabled = true;
-                    wprintw(window, "Open postgresql log: %s", screen->log_path);
-                    return;
-                } else {
-                    wprintw(window, "Do nothing. Log file view is not supported for remote hosts.");
-                    return;
-                }
-                break;
-            case SUBSCREEN_IOSTAT:
-                if (access(DISKSTATS_FILE, R_OK) == -1) {
-                    wprintw(window, "Do nothing. No access to %s.", DISKSTATS_FILE);
-                    return;
-                }
-                wprintw(window, "Show iostat");
-                *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
-                screen->subscreen = SUBSCREEN_IOSTAT;
-                screen->subscreen_enabled = true;
-                break;
-            case SUBSCREEN_NICSTAT:
-                if (access(NETDEV_FILE, R_OK) == -1) {
-                    wprintw(window, "Do nothing. No access to %s.", NETDEV_FILE);
-                    return;
-                }
-                wprintw(window, "Show nicstat");
-                *w_sub = newwin(0, 0, ((LINES * 2) / 3), 0);
-                screen->subscreen = SUBSCREEN_NICSTAT;
-                screen->subscreen_enabled = true;
-                break;
-            case SUBSCREEN_NONE:
-                screen->subscreen = SUBSCREEN_NONE;
-                screen->subscreen_enabled = false;
-        }
-    } else {
-        /* close subscreen */
-        wclear(*w_sub);
-        wrefresh(*w_sub);
-        if (screen->log_fd > 0)
-            close(screen->log_fd);
-        screen->subscreen = SUBSCREEN_NONE;
-        screen->subscreen_enabled = false;
+    const char * msg = "Go to time (YYYY-MM-DD HH:MM:SS or HH:MM:SS): ";
+    char str[S_BUF_LEN];
+    long long target;
+    bool with_esc;
+
+    cmd_readline(window, msg, strlen(msg), &with_esc, str, sizeof(str), true);
+    if (strlen(str) == 0 || with_esc)
+        return;
+
+    if (parse_record_time(str, rep->wall, &target) == false) {
+        wprintw(window, "Invalid time: %s.", str);
         return;
     }
+
+    seek_replay(rep, target);
+    wprintw(window, "Go to %s.", str);
 }
 
 /*
- ******************************************************** routine function **
- * Tail postgresql log. 
+ ********************************************************* replay function **
+ * Replay mode: console is driven by frames of time-series file instead of
+ * live connection. Frames are shown with 1 second refresh, speed can be
+ * increased and replay can be moved back and forth. Subscreens and actions
+ * which need postgres connection aren't available.
  *
  * IN:
- * @window          Window where log will be printed.
- * @w_cmd           Window where diag messages will be printed.
- * @screen          Current screen.
- * @conn            Current postgresql connection.
+ * @args            Input arguments with time-series file path.
+ * @screen          Screen used for context, sorting and filtering options.
  ****************************************************************************
  */
-void print_log(WINDOW * window, WINDOW * w_cmd, struct screen_s * screen, PGconn * conn)
+void replay_stats(struct args_s * args, struct screen_s * screen)
 {
-    unsigned int x, y;                                          /* window coordinates */
-    unsigned int n_lines = 1, n_cols = 1;                       /* number of rows and columns for printing */
-    struct stat stats;                                          /* file stat struct */
-    off_t end_pos;                                              /* end of file position */
-    off_t pos;                                                  /* from this position start read of file */
-    size_t bytes_read;                                          /* bytes read from file to buffer */
-    char buffer[XL_BUF_LEN] = "";                               /* init empty buffer */
-    unsigned int i, nl_count = 0, len, scan_pos;                /* iterator, newline counter, buffer length, in-buffer scan position */
-    char *nl_ptr;                                               /* in-buffer newline pointer */
-
-    getbegyx(window, y, x);                                     /* get window coordinates */
-    /* calculate number of rows for log tailing, 2 is the number of lines for screen header */
-    n_lines = LINES - y - 2;                                    /* calculate number of rows for log tailing */
-    n_cols = COLS - x - 1;                                      /* calculate number of chars in row for cutting multiline log entries */
-    wclear(window);                                             /* clear log window */
+    struct replay_s rep;
+    WINDOW *w_sys, *w_cmd, *w_dba;
+    unsigned int ws_color, wc_color, wa_color, wl_color;
+    unsigned int i, speed = 1;
+    unsigned long sleep_usec;
+    bool paused = false, first_iter = true;
+    struct snapshot_s * snap;
+    int ch;
 
-    if ((fstat(screen->log_fd, &stats)) == -1) {
-	wprintw(w_cmd, "Failed to stat %s", screen->log_path);
-	wrefresh(w_cmd);
-	return;
+    /* connection isn't opened, but screen contexts are used */
+    activate_screen(screen);
+    open_replay_file(&rep, args->replay_file);
+    if (read_replay_frame(&rep) == false) {
+        mreport(true, msg_fatal, "FATAL: %s has no complete frames.\n", args->replay_file);
     }
-    if (S_ISREG (stats.st_mode) && stats.st_size != 0) {        /* log should be a non-empty regular file */
-        end_pos = lseek(screen->log_fd, 0, SEEK_END);           /* get end of file position */
-        pos = end_pos;                                          /* set position to the end of file */
-        bytes_read = XL_BUF_LEN;                                /* read with 8KB block */
-        if (end_pos < XL_BUF_LEN)                               /* if end file pos less than buffer */
-            pos = 0;                                            /* than set read position to the begin of file */
-        else                                                    /* if end file pos more than buffer */
-            pos = pos - bytes_read;                             /* than set read position into end of file minus buffer size */
-        lseek(screen->log_fd, pos, SEEK_SET);                       /* set determined position in file */
-        bytes_read = read(screen->log_fd, buffer, bytes_read);      /* read file to the buffer */
 
-        len = strlen(buffer);                                   /* determine the buffer length */
-        scan_pos = len;                                         /* set in-buffer scan position equal buffer length */
+    initscr();
+    cbreak();
+    noecho();
+    nodelay(stdscr, TRUE);
+    keypad(stdscr,TRUE);
+    set_escdelay(100);
 
-        /* print header */
-        wattron(window, A_BOLD);
-        wprintw(window, "\ntail %s\n", screen->log_path);
-        wattroff(window, A_BOLD);
+    w_sys = newwin(5, 0, 0, 0);
+    w_cmd = newwin(1, 0, 4, 0);
+    w_dba = newwin(0, 0, 5, 0);
 
-        for (i = 0; i < len; i++)                               /* get number of newlines in the buffer */
-            if (buffer[i] == '\n')
-                nl_count++;
-        if (n_lines > nl_count) {                               /* if number of newlines less than required */
-            wprintw(window, "%s", buffer);                      /* then print out buffer content */
-            wrefresh(window);
-            return;                                             /* and finish work */
-        }
+    init_colors(&ws_color, &wc_color, &wa_color, &wl_color);
+    curs_set(0);
 
-        /*
-         * at this place, log size more than buffersize, fill the buffer 
-         * and find \n position from which start printing.
-         */
-        unsigned int n_lines_save = n_lines;                    /* save number of lines need for tail. */
-        do {
-            nl_ptr = memrchr(buffer, '\n', scan_pos);           /* find \n from scan_pos */
-            if (nl_ptr != NULL) {                               /* if found */
-                scan_pos = (nl_ptr - buffer);                   /* remember this place */
-            } else {                                            /* if not found */
-                break;                                          /* finish work */
+    while (1) {
+        wattron(w_sys, COLOR_PAIR(ws_color));
+        wattron(w_dba, COLOR_PAIR(wa_color));
+        wattron(w_cmd, COLOR_PAIR(wc_color));
+
+        if (key_is_pressed()) {
+            curs_set(1);
+            ch = getch();
+            switch (ch) {
+                case 32:                /* pause replay with 'space' */
+                    paused = !paused;
+                    wclear(w_cmd);
+                    wprintw(w_cmd, paused ? "Pause replay." : "Continue replay.");
+                    break;
+                case '+': case '-':     /* change replay speed */
+                    speed = (ch == '+') ? MIN(speed * 2, REPLAY_MAX_SPEED) : MAX(speed / 2, 1);
+                    wclear(w_cmd);
+                    wprintw(w_cmd, "Replay speed: x%u.", speed);
+                    break;
+                case '[': case ']':     /* rewind or fast-forward */
+                    seek_replay(&rep, rep.wall + (ch == ']' ? 1 : -1) * REPLAY_STEP * 1000000LL);
+                    wclear(w_cmd);
+                    wprintw(w_cmd, "%s %i seconds.", (ch == ']') ? "Forward" : "Rewind", REPLAY_STEP);
+                    break;
+                case '{': case '}':     /* long rewind or fast-forward */
+                    seek_replay(&rep, rep.wall + (ch == '}' ? 1 : -1) * REPLAY_LONG_STEP * 1000000LL);
+                    wclear(w_cmd);
+                    wprintw(w_cmd, "%s %i seconds.", (ch == '}') ? "Forward" : "Rewind", REPLAY_LONG_STEP);
+                    break;
+                case 'g':               /* go to specified time */
+                    wclear(w_cmd);
+                    goto_replay_time(w_cmd, &rep);
+                    break;
+                case 260:               /* shift sort order with left arrow */
+                    change_sort_order(screen, false, &first_iter);
+                    break;
+                case 261:               /* shift sort order with right arrow */
+                    change_sort_order(screen, true, &first_iter);
+                    break;
+                case 47:                /* switch order desc/asc */
+                    change_sort_order_direction(screen, &first_iter);
+                    break;
+                case 'd':
+                    switch_context(w_cmd, screen, pg_stat_database, &first_iter);
+                    break;
+                case 'r':
+                    switch_context(w_cmd, screen, pg_stat_replication, &first_iter);
+                    break;
+                case 't':
+                    switch_context(w_cmd, screen, pg_stat_tables, &first_iter);
+                    break;
+                case 'i':
+                    switch_context(w_cmd, screen, pg_stat_indexes, &first_iter);
+                    break;
+                case 'T':
+                    switch_context(w_cmd, screen, pg_statio_tables, &first_iter);
+                    break;
+                case 's':
+                    switch_context(w_cmd, screen, pg_tables_size, &first_iter);
+                    break;
+                case 'a':
+                    switch_context(w_cmd, screen, pg_stat_activity_long, &first_iter);
+                    break;
+                case 'f':
+                    switch_context(w_cmd, screen, pg_stat_functions, &first_iter);
+                    break;
+                case 'v':
+                    switch_context(w_cmd, screen, pg_stat_progress_vacuum, &first_iter);
+                    break;
+                case 'b':
+                    switch_context(w_cmd, screen, pg_stat_backends, &first_iter);
+                    break;
+                case 'x':
+                    pgss_switch(w_cmd, screen, &first_iter);
+                    break;
+                case 'X':
+                    pgss_menu(w_cmd, w_dba, screen, &first_iter);
+                    break;
+                case 'F':               /* set filtering for a column */
+                    set_filter(w_cmd, screen, &first_iter);
+                    break;
+                case 'q':               /* exit program */
+                    endwin();
+                    exit(EXIT_SUCCESS);
+                    break;
+                default:
+                    wclear(w_cmd);
+                    wprintw(w_cmd, "Command isn't available in replay mode.");
+                    flushinp();
+                    break;
             }
-            n_lines--;                                          /* after each iteration decrement the line counter */
-        } while (n_lines != 0);                                 /* stop cycle when line counter equal zero - we found need amount of lines */
+            curs_set(0);
+        } else {
+            /* frames are skipped with higher speed, file which is still recorded is followed */
+            for (i = 0; paused == false && i < speed; i++)
+                if (read_replay_frame(&rep) == false && rep.corrupted == false)
+                    break;
 
-        /* now we should cut multiline log entries to screen length */
-        char str[n_cols];                                       /* use var for one line */
-        char tmp[XL_BUF_LEN];                                   /* tmp var for line from buffer */
-        do {                                                    /* scan buffer from begin */
-            nl_ptr = strstr(buffer, "\n");                      /* find \n in buffer */
-            if (nl_ptr != NULL) {                               /* if found */
-                if (nl_count > n_lines_save) {                              /* and if lines too much, skip them */
-                    snprintf(buffer, sizeof(buffer), "%s", nl_ptr + 1);     /* decrease buffer, cut skipped line */
-                    nl_count--;                                             /* decrease newline counter */
-                    continue;                                   /* start next iteration */
-                }                                                       /* at this place we have sufficient number of lines for tail */
-                snprintf(tmp, nl_ptr - buffer + 1, "%s", buffer);       /* copy log line into temp buffer */
-                if (strlen(tmp) > n_cols) {                             /* if line longer than screen size (multiline), truncate line to screen size */
-                    snprintf(str, n_cols - 4, "%s", buffer);
-                } else {                                                /* if line have normal size, copy line as is */
-                    snprintf(str, strlen(tmp) + 1, "%s", buffer);
-                }
-                wprintw(window, "%s\n", str);                           /* print line to log screen */
-                snprintf(buffer, sizeof(buffer), "%s", nl_ptr + 1);     /* decrease buffer, cut printed line */
+            wclear(w_sys);
+            print_replay_summary(w_sys, &rep, screen, args->replay_file, speed, paused);
+            wrefresh(w_sys);
+
+            /* contexts which weren't sampled in the frame aren't shown */
+            if (rep.rec.sampled[screen->current_context]) {
+                snap = rep.rec.c_snaps[screen->current_context];
+                sort_array(snap, screen);
+                print_data(w_dba, snap, screen);
             } else {
-                break;                                                  /* if \n not found, finish work */
+                wclear(w_dba);
+                wprintw(w_dba, "No recorded data for current context.");
+                wrefresh(w_dba);
             }
-            n_lines++;                                                  /* after each iteration, increase newline counter */
-        } while (n_lines != n_lines_save);                              /* print lines until newline counter not equal saved newline counter */
-    } else {
-        wprintw(w_cmd, "Do nothing. Log is not a regular file or empty.");     /* if file not regular or empty */
-        subscreen_process(w_cmd, &window, screen, conn, SUBSCREEN_NONE);    /* close log file and log screen */
+
+            wrefresh(w_cmd);
+            wclear(w_cmd);
+
+            for (sleep_usec = 0; sleep_usec < DEFAULT_INTERVAL; sleep_usec += INTERVAL_STEP)
+                if (wait_for_input(NULL, INTERVAL_STEP / 1000) == false)
+                    break;
+        }
+    }
+}
+
+/*
+ ********************************************************* report function **
+ * Initialize report state for context or subscreen specified by name.
+ *
+ * IN:
+ * @args            Input arguments with report options.
+ *
+ * OUT:
+ * @report          Empty report state.
+ ****************************************************************************
+ */
+void init_report(struct report_s * report, struct args_s * args)
+{
+    unsigned int i;
+
+    memset(report, 0, sizeof(struct report_s));
+    if (strcmp(args->report_context, REPORT_IOSTAT) == 0) {
+        report->subscreen = SUBSCREEN_IOSTAT;
+        return;
+    }
+    if (strcmp(args->report_context, REPORT_NICSTAT) == 0) {
+        report->subscreen = SUBSCREEN_NICSTAT;
+        return;
     }
-    
-    wrefresh(window);
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        if (strcmp(args->report_context, context_names[i]) == 0)
+            break;
+    if (i == TOTAL_CONTEXTS) {
+        mreport(true, msg_fatal, "FATAL: unknown report context: %s.\n", args->report_context);
+    }
+    report->context = i;
+    report->acc = init_snapshot();
+    report->tmp = init_snapshot();
 }
 
 /*
- ****************************************************** key press function **
- * Open log in $PAGER.
+ ********************************************************* report function **
+ * Merge context snapshot of the frame into aggregated rows. Rows are 
+ * matched by the same key columns as used for rates. Counters deltas are
+ * added to totals, other values are taken from the latest frame. Rows which
+ * are absent in the frame keep their totals.
  *
  * IN:
- * @window          Window where errors will be displayed.
- * @screen          Screen options.
- * @conn            Current connection.
+ * @report          Report state.
+ * @c               Snapshot of the frame, with rows matched by diff_arrays()
+ *                  with previous snapshot of the frame.
+ * @p               Snapshot of the previous frame.
  ****************************************************************************
  */
-void show_full_log(WINDOW * window, struct screen_s * screen, PGconn * conn)
+void aggregate_report_snapshot(struct report_s * report, struct snapshot_s * c, struct snapshot_s * p)
 {
-    pid_t pid;
+    struct snapshot_s * acc = report->acc, * tmp = report->tmp;
+    unsigned int i, j, row, n_rows = c->n_rows;
+    size_t data_len = 0;
+    long long delta;
+    int a;
+
+    /* rows of snapshots with other columns or without key can't be merged */
+    if (acc->n_cols != c->n_cols || acc->key != c->key || c->key == 0)
+        acc->n_rows = 0;
+
+    if (c->n_rows > report->rows_size) {
+        report->rows_size = c->n_rows * 2;
+        if ((report->rows = realloc(report->rows, sizeof(int) * report->rows_size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for report rows failed.\n");
+        }
+    }
+    if (acc->n_rows > report->matched_size) {
+        report->matched_size = acc->n_rows * 2;
+        if ((report->matched = realloc(report->matched, sizeof(bool) * report->matched_size)) == NULL) {
+            mreport(true, msg_fatal, "FATAL: realloc for report rows failed.\n");
+        }
+    }
+    memset(report->matched, 0, sizeof(bool) * acc->n_rows);
+
+    /* find aggregated rows and calculate space for text values */
+    if (acc->n_rows > 0)
+        build_snapshot_hash(acc, c->key);
+    for (i = 0; i < c->n_rows; i++) {
+        a = (acc->n_rows > 0) ? find_snapshot_row(acc, c, i, c->key) : -1;
+        report->rows[i] = a;
+        if (a != -1)
+            report->matched[a] = true;
+        for (j = 0; j < c->n_cols; j++)
+            if (c->cols[j].type != col_counter)
+                data_len += SNAPSHOT_CELL(c, i, j)->len + 1;
+    }
+    for (i = 0; i < acc->n_rows; i++) {
+        if (report->matched[i])
+            continue;
+        n_rows++;
+        for (j = 0; j < acc->n_cols; j++)
+            if (acc->cols[j].type != col_counter)
+                data_len += SNAPSHOT_CELL(acc, i, j)->len + 1;
+    }
 
-    if (check_pg_listen_addr(screen, conn)) {
-        /* get logfile path  */
-        get_logfile_path(screen->log_path, conn);
-        if (strlen(screen->log_path) != 0) {
-            /* escape from ncurses mode */
-            refresh();
-            endwin();
-            pid = fork();                   /* start child */
-            if (pid == 0) {
-                /* get pager from environment variables, otherwise use default pager */
-                static char pager[S_BUF_LEN];
-                if (getenv("PAGER") != NULL)
-                    snprintf(pager, sizeof(pager), "%s", getenv("PAGER"));
-                else
-                    snprintf(pager, sizeof(pager), "%s", DEFAULT_PAGER);
-                execlp(pager, pager, screen->log_path, NULL);
-                exit(EXIT_SUCCESS);
-            } else if (pid < 0) {
-                wprintw(window, "ERROR: fork failed, can't open %s.", screen->log_path);
-                return;
-            } else if (waitpid(pid, NULL, 0) != pid) {
-                wprintw(window, "ERROR: waitpid failed.");
-                return;
+    reserve_snapshot(tmp, n_rows, c->n_cols, data_len);
+    for (j = 0; j < c->n_cols; j++)
+        set_snapshot_column(tmp, j, c->cols[j].name, c->cols[j].type);
+    tmp->key = c->key;
+    tmp->monotonic = c->monotonic;
+    tmp->ts = c->ts;
+
+    for (i = 0; i < c->n_rows; i++) {
+        a = report->rows[i];
+        for (j = 0; j < c->n_cols; j++) {
+            if (c->cols[j].type != col_counter) {
+                record_copy_value(tmp, i, c, i, j);
+                continue;
             }
-        } else {
-            wprintw(window, "Do nothing. Unable to determine log filename (not SUPERUSER?) or no access permissions.");
+            /* deltas are taken in the same way as rates, rows appeared in the frame have no delta */
+            delta = 0;
+            if (c->prev[i] != -1 && p->cols[j].type == col_counter) {
+                delta = c->cols[j].counters[i] - p->cols[j].counters[c->prev[i]];
+                if (delta < 0 && c->monotonic)
+                    delta = 0;
+            }
+            if (a != -1 && acc->cols[j].type == col_counter)
+                delta += acc->cols[j].counters[a];
+            tmp->cols[j].counters[i] = delta;
+            tmp->cols[j].rates[i] = 0;
         }
-    } else {
-        wprintw(window, "Do nothing. Log file viewing is not supported for remote hosts.");
+    }
+    for (i = 0, row = c->n_rows; i < acc->n_rows; i++) {
+        if (report->matched[i])
+            continue;
+        for (j = 0; j < c->n_cols; j++)
+            record_copy_value(tmp, row, acc, i, j);
+        row++;
     }
 
-    /* return to ncurses mode */
-    refresh();
-    return;
+    report->acc = tmp;
+    report->tmp = acc;
 }
 
 /*
- ****************************************************** key-press function **
- * Reset PostgreSQL stat counters
+ ********************************************************* report function **
+ * Add devices counters deltas of the frame to devices totals. Devices are
+ * matched by names, so changed devices list doesn't mix their stats.
  *
  * IN:
- * @window              Window where result will be printed.
- * @conn                Current PostgreSQL connection.
+ * @report          Report state.
+ * @rec             Decoder state with decoded frame.
  ****************************************************************************
  */
-void pg_stat_reset(WINDOW * window, PGconn * conn, bool * reseted)
+void aggregate_report_iostat(struct report_s * report, struct record_s * rec)
 {
-    char errmsg[ERRSIZE];
-    PGresult * res;
+    struct iodata_s * c, * p, * t;
+    unsigned int i, k;
+
+    for (i = 0; i < rec->bdev; i++) {
+        c = rec->c_ios[i];
+        p = rec->p_ios[i];
+        /* devices list is changed in the frame, device has no previous stat */
+        if (strcmp(c->devname, p->devname) != 0)
+            continue;
 
-    if ((res = do_query(conn, PG_STAT_RESET_QUERY, errmsg)) != NULL) {
-        wprintw(window, "Reset statistics");
-        *reseted = true;
-    } else
-        wprintw(window, "Reset statistics failed: %s", errmsg);
-    
-    PQclear(res);
+        /* usually devices are in the same order in all frames */
+        k = i;
+        if (k >= report->n_ios || strcmp(report->ios[k].devname, c->devname) != 0)
+            for (k = 0; k < report->n_ios && strcmp(report->ios[k].devname, c->devname) != 0; k++)
+                ;
+        if (k == report->n_ios) {
+            if (report->n_ios == report->ios_size) {
+                report->ios_size = (report->ios_size > 0) ? report->ios_size * 2 : 8;
+                if ((report->ios = realloc(report->ios, STATS_IODATA_SIZE * report->ios_size)) == NULL) {
+                    mreport(true, msg_fatal, "FATAL: realloc for report iostat failed.\n");
+                }
+            }
+            memset(&report->ios[k], 0, STATS_IODATA_SIZE);
+            report->ios[k].major = c->major;
+            report->ios[k].minor = c->minor;
+            snprintf(report->ios[k].devname, sizeof(report->ios[k].devname), "%s", c->devname);
+            report->n_ios++;
+        }
+
+        t = &report->ios[k];
+        t->r_completed += COUNTER_DELTA(p->r_completed, c->r_completed);
+        t->r_merged += COUNTER_DELTA(p->r_merged, c->r_merged);
+        t->r_sectors += COUNTER_DELTA(p->r_sectors, c->r_sectors);
+        t->r_spent += COUNTER_DELTA(p->r_spent, c->r_spent);
+        t->w_completed += COUNTER_DELTA(p->w_completed, c->w_completed);
+        t->w_merged += COUNTER_DELTA(p->w_merged, c->w_merged);
+        t->w_sectors += COUNTER_DELTA(p->w_sectors, c->w_sectors);
+        t->w_spent += COUNTER_DELTA(p->w_spent, c->w_spent);
+        t->t_spent += COUNTER_DELTA(p->t_spent, c->t_spent);
+        t->t_weighted += COUNTER_DELTA(p->t_weighted, c->t_weighted);
+    }
 }
 
 /*
- ****************************************************** key-press function **
- * Get query text using pseudo pg_stat_statements.queryid.
+ ********************************************************* report function **
+ * Add interfaces counters deltas of the frame to interfaces totals.
+ * Interfaces settings are taken from the latest frame.
  *
  * IN:
- * @window              Window where result will be printed.
- * @screen              Current screen settings.
- * @conn                Current PostgreSQL connection.
+ * @report          Report state.
+ * @rec             Decoder state with decoded frame.
  ****************************************************************************
  */
-void get_query_by_id(WINDOW * window, struct screen_s * screen, PGconn * conn)
+void aggregate_report_nicstat(struct report_s * report, struct record_s * rec)
 {
-    if (screen->current_context != pg_stat_statements_timing
-            && screen->current_context != pg_stat_statements_general
-            && screen->current_context != pg_stat_statements_io
-            && screen->current_context != pg_stat_statements_temp
-            && screen->current_context != pg_stat_statements_local) {
-        wprintw(window, "Get query text is not allowed here.");
-        return;
-    }
-    
-    PGresult * res;
-    bool with_esc;
-    char msg[] = "Enter queryid: ",
-         query[QUERY_MAXLEN],
-         pager[M_BUF_LEN] = "";
-    char queryid[XS_BUF_LEN];
-    char errmsg[ERRSIZE];
-    FILE * fpout;
-
-    cmd_readline(window, msg, strlen(msg), &with_esc, queryid, sizeof(queryid), true);
-    if (check_string(queryid, is_alfanum) == -1) {
-        wprintw(window, "Do nothing. Value is not valid.");
-        return;
-    }
+    struct nicdata_s * c, * p, * t;
+    unsigned int i, k;
+
+    for (i = 0; i < rec->idev; i++) {
+        c = rec->c_nicd[i];
+        p = rec->p_nicd[i];
+        /* interfaces list is changed in the frame, interface has no previous stat */
+        if (strcmp(c->ifname, p->ifname) != 0)
+            continue;
 
-    if (strlen(queryid) != 0 && with_esc == false) {
-        /* do query and send result into less */
-	snprintf(query, sizeof(query), "%s%s%s", PG_GET_QUERYREP_BY_QUERYID_QUERY_P1, queryid, PG_GET_QUERYREP_BY_QUERYID_QUERY_P2);
-        if ((res = do_query(conn, query, errmsg)) == NULL) {
-            wprintw(window, "%s", errmsg);
-            return;
+        /* usually interfaces are in the same order in all frames */
+        k = i;
+        if (k >= report->n_nicd || strcmp(report->nicd[k].ifname, c->ifname) != 0)
+            for (k = 0; k < report->n_nicd && strcmp(report->nicd[k].ifname, c->ifname) != 0; k++)
+                ;
+        if (k == report->n_nicd) {
+            if (report->n_nicd == report->nicd_size) {
+                report->nicd_size = (report->nicd_size > 0) ? report->nicd_size * 2 : 8;
+                if ((report->nicd = realloc(report->nicd, STATS_NICDATA_SIZE * report->nicd_size)) == NULL) {
+                    mreport(true, msg_fatal, "FATAL: realloc for report nicstat failed.\n");
+                }
+            }
+            memset(&report->nicd[k], 0, STATS_NICDATA_SIZE);
+            snprintf(report->nicd[k].ifname, sizeof(report->nicd[k].ifname), "%s", c->ifname);
+            report->n_nicd++;
         }
 
-        /* finish work if empty answer */
-        if (PQntuples(res) == 0) {
-            wprintw(window, "Do nothing. Empty answer for %s", queryid);
-            PQclear(res);
-            return;
-        }
+        t = &report->nicd[k];
+        t->speed = c->speed;
+        t->duplex = c->duplex;
+        t->rbytes += COUNTER_DELTA(p->rbytes, c->rbytes);
+        t->rpackets += COUNTER_DELTA(p->rpackets, c->rpackets);
+        t->ierr += COUNTER_DELTA(p->ierr, c->ierr);
+        t->wbytes += COUNTER_DELTA(p->wbytes, c->wbytes);
+        t->wpackets += COUNTER_DELTA(p->wpackets, c->wpackets);
+        t->oerr += COUNTER_DELTA(p->oerr, c->oerr);
+        t->coll += COUNTER_DELTA(p->coll, c->coll);
+        t->sat += COUNTER_DELTA(p->sat, c->sat);
+    }
+}
 
-        if (getenv("PAGER") != NULL)
-            snprintf(pager, sizeof(pager), "%s", getenv("PAGER"));
-        else
-            snprintf(pager, sizeof(pager), "%s", DEFAULT_PAGER);
-        
-        if ((fpout = popen(pager, "w")) == NULL) {
-            wprintw(window, "Do nothing. Failed to open pipe to %s", pager);
-            return;
+/*
+ ********************************************************* report function **
+ * Push row into bounded heap of top rows. Root of the heap is the row which
+ * is printed last, it's replaced when better row is pushed into full heap.
+ *
+ * IN:
+ * @heap            Heap of rows numbers.
+ * @n               Number of rows in the heap.
+ * @limit           Heap size.
+ * @row             Row number.
+ * @cmp             Comparison function used for sorting.
+ * @key             Order key passed to comparison function.
+ *
+ * OUT:
+ * @heap            Heap with row.
+ * @n               Number of rows in the heap.
+ ****************************************************************************
+ */
+void push_report_heap(unsigned int * heap, unsigned int * n, unsigned int limit, unsigned int row,
+        int (*cmp)(const void *, const void *, void *), struct sort_key_s * key)
+{
+    unsigned int i, child, tmp;
+
+    if (*n < limit) {
+        /* sift up while parent is printed before the row */
+        i = (*n)++;
+        heap[i] = row;
+        while (i > 0 && cmp(&heap[(i - 1) / 2], &heap[i], key) < 0) {
+            tmp = heap[i];
+            heap[i] = heap[(i - 1) / 2];
+            heap[(i - 1) / 2] = tmp;
+            i = (i - 1) / 2;
         }
+        return;
+    }
 
-        /* escape from ncurses mode */
-        refresh();
-        endwin();
-
-        /* print result */
-        fprintf(fpout, "summary:\n\ttotal_time: %s, cpu_time: %s, io_time: %s (ALL: %s%%, CPU: %s%%, IO: %s%%),\ttotal queries: %s\n\
-query info:\n\
-\tusename:\t\t\t\t%s,\n\
-\tdatname:\t\t\t\t%s,\n\
-\tcalls (relative to all queries):\t%s (%s%%),\n\
-\trows (relative to all queries):\t\t%s (%s%%),\n\
-\ttotal time (relative to all queries):\t%s (ALL: %s%%, CPU: %s%%, IO: %s%%),\n\
-\taverage time (only for this query):\t%sms, cpu_time: %sms, io_time: %sms, (ALL: %s%%, CPU: %s%%, IO: %s%%),\n\n\
-query text (id: %s):\n%s",
-        /* summary */
-        PQgetvalue(res, 0, REP_ALL_TOTAL_TIME), PQgetvalue(res, 0, REP_ALL_CPU_TIME), PQgetvalue(res, 0, REP_ALL_IO_TIME),
-        PQgetvalue(res, 0, REP_ALL_TOTAL_TIME_PCT), PQgetvalue(res, 0, REP_ALL_CPU_TIME_PCT), PQgetvalue(res, 0, REP_ALL_IO_TIME_PCT), 
-        PQgetvalue(res, 0, REP_ALL_TOTAL_QUERIES),
-        /* user, dbname */
-        PQgetvalue(res, 0, REP_USER), PQgetvalue(res, 0, REP_DBNAME),
-        /* calls and rows */
-        PQgetvalue(res, 0, REP_CALLS), PQgetvalue(res, 0, REP_CALLS_PCT),
-        PQgetvalue(res, 0, REP_ROWS), PQgetvalue(res, 0, REP_ROWS_PCT),
-        /* timings */
-        PQgetvalue(res, 0, REP_TOTAL_TIME), PQgetvalue(res, 0, REP_TOTAL_TIME_PCT), PQgetvalue(res, 0, REP_CPU_TIME_PCT), PQgetvalue(res, 0, REP_IO_TIME_PCT),
-        /* averages */
-        PQgetvalue(res, 0, REP_AVG_TIME), PQgetvalue(res, 0, REP_AVG_CPU_TIME), PQgetvalue(res, 0, REP_AVG_IO_TIME), 
-        PQgetvalue(res, 0, REP_AVG_TIME_PCT), PQgetvalue(res, 0, REP_AVG_CPU_TIME_PCT), PQgetvalue(res, 0, REP_AVG_IO_TIME_PCT),
-        /* query */
-        queryid, PQgetvalue(res, 0, REP_QUERY));
-
-        /* clean */
-        PQclear(res);
-        pclose(fpout);
+    if (limit == 0 || cmp(&row, &heap[0], key) >= 0)
+        return;
 
-        /* return to ncurses mode */
-        refresh();
-    } else if (strlen(queryid) == 0 && with_esc == false) {
-        wprintw(window, "Nothing to do. Nothing entered");
-    } else if (with_esc) {
-        ;
-    } else {
-        wprintw(window, "Nothing to do.");
+    /* sift down while any child is printed after the row */
+    heap[0] = row;
+    for (i = 0; (child = 2 * i + 1) < *n; i = child) {
+        if (child + 1 < *n && cmp(&heap[child], &heap[child + 1], key) < 0)
+            child++;
+        if (cmp(&heap[i], &heap[child], key) >= 0)
+            break;
+        tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
     }
 }
 
 /*
- *********************************************************** init function **
- * Init output colors.
+ ********************************************************* report function **
+ * Get order columns from report options.
  *
  * IN:
- * @ws_color            Sysstat window current color.
- * @wc_color            Cmdline window current color.
- * @wa_color            Database answer window current color.
- * @wl_color            Subscreen window current color.
+ * @args            Input arguments with comma separated columns names.
+ * @names           Columns names.
+ * @n_names         Number of columns.
+ * @default_order   Column used when order isn't specified.
+ *
+ * OUT:
+ * @orders          Order columns numbers.
+ *
+ * RETURNS:
+ * Number of order columns.
  ****************************************************************************
  */
-void init_colors(unsigned int * ws_color, unsigned int * wc_color, unsigned int * wa_color, unsigned int * wl_color)
+unsigned int get_report_orders(struct args_s * args, const char * names[], unsigned int n_names,
+        unsigned int orders[], unsigned int default_order)
 {
-    start_color();
-    init_pair(0, COLOR_BLACK,   COLOR_BLACK);
-    init_pair(1, COLOR_RED,     COLOR_BLACK);
-    init_pair(2, COLOR_GREEN,   COLOR_BLACK);
-    init_pair(3, COLOR_YELLOW,  COLOR_BLACK);
-    init_pair(4, COLOR_BLUE,    COLOR_BLACK);
-    init_pair(5, COLOR_MAGENTA, COLOR_BLACK);
-    init_pair(6, COLOR_CYAN,    COLOR_BLACK);
-    init_pair(7, COLOR_WHITE,   COLOR_BLACK);
-    /* set defaults */
-    *ws_color = 7;
-    *wc_color = 7;
-    *wa_color = 7;
-    *wl_color = 7;
+    char str[S_BUF_LEN], * name, * saveptr;
+    unsigned int j, n = 0;
+
+    snprintf(str, sizeof(str), "%s", args->report_order);
+    for (name = strtok_r(str, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+        for (j = 0; j < n_names; j++)
+            if (strcmp(name, names[j]) == 0)
+                break;
+        if (j == n_names) {
+            mreport(true, msg_fatal, "FATAL: unknown report order column: %s.\n", name);
+        }
+        if (n == REPORT_MAX_ORDERS) {
+            mreport(true, msg_fatal, "FATAL: too many report order columns, max is %d.\n", REPORT_MAX_ORDERS);
+        }
+        orders[n++] = j;
+    }
+
+    if (n == 0)
+        orders[n++] = (default_order < n_names) ? default_order : 0;
+    return n;
 }
 
 /*
- ************************************************** color-related function **
- * Draw help of color-change screen.
+ ********************************************************* report function **
+ * Print title of report table.
  *
  * IN:
- * @ws_color            Sysstat window current color.
- * @wc_color            Cmdline window current color.
- * @wa_color            Database answer window current color.
- * @wl_color            Subscreen window current color.
- * @target              Short name of the area which color will be changed.
- * @target_color        Next color of the area.
+ * @report          Report state.
+ * @args            Input arguments with report options.
+ * @order           Order column name.
  ****************************************************************************
  */
-void draw_color_help(WINDOW * w, unsigned int * ws_color, unsigned int * wc_color,
-		unsigned int * wa_color, unsigned int * wl_color, unsigned int target, unsigned int * target_color)
+void print_report_title(struct report_s * report, struct args_s * args, const char * order)
 {
-    wclear(w);
-    wprintw(w, "Help for color mapping - %s, version %.1f.%d\n\n",
-            PROGRAM_NAME, PROGRAM_VERSION, PROGRAM_RELEASE);
-    wattron(w, COLOR_PAIR(*ws_color));
-    wprintw(w, "\tpgcenter: 2015-08-03 16:12:16, load average: 0.54, 0.43, 0.41\n\
-\t    %%cpu:  4.8 us,  5.0 sy,  0.0 ni, 90.2 id,  0.0 wa,  0.0 hi,  0.0 si,  \n\
-\t  conn 1: 127.0.0.1:5432 postgres@pgbench        conn state: ok\n\
-\tactivity:  9 total,  8 idle,  0 idle_in_xact,  1 active,  0 waiting,\n");
-    wattroff(w, COLOR_PAIR(*ws_color));
-
-    wattron(w, COLOR_PAIR(*wc_color));
-    wprintw(w, "\tNasty message or input prompt.\n");
-    wattroff(w, COLOR_PAIR(*wc_color));
-
-    wattron(w, COLOR_PAIR(*wa_color));
-    wattron(w, A_BOLD);
-    wprintw(w, "\tuser      database  calls  calls/s  total_time  read_time  write_time  cpu_\n");
-    wattroff(w, A_BOLD);
-    wprintw(w, "\tpostgres  pgbench   83523  3        9294.62     0.00       0.00        9294\n\
-\tadmin     pgbench   24718  0        30731.86    28672.12   0.00        2059\n\n");
-    wattroff(w, COLOR_PAIR(*wa_color));
-
-    wattron(w, COLOR_PAIR(*wl_color));
-    wprintw(w, "\t< 2015-08-03 16:17:55.848 YEKT >LOG:  database system is ready to accept co\n\
-\t< 2015-08-03 16:17:55.848 YEKT >LOG:  autovacuum launcher started\n\n");
-    wattroff(w, COLOR_PAIR(*wl_color));
+    char start[20], end[20];
+    time_t t;
 
-    wprintw(w, "1) Select a target as an upper case letter, current target is  %c :\n\
-\tS = Summary Data, M = Messages/Prompt, P = PostgreSQL Information, L = Additional screen\n", target);
-    wprintw(w, "2) Select a color as a number, current color is  %i :\n\
-\t0 = black,  1 = red,      2 = green,  3 = yellow,\n\
-\t4 = blue,   5 = magenta,  6 = cyan,   7 = white\n", *target_color);
-    wprintw(w, "3) Then use keys: 'Esc' to abort changes, 'Enter' to commit and end.\n");
+    t = report->start / 1000000;
+    strftime(start, sizeof(start), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    t = report->end / 1000000;
+    strftime(end, sizeof(end), "%Y-%m-%d %H:%M:%S", localtime(&t));
 
-    touchwin(w);
-    wrefresh(w);
+    printf("%s: %s - %s, %u frames, top %u by %s\n",
+            args->report_context, start, end, report->frames, args->report_limit, order);
 }
 
 /*
- ****************************************************** key press function **
- * Change output colors.
+ ********************************************************* report function **
+ * Print top rows of aggregated context for each order column. Columns and
+ * sort order are the same as in console, counters are printed as totals
+ * over the time window. Top rows of all columns are taken in one pass.
  *
  * IN:
- * @ws_color            Sysstat window current color.
- * @wc_color            Cmdline window current color.
- * @wa_color            Database answer window current color.
- * @wl_color            Subscreen window current color.
+ * @report          Report state.
+ * @args            Input arguments with report options.
+ * @screen          Screen used for default sort order.
  ****************************************************************************
  */
-void change_colors(unsigned int * ws_color, unsigned int * wc_color, unsigned int * wa_color, unsigned int * wl_color)
+void print_report_snapshot(struct report_s * report, struct args_s * args, struct screen_s * screen)
 {
-    WINDOW * w;
-    int ch;
-    unsigned int target = 'S',
-        * target_color = ws_color;
-    unsigned int ws_save = *ws_color,
-        wc_save = *wc_color,
-        wa_save = *wa_color,
-        wl_save = *wl_color;
-    
-    w = subwin(stdscr, 0, 0, 0, 0);
-    echo();
-    cbreak();
-    nodelay(w, FALSE);
-    keypad(w, TRUE);
+    struct snapshot_s * snap = report->acc;
+    unsigned int i, j, k, row, n_orders, default_order = 0, limit = args->report_limit;
+    unsigned int orders[REPORT_MAX_ORDERS], n[REPORT_MAX_ORDERS];
+    int (*cmp[REPORT_MAX_ORDERS])(const void *, const void *, void *);
+    struct sort_key_s keys[REPORT_MAX_ORDERS];
+    const char * names[snap->n_cols + 1];
+    char value[XS_BUF_LEN * 2];
+    struct colAttrs * columns;
+    unsigned int * heaps;
+    bool desc = true;
 
-    do {
-        draw_color_help(w, ws_color, wc_color, wa_color, wl_color, target, target_color);
-        ch = wgetch(w);
-        switch (ch) {
-            case 'S':
-                target = 'S';
-                target_color = ws_color;
-                break;
-            case 'M':
-                target = 'M';
-                target_color = wc_color;
-                break;
-            case 'P':
-                target = 'P';
-                target_color = wa_color;
-                break;
-            case 'L':
-                target = 'L';
-                target_color = wl_color;
-                break;
-            case '0': case '1': case '2': case '3':
-            case '4': case '5': case '6': case '7':
-                *target_color = ch - '0';
-                break;
-            default:
-                break;
+    if (snap->n_cols == 0) {
+        printf("%s: no recorded data in time window.\n", args->report_context);
+        return;
+    }
+
+    for (i = 0; i < TOTAL_CONTEXTS; i++)
+        if (screen->context_list[i].context == report->context) {
+            default_order = screen->context_list[i].order_key;
+            desc = screen->context_list[i].order_desc;
         }
-    } while (ch != '\n' && ch != 27);
 
-    /* if Esc entered, restore previous colors */
-    if (ch == 27) {
-        *ws_color = ws_save;
-        *wc_color = wc_save;
-        *wa_color = wa_save;
-        *wl_color = wl_save;
+    for (j = 0; j < snap->n_cols; j++) {
+        names[j] = snap->cols[j].name;
+        /* counters are printed and sorted as totals */
+        if (snap->cols[j].type == col_counter)
+            for (i = 0; i < snap->n_rows; i++)
+                snap->cols[j].rates[i] = snap->cols[j].counters[i];
     }
+    n_orders = get_report_orders(args, names, snap->n_cols, orders, default_order);
 
-    noecho();
-    cbreak();
-    nodelay(w, TRUE);
-    keypad(w, FALSE);
-    delwin(w);
+    if ((heaps = malloc(sizeof(unsigned int) * limit * n_orders)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for report failed.\n");
+    }
+
+    /* comparator function depends on column data type, as in console */
+    for (k = 0; k < n_orders; k++) {
+        keys[k].snap = snap;
+        keys[k].key = orders[k];
+        n[k] = 0;
+        if (snap->cols[orders[k]].type == col_text) {
+            keys[k].values = NULL;
+            cmp[k] = desc ? str_cmp_desc : str_cmp_asc;
+        } else {
+            keys[k].values = (snap->cols[orders[k]].type == col_counter)
+                ? snap->cols[orders[k]].rates
+                : snap->cols[orders[k]].numbers;
+            cmp[k] = desc ? num_cmp_desc : num_cmp_asc;
+        }
+    }
+
+    for (i = 0; i < snap->n_rows; i++)
+        for (k = 0; k < n_orders; k++)
+            push_report_heap(heaps + k * limit, &n[k], limit, i, cmp[k], &keys[k]);
+
+    columns = init_colattrs(snap->n_cols);
+    calculate_width(columns, NULL, NULL, snap, snap->n_rows, snap->n_cols);
+
+    for (k = 0; k < n_orders; k++) {
+        qsort_r(heaps + k * limit, n[k], sizeof(unsigned int), cmp[k], &keys[k]);
+        print_report_title(report, args, names[orders[k]]);
+
+        /* last column isn't padded, it's usually long text */
+        for (j = 0; j < snap->n_cols; j++)
+            printf("%-*s", (j == snap->n_cols - 1) ? 0 : columns[j].width, columns[j].name);
+        printf("\n");
+        for (i = 0; i < n[k]; i++) {
+            row = heaps[k * limit + i];
+            for (j = 0; j < snap->n_cols; j++)
+                printf("%-*s", (j == snap->n_cols - 1) ? 0 : columns[j].width,
+                        get_snapshot_value(snap, row, j, value, sizeof(value)));
+            printf("\n");
+        }
+        printf("\n");
+    }
+
+    free(columns);
+    free(heaps);
 }
 
 /*
- ****************************************************** key-press function **
- * Switch statistics context.
+ ********************************************************* report function **
+ * Print top devices or interfaces for each order column. Values are the
+ * same as in iostat or nicstat subscreen, but calculated over the time
+ * window. Devices without IO in the window aren't printed.
  *
  * IN:
- * @window              Window for printing diag messages.
- * @screen              Current screen.
- * @context             New statistics context.
- * @res                 Array with previous query results.
- * @first_iter          Flag for resetting previous query results.
+ * @report          Report state.
+ * @args            Input arguments with report options.
  ****************************************************************************
  */
-void switch_context(WINDOW * window, struct screen_s * screen, 
-                    enum context context, PGresult * res, bool * first_iter)
+void print_report_devices(struct report_s * report, struct args_s * args)
 {
-    wclear(window);
-    switch (context) {
-        case pg_stat_database:
-            wprintw(window, "Show databases statistics");
-            break;
-        case pg_stat_replication:
-            wprintw(window, "Show replication statistics");
-            break;
-        case pg_stat_tables:
-            wprintw(window, "Show tables statistics");
-            break;
-        case pg_stat_indexes:
-            wprintw(window, "Show indexes statistics");
-            break;
-        case pg_statio_tables:
-            wprintw(window, "Show tables IO statistics");
-            break;
-        case pg_tables_size:
-            wprintw(window, "Show tables sizes");
-            break;
-        case pg_stat_activity_long:
-            wprintw(window, "Show activity (age threshold: %s)", screen->pg_stat_activity_min_age);
-            break;
-        case pg_stat_functions:
-            wprintw(window, "Show functions statistics");
-            break;
-        case pg_stat_statements_timing:
-            wprintw(window, "Show pg_stat_statements timings");
-            break;
-        case pg_stat_statements_general:
-            wprintw(window, "Show pg_stat_statements general");
-            break;
-        case pg_stat_statements_io:
-            wprintw(window, "Show pg_stat_statements io");
-            break;
-        case pg_stat_statements_temp:
-            wprintw(window, "Show pg_stat_statements temp");
-            break;
-        case pg_stat_statements_local:
-            wprintw(window, "Show pg_stat_statements local io");
-            break;
-        case pg_stat_progress_vacuum:
-            wprintw(window, "Show vacuum progress");
-            break;
-        default:
-            break;
+    static const char * iostat_names[IOSTAT_COLS] = {
+        "rrqm/s", "wrqm/s", "r/s", "w/s", "rMB/s", "wMB/s",
+        "avgrq-sz", "avgqu-sz", "await", "r_await", "w_await", "%util" };
+    static const char * nicstat_names[NICSTAT_COLS] = {
+        "rMbps", "wMbps", "rPk/s", "wPk/s", "rAvs", "wAvs", "IErr",
+        "OErr", "Coll", "Sat", "%rUtil", "%wUtil", "%Util" };
+    static struct iodata_s io_zero;
+    static struct nicdata_s nic_zero;
+    bool iostat = (report->subscreen == SUBSCREEN_IOSTAT);
+    unsigned int n_cols = iostat ? IOSTAT_COLS : NICSTAT_COLS,
+                 n_devs = iostat ? report->n_ios : report->n_nicd,
+                 limit = args->report_limit;
+    const char ** names = iostat ? iostat_names : nicstat_names;
+    unsigned int i, j, k, dev, n_orders;
+    unsigned int orders[REPORT_MAX_ORDERS], n[REPORT_MAX_ORDERS];
+    struct sort_key_s keys[REPORT_MAX_ORDERS];
+    double row[NICSTAT_COLS], * values;
+    char line[L_BUF_LEN];
+    unsigned int * heaps;
+
+    /* utilization is the last column and it's the default order */
+    n_orders = get_report_orders(args, names, n_cols, orders, n_cols - 1);
+
+    if ((values = malloc(sizeof(double) * n_cols * MAX(n_devs, 1))) == NULL
+            || (heaps = malloc(sizeof(unsigned int) * limit * n_orders)) == NULL) {
+        mreport(true, msg_fatal, "FATAL: malloc for report failed.\n");
     }
 
-    screen->current_context = context;
-    if (res && *first_iter == false)
-        PQclear(res);
-    *first_iter = true;
+    /* values are stored by columns, so they can be used as order keys */
+    for (dev = 0; dev < n_devs; dev++) {
+        if (iostat)
+            get_iostat_values(&report->ios[dev], &io_zero, report->itv, row);
+        else
+            get_nicstat_values(&report->nicd[dev], &nic_zero, report->itv, row);
+        for (j = 0; j < n_cols; j++)
+            values[j * n_devs + dev] = row[j];
+    }
+
+    for (k = 0; k < n_orders; k++) {
+        keys[k].snap = NULL;
+        keys[k].key = orders[k];
+        keys[k].values = values + orders[k] * n_devs;
+        n[k] = 0;
+    }
+
+    for (dev = 0; dev < n_devs; dev++) {
+        if (iostat && report->ios[dev].r_completed == 0 && report->ios[dev].w_completed == 0)
+            continue;
+        if (!iostat && report->nicd[dev].rpackets == 0 && report->nicd[dev].wpackets == 0)
+            continue;
+        for (k = 0; k < n_orders; k++)
+            push_report_heap(heaps + k * limit, &n[k], limit, dev, num_cmp_desc, &keys[k]);
+    }
+
+    for (k = 0; k < n_orders; k++) {
+        qsort_r(heaps + k * limit, n[k], sizeof(unsigned int), num_cmp_desc, &keys[k]);
+        print_report_title(report, args, names[orders[k]]);
+        printf(iostat ? IOSTAT_HEADER : NICSTAT_HEADER);
+        for (i = 0; i < n[k]; i++) {
+            dev = heaps[k * limit + i];
+            for (j = 0; j < n_cols; j++)
+                row[j] = values[j * n_devs + dev];
+            if (iostat)
+                format_iostat_row(line, sizeof(line), report->ios[dev].devname, row);
+            else
+                format_nicstat_row(line, sizeof(line), report->nicd[dev].ifname, row);
+            fputs(line, stdout);
+        }
+        printf("\n");
+    }
+
+    free(values);
+    free(heaps);
 }
 
 /*
- ****************************************************** key press function **
- * Print on-program help.
+ ********************************************************* report function **
+ * Report mode: frames of time-series file in the time window are streamed
+ * once and aggregated, then top rows are printed for each order column.
+ * Frames which don't continue previous frame (the first frame, frames
+ * after corrupted ones) are only used as a base for next deltas.
  *
  * IN:
- * @first_iter              Reset stats counter after help.
+ * @args            Input arguments with time-series file path and report
+ *                  options.
+ * @screen          Screen used for default sort order.
  ****************************************************************************
  */
-void print_help_screen(bool * first_iter)
+void report_stats(struct args_s * args, struct screen_s * screen)
 {
-    WINDOW * w;
-    int ch;
+    struct replay_s rep;
+    struct report_s report;
+    struct record_s * rec = &rep.rec;
+    long long from = 0, to = LLONG_MAX;
+
+    activate_screen(screen);
+    init_report(&report, args);
+    open_replay_file(&rep, args->replay_file);
+    if (read_replay_frame(&rep) == false) {
+        mreport(true, msg_fatal, "FATAL: %s has no complete frames.\n", args->replay_file);
+    }
 
-    w = subwin(stdscr, 0, 0, 0, 0);
-    cbreak();
-    nodelay(w, FALSE);
-    keypad(w, TRUE);
+    /* time without date means time of the first recorded day */
+    if ((strlen(args->report_from) != 0 && parse_record_time(args->report_from, rep.wall, &from) == false)
+            || (strlen(args->report_to) != 0 && parse_record_time(args->report_to, rep.wall, &to) == false)) {
+        mreport(true, msg_fatal, "FATAL: invalid report time, use YYYY-MM-DD HH:MM:SS or HH:MM:SS.\n");
+    }
+    if (from > rep.wall)
+        seek_replay(&rep, from);
+    report.start = report.end = rep.wall;
 
-    wclear(w);
-    wprintw(w, "Help for interactive commands - %s version %.1f.%d\n\n",
-                PROGRAM_NAME, PROGRAM_VERSION, PROGRAM_RELEASE);
-    wprintw(w, "general actions:\n\
-  a,d,i,f,r       mode: 'a' activity, 'd' databases, 'i' indexes, 'f' functions, 'r' replication,\n\
-  s,t,T,v         's' tables sizes, 't' tables, 'T' tables IO, 'v' vacuum progress,\n\
-  x,X             'x' pg_stat_statements switch, 'X' pg_stat_statements menu.\n\
-  Left,Right,/,F  'Left,Right' change column sort, '/' change sort desc/asc, 'F' set filter.\n\
-  C,E,R           config: 'C' show config, 'E' edit configs, 'R' reload config.\n\
-  p                       'p' start psql session.\n\
-  l               'l' open log file with pager.\n\
-  N,Ctrl+D,W      'N' add new connection, Ctrl+D close current connection, 'W' write connections info.\n\
-  1..8            switch between consoles.\n\
-subscreen actions:\n\
-  B,I,L           'B' iostat, 'I' nicstat, 'L' logtail.\n\
-activity actions:\n\
-  -,_             '-' cancel backend by pid, '_' terminate backend by pid.\n\
-  >,.             '>' set new mask, '.' show current mask.\n\
-  Del,Shift+Del   'Del' cancel backend group using mask, 'Shift+Del' terminate backend group using mask.\n\
-  A               change activity age threshold.\n\
-  G               get report about query using hash.\n\n\
-other actions:\n\
-  , Q             ',' show system tables on/off, 'Q' reset postgresql statistics counters.\n\
-  z,Z             'z' set refresh interval, 'Z' change color scheme.\n\
-  space           pause program execution.\n\
-  h,F1            show help screen.\n\
-  q               quit.\n\n");
-    wprintw(w, "Type 'Esc' to continue.\n");
+    while (read_replay_frame(&rep) || rep.corrupted) {
+        if (rep.corrupted)
+            continue;
+        if (rep.wall > to)
+            break;
+        if (rec->frames < 2)
+            continue;
 
-    do {
-        ch = wgetch(w);
-    } while (ch != 27);
+        if (report.subscreen == SUBSCREEN_IOSTAT)
+            aggregate_report_iostat(&report, rec);
+        else if (report.subscreen == SUBSCREEN_NICSTAT)
+            aggregate_report_nicstat(&report, rec);
+        /* snapshot which doesn't continue previous one is only a base for next deltas */
+        else if (rec->matched[report.context])
+            aggregate_report_snapshot(&report, rec->c_snaps[report.context], rec->p_snaps[report.context]);
+        report.itv += get_interval(rec->uptime0[!rec->curr], rec->uptime0[rec->curr]);
+        report.frames++;
+        report.end = rep.wall;
+    }
 
-    *first_iter = true;
-    cbreak();
-    nodelay(w, TRUE);
-    keypad(w, FALSE);
-    delwin(w);
+    if (report.frames == 0) {
+        mreport(true, msg_fatal, "FATAL: no frames in report time window.\n");
+    }
+    if (report.subscreen == SUBSCREEN_NONE)
+        print_report_snapshot(&report, args, screen);
+    else
+        print_report_devices(&report, args);
+
+    exit(EXIT_SUCCESS);
 }
 
 /*
@@ -4718,30 +11752,25 @@ other actions:\n\
 int main(int argc, char *argv[])
 {
     struct args_s *args = init_args_mem();              /* struct for input args */
-    struct screen_s *screens[MAX_SCREEN];               /* array of screens */
+    struct screen_s **screens;                          /* registry of screens */
     struct cpu_s *st_cpu[2];                            /* cpu usage struct */
     struct mem_s *st_mem_short;                         /* mem usage struct */
+    struct pg_stat_s pg_stats;                          /* postgres stats for sysstat screen */
 
     WINDOW *w_sys, *w_cmd, *w_dba, *w_sub;              /* ncurses windows  */
+    struct sink_s sink;                                 /* output of sampled rows */
     int ch;                                    		/* store key press  */
+    unsigned int i;
     bool first_iter = true;                             /* first-run flag   */
     static unsigned int console_no = 1;                 /* console number   */
     static unsigned int console_index = 0;              /* console index in screen array */
 
-    PGconn      *conns[MAX_SCREEN];                     /* connections array    */
-    PGresult    *p_res = NULL,
-                *c_res = NULL;                          /* query results        */
-    char query[QUERY_MAXLEN];                           /* query text           */
-    unsigned int n_rows, n_cols, n_prev_rows = 0;       /* query results opts   */
+    PGconn      **conns;                                /* connections array    */
     char errmsg[ERRSIZE];                               /* query error message  */
 
     unsigned long interval = DEFAULT_INTERVAL,          /* sleep interval       */
              sleep_usec = 0;                            /* time spent in sleep  */
 
-    char ***p_arr = NULL,
-         ***c_arr = NULL,
-         ***r_arr = NULL;                               /* 3d arrays for query results  */
-
     unsigned int ws_color, wc_color, wa_color, wl_color;/* colors for text zones */
 
     /* init iostat stuff */
@@ -4754,38 +11783,73 @@ int main(int argc, char *argv[])
     struct nicdata_s *c_nicdata[idev];
     struct nicdata_s *p_nicdata[idev];
 
+    /* init per-cpu stuff, cpu "all" and all configured cpus */
+    long ncpu_conf = sysconf(_SC_NPROCESSORS_CONF);
+    unsigned int ncpu = (ncpu_conf > 0) ? ncpu_conf : 1;
+    struct cpu_s c_cpus[ncpu + 1];
+    struct cpu_s p_cpus[ncpu + 1];
+
     /* repaint iostat/nicstat if number of devices changed */
     bool repaint = false;
 
+    /* cgroup stats are shown instead of host stats */
+    bool cgroup_view = false;
+
     /* init various stuff */
     init_signal_handlers();
     init_args_struct(args);
-    init_screens(screens);
+    init_screens(&screens, &conns);
     init_stats(st_cpu, &st_mem_short);
     init_iostats(c_ios, p_ios, bdev);
     init_nicdata(c_nicdata, p_nicdata, idev);
+    memset(c_cpus, 0, STATS_CPU_SIZE * (ncpu + 1));
+    memset(p_cpus, 0, STATS_CPU_SIZE * (ncpu + 1));
     get_HZ();
 
     /* process cmd args */
     if (argc > 1) {
         arg_parse(argc, argv, args);
         if (strlen(args->connfile) != 0 && args->count == 1) {
-            if (create_pgcenterrc_conn(args, screens, 0) == PGCENTERRC_READ_ERR) {
+            if (create_pgcenterrc_conn(args, &screens, &conns, 0) == PGCENTERRC_READ_ERR) {
                 create_initial_conn(args, screens);
             }
         } else {
             create_initial_conn(args, screens);
-            create_pgcenterrc_conn(args, screens, 1);
+            create_pgcenterrc_conn(args, &screens, &conns, 1);
         }
     } else {
-        if (create_pgcenterrc_conn(args, screens, 0) == PGCENTERRC_READ_ERR)
+        if (create_pgcenterrc_conn(args, &screens, &conns, 0) == PGCENTERRC_READ_ERR)
             create_initial_conn(args, screens);
     }
 
-    /* open connections to postgres */
+    /* results format is common for all connections */
+    for (i = 0; screens[i] != NULL; i++)
+        screens[i]->binary_results = args->binary_results;
+
+    /* report is printed from recorded stats and program exits */
+    if (args->report)
+        report_stats(args, screens[0]);
+
+    /* in replay mode stats are read from file, connections aren't opened */
+    if (strlen(args->replay_file) != 0)
+        replay_stats(args, screens[0]);
+
+    /* open connection of the first screen, others are opened when viewed */
     prepare_conninfo(screens);
     open_connections(screens, conns);
 
+    /* in record mode stats of the first screen are written into file, console isn't started */
+    if (strlen(args->record_file) != 0)
+        record_stats(args, screens[0], conns[0]);
+
+    /* with csv or json format rows of the first screen are streamed, console isn't started */
+    if (strcmp(args->output_format, "ncurses") != 0)
+        export_stats(args, screens[0], conns[0]);
+
+    /* in daemon mode metrics of the first screen are served over http, console isn't started */
+    if (strlen(args->listen) != 0)
+        daemon_stats(args, screens[0], conns[0]);
+
     /* init screens */
     initscr();
     cbreak();
@@ -4798,12 +11862,29 @@ int main(int argc, char *argv[])
     w_cmd = newwin(1, 0, 4, 0);
     w_dba = newwin(0, 0, 5, 0);
     w_sub = NULL;
+    init_sink(&sink, sink_ncurses, w_dba, NULL);
 
     init_colors(&ws_color, &wc_color, &wa_color, &wl_color);
     curs_set(0);
 
     /* main loop */
     while (1) {
+        /* connection opened by fleet overview is opened again if it isn't ready, password might be asked */
+        if (conns[console_index] != NULL && screens[console_index]->background_conn) {
+            screens[console_index]->background_conn = false;
+            if (screens[console_index]->connect_events != 0 || PQstatus(conns[console_index]) == CONNECTION_BAD) {
+                PQfinish(conns[console_index]);
+                conns[console_index] = NULL;
+                screens[console_index]->connect_events = 0;
+            }
+        }
+
+        /* connection is opened when its screen is viewed first time */
+        if (conns[console_index] == NULL) {
+            conns[console_index] = open_screen_connection(w_cmd, screens[console_index]);
+            first_iter = true;
+        }
+
         /* colors on */
         wattron(w_sys, COLOR_PAIR(ws_color));
         wattron(w_dba, COLOR_PAIR(wa_color));
@@ -4817,12 +11898,17 @@ int main(int argc, char *argv[])
             ch = getch();
             switch (ch) {
                 case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8':
-                    console_index = switch_conn(w_cmd, screens, ch, console_index, console_no, p_res, &first_iter);
+                    console_index = switch_conn(w_cmd, screens, ch, console_index, console_no);
+                    console_no = console_index + 1;
+                    break;
+                case '[': case ']':     /* switch to previous or next screen */
+                    console_index = switch_conn_relative(w_cmd, screens, console_index, ch == ']');
                     console_no = console_index + 1;
                     break;
                 case 'N':               /* open new screen with new connection */
-                    console_index = add_connection(w_cmd, screens, conns, console_index);
+                    console_index = add_connection(w_cmd, &screens, &conns, console_index);
                     console_no = console_index + 1;
+                    screens[console_index]->binary_results = args->binary_results;
                     first_iter = true;
                     break;
                 case 4:                 /* close current screen with Ctrl + D */
@@ -4856,6 +11942,11 @@ int main(int argc, char *argv[])
                         subscreen_process(w_cmd, &w_sub, screens[console_index], conns[console_index], SUBSCREEN_NONE);
                     subscreen_process(w_cmd, &w_sub, screens[console_index], conns[console_index], SUBSCREEN_NICSTAT);
                     break;
+                case 'K':               /* per-cpu subscreen on/off */
+                    if (screens[console_index]->subscreen != SUBSCREEN_CPUSTAT)
+                        subscreen_process(w_cmd, &w_sub, screens[console_index], conns[console_index], SUBSCREEN_NONE);
+                    subscreen_process(w_cmd, &w_sub, screens[console_index], conns[console_index], SUBSCREEN_CPUSTAT);
+                    break;
                 case 410:               /* when subscreen enabled and window has resized, repaint subscreen */
                     if (screens[console_index]->subscreen != SUBSCREEN_NONE) {
                         /* save current subscreen, for restore it later */
@@ -4893,60 +11984,71 @@ int main(int argc, char *argv[])
                     break;
                 case 47:                /* switch order desc/asc */
                     change_sort_order_direction(screens[console_index], &first_iter);
-                    PQclear(p_res);
                     break;
                 case 'p':               /* start psql session to current postgres */
                     start_psql(w_cmd, screens[console_index]);
                     break;
                 case 'd':               /* open pg_stat_database screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_database, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_database, &first_iter);
                     break;
                 case 'r':               /* open pg_stat_replication screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_replication, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_replication, &first_iter);
                     break;
                 case 't':               /* open pg_stat_tables screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_tables, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_tables, &first_iter);
                     break;
                 case 'i':               /* open pg_stat(io)_indexes screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_indexes, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_indexes, &first_iter);
                     break;
                 case 'T':               /* open pg_statio_tables screen */
-                    switch_context(w_cmd, screens[console_index], pg_statio_tables, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_statio_tables, &first_iter);
                     break;
                 case 's':               /* open database object sizes screen */
-                    switch_context(w_cmd, screens[console_index], pg_tables_size, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_tables_size, &first_iter);
                     break;
                 case 'a':               /* show pg_stat_activity screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_activity_long, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_activity_long, &first_iter);
                     break;
                 case 'f':               /* open pg_stat_functions screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_functions, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_functions, &first_iter);
                     break;
                 case 'x':               /* switch to next pg_stat_statements screen */
-                    pgss_switch(w_cmd, screens[console_index], p_res, &first_iter);
+                    pgss_switch(w_cmd, screens[console_index], &first_iter);
                     break;
                 case 'X':               /* open pg_stat_statements menu */
                     pgss_menu(w_cmd, w_dba, screens[console_index], &first_iter);
                     break;
                 case 'v':               /* show pg_stat_activity screen */
-                    switch_context(w_cmd, screens[console_index], pg_stat_progress_vacuum, p_res, &first_iter);
+                    switch_context(w_cmd, screens[console_index], pg_stat_progress_vacuum, &first_iter);
+                    break;
+                case 'b':               /* show backends processes screen */
+                    if (screens[console_index]->pg_special.pg_is_local)
+                        switch_context(w_cmd, screens[console_index], pg_stat_backends, &first_iter);
+                    else {
+                        wclear(w_cmd);
+                        wprintw(w_cmd, "Do nothing. Backends processes not supported for remote hosts.");
+                    }
+                    break;
+                case 'O':               /* show fleet overview screen */
+                    switch_context(w_cmd, screens[console_index], pg_fleet, &first_iter);
                     break;
                 case 'A':               /* change duration threshold in pg_stat_activity wcreen */
-                    change_min_age(w_cmd, screens[console_index], p_res, &first_iter);
+                    change_min_age(w_cmd, screens[console_index], &first_iter);
+                    break;
+                case 'c':               /* show cgroup stats on/off toggle */
+                    cgroup_view_toggle(w_cmd, screens[console_index]);
                     break;
                 case ',':               /* show system view on/off toggle */
                     system_view_toggle(w_cmd, screens[console_index], &first_iter);
-                    PQclear(p_res);
                     break;
                 case 'Q':               /* reset pg stat counters */
                     pg_stat_reset(w_cmd, conns[console_index], &first_iter);
-                    PQclear(p_res);
                     break;
                 case 'G':               /* get query text using pg_stat_statements.queryid */
                     get_query_by_id(w_cmd, screens[console_index], conns[console_index]);
                     break;
                 case 'F':               /* set filtering for a column */
-                    set_filter(w_cmd, screens[console_index], p_res, &first_iter);
+                    set_filter(w_cmd, screens[console_index], &first_iter);
                     break;
                 case 'z':               /* change refresh interval */
                     interval = change_refresh(w_cmd, interval);
@@ -4970,6 +12072,9 @@ int main(int argc, char *argv[])
             }
             wattroff(w_cmd, COLOR_PAIR(wc_color));
             curs_set(0);
+
+            /* screen might be switched to the one with background query, commands need idle connection */
+            cancel_context_queries(screens, conns, console_index, false);
         } else {
             reconnect_if_failed(w_cmd, conns[console_index], screens[console_index], &first_iter);
 
@@ -4979,88 +12084,62 @@ int main(int argc, char *argv[])
             wclear(w_sys);
             print_title(w_sys);
             print_loadavg(w_sys);
-            print_cpu_usage(w_sys, st_cpu);
-            print_mem_usage(w_sys, st_mem_short);
+            /* postgres which runs in cgroup is shown with its own cpu and memory usage */
+            cgroup_view = (screens[console_index]->host_view == false
+                    && open_cgroup(screens[console_index]->pg_special.pg_cgroup));
+            if (cgroup_view) {
+                /* host cpu is still sampled, so its rates are fresh when cgroup is toggled off */
+                print_cpu_usage(NULL, st_cpu);
+                print_cgroup_usage(w_sys);
+            } else {
+                print_cpu_usage(w_sys, st_cpu);
+                print_mem_usage(w_sys, st_mem_short);
+            }
             print_conninfo(w_sys, conns[console_index], console_no);
-            print_pg_general(w_sys, screens[console_index], conns[console_index]);
-            print_postgres_activity(w_sys, screens[console_index], conns[console_index]);
-            print_vacuum_info(w_sys, screens[console_index], conns[console_index]);
-            print_pgss_info(w_sys, conns[console_index], interval);
+            /* query is interrupted by key press, handle key immediately */
+            if (get_pg_stats(conns[console_index], screens[console_index], &pg_stats) == false)
+                continue;
+            print_pg_general(w_sys, screens[console_index], &pg_stats);
+            print_postgres_activity(w_sys, &pg_stats);
+            print_vacuum_info(w_sys, screens[console_index], &pg_stats);
+            print_pgss_info(w_sys, &pg_stats);
             wrefresh(w_sys);
 
             /* 
              * Database screen. 
              */
-            prepare_query(screens[console_index], query);
-            if ((c_res = do_query(conns[console_index], query, errmsg)) == NULL) {
-                /* if error occured print SQL error message into cmd */
-                PQclear(c_res);
-                c_res = NULL;
-                p_res = NULL;
-                first_iter = true;
-                wclear(w_dba);
-                wprintw(w_dba, "%s", errmsg);
-                wrefresh(w_dba);
-                sleep(1);
-                continue;
-            }
-            n_rows = PQntuples(c_res);
-            n_cols = PQnfields(c_res);
-
-            /* 
-             * on startup or when context is switched, copy current data snapshot 
-             * to previous data snapshot and restart cycle
-             */
+            /* on startup or when context is switched, current screen takes new first snapshot */
             if (first_iter) {
-                p_res = PQcopyResult(c_res, PG_COPYRES_ATTRS | PG_COPYRES_TUPLES);
-                PQclear(c_res);
-                usleep(10000);
+                screens[console_index]->sampled = false;
                 first_iter = false;
-                continue;
             }
 
-            /* 
-             * when number of rows changed (when db/table/index created or 
-             * droped), update previous snapshot to current state and start new 
-             * iteration. 
-             */
-            if (n_prev_rows < n_rows) {
-                PQclear(p_res);
-                p_res = PQcopyResult(c_res, PG_COPYRES_ATTRS | PG_COPYRES_TUPLES);
-                PQclear(c_res);
-                n_prev_rows = n_rows;
-                usleep(10000);
-                continue;
+            /* all open connections are sampled, every screen keeps its own snapshots */
+            switch (sample_screens(screens, conns, console_index, errmsg)) {
+                case SAMPLE_CANCELED:
+                    /* query is interrupted by key press, handle key immediately */
+                    continue;
+                case SAMPLE_FAILED:
+                    /* if error occured print SQL error message into cmd */
+                    wclear(w_dba);
+                    wprintw(w_dba, "%s", errmsg);
+                    wrefresh(w_dba);
+                    sleep(1);
+                    continue;
+                case SAMPLE_NODATA:
+                    /* there are no rates yet, restart cycle to get them */
+                    usleep(10000);
+                    continue;
+                case SAMPLE_OK: default:
+                    break;
             }
 
-            /* create storages for values from PQgetvalue */
-            p_arr = init_array(p_arr, n_rows, n_cols);
-            c_arr = init_array(c_arr, n_rows, n_cols);
-            r_arr = init_array(r_arr, n_rows, n_cols);
-
-            /* copy whole query results (current, previous) into arrays */
-            pgrescpy(p_arr, p_res, n_rows, n_cols);
-            pgrescpy(c_arr, c_res, n_rows, n_cols);
+            /* sort latest snapshot using order key, it becomes previous after sampling */
+            sort_array(screens[console_index]->p_snap, screens[console_index]);
 
-            /* diff current and previous arrays and build result array */
-            diff_arrays(p_arr, c_arr, r_arr, screens[console_index], n_rows, n_cols, interval);
-
-            /* sort result array using order key */
-            sort_array(r_arr, n_rows, n_cols, screens[console_index]);
-
-            /* print sorted result array */
-            print_data(w_dba, c_res, r_arr, n_rows, n_cols, screens[console_index]);
-
-            /* replace previous database query result with current result */
-            PQclear(p_res);
-            p_res = PQcopyResult(c_res, PG_COPYRES_ATTRS | PG_COPYRES_TUPLES);
-            n_prev_rows = n_rows;
-            PQclear(c_res);
-
-            /* free memory allocated for arrays */
-            free_array(p_arr, n_rows, n_cols);
-            free_array(c_arr, n_rows, n_cols);
-            free_array(r_arr, n_rows, n_cols);
+            /* print sorted latest snapshot */
+            write_sink_snapshot(&sink, screens[console_index]->p_snap, screens[console_index],
+                    screens[console_index]->current_context, time(NULL));
 
             wrefresh(w_cmd);
             wclear(w_cmd);
@@ -5073,6 +12152,10 @@ int main(int argc, char *argv[])
                     print_log(w_sub, w_cmd, screens[console_index], conns[console_index]);
                     break;
                 case SUBSCREEN_IOSTAT:
+                    if (cgroup_view) {
+                        print_cgroup_iostat(w_sub, c_ios, bdev);
+                        break;
+                    }
                     print_iostat(w_sub, w_cmd, c_ios, p_ios, bdev, &repaint);
                     if (repaint) {
                         free_iostats(c_ios, p_ios, bdev);
@@ -5094,6 +12177,9 @@ int main(int argc, char *argv[])
                         repaint = false;
                     }
                     break;
+                case SUBSCREEN_CPUSTAT:
+                    print_cpustat(w_sub, c_cpus, p_cpus, ncpu);
+                    break;
                 case SUBSCREEN_NONE: default:
                     break;
             }
@@ -5103,7 +12189,9 @@ int main(int argc, char *argv[])
                 if (key_is_pressed())
                     break;
                 else {
-                    usleep(INTERVAL_STEP);
+                    /* don't oversleep when interval isn't multiple of step, wake up on key press */
+                    if (wait_for_input(NULL, MIN(INTERVAL_STEP, interval - sleep_usec) / 1000) == false)
+                        break;
                     if (interval > DEFAULT_INTERVAL && sleep_usec == DEFAULT_INTERVAL) {
                         wrefresh(w_cmd);
                         wclear(w_cmd);
@@ -26,7 +26,7 @@
 #define QUERY_MAXLEN		XL_BUF_LEN
 
 #define ERRSIZE             128
-#define MAX_SCREEN          8
+#define SCREENS_INIT        8               /* initial size of screens registry, covers '1'..'8' keys */
 #define MAX_COLS            20              /* filtering purposes */
 #define INVALID_ORDER_KEY   99
 #define PG_STAT_ACTIVITY_MIN_AGE_DEFAULT "00:00:00.0"
@@ -37,6 +37,10 @@
 #define MEMINFO_FILE            "/proc/meminfo"
 #define DISKSTATS_FILE          "/proc/diskstats"
 #define NETDEV_FILE             "/proc/net/dev"
+#define PROC_DIR                "/proc"
+#define PROC_PID_CGROUP         "/proc/%d/cgroup"
+#define CGROUP_ROOT             "/sys/fs/cgroup"
+#define CGROUP_ROOT_ENV         "PGCENTER_CGROUP_ROOT"      /* overrides cgroup2 mount point */
 #define PGCENTERRC_FILE         ".pgcenterrc"
 #define PG_CONF_FILE            "postgresql.conf"
 #define PG_HBA_FILE             "pg_hba.conf"
@@ -69,17 +73,199 @@
 #define PGCENTERRC_READ_OK  0
 #define PGCENTERRC_READ_ERR 1
 
+/* results of sampling all connections */
+#define SAMPLE_OK           0                   /* current screen has new rates */
+#define SAMPLE_NODATA       1                   /* current screen got its first results */
+#define SAMPLE_FAILED       2                   /* current screen query failed */
+#define SAMPLE_CANCELED     3                   /* sampling is interrupted by key press */
+#define CONNECT_WAIT        0.1                 /* seconds sampling waits for connections in progress */
+
 /* others defaults */
 #define DEFAULT_PAGER       "less"
 #define DEFAULT_EDITOR      "vi"
 #define DEFAULT_PSQL        "psql"
 #define DEFAULT_INTERVAL    1000000
 #define INTERVAL_MAXLEN	    300			/* in seconds */
+#define INTERVAL_MIN        100000              /* in microseconds */
 #define INTERVAL_STEP       200000
 
 #define HZ                  hz
 unsigned int hz;
 
+/* headless mode (recording), ncurses isn't initialized and keys aren't read */
+bool headless;
+volatile sig_atomic_t stop_requested;       /* set by signal handler in headless mode */
+
+/* /proc files are kept open during session and read again from the start on each sample */
+enum proc_file
+{
+    proc_loadavg,
+    proc_stat,
+    proc_uptime,
+    proc_meminfo,
+    proc_diskstats,
+    proc_netdev,
+    cgroup_cpu_stat,
+    cgroup_cpu_max,
+    cgroup_memory_current,
+    cgroup_memory_max,
+    cgroup_memory_stat,
+    cgroup_io_stat,
+    cgroup_cpu_pressure,
+    cgroup_memory_pressure,
+    cgroup_io_pressure,
+    TOTAL_PROC_FILES
+};
+
+/* cgroup files have no fixed path, they are set when postgres cgroup is opened */
+#define CGROUP_FIRST_FILE   cgroup_cpu_stat
+#define TOTAL_CGROUP_FILES  (TOTAL_PROC_FILES - CGROUP_FIRST_FILE)
+
+#define PROC_BUF_LEN        4096            /* initial size of /proc file buffer, it grows when needed */
+
+struct proc_file_s
+{
+    const char * path;                      /* NULL if file isn't known yet */
+    int fd;                                 /* -1 if not opened yet or read failed */
+    char * buf;                             /* file contents, null-terminated */
+    size_t size;                            /* allocated buffer size */
+};
+
+/* key of "key value" file, e.g. meminfo or cgroup memory.stat, its value is stored at offset */
+struct proc_key_s
+{
+    const char * key;
+    unsigned int len;
+    size_t offset;                          /* offset of value in stats struct */
+};
+
+/* meminfo keys are matched through perfect hash of key length, first and last characters */
+#define MEMINFO_HASH_SIZE   16
+#define MEMINFO_HASH(k,len) (((len) + (k)[0] + 3 * (k)[(len) - 1]) & (MEMINFO_HASH_SIZE - 1))
+
+struct proc_file_s proc_files[TOTAL_PROC_FILES] = {
+    { LOADAVG_FILE, -1, NULL, 0 },
+    { STAT_FILE, -1, NULL, 0 },
+    { UPTIME_FILE, -1, NULL, 0 },
+    { MEMINFO_FILE, -1, NULL, 0 },
+    { DISKSTATS_FILE, -1, NULL, 0 },
+    { NETDEV_FILE, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 },
+    { NULL, -1, NULL, 0 }
+};
+
+/* cgroup v2 files names, in order of enum proc_file */
+const char * cgroup_files[TOTAL_CGROUP_FILES] = {
+    "cpu.stat", "cpu.max", "memory.current", "memory.max", "memory.stat", "io.stat",
+    "cpu.pressure", "memory.pressure", "io.pressure"
+};
+
+/* cgroup stats, times are in microseconds, memory is in bytes */
+struct cgroup_stat_s
+{
+    double ts;                              /* monotonic time of sample, 0 if there is no sample */
+    unsigned long long usage_usec;
+    unsigned long long user_usec;
+    unsigned long long system_usec;
+    unsigned long long throttled_usec;
+    double cpu_max;                         /* cpus allowed by quota, 0 if unlimited */
+    unsigned long long mem_current;
+    unsigned long long mem_max;             /* 0 if unlimited */
+    unsigned long long anon;
+    unsigned long long file;
+    unsigned long long cpu_some;            /* total stall times of pressure files */
+    unsigned long long mem_some;
+    unsigned long long mem_full;
+    unsigned long long io_some;
+    unsigned long long io_full;
+};
+
+/* io.stat line of cgroup */
+struct cgroup_io_s
+{
+    unsigned int major;
+    unsigned int minor;
+    unsigned long long rbytes;
+    unsigned long long wbytes;
+    unsigned long long rios;
+    unsigned long long wios;
+    unsigned long long dbytes;
+    unsigned long long dios;
+};
+
+#define CGROUP_IOSTAT_COLS      6
+#define CGROUP_IOSTAT_HEADER    "Device:               r/s      w/s    rMB/s    wMB/s      d/s    dMB/s\n"
+
+/* postgres cgroup which files are opened, current and previous samples */
+struct cgroup_s
+{
+    char path[PATH_MAX];                    /* empty if cgroup isn't opened */
+    char files[TOTAL_CGROUP_FILES][PATH_MAX];
+    struct cgroup_stat_s stat[2];
+    unsigned int curr;                      /* index of the latest sample */
+    struct cgroup_io_s * io[2];
+    unsigned int n_io[2];
+    unsigned int io_size[2];
+    double io_ts[2];
+    unsigned int io_curr;
+};
+
+struct cgroup_s cgroup;
+
+/* 
+ * Backends processes files are opened through /proc directory descriptor
+ * and are kept open while backend exists, as long as descriptors limit
+ * allows. Processes beyond the limit are read with open/read/close.
+ */
+#define BACKEND_PROC_COLS   5               /* process columns inserted after pid */
+#define BACKEND_BUF_LEN     1024            /* /proc/<pid>/stat and io are short */
+#define BACKEND_FD_RESERVE  64              /* descriptors left for connections, logs and records */
+#define BACKEND_FD_DENIED   -2              /* file isn't readable, e.g. io of process of another user */
+
+struct backend_proc_s
+{
+    int pid;
+    int stat_fd;                            /* -1 if file isn't kept open */
+    int io_fd;                              /* -1 if file isn't kept open, or BACKEND_FD_DENIED */
+    bool seen;                              /* pid is found in the last query result */
+};
+
+/* processes of backends seen by the screen, each screen keeps its own */
+struct backends_cache_s
+{
+    struct backend_proc_s * pids;           /* cached processes, sorted by pid */
+    unsigned int n_pids;
+    unsigned int size;                      /* allocated entries */
+};
+
+/* state shared by screens caches */
+struct backends_proc_s
+{
+    int dir_fd;                             /* /proc directory, -1 if not opened yet */
+    unsigned int n_fds;                     /* descriptors kept open by all screens */
+    unsigned int max_fds;                   /* limit of descriptors kept open */
+    char buf[BACKEND_BUF_LEN];
+};
+
+struct backends_proc_s backends_proc = { -1, 0, 0, "" };
+
+/* process stats of backend, cpu is in hundredths of second, so its rate is percent */
+struct backend_stat_s
+{
+    long long cpu;
+    long long read_kb;
+    long long write_kb;
+    long long rss_mb;
+    char state;
+};
+
 #define GROUP_ACTIVE        1 << 0
 #define GROUP_IDLE          1 << 1
 #define GROUP_IDLE_IN_XACT  1 << 2
@@ -90,6 +276,7 @@ unsigned int hz;
 #define SUBSCREEN_LOGTAIL   1
 #define SUBSCREEN_IOSTAT    2
 #define SUBSCREEN_NICSTAT   3
+#define SUBSCREEN_CPUSTAT   4
 
 /* comparison functions */
 #define min(a,b)    (a > b) ? b : a
@@ -127,10 +314,24 @@ enum context
     pg_stat_statements_io,
     pg_stat_statements_temp,
     pg_stat_statements_local,
-    pg_stat_progress_vacuum
+    pg_stat_progress_vacuum,
+    pg_stat_backends,
+    pg_fleet
 };
 
-#define TOTAL_CONTEXTS          14
+#define TOTAL_CONTEXTS          16
+
+/* contexts names used in command line, in order of enum context */
+const char * context_names[TOTAL_CONTEXTS] = {
+    "pg_stat_database", "pg_stat_replication", "pg_stat_tables", "pg_stat_indexes",
+    "pg_statio_tables", "pg_tables_size", "pg_stat_activity_long", "pg_stat_functions",
+    "pg_stat_statements_timing", "pg_stat_statements_general", "pg_stat_statements_io",
+    "pg_stat_statements_temp", "pg_stat_statements_local", "pg_stat_progress_vacuum",
+    "pg_stat_backends", "pg_fleet"
+};
+
+/* pg_stat_statements contexts, their query texts are fetched separately */
+#define PGSS_CONTEXT(ctx)       ((ctx) >= pg_stat_statements_timing && (ctx) <= pg_stat_statements_local)
 #define DEFAULT_QUERY_CONTEXT   pg_stat_database
 
 /* struct for context list used in screen */
@@ -142,6 +343,8 @@ struct context_s
     char fstrings[MAX_COLS][S_BUF_LEN];         /* filtering patterns */
 };
 
+#define CONTEXT_SIZE (sizeof(struct context_s))
+
 /* struct for input args */
 struct args_s
 {
@@ -152,8 +355,30 @@ struct args_s
     char user[CONN_ARG_MAXLEN];
     char dbname[CONN_ARG_MAXLEN];
     bool need_passwd;
+    bool binary_results;
+    char record_file[PATH_MAX];
+    char replay_file[PATH_MAX];
+    bool report;                        /* report command is used */
+    char report_from[S_BUF_LEN];
+    char report_to[S_BUF_LEN];
+    char report_context[S_BUF_LEN];
+    char report_order[S_BUF_LEN];       /* comma separated columns names */
+    unsigned int report_limit;
+    char output_format[XS_BUF_LEN];     /* ncurses, csv or json */
+    char output_file[PATH_MAX];         /* csv and json output, stdout by default */
+    char listen[S_BUF_LEN];             /* [ADDR:]PORT of metrics endpoint */
 };
 
+/* long options which have no short equivalents */
+#define OPT_FROM            256
+#define OPT_TO              257
+#define OPT_CONTEXT         258
+#define OPT_ORDER           259
+#define OPT_LIMIT           260
+#define OPT_FORMAT          261
+#define OPT_OUTPUT          262
+#define OPT_LISTEN          263
+
 #define ARGS_SIZE (sizeof(struct args_s))
 
 /* struct for postgres specific details, get that when connected to postgres server */
@@ -163,10 +388,34 @@ struct pg_special_s
     unsigned int av_max_workers;		/* autovacuum_max_workers GUC value */
     char pg_version_num[XS_BUF_LEN];		/* postgresql version XXYYZZ format */
     char pg_version[XS_BUF_LEN];		/* postgresql version X.Y.Z format */
+    unsigned int prepared;			/* mask of contexts with prepared queries */
+    bool pg_is_local;				/* postgres runs on this host, its processes are seen */
+    char pg_cgroup[PATH_MAX];			/* cgroup v2 directory of postgres, empty if unknown */
 };
 
 #define PG_SPECIAL_SIZE (sizeof(struct pg_special_s))
 
+/* struct for postgres stats shown in sysstat screen, collected in one round trip */
+struct pg_stat_s
+{
+    char uptime[S_BUF_LEN];                     /* postmaster uptime */
+    unsigned int t_count;                       /* total number of connections */
+    unsigned int i_count;                       /* number of idle connections */
+    unsigned int x_count;                       /* number of idle in xact */
+    unsigned int a_count;                       /* number of active connections */
+    unsigned int w_count;                       /* number of waiting connections */
+    unsigned int o_count;                       /* other, unclassiffied */
+    unsigned int av_count;                      /* total number of autovacuum workers */
+    unsigned int avw_count;                     /* number of wraparound workers */
+    unsigned int mv_count;                      /* number of manual vacuums executed by user */
+    char vac_maxtime[XS_BUF_LEN];               /* the longest worker or vacuum */
+    char xact_maxtime[XS_BUF_LEN];              /* the longest transaction */
+    float avgtime;                              /* average statements time */
+    long long total_calls;                      /* total number of statements */
+    double ts;                                  /* monotonic time when stats collected */
+    bool pgss_ok;                               /* pg_stat_statements stats are valid */
+};
+
 /* struct which define connection options */
 struct screen_s
 {
@@ -185,9 +434,18 @@ struct screen_s
     int log_fd;                                 /* logfile fd for log viewing */
     enum context current_context;
     char pg_stat_activity_min_age[XS_BUF_LEN];
-    struct context_s context_list[TOTAL_CONTEXTS];
+    struct context_s * context_list;            /* allocated when screen is viewed */
     int signal_options;
     bool pg_stat_sys;
+    bool binary_results;                        /* fetch results in binary format */
+    bool host_view;                             /* show host stats even if postgres has cgroup */
+    struct backends_cache_s backends;           /* processes of backends context */
+    struct snapshot_s * p_snap;                 /* previous context query results */
+    struct snapshot_s * c_snap;                 /* current context query results */
+    bool sampled;                               /* previous snapshot is valid for rates */
+    bool query_sent;                            /* context query is in progress */
+    short connect_events;                       /* poll events awaited by connection in progress */
+    bool background_conn;                       /* connection opened without asking password */
 };
 
 #define SCREEN_SIZE (sizeof(struct screen_s))
@@ -242,9 +500,6 @@ struct iodata_s
     unsigned long io_in_progress;       /* I/Os currently in progress */
     unsigned long t_spent;              /* time spent doing I/Os (ms) */
     unsigned long t_weighted;           /* weighted time spent doing I/Os (ms) */
-    double arqsz;                       /* average request size */
-    double await;                       /* latency */
-    double util;                        /* device utilization */
 };
 
 #define STATS_IODATA_SIZE (sizeof(struct iodata_s))
@@ -279,59 +534,413 @@ struct nicdata_s
 #define SP_VALUE(m,n,p) (((double) ((n) - (m))) / (p) * 100)
 #define S_VALUE(m,n,p) (((double) ((n) - (m))) / (p) * HZ)
 
+/* Macro used to get delta of counter, counter which is reset has no delta */
+#define COUNTER_DELTA(m,n) ((n) > (m) ? (n) - (m) : 0)
+
+/* Macros used to get rate of cgroup counter, it's zero without interval */
+#define CGROUP_RATE(m,n,itv) (((itv) > 0) ? (double) COUNTER_DELTA(m, n) / (itv) : 0.0)
+#define CGROUP_PCT(m,n,itv) (CGROUP_RATE(m, n, itv) * 100)
+
+/* iostat and nicstat values, columns names are used for report ordering */
+#define IOSTAT_COLS     12
+#define IOSTAT_HEADER   "Device:           rrqm/s  wrqm/s      r/s      w/s    rMB/s    wMB/s avgrq-sz avgqu-sz     await   r_await   w_await   %%util\n"
+#define NICSTAT_COLS    13
+#define NICSTAT_HEADER  "    Interface:   rMbps   wMbps    rPk/s    wPk/s     rAvs     wAvs     IErr     OErr     Coll      Sat   %%rUtil   %%wUtil    %%Util\n"
+
+/* per-cpu values, cpus are shown in columns of CPUSTAT_WIDTH */
+#define CPUSTAT_COLS    7
+#define CPUSTAT_HEADER  "   cpu   %%usr   %%sys    %%wa    %%hi    %%si    %%st    %%id"
+#define CPUSTAT_WIDTH   55
+#define CPUSTAT_GAP     3
+#define CPUSTAT_HOT     90.0                /* busy percent of hot cpu, iowait isn't busy time */
+
+struct cpustat_row_s
+{
+    unsigned int cpu;
+    double busy;                            /* -1 if cpu has no stats */
+};
+
 /* Macros used to determine array size */
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
+/* Macros used to get minimum and maximum of two values */
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+/* Macros used to declare columns which are used as rows key in snapshots */
+#define DIFF_KEY(col) (1U << (col))
+
 /* struct for column widths */
 struct colAttrs {
-    char name[COL_MAXLEN];
+    char name[COL_MAXLEN + 1];          /* column name and filtration mark */
     int width;
 };
 
+/* struct for a single value in the snapshot, value is stored as slice of the arena */
+struct cell_s
+{
+    size_t offset;                      /* value offset from the arena start */
+    unsigned int len;                   /* value length without trailing zero */
+};
+
+/* type of output sink, sampled rows are printed into ncurses window or streamed */
+enum sink_type
+{
+    sink_ncurses,
+    sink_csv,
+    sink_json
+};
+
+#define SINK_BUF_LEN        (256 * 1024)        /* streamed rows are written by large chunks */
+
+/* struct for output sink */
+struct sink_s
+{
+    enum sink_type type;
+    WINDOW * window;                            /* ncurses sink */
+    int fd;                                     /* csv and json sinks */
+    char * buf;                                 /* rows which aren't written yet */
+    size_t size;
+    size_t used;
+    unsigned int header_cols[TOTAL_CONTEXTS];   /* csv header is written again when columns are changed */
+};
+
+#define METRICS_BUF_LEN     (64 * 1024)         /* initial size of rendered metrics, buffers grow when needed */
+#define METRICS_DEFAULT_ADDR "127.0.0.1"
+#define METRICS_BACKLOG     16
+#define METRICS_TIMEOUT     5                   /* seconds, slow scrapers are dropped */
+#define METRICS_ACCEPT_PAUSE 100000             /* usec, pause after failed accept, e.g. out of fds */
+#define METRICS_REQUEST_LEN 4096
+#define METRICS_FRESH       4                   /* middle buffer is published and isn't taken yet */
+
+/* rendered metrics */
+struct metrics_buf_s
+{
+    char * data;
+    size_t size;
+    size_t used;
+};
+
+/*
+ * Metrics are published through triple buffer: collector renders into back
+ * buffer, scraper sends front buffer, they're exchanged with middle buffer
+ * atomically, so neither of them waits for another.
+ */
+struct metrics_s
+{
+    struct metrics_buf_s bufs[3];
+    unsigned int back;                          /* owned by collector */
+    unsigned int front;                         /* owned by scraper */
+    unsigned int middle;                        /* shared, with METRICS_FRESH flag */
+    int listen_fd;
+};
+
+/* type of values stored in the snapshot column */
+enum col_type
+{
+    col_text,                           /* text values, printed as is */
+    col_number,                         /* numeric values, printed as is and sorted as numbers */
+    col_counter                         /* integer counters, printed as deltas */
+};
+
+/* struct for the snapshot column, all values of the column are stored contiguously */
+struct column_s
+{
+    char name[COL_MAXLEN];
+    enum col_type type;
+    struct cell_s * cells;              /* values slices (text and number columns) */
+    double * numbers;                   /* parsed values (number columns) */
+    long long * counters;               /* parsed values (counter columns) */
+    double * rates;                     /* deltas per second (counter columns) */
+};
+
+/*
+ * Struct for query results snapshot. Query results are parsed once into typed
+ * columns, text values are stored in a single arena. Memory is allocated once
+ * and grows only when the results grow, so repeated refreshes don't touch
+ * allocator.
+ */
+struct snapshot_s
+{
+    char * data;                        /* arena with text values */
+    size_t data_size;                   /* allocated arena size */
+    size_t data_used;                   /* used arena size */
+    struct column_s * cols;             /* snapshot columns */
+    unsigned int cols_size;             /* number of allocated columns */
+    unsigned int * order;               /* rows order, used for sorting */
+    int * prev;                         /* matched rows in previous snapshot, -1 if none */
+    long long * aligned;                /* previous counters aligned to current rows */
+    unsigned int rows_size;             /* number of allocated rows */
+    unsigned int * hash;                /* rows hash table, values are rows numbers + 1 */
+    unsigned int hash_size;             /* number of hash table slots, power of 2 */
+    unsigned int hash_key;              /* columns mask used for building hash table */
+    unsigned int key;                   /* columns mask used as rows key */
+    bool monotonic;                     /* counters never decrease, except stats reset */
+    double ts;                          /* monotonic time when query completed, in seconds */
+    unsigned int n_rows;                /* number of rows in snapshot */
+    unsigned int n_cols;                /* number of cols in snapshot */
+};
+
+#define SNAPSHOT_SIZE (sizeof(struct snapshot_s))
+
+/* Macros used to access snapshot text values */
+#define SNAPSHOT_CELL(s,row,col) (&(s)->cols[(col)].cells[(row)])
+#define SNAPSHOT_VALUE(s,row,col) ((s)->data + SNAPSHOT_CELL(s,row,col)->offset)
+
+/* cache of normalized pg_stat_statements query texts, flushed entirely when full */
+#define QUERY_CACHE_SLOTS       32768                   /* power of two */
+#define QUERY_CACHE_MAXLEN      (32 * 1024 * 1024)      /* max size of cached texts */
+
+struct query_cache_slot_s
+{
+    bool used;
+    size_t key;                         /* queryid offset in cache arena */
+    size_t value;                       /* normalized query offset in cache arena */
+    unsigned int len;                   /* normalized query length */
+};
+
+struct query_cache_s
+{
+    char * data;                        /* arena for queryids and queries */
+    size_t data_size;
+    size_t data_used;
+    struct query_cache_slot_s * slots;
+    unsigned int n_entries;
+};
+
+/* struct which passed to comparison functions */
+struct sort_key_s
+{
+    struct snapshot_s * snap;
+    unsigned int key;
+    const double * values;              /* numeric values of the key column */
+};
+
+/*
+ * Recording of statistics into binary time-series file. File starts with
+ * magic and HZ value, then frames follow. Each frame is prefixed with its 
+ * length, so frame which is partially written on crash is detected and cut.
+ * Values are stored as zigzag varints of deltas from previous frame, 
+ * keyframes are stored as deltas from zero and don't depend on other frames.
+ * Offsets of keyframes are written into sidecar index file.
+ */
+#define RECORD_MAGIC            "PGCREC01"
+#define RECORD_MAGIC_LEN        8
+#define RECORD_HEADER_LEN       (RECORD_MAGIC_LEN + 4)
+#define RECORD_INDEX_SUFFIX     ".idx"
+#define RECORD_TMP_SUFFIX       ".tmp"
+#define RECORD_INDEX_ENTRY_LEN  16                      /* wall time and offset of keyframe */
+#define RECORD_KEYFRAME_EVERY   600                     /* frames between keyframes */
+#define RECORD_MAX_COLS         64                      /* columns tracked by changed columns mask */
+
+/* Macros used to write delta of the struct field, deltas of unsigned fields may be negative */
+#define RECORD_DELTA(c,p,f) ((long long) (c)->f - (long long) (p)->f)
+#define RECORD_PUT_DELTA(buf,c,p,f) record_put_svarint((buf), RECORD_DELTA(c,p,f))
+#define RECORD_GET_DELTA(cur,c,p,f) ((c)->f = (p)->f + record_read_svarint(cur))
+
+/* replay steps and speed limits */
+#define REPLAY_STEP             60                      /* seconds, rewind and fast-forward */
+#define REPLAY_LONG_STEP        600                     /* seconds, long rewind and fast-forward */
+#define REPLAY_MAX_SPEED        64                      /* frames per refresh */
+#define REPLAY_RELEASE_LEN      (64 * 1024 * 1024)      /* mapped pages behind replay position are released by chunks */
+
+/* report over recorded stats */
+#define REPORT_DEFAULT_LIMIT    20                      /* top rows printed for each order column */
+#define REPORT_MAX_ORDERS       8                       /* order columns in one report */
+#define REPORT_IOSTAT           "iostat"
+#define REPORT_NICSTAT          "nicstat"
+
+/* type of the frame */
+enum record_frame
+{
+    frame_keyframe,
+    frame_delta
+};
+
+/* sections of the frame, section of each kind is optional */
+enum record_section
+{
+    sec_end,
+    sec_cpu,                            /* uptime, cpu_s and load average */
+    sec_mem,                            /* mem_s */
+    sec_pgstat,                         /* pg_stat_s */
+    sec_iostat,                         /* iodata_s of all devices */
+    sec_nicstat,                        /* nicdata_s of all interfaces */
+    sec_context                         /* snapshot of context query results */
+};
+
+/* operations of the snapshot rows stream, rows are compared with previous snapshot */
+enum record_op
+{
+    op_end,
+    op_skip,                            /* next rows are the same as in previous snapshot */
+    op_update,                          /* row of previous snapshot with changed columns */
+    op_insert                           /* new row with all values */
+};
+
+/* growable buffer for encoded frame */
+struct record_buf_s
+{
+    unsigned char * data;
+    size_t size;
+    size_t used;
+};
+
+/* cursor over encoded frame */
+struct record_cursor_s
+{
+    const unsigned char * data;
+    size_t len;
+    size_t pos;
+    bool error;                         /* frame is truncated or corrupted */
+};
+
+/* recorder state, previous values are kept for delta encoding */
+struct record_s
+{
+    FILE * fp;                          /* time-series file */
+    FILE * idx;                         /* keyframes index file */
+    struct record_buf_s buf;            /* current frame */
+    unsigned int frames;                /* frames written since last keyframe, or decoded since first keyframe */
+    unsigned int curr;                  /* index of current sample, previous is !curr */
+    unsigned long long uptime[2];
+    unsigned long long uptime0[2];
+    struct cpu_s cpu[2][2];             /* cpu "all" and first cpu */
+    long long la[2][3];                 /* load average multiplied by 100 */
+    struct mem_s mem[2];
+    struct pg_stat_s pg_stats[2];
+    struct iodata_s ** c_ios;
+    struct iodata_s ** p_ios;
+    unsigned int bdev;
+    bool ios_names;                     /* devices list must be written */
+    struct nicdata_s ** c_nicd;
+    struct nicdata_s ** p_nicd;
+    unsigned int idev;
+    bool nicd_names;                    /* interfaces list must be written */
+    struct snapshot_s * c_snaps[TOTAL_CONTEXTS];
+    struct snapshot_s * p_snaps[TOTAL_CONTEXTS];
+    bool sampled[TOTAL_CONTEXTS];       /* current snapshot is taken in this sample */
+    bool recorded[TOTAL_CONTEXTS];      /* previous snapshot is written in previous frame */
+    bool matched[TOTAL_CONTEXTS];       /* rows of decoded snapshot are matched with previous one */
+    bool disabled[TOTAL_CONTEXTS];      /* context query failed, it isn't recorded anymore */
+};
+
+/* replay state, frames are decoded into the same state as recorder has */
+struct replay_s
+{
+    struct record_s rec;                /* decoded frames */
+    int fd;                             /* time-series file */
+    const unsigned char * map;          /* mapped time-series file */
+    size_t map_len;                     /* mapped length, it grows while file is recorded */
+    off_t released;                     /* mapped pages before this offset are released */
+    char idx_path[PATH_MAX + sizeof(RECORD_INDEX_SUFFIX)];
+    const unsigned char * idx_map;      /* mapped keyframes index file */
+    size_t idx_len;
+    ino_t idx_ino;                      /* index file is replaced by restarted recorder */
+    long long * index_wall;             /* keyframes found by walking over frames, used without index file */
+    off_t * index_offset;
+    unsigned int n_index;
+    unsigned int index_size;
+    off_t offset;                       /* offset of the next frame */
+    long long wall;                     /* wall time of last decoded frame */
+    bool decoded;                       /* any frame is decoded */
+    bool corrupted;                     /* frame at offset can't be decoded */
+};
+
+/*
+ * Report state. Counters deltas of frames in the time window are summed
+ * into totals, so memory depends only on the number of distinct rows.
+ */
+struct report_s
+{
+    enum context context;
+    unsigned int subscreen;             /* SUBSCREEN_IOSTAT or SUBSCREEN_NICSTAT, context isn't used then */
+    struct snapshot_s * acc;            /* context rows with counters totals */
+    struct snapshot_s * tmp;            /* acc merged with the next frame, then they're swapped */
+    int * rows;                         /* acc rows matched with frame rows, -1 if none */
+    bool * matched;                     /* acc rows found in the frame */
+    unsigned int rows_size;
+    unsigned int matched_size;
+    struct iodata_s * ios;              /* devices with counters totals */
+    unsigned int n_ios;
+    unsigned int ios_size;
+    struct nicdata_s * nicd;            /* interfaces with counters totals */
+    unsigned int n_nicd;
+    unsigned int nicd_size;
+    unsigned long long itv;             /* sum of frames intervals, in jiffies */
+    unsigned int frames;                /* aggregated frames */
+    long long start;                    /* wall time of the window start, in microseconds */
+    long long end;                      /* wall time of the last aggregated frame */
+};
+
+/* PostgreSQL types OIDs used for parsing query results, see src/include/catalog/pg_type.h */
+#define BOOLOID         16
+#define INT8OID         20
+#define INT2OID         21
+#define INT4OID         23
+#define TEXTOID         25
+#define OIDOID          26
+#define FLOAT4OID       700
+#define FLOAT8OID       701
+#define NUMERICOID      1700
+
+/* binary format of numeric, see src/backend/utils/adt/numeric.c */
+#define NUMERIC_NBASE       10000
+#define NUMERIC_DEC_DIGITS  4
+#define NUMERIC_NEG         0x4000
+#define NUMERIC_NAN         0xC000
+#define NUMERIC_HDRSZ       8               /* ndigits, weight, sign, dscale */
+
+/* space reserved for text representation of values received in binary format */
+#define BINARY_TEXT_MAXLEN  S_BUF_LEN
+
 /* PostgreSQL answers, see PQresultStatus() at http://www.postgresql.org/docs/9.4/static/libpq-exec.html */
 #define PG_CMD_OK       PGRES_COMMAND_OK
 #define PG_TUP_OK       PGRES_TUPLES_OK
 #define PG_FATAL_ERR    PGRES_FATAL_ERROR
 
-/* sysstat screen queries */
+/* sysstat screen queries, pg_stat_activity is scanned once */
+#define PG_SYS_STAT_ACTIVITY_COMMON \
+         "count(CASE WHEN state = 'idle' THEN 1 END) AS idle, \
+         count(CASE WHEN state IN ('idle in transaction', 'idle in transaction (aborted)') THEN 1 END) AS idle_in_xact, \
+         count(CASE WHEN state = 'active' THEN 1 END) AS active, "
+#define PG_SYS_STAT_ACTIVITY_OTHERS \
+         "count(CASE WHEN state IN ('fastpath function call','disabled') THEN 1 END) AS others, \
+         count(CASE WHEN query ~* '^autovacuum:' AND pid <> pg_backend_pid() THEN 1 END) AS av_workers, \
+         count(CASE WHEN query ~* '^autovacuum:.*to prevent wraparound' AND pid <> pg_backend_pid() THEN 1 END) AS av_wrap, \
+         count(CASE WHEN query ~* '^vacuum' AND pid <> pg_backend_pid() THEN 1 END) AS v_manual, \
+         coalesce(date_trunc('seconds', max(CASE WHEN (query ~* '^autovacuum:' OR query ~* '^vacuum') \
+             AND pid <> pg_backend_pid() THEN now() - xact_start END)), '00:00:00') AS av_maxtime, \
+         coalesce(date_trunc('seconds', max(CASE WHEN query !~* '^autovacuum:' AND query !~* '^vacuum' \
+             AND pid <> pg_backend_pid() THEN now() - xact_start END)), '00:00:00') AS xact_maxtime \
+       FROM pg_stat_activity;"
+
 /* for postgresql versions before 9.6 */
-#define PG_STAT_ACTIVITY_COUNT_95_QUERY \
-    "WITH pgsa AS (SELECT * FROM pg_stat_activity) \
-       SELECT \
-         (SELECT count(*) AS total FROM pgsa), \
-         (SELECT count(*) AS idle FROM pgsa WHERE state = 'idle'), \
-         (SELECT count(*) AS idle_in_xact FROM pgsa WHERE state IN ('idle in transaction', 'idle in transaction (aborted)')), \
-         (SELECT count(*) AS active FROM pgsa WHERE state = 'active'), \
-         (SELECT count(*) AS waiting FROM pgsa WHERE waiting), \
-         (SELECT count(*) AS others FROM pgsa WHERE state IN ('fastpath function call','disabled'));"
+#define PG_SYS_STAT_ACTIVITY_95_QUERY \
+    "SELECT \
+         date_trunc('seconds', now() - pg_postmaster_start_time()) AS uptime, \
+         count(*) AS total, " \
+         PG_SYS_STAT_ACTIVITY_COMMON \
+         "count(CASE WHEN waiting THEN 1 END) AS waiting, " \
+         PG_SYS_STAT_ACTIVITY_OTHERS
 
 /* for postgresql versions since 9.6 */
-#define PG_STAT_ACTIVITY_COUNT_QUERY \
-    "WITH pgsa AS (SELECT * FROM pg_stat_activity) \
-       SELECT \
-         (SELECT count(*) AS total FROM pgsa), \
-         (SELECT count(*) AS idle FROM pgsa WHERE state = 'idle'), \
-         (SELECT count(*) AS idle_in_xact FROM pgsa WHERE state IN ('idle in transaction', 'idle in transaction (aborted)')), \
-         (SELECT count(*) AS active FROM pgsa WHERE state = 'active'), \
-         (SELECT count(*) AS waiting FROM pgsa WHERE wait_event IS NOT NULL), \
-         (SELECT count(*) AS others FROM pgsa WHERE state IN ('fastpath function call','disabled'));"
-
-#define PG_STAT_ACTIVITY_AV_COUNT_QUERY \
-    "WITH pgsa AS (SELECT * FROM pg_stat_activity) \
-       SELECT \
-         (SELECT count(*) AS av_workers FROM pgsa WHERE query ~* '^autovacuum:' AND pid <> pg_backend_pid()), \
-         (SELECT count(*) AS av_wrap FROM pgsa WHERE query ~* '^autovacuum:.*to prevent wraparound' AND pid <> pg_backend_pid()), \
-	 (SELECT count(*) AS v_manual FROM pgsa WHERE query ~* '^vacuum' AND pid <> pg_backend_pid()), \
-	 (SELECT coalesce(date_trunc('seconds', max(now() - xact_start)), '00:00:00') AS av_maxtime FROM pgsa \
-	 WHERE (query ~* '^autovacuum:' OR query ~* '^vacuum') AND pid <> pg_backend_pid());"
+#define PG_SYS_STAT_ACTIVITY_QUERY \
+    "SELECT \
+         date_trunc('seconds', now() - pg_postmaster_start_time()) AS uptime, \
+         count(*) AS total, " \
+         PG_SYS_STAT_ACTIVITY_COMMON \
+         "count(CASE WHEN wait_event IS NOT NULL THEN 1 END) AS waiting, " \
+         PG_SYS_STAT_ACTIVITY_OTHERS
 
+/* pg_stat_statements might be not installed, so it goes last in the batch */
 #define PG_STAT_STATEMENTS_SYS_QUERY \
         "SELECT (sum(total_time) / sum(calls))::numeric(6,3) AS avg_query, sum(calls) AS total_calls FROM pg_stat_statements"
-#define PG_STAT_ACTIVITY_SYS_QUERY \
-        "SELECT coalesce(date_trunc('seconds', max(now() - xact_start)), '00:00:00') FROM pg_stat_activity \
-            WHERE (query !~* '^autovacuum:' AND query !~* '^vacuum') AND pid <> pg_backend_pid()"
 
-/* context queries */
+/* 
+ * context queries, pg_stat_statements queries return only queryid without
+ * query text, texts are fetched once and cached on client side.
+ */
 #define PG_STAT_DATABASE_91_QUERY \
     "SELECT \
         datname, \
@@ -340,8 +949,7 @@ struct colAttrs {
         tup_returned AS returned, tup_fetched AS fetched, \
         tup_inserted AS inserts, tup_updated AS updates, tup_deleted AS deletes, \
         conflicts \
-    FROM pg_stat_database \
-    ORDER BY datname"
+    FROM pg_stat_database"
 
 #define PG_STAT_DATABASE_QUERY \
     "SELECT \
@@ -353,20 +961,21 @@ struct colAttrs {
         conflicts, deadlocks, \
         temp_files AS tmp_files, temp_bytes AS tmp_bytes, \
         blk_read_time AS read_t, blk_write_time AS write_t \
-    FROM pg_stat_database \
-    ORDER BY datname DESC"
+    FROM pg_stat_database"
 
 /* Start and end number for columns used for make diff array */
 #define PG_STAT_DATABASE_DIFF_MIN           1
 #define PG_STAT_DATABASE_DIFF_MAX_91        10
 #define PG_STAT_DATABASE_DIFF_MAX_LT        15
+/* Columns mask used as a key for matching rows from previous and current snapshots */
+#define PG_STAT_DATABASE_DIFF_KEY           DIFF_KEY(0)                     /* datname */
 /* Max number of columns for specified context, can vary in different PostgreSQL versions */
 #define PG_STAT_DATABASE_CMAX_91            10
 #define PG_STAT_DATABASE_CMAX_LT            15
 
 #define PG_STAT_REPLICATION_QUERY_P1 \
     "SELECT \
-        client_addr AS client, usename AS user, application_name AS name, \
+        host(client_addr) AS client, usename AS user, application_name AS name, \
         state, sync_state AS mode, \
 	(pg_xlog_location_diff("
 #define PG_STAT_REPLICATION_QUERY_P2 \
@@ -376,15 +985,22 @@ struct colAttrs {
 	(pg_xlog_location_diff(flush_location,replay_location) / 1024)::int as replay, \
 	(pg_xlog_location_diff("
 #define PG_STAT_REPLICATION_QUERY_P3 \
-    ",replay_location))::int / 1024 as total_lag FROM pg_stat_replication \
-    ORDER BY left(md5(client_addr::text || client_port::text), 10) DESC"
+    ",replay_location))::int / 1024 as total_lag FROM pg_stat_replication"
 
 /* use functions depending on recovery */
 #define PG_STAT_REPLICATION_NOREC "pg_current_xlog_location()"
 #define PG_STAT_REPLICATION_REC "pg_last_xlog_receive_location()"
 #define PG_STAT_REPLICATION_CMAX_LT 9
 
-#define PG_STAT_TABLES_QUERY_P1 \
+/* 
+ * Statistics of user or all tables and indexes are selected using $1 parameter,
+ * conditions are the same as in pg_stat_user_* views.
+ */
+#define PG_STAT_SCHEMAS_FILTER(alias) \
+    "($1::bool OR (" alias "schemaname NOT IN ('pg_catalog', 'information_schema') \
+        AND " alias "schemaname !~ '^pg_toast'))"
+
+#define PG_STAT_TABLES_QUERY \
     "SELECT \
         schemaname || '.' || relname as relation, \
         seq_scan, seq_tup_read as seq_read, \
@@ -392,14 +1008,15 @@ struct colAttrs {
         n_tup_ins as inserts, n_tup_upd as updates, \
         n_tup_del as deletes, n_tup_hot_upd as hot_updates, \
         n_live_tup as live, n_dead_tup as dead \
-    FROM pg_stat_"
-#define PG_STAT_TABLES_QUERY_P2 "_tables ORDER BY (schemaname || '.' || relname) DESC"
+    FROM pg_stat_all_tables \
+    WHERE " PG_STAT_SCHEMAS_FILTER("")
 
 #define PG_STAT_TABLES_DIFF_MIN     1
 #define PG_STAT_TABLES_DIFF_MAX     10
+#define PG_STAT_TABLES_DIFF_KEY     DIFF_KEY(0)                     /* relation */
 #define PG_STAT_TABLES_CMAX_LT      10
 
-#define PG_STATIO_TABLES_QUERY_P1 \
+#define PG_STATIO_TABLES_QUERY \
     "SELECT \
         schemaname ||'.'|| relname as relation, \
         heap_blks_read * (SELECT current_setting('block_size')::int / 1024) AS heap_read, \
@@ -410,30 +1027,30 @@ struct colAttrs {
         toast_blks_hit * (SELECT current_setting('block_size')::int / 1024) AS toast_hit, \
         tidx_blks_read * (SELECT current_setting('block_size')::int / 1024) AS tidx_read, \
         tidx_blks_hit * (SELECT current_setting('block_size')::int / 1024) AS tidx_hit \
-    FROM pg_statio_"
-#define PG_STATIO_TABLES_QUERY_P2 "_tables ORDER BY (schemaname || '.' || relname) DESC"
+    FROM pg_statio_all_tables \
+    WHERE " PG_STAT_SCHEMAS_FILTER("")
 
 #define PG_STATIO_TABLES_DIFF_MIN   1
 #define PG_STATIO_TABLES_DIFF_MAX   8
+#define PG_STATIO_TABLES_DIFF_KEY   DIFF_KEY(0)                     /* relation */
 #define PG_STATIO_TABLES_CMAX_LT    8
 
-#define PG_STAT_INDEXES_QUERY_P1 \
+#define PG_STAT_INDEXES_QUERY \
     "SELECT \
         s.schemaname ||'.'|| s.relname as relation, s.indexrelname AS index, \
         s.idx_scan, s.idx_tup_read, s.idx_tup_fetch, \
         i.idx_blks_read * (SELECT current_setting('block_size')::int / 1024) AS idx_read, \
         i.idx_blks_hit * (SELECT current_setting('block_size')::int / 1024) AS idx_hit \
     FROM \
-        pg_stat_"
-#define PG_STAT_INDEXES_QUERY_P2 "_indexes s, pg_statio_"
-#define PG_STAT_INDEXES_QUERY_P3 "_indexes i WHERE s.indexrelid = i.indexrelid \
-        ORDER BY (s.schemaname ||'.'|| s.relname ||'.'|| s.indexrelname) DESC"
+        pg_stat_all_indexes s, pg_statio_all_indexes i \
+    WHERE s.indexrelid = i.indexrelid AND " PG_STAT_SCHEMAS_FILTER("s.")
 
 #define PG_STAT_INDEXES_DIFF_MIN    2
 #define PG_STAT_INDEXES_DIFF_MAX    6
+#define PG_STAT_INDEXES_DIFF_KEY    (DIFF_KEY(0) | DIFF_KEY(1))     /* relation, index */
 #define PG_STAT_INDEXES_CMAX_LT     6
 
-#define PG_TABLES_SIZE_QUERY_P1 \
+#define PG_TABLES_SIZE_QUERY \
     "SELECT \
         s.schemaname ||'.'|| s.relname AS relation, \
         pg_total_relation_size((s.schemaname ||'.'|| s.relname)::regclass) / 1024 AS total_size, \
@@ -444,15 +1061,15 @@ struct colAttrs {
         pg_relation_size((s.schemaname ||'.'|| s.relname)::regclass) / 1024 AS rel_change, \
         (pg_total_relation_size((s.schemaname ||'.'|| s.relname)::regclass) / 1024) - \
             (pg_relation_size((s.schemaname ||'.'|| s.relname)::regclass) / 1024) AS idx_change \
-        FROM pg_stat_"
-#define PG_TABLES_SIZE_QUERY_P2 "_tables s, pg_class c WHERE s.relid = c.oid \
-        ORDER BY (s.schemaname || '.' || s.relname) DESC"
+        FROM pg_stat_all_tables s, pg_class c \
+    WHERE s.relid = c.oid AND " PG_STAT_SCHEMAS_FILTER("s.")
 
 #define PG_TABLES_SIZE_DIFF_MIN     4
 #define PG_TABLES_SIZE_DIFF_MAX     6
+#define PG_TABLES_SIZE_DIFF_KEY     DIFF_KEY(0)                     /* relation */
 #define PG_TABLES_SIZE_CMAX_LT      6
 
-#define PG_STAT_ACTIVITY_LONG_91_QUERY_P1 \
+#define PG_STAT_ACTIVITY_LONG_91_QUERY \
     "SELECT \
         procpid AS pid, client_addr AS cl_addr, client_port AS cl_port, \
         datname, usename, waiting, \
@@ -469,20 +1086,17 @@ struct colAttrs {
             E'/\\\\*.*?\\\\*\\/', '', 'g'), \
             E'\\\\s+', ' ', 'g') AS query \
     FROM pg_stat_activity \
-    WHERE ((clock_timestamp() - xact_start) > '"
-#define PG_STAT_ACTIVITY_LONG_91_QUERY_P2 \
-    "'::interval OR (clock_timestamp() - query_start) > '"
-#define PG_STAT_ACTIVITY_LONG_91_QUERY_P3 \
-    "'::interval) AND current_query <> '<IDLE>' AND procpid <> pg_backend_pid() \
+    WHERE ((clock_timestamp() - xact_start) > $1::interval \
+        OR (clock_timestamp() - query_start) > $1::interval) AND current_query <> '<IDLE>' AND procpid <> pg_backend_pid() \
     ORDER BY procpid DESC"
 
-#define PG_STAT_ACTIVITY_LONG_95_QUERY_P1 \
+#define PG_STAT_ACTIVITY_LONG_95_QUERY \
     "SELECT \
-        pid, client_addr AS cl_addr, client_port AS cl_port, \
+        pid, host(client_addr) AS cl_addr, client_port AS cl_port, \
         datname, usename, state, waiting, \
-        date_trunc('seconds', clock_timestamp() - xact_start) AS xact_age, \
-        date_trunc('seconds', clock_timestamp() - query_start) AS query_age, \
-        date_trunc('seconds', clock_timestamp() - state_change) AS change_age, \
+        date_trunc('seconds', clock_timestamp() - xact_start)::text AS xact_age, \
+        date_trunc('seconds', clock_timestamp() - query_start)::text AS query_age, \
+        date_trunc('seconds', clock_timestamp() - state_change)::text AS change_age, \
         regexp_replace( \
         regexp_replace( \
         regexp_replace( \
@@ -494,20 +1108,17 @@ struct colAttrs {
             E'/\\\\*.*?\\\\*\\/', '', 'g'), \
             E'\\\\s+', ' ', 'g') AS query \
     FROM pg_stat_activity \
-    WHERE ((clock_timestamp() - xact_start) > '"
-#define PG_STAT_ACTIVITY_LONG_95_QUERY_P2 \
-    "'::interval OR (clock_timestamp() - query_start) > '"
-#define PG_STAT_ACTIVITY_LONG_95_QUERY_P3 \
-    "'::interval) AND state <> 'idle' AND pid <> pg_backend_pid() \
+    WHERE ((clock_timestamp() - xact_start) > $1::interval \
+        OR (clock_timestamp() - query_start) > $1::interval) AND state <> 'idle' AND pid <> pg_backend_pid() \
     ORDER BY pid DESC"
 
-#define PG_STAT_ACTIVITY_LONG_QUERY_P1 \
+#define PG_STAT_ACTIVITY_LONG_QUERY \
     "SELECT \
-        pid, client_addr AS cl_addr, client_port AS cl_port, \
+        pid, host(client_addr) AS cl_addr, client_port AS cl_port, \
         datname, usename, state, wait_event_type AS wait_etype, wait_event, \
-        date_trunc('seconds', clock_timestamp() - xact_start) AS xact_age, \
-        date_trunc('seconds', clock_timestamp() - query_start) AS query_age, \
-        date_trunc('seconds', clock_timestamp() - state_change) AS change_age, \
+        date_trunc('seconds', clock_timestamp() - xact_start)::text AS xact_age, \
+        date_trunc('seconds', clock_timestamp() - query_start)::text AS query_age, \
+        date_trunc('seconds', clock_timestamp() - state_change)::text AS change_age, \
         regexp_replace( \
         regexp_replace( \
         regexp_replace( \
@@ -519,11 +1130,8 @@ struct colAttrs {
             E'/\\\\*.*?\\\\*\\/', '', 'g'), \
             E'\\\\s+', ' ', 'g') AS query \
     FROM pg_stat_activity \
-    WHERE ((clock_timestamp() - xact_start) > '"
-#define PG_STAT_ACTIVITY_LONG_QUERY_P2 \
-    "'::interval OR (clock_timestamp() - query_start) > '"
-#define PG_STAT_ACTIVITY_LONG_QUERY_P3 \
-    "'::interval) AND state <> 'idle' AND pid <> pg_backend_pid() \
+    WHERE ((clock_timestamp() - xact_start) > $1::interval \
+        OR (clock_timestamp() - query_start) > $1::interval) AND state <> 'idle' AND pid <> pg_backend_pid() \
     ORDER BY pid DESC"
 
 /* don't use array sorting when showing long activity, row order defined in query */
@@ -535,15 +1143,15 @@ struct colAttrs {
     "SELECT \
         funcid, schemaname ||'.'||funcname AS function, \
         calls AS total_calls, calls AS calls, \
-        date_trunc('seconds', total_time / 1000 * '1 second'::interval) AS total_t, \
-        date_trunc('seconds', self_time / 1000 * '1 second'::interval) AS self_t, \
+        date_trunc('seconds', total_time / 1000 * '1 second'::interval)::text AS total_t, \
+        date_trunc('seconds', self_time / 1000 * '1 second'::interval)::text AS self_t, \
         round((total_time / calls)::numeric, 4) AS avg_t, \
         round((self_time / calls)::numeric, 4) AS avg_self_t \
-    FROM pg_stat_user_functions \
-    ORDER BY funcid DESC"
+    FROM pg_stat_user_functions"
 
 /* diff array using only one column */
 #define PG_STAT_FUNCTIONS_DIFF_MIN     3
+#define PG_STAT_FUNCTIONS_DIFF_KEY     DIFF_KEY(0)                  /* funcid */
 #define PG_STAT_FUNCTIONS_CMAX_LT      7
 
 #define PG_STAT_STATEMENTS_TIMING_91_QUERY_P1 \
@@ -552,56 +1160,36 @@ struct colAttrs {
         date_trunc('seconds', round(sum(p.total_time)) / 1000 * '1 second'::interval) AS t_all_t, \
         round(sum(p.total_time)) AS all_t, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PG_STAT_STATEMENTS_TIMING_QUERY_P1 \
     "SELECT \
         a.rolname AS user, d.datname AS database, \
-        date_trunc('seconds', round(sum(p.total_time)) / 1000 * '1 second'::interval) AS t_all_t, \
-        date_trunc('seconds', round(sum(p.blk_read_time)) / 1000 * '1 second'::interval) AS t_read_t, \
-        date_trunc('seconds', round(sum(p.blk_write_time)) / 1000 * '1 second'::interval) AS t_write_t, \
-        date_trunc('seconds', round((sum(p.total_time) - (sum(p.blk_read_time) + sum(p.blk_write_time)))) / 1000 * '1 second'::interval) AS t_cpu_t, \
+        date_trunc('seconds', round(sum(p.total_time)) / 1000 * '1 second'::interval)::text AS t_all_t, \
+        date_trunc('seconds', round(sum(p.blk_read_time)) / 1000 * '1 second'::interval)::text AS t_read_t, \
+        date_trunc('seconds', round(sum(p.blk_write_time)) / 1000 * '1 second'::interval)::text AS t_write_t, \
+        date_trunc('seconds', round((sum(p.total_time) - (sum(p.blk_read_time) + sum(p.blk_write_time)))) / 1000 * '1 second'::interval)::text AS t_cpu_t, \
         round(sum(p.total_time)) AS all_t, \
         round(sum(p.blk_read_time)) AS read_t, \
         round(sum(p.blk_write_time)) AS write_t, \
         round((sum(p.total_time) - (sum(p.blk_read_time) + sum(p.blk_write_time)))) AS cpu_t, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PGSS_TIMING_DIFF_MIN_91  3
 #define PGSS_TIMING_DIFF_MAX_91  4
 #define PGSS_TIMING_DIFF_MIN_LT  6
 #define PGSS_TIMING_DIFF_MAX_LT  10
+#define PGSS_TIMING_DIFF_KEY_91  (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(5))     /* user, database, queryid */
+#define PGSS_TIMING_DIFF_KEY_LT  (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(11))
 #define PGSS_TIMING_CMAX_91      6
 #define PGSS_TIMING_CMAX_LT      12
 
@@ -610,47 +1198,26 @@ struct colAttrs {
         a.rolname AS user, d.datname AS database, \
         sum(p.calls) AS t_calls, sum(p.rows) as t_rows, \
         sum(p.calls) AS calls, sum(p.rows) as rows, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PG_STAT_STATEMENTS_GENERAL_QUERY_P1 \
     "SELECT \
         a.rolname AS user, d.datname AS database, \
         sum(p.calls) AS t_calls, sum(p.rows) as t_rows, \
         sum(p.calls) AS calls, sum(p.rows) as rows, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PGSS_GENERAL_DIFF_MIN_LT    4
 #define PGSS_GENERAL_DIFF_MAX_LT    5
+#define PGSS_GENERAL_DIFF_KEY_LT    (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(6))  /* user, database, queryid */
 #define PGSS_GENERAL_CMAX_LT        7
 
 #define PG_STAT_STATEMENTS_IO_91_QUERY_P1 \
@@ -669,22 +1236,11 @@ struct colAttrs {
         (sum(p.shared_blks_written) + sum(p.local_blks_written)) \
             * (SELECT current_setting('block_size')::int / 1024) as written, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PG_STAT_STATEMENTS_IO_QUERY_P1 \
     "SELECT \
@@ -706,27 +1262,18 @@ struct colAttrs {
         (sum(p.shared_blks_written) + sum(p.local_blks_written)) \
             * (SELECT current_setting('block_size')::int / 1024) as written, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PGSS_IO_DIFF_MIN_91    5
 #define PGSS_IO_DIFF_MAX_91    8
 #define PGSS_IO_DIFF_MIN_LT    6
 #define PGSS_IO_DIFF_MAX_LT    10
+#define PGSS_IO_DIFF_KEY_91    (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(9))       /* user, database, queryid */
+#define PGSS_IO_DIFF_KEY_LT    (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(11))
 #define PGSS_IO_CMAX_91    10
 #define PGSS_IO_CMAX_LT    12
 
@@ -742,25 +1289,15 @@ struct colAttrs {
         sum(p.temp_blks_written) \
             * (SELECT current_setting('block_size')::int / 1024) as tmp_write, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PGSS_TEMP_DIFF_MIN_LT   4
 #define PGSS_TEMP_DIFF_MAX_LT   6
+#define PGSS_TEMP_DIFF_KEY_LT   (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(7))      /* user, database, queryid */
 #define PGSS_TEMP_CMIN_LT       2
 #define PGSS_TEMP_CMAX_LT       8
 
@@ -774,22 +1311,11 @@ struct colAttrs {
         (sum(p.local_blks_read)) * (SELECT current_setting('block_size')::int / 1024) as lo_reads, \
         (sum(p.local_blks_written)) * (SELECT current_setting('block_size')::int / 1024) as lo_written, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PG_STAT_STATEMENTS_LOCAL_QUERY_P1 \
     "SELECT \
@@ -803,35 +1329,38 @@ struct colAttrs {
         (sum(p.local_blks_dirtied)) * (SELECT current_setting('block_size')::int / 1024) as lo_dirtied, \
         (sum(p.local_blks_written)) * (SELECT current_setting('block_size')::int / 1024) as lo_written, \
         sum(p.calls) AS calls, \
-        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace( \
-        regexp_replace(p.query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') AS query \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid \
     FROM pg_stat_statements p \
     JOIN pg_authid a ON a.oid=p.userid \
     JOIN pg_database d ON d.oid=p.dbid \
-    GROUP BY a.rolname, d.datname, query \
-    ORDER BY left(md5(d.datname || a.rolname || p.query ), 10) DESC"
+    GROUP BY a.rolname, d.datname, query"
 
 #define PGSS_LOCAL_DIFF_MIN_91    5
 #define PGSS_LOCAL_DIFF_MAX_91    8
 #define PGSS_LOCAL_DIFF_MIN_LT    6
 #define PGSS_LOCAL_DIFF_MAX_LT    10
+#define PGSS_LOCAL_DIFF_KEY_91    (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(9))    /* user, database, queryid */
+#define PGSS_LOCAL_DIFF_KEY_LT    (DIFF_KEY(0) | DIFF_KEY(1) | DIFF_KEY(11))
 #define PGSS_LOCAL_CMAX_91    10
 #define PGSS_LOCAL_CMAX_LT    12
 
+/* texts of pg_stat_statements queries, $1 is array of queryids */
+#define PG_STAT_STATEMENTS_TEXTS_QUERY \
+    "SELECT DISTINCT ON (1) \
+        left(md5(d.datname || a.rolname || p.query ), 10) AS queryid, p.query \
+    FROM pg_stat_statements p \
+    JOIN pg_authid a ON a.oid=p.userid \
+    JOIN pg_database d ON d.oid=p.dbid \
+    WHERE left(md5(d.datname || a.rolname || p.query ), 10) = ANY($1::text[])"
+
+/* name of column synthesized from cached query texts */
+#define PGSS_QUERY_COLUMN       "query"
+
 #define PG_STAT_PROGRESS_VACUUM_QUERY \
     "SELECT \
      	a.pid, \
-	date_trunc('seconds', clock_timestamp() - xact_start) AS xact_age, \
-        v.datname, v.relid::regclass AS relation, \
+	date_trunc('seconds', clock_timestamp() - xact_start)::text AS xact_age, \
+        v.datname, v.relid::regclass::text AS relation, \
 	a.state, v.phase, \
 	v.heap_blks_total * (SELECT current_setting('block_size')::int / 1024) AS total, \
 	v.heap_blks_scanned * (SELECT current_setting('block_size')::int / 1024) AS scanned, \
@@ -844,6 +1373,76 @@ struct colAttrs {
 
 #define PG_STAT_PROGRESS_VACUUM_CMAX_LT 11
 
+/* 
+ * Backends query is joined with processes stats on client side, process
+ * columns (cpu, read_kb, write_kb, rss_mb, pstate) are inserted after pid.
+ */
+#define PG_STAT_BACKENDS_91_QUERY \
+    "SELECT \
+        procpid AS pid, datname, usename AS user, waiting, \
+        date_trunc('seconds', clock_timestamp() - query_start) AS query_age, \
+        current_query AS query \
+    FROM pg_stat_activity WHERE procpid <> pg_backend_pid() \
+    ORDER BY procpid DESC"
+
+#define PG_STAT_BACKENDS_95_QUERY \
+    "SELECT \
+        pid, datname, usename AS user, state, waiting, \
+        date_trunc('seconds', clock_timestamp() - query_start)::text AS query_age, \
+        query \
+    FROM pg_stat_activity WHERE pid <> pg_backend_pid() \
+    ORDER BY pid DESC"
+
+#define PG_STAT_BACKENDS_QUERY \
+    "SELECT \
+        pid, datname, usename AS user, state, \
+        wait_event_type AS wait_etype, wait_event, \
+        date_trunc('seconds', clock_timestamp() - query_start)::text AS query_age, \
+        query \
+    FROM pg_stat_activity WHERE pid <> pg_backend_pid() \
+    ORDER BY pid DESC"
+
+#define PG_STAT_BACKENDS_DIFF_MIN   1
+#define PG_STAT_BACKENDS_DIFF_MAX   3
+#define PG_STAT_BACKENDS_DIFF_KEY   DIFF_KEY(0)                     /* pid */
+#define PG_STAT_BACKENDS_CMAX_91    10
+#define PG_STAT_BACKENDS_CMAX_95    11
+#define PG_STAT_BACKENDS_CMAX_LT    12
+
+/* 
+ * Fleet overview query is sent to all connections, each server returns one
+ * row and server name and state columns are added on client side.
+ */
+#define PG_FLEET_QUERY_P1 \
+    "SELECT \
+        (SELECT sum(xact_commit + xact_rollback) FROM pg_stat_database) AS xacts, \
+        (SELECT sum(xact_rollback) FROM pg_stat_database) AS rollbacks, \
+        count(CASE WHEN state = 'active' THEN 1 END) AS active, \
+        count(CASE WHEN state IN ('idle in transaction', 'idle in transaction (aborted)') THEN 1 END) AS idle_xact, "
+#define PG_FLEET_WAITING_95 "count(CASE WHEN waiting THEN 1 END) AS waiting, "
+#define PG_FLEET_WAITING    "count(CASE WHEN wait_event IS NOT NULL THEN 1 END) AS waiting, "
+#define PG_FLEET_QUERY_P2 \
+        "coalesce(date_trunc('seconds', max(CASE WHEN query !~* '^autovacuum:' AND query !~* '^vacuum' \
+            THEN now() - xact_start END)), '00:00:00')::text AS xact_maxtime, \
+        CASE WHEN pg_is_in_recovery() \
+            THEN coalesce(date_trunc('seconds', now() - pg_last_xact_replay_timestamp()), '00:00:00')::text \
+            ELSE (SELECT coalesce(pg_size_pretty(max(pg_xlog_location_diff(pg_current_xlog_location(), replay_location))::bigint), '0 bytes') \
+                FROM pg_stat_replication) \
+        END AS repl_lag, \
+        (SELECT round(100 * sum(blks_hit) / nullif(sum(blks_hit) + sum(blks_read), 0), 2) \
+            FROM pg_stat_database) AS hit_ratio \
+    FROM pg_stat_activity WHERE pid <> pg_backend_pid()"
+
+#define PG_FLEET_DIFF_MIN   2
+#define PG_FLEET_DIFF_MAX   3
+#define PG_FLEET_DIFF_KEY   (DIFF_KEY(0) | DIFF_KEY(1))         /* server, state */
+#define PG_FLEET_CMAX_LT    9
+
+#define PG_FLEET_STATE_OK           "ok"
+#define PG_FLEET_STATE_CONNECTING   "connecting"
+#define PG_FLEET_STATE_UNREACHABLE  "unreachable"
+#define PG_FLEET_STATE_FAILED       "failed"
+
 /* other queries */
 /* don't log our queries */
 #define PG_SUPPRESS_LOG_QUERY "SET log_min_duration_statement TO 10000"
@@ -880,19 +1479,20 @@ struct colAttrs {
 /* reset statistics query */
 #define PG_STAT_RESET_QUERY "SELECT pg_stat_reset(), pg_stat_statements_reset()"
 
-/* postmaster uptime query */
-#define PG_UPTIME_QUERY "SELECT date_trunc('seconds', now() - pg_postmaster_start_time())"
-
 /* start end exit functions */
 void sig_handler(int signo);
 void init_signal_handlers(void);
-void init_screens(struct screen_s *screens[]);
+void init_screens(struct screen_s ** screens[], PGconn ** conns[]);
+void grow_screens(struct screen_s ** screens[], PGconn ** conns[], unsigned int size);
+unsigned int count_screens(struct screen_s * screens[]);
+void activate_screen(struct screen_s * screen);
 struct args_s * init_args_mem(void);
 void init_args_struct(struct args_s *args);
 void check_portnum(const char * portnum);
 void arg_parse(int argc, char *argv[], struct args_s *args);
 void create_initial_conn(struct args_s * args, struct screen_s * screens[]);
-unsigned int create_pgcenterrc_conn(struct args_s * args, struct screen_s * screens[], unsigned int pos);
+unsigned int create_pgcenterrc_conn(struct args_s * args, struct screen_s ** screens[],
+        PGconn ** conns[], unsigned int pos);
 void exit_prog(struct screen_s * screens[], PGconn * conns[]);
 
 /* connections and queries unctions */
@@ -900,12 +1500,42 @@ char * password_prompt(const char *prompt, unsigned int pw_maxlen, bool echo);
 void reconnect_if_failed(WINDOW * window, PGconn * conn, struct screen_s * screen, bool *reconnected);
 void prepare_conninfo(struct screen_s * screens[]);
 void open_connections(struct screen_s * screens[], PGconn * conns[]);
+void init_connection(PGconn * conn, struct screen_s * screen);
+PGconn * open_screen_connection(WINDOW * window, struct screen_s * screen);
+PGconn * start_screen_connection(struct screen_s * screen);
+void poll_screen_connection(PGconn * conn, struct screen_s * screen);
 void close_connections(struct screen_s * screens[], PGconn * conns[]);
 void prepare_query(struct screen_s * screen, char * query);
+int get_query_params(struct screen_s * screen, const char * params[]);
+bool send_context_query(PGconn * conn, struct screen_s * screen, char errmsg[]);
+PGresult * finish_context_query(PGconn * conn, struct screen_s * screen, char errmsg[], bool * canceled);
+void cancel_context_queries(struct screen_s * screens[], PGconn * conns[], unsigned int console_index, bool all);
+int store_screen_result(struct screen_s * screen, PGresult * res);
+void prepare_fleet_query(struct screen_s * screen, char * query);
+PGresult * merge_fleet_results(struct screen_s * screens[], PGconn * conns[], PGresult * results[], unsigned int n);
+PGresult * join_backends_proc(PGresult * res, struct backends_cache_s * cache, bool local);
+int sample_screens(struct screen_s * screens[], PGconn * conns[], unsigned int console_index, char errmsg[]);
+void exit_on_hangup(short revents);
+bool wait_for_input(PGconn * conn, int timeout_ms);
+void cancel_query(PGconn * conn);
+PGresult * get_query_result(PGconn * conn, char errmsg[]);
+void get_query_error(PGresult * res, char errmsg[]);
+PGresult * wait_query_result(PGconn * conn, char errmsg[], bool * canceled);
 PGresult * do_query(PGconn * conn, const char * query, char errmsg[]);
 
 /* system resources functions */
 void get_time(char * strtime);
+double get_monotonic_time(void);
+char * read_proc_file(enum proc_file file);
+char * next_proc_line(char ** pos);
+unsigned long long scan_proc_number(char ** pos);
+char * scan_proc_word(char ** pos, char delim, unsigned int * len);
+void scan_proc_cpu(char ** pos, struct cpu_s * cpu);
+unsigned int count_proc_lines(enum proc_file file);
+struct backend_proc_s * get_backend_proc(struct backends_cache_s * cache, int pid);
+void release_backends_proc(struct backends_cache_s * cache);
+int read_backend_file(struct backend_proc_s * bp, int * fd, const char * name);
+bool read_backend_stat(struct backend_proc_s * bp, struct backend_stat_s * st);
 float * get_loadavg();
 void print_loadavg(WINDOW * window);
 void init_stats(struct cpu_s *st_cpu[], struct mem_s **st_mem_short);
@@ -923,42 +1553,109 @@ double ll_sp_value(unsigned long long value1, unsigned long long value2,
         unsigned long long itv);
 void write_cpu_stat_raw(WINDOW * window, struct cpu_s *st_cpu[],
         unsigned int curr, unsigned long long itv);
+void read_mem_stat(struct mem_s *st_mem_short);
+void write_mem_stat(WINDOW * window, struct mem_s *st_mem_short);
+bool read_diskstats(struct iodata_s *c_ios[], unsigned int bdev, unsigned int * ndev);
+bool read_netdev(struct nicdata_s *c_nicd[], unsigned int idev, unsigned int * ndev);
+void get_iostat_values(struct iodata_s * c, struct iodata_s * p, unsigned long long itv, double * values);
+void format_iostat_row(char * buf, size_t len, const char * devname, const double * values);
 void print_iostat(WINDOW * window, WINDOW * w_cmd, struct iodata_s *c_ios[],
         struct iodata_s *p_ios[], unsigned int bdev, bool * repaint);
+void get_nicstat_values(struct nicdata_s * c, struct nicdata_s * p, unsigned long long itv, double * values);
+void format_nicstat_row(char * buf, size_t len, const char * ifname, const double * values);
+double get_cpustat_values(struct cpu_s * c, struct cpu_s * p, double * values);
+int cpustat_cmp_desc(const void * a, const void * b);
+void print_cpustat(WINDOW * window, struct cpu_s * c_cpus, struct cpu_s * p_cpus, unsigned int ncpu);
+void get_cgroup_path(PGconn * conn, char * path, size_t len);
+bool open_cgroup(const char * path);
+unsigned long long read_cgroup_pressure(enum proc_file file, unsigned long long * full);
+void read_cgroup_stat(struct cgroup_stat_s * st);
+void print_cgroup_usage(WINDOW * window);
+unsigned int read_cgroup_io(struct cgroup_io_s ** io, unsigned int * size);
+void print_cgroup_iostat(WINDOW * window, struct iodata_s * c_ios[], unsigned int bdev);
 void get_speed_duplex(struct nicdata_s * nicdata);
 
 /* print screen functions */
 void print_title(WINDOW * window);
 void print_cpu_usage(WINDOW * window, struct cpu_s *st_cpu[]);
 void print_conninfo(WINDOW * window, PGconn *conn, unsigned int console_no);
-void print_pg_general(WINDOW * window, struct screen_s * screen, PGconn * conn);
-void print_postgres_activity(WINDOW * window, struct screen_s * screen, PGconn * conn);
-void print_vacuum_info(WINDOW * window, struct screen_s * screen, PGconn * conn);
-void print_pgss_info(WINDOW * window, PGconn * conn, unsigned long interval);
-void print_data(WINDOW *window, PGresult *res, char ***arr, 
-        unsigned int n_rows, unsigned int n_cols, struct screen_s * screen);
+bool get_pg_stats(PGconn * conn, struct screen_s * screen, struct pg_stat_s * stats);
+void print_pg_general(WINDOW * window, struct screen_s * screen, struct pg_stat_s * stats);
+void print_postgres_activity(WINDOW * window, struct pg_stat_s * stats);
+void print_vacuum_info(WINDOW * window, struct screen_s * screen, struct pg_stat_s * stats);
+void print_pgss_info(WINDOW * window, struct pg_stat_s * stats);
+void print_data(WINDOW *window, struct snapshot_s * snap, struct screen_s * screen);
+void init_sink(struct sink_s * sink, enum sink_type type, WINDOW * window, const char * path);
+void write_sink(struct sink_s * sink, const char * data, size_t len);
+void flush_sink(struct sink_s * sink);
+void sink_append(struct sink_s * sink, const char * str, size_t len);
+void sink_append_csv(struct sink_s * sink, const char * value);
+void sink_append_json(struct sink_s * sink, const char * value);
+void write_sink_snapshot(struct sink_s * sink, struct snapshot_s * snap, struct screen_s * screen,
+        enum context context, time_t t);
 void print_log(WINDOW * window, WINDOW * w_cmd, struct screen_s * screen, PGconn * conn);
 
 /* data arrays functions */
-char *** init_array(char ***arr, unsigned int n_rows, unsigned int n_cols);
-char *** free_array(char ***arr, unsigned int n_rows, unsigned int n_cols);
+struct snapshot_s * init_snapshot(void);
+void reserve_snapshot(struct snapshot_s * snap, unsigned int n_rows, unsigned int n_cols, size_t data_len);
+void free_snapshot(struct snapshot_s * snap);
+void set_snapshot_column(struct snapshot_s * snap, unsigned int col, const char * name, enum col_type type);
+void add_snapshot_text(struct snapshot_s * snap, unsigned int row, unsigned int col,
+        const char * value, unsigned int len);
+long long decode_int(const char * value, unsigned int len);
+double decode_float(const char * value, unsigned int len);
+long long decode_numeric_int(const char * value, unsigned int len);
+unsigned int decode_numeric(const char * value, unsigned int len, char * buf, unsigned int size);
+void add_snapshot_binary(struct snapshot_s * snap, unsigned int row, unsigned int col,
+        Oid type, const char * value, unsigned int len);
+void add_snapshot_value(struct snapshot_s * snap, unsigned int row, unsigned int col,
+        const char * value, unsigned int len);
+const char * get_snapshot_value(struct snapshot_s * snap, unsigned int row, unsigned int col,
+        char * buf, size_t len);
+long long parse_counter(const char * value);
+unsigned int int_len(long long value);
 int str_cmp_desc(const void * a, const void * b, void * arg);
 int str_cmp_asc(const void * a, const void * b, void * arg);
-int int_cmp_desc(const void * a, const void * b, void * arg);
-int int_cmp_asc(const void * a, const void * b, void * arg);
-void pgrescpy(char ***arr, PGresult *res, unsigned int n_rows, unsigned int n_cols);
-void diff_arrays(char ***p_arr, char ***c_arr, char ***res_arr, struct screen_s * screen, 
-        unsigned int n_rows, unsigned int n_cols, unsigned long interval);
-void sort_array(char ***res_arr, unsigned int n_rows, unsigned int n_cols, struct screen_s * screen);
+int num_cmp_desc(const void * a, const void * b, void * arg);
+int num_cmp_asc(const void * a, const void * b, void * arg);
+void get_diff_opts(struct screen_s * screen, unsigned int * min, unsigned int * max, unsigned int * key);
+unsigned int skip_query_cast(const char * query, unsigned int pos, unsigned int len);
+unsigned int skip_query_list(const char * query, unsigned int pos, unsigned int len, char mark);
+unsigned int normalize_query(char * query, unsigned int len);
+struct query_cache_s * get_query_cache(void);
+struct query_cache_slot_s * find_query_cache_slot(struct query_cache_s * cache, const char * queryid);
+const char * lookup_query_cache(const char * queryid, unsigned int * len);
+void store_query_cache(const char * queryid, char * query, unsigned int len);
+bool fetch_query_texts(PGconn * conn, PGresult * res, char errmsg[], bool * canceled);
+void pgrescpy(struct snapshot_s * snap, PGresult *res, struct screen_s * screen);
+unsigned int hash_snapshot_row(struct snapshot_s * snap, unsigned int row, unsigned int key);
+bool cmp_snapshot_rows(struct snapshot_s * a, unsigned int a_row,
+        struct snapshot_s * b, unsigned int b_row, unsigned int key);
+void build_snapshot_hash(struct snapshot_s * snap, unsigned int key);
+int find_snapshot_row(struct snapshot_s * snap, struct snapshot_s * from, unsigned int row, unsigned int key);
+void calc_rates_scalar(double * rates, const long long * curr, const long long * prev,
+        unsigned int n, double divisor, bool clamp);
+#ifdef __SSE2__
+void calc_rates_sse2(double * rates, const long long * curr, const long long * prev,
+        unsigned int n, double divisor);
+void calc_rates_avx2(double * rates, const long long * curr, const long long * prev,
+        unsigned int n, double divisor);
+#endif
+void calc_rates(double * rates, const long long * curr, const long long * prev,
+        unsigned int n, double divisor, bool clamp);
+bool diff_arrays(struct snapshot_s * p_snap, struct snapshot_s * c_snap);
+void sort_array(struct snapshot_s * snap, struct screen_s * screen);
 
 /* key-press functions */
 unsigned int switch_conn(WINDOW * window, struct screen_s * screens[],
-        unsigned int ch, unsigned int console_index, unsigned int console_no, PGresult * res, bool * first_iter);
+        unsigned int ch, unsigned int console_index, unsigned int console_no);
+unsigned int switch_conn_relative(WINDOW * window, struct screen_s * screens[],
+        unsigned int console_index, bool forward);
 void change_sort_order(struct screen_s * screen, bool increment, bool * first_iter);
 void change_sort_order_direction(struct screen_s * screen, bool * first_iter);
-void change_min_age(WINDOW * window, struct screen_s * screen, PGresult *res, bool *first_iter);
-unsigned int add_connection(WINDOW * window, struct screen_s * screens[],
-        PGconn * conns[], unsigned int console_index);
+void change_min_age(WINDOW * window, struct screen_s * screen, bool *first_iter);
+unsigned int add_connection(WINDOW * window, struct screen_s ** screens[],
+        PGconn ** conns[], unsigned int console_index);
 unsigned int close_connection(WINDOW * window, struct screen_s * screens[],
         PGconn * conns[], unsigned int console_index, bool *first_iter);
 void write_pgcenterrc(WINDOW * window, struct screen_s * screens[], PGconn * conns[], struct args_s * args);
@@ -966,7 +1663,7 @@ void show_config(WINDOW * window, PGconn * conn);
 void reload_conf(WINDOW * window, PGconn * conn);
 void edit_config(WINDOW * window, struct screen_s * screen, PGconn * conn, const char * config_file_guc);
 void edit_config_menu(WINDOW * w_cmd, WINDOW * w_dba, struct screen_s * screen, PGconn * conn, bool *first_iter);
-void pgss_switch(WINDOW * w_cmd, struct screen_s * screen, PGresult * p_res, bool *first_iter);
+void pgss_switch(WINDOW * w_cmd, struct screen_s * screen, bool *first_iter);
 void pgss_menu(WINDOW * w_cmd, WINDOW * w_dba, struct screen_s * screen, bool *first_iter);
 void signal_single_backend(WINDOW * window, struct screen_s *screen, PGconn * conn, bool do_terminate);
 void get_statemask(WINDOW * window, struct screen_s * screen);
@@ -976,13 +1673,14 @@ void start_psql(WINDOW * window, struct screen_s * screen);
 unsigned long change_refresh(WINDOW * window, unsigned long interval);
 void do_noop(WINDOW * window, unsigned long interval);
 void system_view_toggle(WINDOW * window, struct screen_s * screen, bool * first_iter);
+void cgroup_view_toggle(WINDOW * window, struct screen_s * screen);
 void log_process(WINDOW * window, WINDOW ** w_log, struct screen_s * screen, PGconn * conn, unsigned int subscreen);
 void show_full_log(WINDOW * window, struct screen_s * screen, PGconn * conn);
 void get_query_by_id(WINDOW * window, struct screen_s * screen, PGconn * conn);
 void pg_stat_reset(WINDOW * window, PGconn * conn, bool * reseted);
 void switch_context(WINDOW * window, struct screen_s * screen,
-        enum context context, PGresult * res, bool * first_iter);
-void set_filter(WINDOW * win, struct screen_s * screen, PGresult * res, bool * first_iter);
+        enum context context, bool * first_iter);
+void set_filter(WINDOW * win, struct screen_s * screen, bool * first_iter);
 
 /* functions routines */
 bool key_is_pressed(void);
@@ -990,7 +1688,8 @@ void mreport(bool do_exit, enum mtype mtype, const char * msg, ...);
 void strrpl(char * o_string, const char * s_string, const char * r_string, unsigned int buf_size);
 int check_string(const char * string, enum chk_type ctype);
 struct colAttrs * init_colattrs(unsigned int n_cols);
-void calculate_width(struct colAttrs *columns, PGresult *res, struct screen_s * screen, char ***arr, unsigned int n_rows, unsigned int n_cols);
+void calculate_width(struct colAttrs *columns, PGresult *res, struct screen_s * screen,
+        struct snapshot_s * snap, unsigned int n_rows, unsigned int n_cols);
 void cmd_readline(WINDOW *window, const char * msg, unsigned int pos, bool * with_esc, char * str, unsigned int len, bool echoing);
 void clear_screen_connopts(struct screen_s * screens[], unsigned int i);
 void shift_screens(struct screen_s * screens[], PGconn * conns[], unsigned int i);
@@ -998,13 +1697,96 @@ bool check_pg_listen_addr(struct screen_s * screen, PGconn * conn);
 void get_conf_value(PGconn * conn, const char * config_option_name, char * config_option_value);
 void get_pg_special(PGconn * conn, struct screen_s * screen);
 void get_logfile_path(char * path, PGconn * conn);
-void get_pg_uptime(PGconn * conn, char * uptime);
 unsigned int count_block_devices(void);
 unsigned int count_nic_devices(void);
 void replace_iodata(struct iodata_s *curr[], struct iodata_s *prev[], unsigned int bdev);
 void replace_nicdata(struct nicdata_s *curr[], struct nicdata_s *prev[], unsigned int idev);
 ITEM ** init_menuitems(unsigned int n_choices);
 
+/* recording functions */
+void record_reserve(struct record_buf_s * buf, size_t len);
+void record_put_byte(struct record_buf_s * buf, unsigned char value);
+void record_put_fixed(struct record_buf_s * buf, unsigned long long value, unsigned int len);
+void record_put_varint(struct record_buf_s * buf, unsigned long long value);
+void record_put_svarint(struct record_buf_s * buf, long long value);
+void record_put_double(struct record_buf_s * buf, double value);
+void record_put_string(struct record_buf_s * buf, const char * value, unsigned int len);
+void record_put_skip(struct record_buf_s * buf, unsigned int * skip);
+void record_put_deltas(struct record_buf_s * buf, const long long * delta, unsigned int n);
+unsigned long long record_get_fixed(const unsigned char * data, unsigned int len);
+void record_put_cpu(struct record_buf_s * buf, struct cpu_s * c, struct cpu_s * p);
+void record_put_mem(struct record_buf_s * buf, struct mem_s * c, struct mem_s * p);
+void record_put_pgstat(struct record_buf_s * buf, struct pg_stat_s * c, struct pg_stat_s * p);
+void record_put_iostat(struct record_buf_s * buf, struct iodata_s *c_ios[], struct iodata_s *p_ios[],
+        unsigned int bdev, bool names);
+void record_put_nicstat(struct record_buf_s * buf, struct nicdata_s *c_nicd[], struct nicdata_s *p_nicd[],
+        unsigned int idev, bool names);
+void record_put_snapshot(struct record_buf_s * buf, struct snapshot_s * c, struct snapshot_s * p);
+void write_record_index(struct record_s * rec, long long wall, off_t offset);
+void open_record_file(struct record_s * rec, const char * path);
+void init_record(struct record_s * rec, const char * path);
+void sample_record_contexts(struct record_s * rec, struct screen_s * screen, PGconn * conn);
+void sample_record(struct record_s * rec, struct screen_s * screen, PGconn * conn);
+void reset_record_prev(struct record_s * rec);
+void write_record_frame(struct record_s * rec);
+void shift_record_sample(struct record_s * rec);
+void record_stats(struct args_s * args, struct screen_s * screen, PGconn * conn);
+void export_stats(struct args_s * args, struct screen_s * screen, PGconn * conn);
+void add_metrics(struct metrics_buf_s * buf, const char * fmt, ...);
+void add_metrics_label(struct metrics_buf_s * buf, const char * value);
+void render_metrics(struct metrics_buf_s * buf, struct record_s * rec, bool up);
+void publish_metrics(struct metrics_s * m);
+struct metrics_buf_s * take_metrics(struct metrics_s * m);
+int open_metrics_listener(const char * listen_addr);
+void * serve_metrics(void * arg);
+void daemon_stats(struct args_s * args, struct screen_s * screen, PGconn * conn);
+void resize_record_iostats(struct record_s * rec, unsigned int bdev);
+void resize_record_nicdata(struct record_s * rec, unsigned int idev);
+unsigned char record_read_byte(struct record_cursor_s * cur);
+unsigned long long record_read_varint(struct record_cursor_s * cur);
+long long record_read_svarint(struct record_cursor_s * cur);
+double record_read_double(struct record_cursor_s * cur);
+const char * record_read_string(struct record_cursor_s * cur, unsigned int * len);
+void record_read_cpu(struct record_cursor_s * cur, struct cpu_s * c, struct cpu_s * p);
+void record_read_mem(struct record_cursor_s * cur, struct mem_s * c, struct mem_s * p);
+void record_read_pgstat(struct record_cursor_s * cur, struct pg_stat_s * c, struct pg_stat_s * p);
+void record_read_deltas(struct record_cursor_s * cur, long long * delta, unsigned int n);
+void record_read_iostat(struct record_cursor_s * cur, struct record_s * rec);
+void record_read_nicstat(struct record_cursor_s * cur, struct record_s * rec);
+void record_set_value(struct snapshot_s * snap, unsigned int row, unsigned int col,
+        const char * value, unsigned int len);
+void record_copy_value(struct snapshot_s * c, unsigned int row, struct snapshot_s * p,
+        unsigned int p_row, unsigned int col);
+bool record_read_rows(struct record_cursor_s * cur, struct snapshot_s * c, struct snapshot_s * p,
+        const enum col_type * types, unsigned int n_cols, unsigned int n_rows, size_t * data_len);
+bool record_read_snapshot(struct record_cursor_s * cur, struct snapshot_s * c, struct snapshot_s * p);
+bool read_record_frame(struct record_s * rec, const unsigned char * data, size_t len, long long * wall);
+void add_replay_index(struct replay_s * rep, long long wall, off_t offset);
+unsigned int count_replay_index(struct replay_s * rep);
+off_t get_replay_index(struct replay_s * rep, unsigned int i, long long * wall);
+const unsigned char * map_file(const unsigned char * map, size_t len, int fd, size_t size);
+void map_replay_file(struct replay_s * rep);
+void open_replay_file(struct replay_s * rep, const char * path);
+bool read_replay_frame(struct replay_s * rep);
+void seek_replay(struct replay_s * rep, long long target);
+void print_replay_summary(WINDOW * window, struct replay_s * rep, struct screen_s * screen,
+        const char * path, unsigned int speed, bool paused);
+bool parse_record_time(const char * str, long long base, long long * result);
+void goto_replay_time(WINDOW * window, struct replay_s * rep);
+void replay_stats(struct args_s * args, struct screen_s * screen);
+void init_report(struct report_s * report, struct args_s * args);
+void aggregate_report_snapshot(struct report_s * report, struct snapshot_s * c, struct snapshot_s * p);
+void aggregate_report_iostat(struct report_s * report, struct record_s * rec);
+void aggregate_report_nicstat(struct report_s * report, struct record_s * rec);
+void push_report_heap(unsigned int * heap, unsigned int * n, unsigned int limit, unsigned int row,
+        int (*cmp)(const void *, const void *, void *), struct sort_key_s * key);
+unsigned int get_report_orders(struct args_s * args, const char * names[], unsigned int n_names,
+        unsigned int orders[], unsigned int default_order);
+void print_report_title(struct report_s * report, struct args_s * args, const char * order);
+void print_report_snapshot(struct report_s * report, struct args_s * args, struct screen_s * screen);
+void print_report_devices(struct report_s * report, struct args_s * args);
+void report_stats(struct args_s * args, struct screen_s * screen);
+
 /* color functions */
 void init_colors(unsigned int * ws_color, unsigned int * wc_color, unsigned int * wa_color, unsigned int * wl_color);
 void draw_color_help(WINDOW * w, unsigned int * ws_color, unsigned int * wc_color,
@@ -3,22 +3,7 @@
  */
 
 #define PG_GET_QUERYREP_BY_QUERYID_QUERY_P1 \
-    "WITH pg_stat_statements_normalized AS ( \
-        SELECT *, \
-            regexp_replace( \
-            regexp_replace( \
-            regexp_replace( \
-            regexp_replace( \
-            regexp_replace(query, \
-            E'\\\\?(::[a-zA-Z_]+)?( *, *\\\\?(::[a-zA-Z_]+)?)+', '?', 'g'), \
-            E'\\\\$[0-9]+(::[a-zA-Z_]+)?( *, *\\\\$[0-9]+(::[a-zA-Z_]+)?)*', '$N', 'g'), \
-            E'--.*$', '', 'ng'), \
-            E'/\\\\*.*?\\\\*\\/', '', 'g'), \
-            E'\\\\s+', ' ', 'g') \
-            AS query_normalized \
-        FROM pg_stat_statements \
-    ), \
-    totals AS ( \
+    "WITH totals AS ( \
         SELECT  \
             sum(total_time) AS total_time, \
             greatest(sum(blk_read_time+blk_write_time), 1) AS io_time, \
@@ -35,14 +20,14 @@
             sum(total_time) AS total_time, \
             sum(blk_read_time) AS blk_read_time, sum(blk_write_time) AS blk_write_time, \
             sum(calls) AS calls, sum(rows) AS rows \
-        FROM pg_stat_statements_normalized p \
+        FROM pg_stat_statements p \
         JOIN pg_authid a ON a.oid=p.userid \
         JOIN pg_database d ON d.oid=p.dbid \
         WHERE TRUE AND left(md5(d.datname || a.rolname || p.query ), 10) = '"
 
 #define PG_GET_QUERYREP_BY_QUERYID_QUERY_P2 \
     "' \
-        GROUP BY d.datname, a.rolname, query_normalized \
+        GROUP BY d.datname, a.rolname, p.query \
     ), \
     totals_readable AS ( \
         SELECT \